@@ -0,0 +1,115 @@
+#pragma once
+
+#include "PlayerMovement.h"
+
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+
+////////////////////////////////////////////////////////
+// Shared pieces of the headless benchmarks: simulated players,
+// scripted input and a flat floor standing in for physics
+////////////////////////////////////////////////////////
+
+struct SSimulatedPlayer
+{
+	PMoveState state;
+	PMoveVec3 position;
+};
+
+// Deterministic strafe jumping input: hold forward, alternate strafe direction and
+// sweep the view towards it, and keep jump held so every landing bunny hops
+inline Cmd GetScriptedCmd(int player, int tick, PMoveState& state, float dt)
+{
+	const int strafePeriod = 40 + (player % 17);
+	const float strafeSign = ((tick / strafePeriod) & 1) ? 1.f : -1.f;
+
+	Cmd cmd;
+	cmd.sequence = static_cast<uint32_t>(tick) + 1;
+	cmd.forwardMove = (player % 5 == 0) ? 0.f : 1.f;
+	cmd.rightMove = strafeSign;
+	cmd.jump = true;
+
+	state.yaw += strafeSign * 2.5f * dt;
+	state.wishJump = true;
+	cmd.yaw = state.yaw;
+
+	return cmd;
+}
+
+// Minimal stand-in for the character controller: a flat floor at z = 0
+inline void StepWorld(SSimulatedPlayer& player, const PMoveParams& params, float dt)
+{
+	if (player.state.jumped)
+	{
+		player.state.velocity.z += params.jumpImpulse;
+		player.state.jumped = false;
+	}
+
+	player.position = player.position + player.state.velocity * dt;
+
+	player.state.onGround = player.position.z <= 0.f && player.state.velocity.z <= 0.f;
+	if (player.position.z < 0.f)
+	{
+		player.position.z = 0.f;
+	}
+}
+
+inline std::vector<SSimulatedPlayer> CreatePlayers(int playerCount)
+{
+	std::vector<SSimulatedPlayer> players(playerCount);
+	for (int i = 0; i < playerCount; ++i)
+	{
+		players[i].state.yaw = 0.01f * static_cast<float>(i);
+		players[i].state.onGround = true;
+	}
+	return players;
+}
+
+// Sloped ground, planes too steep to stand on and slippery surfaces for the randomized comparisons, a quarter of each
+template<typename TRandom>
+inline void RandomizeGround(PMoveState& state, TRandom& random)
+{
+	std::uniform_real_distribution<float> slope(0.f, 1.2f);
+	std::uniform_real_distribution<float> direction(-3.2f, 3.2f);
+	std::uniform_int_distribution<int> chance(0, 3);
+
+	if (chance(random) == 0)
+	{
+		const float angle = slope(random);
+		const float heading = direction(random);
+		state.groundNormal = PMoveVec3(std::sin(angle) * std::cos(heading), std::sin(angle) * std::sin(heading), std::cos(angle));
+		state.onSteepPlane = !state.onGround && state.groundNormal.z < PMove::MinWalkNormal;
+	}
+	state.surfaceFriction = chance(random) == 0 ? 0.25f : 1.f;
+}
+
+// The ground a state was set up with, as it is handed to CPlayerMovementSystem::SetInput
+inline PMoveGroundContact GetGroundContact(const PMoveState& state)
+{
+	PMoveGroundContact ground;
+	ground.onGround = state.onGround;
+	ground.onSteepPlane = state.onSteepPlane;
+	ground.normal = state.groundNormal;
+	ground.surfaceFriction = state.surfaceFriction;
+	return ground;
+}
+
+// Fold the end positions into a checksum so the work can't be optimized away, and so paths can be compared
+inline double GetChecksum(const std::vector<SSimulatedPlayer>& players)
+{
+	double checksum = 0.0;
+	for (const SSimulatedPlayer& player : players)
+	{
+		checksum += player.position.x + player.position.y + player.position.z;
+	}
+	return checksum;
+}
+
+using Clock = std::chrono::steady_clock;
+
+inline double GetSecondsSince(Clock::time_point start)
+{
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
@@ -0,0 +1,179 @@
+////////////////////////////////////////////////////////
+// Headless command batching benchmark
+// A client sends its newest commands every few ticks over a lossy link,
+// for a range of redundancy settings. Reports packet size, encode/decode
+// cost and how many commands and jump presses never reached the server,
+// and checks that every command that arrived matches what the client
+// predicted with bit for bit, and that a crafted packet can't decode
+// moves beyond full deflection.
+//
+// Build (from the repository root):
+//   g++ -O2 -std=c++17 -I. -IBenchmark Benchmark/CommandBatchBenchmark.cpp PlayerMovement.cpp CommandBatch.cpp -o command_batch_bench
+// Usage:
+//   command_batch_bench [ticks] [loss %] [ticks per packet]
+////////////////////////////////////////////////////////
+
+#include "BenchmarkCommon.h"
+#include "BitStream.h"
+#include "CommandBatch.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+	bool IsSameCmd(const Cmd& a, const Cmd& b)
+	{
+		return a.sequence == b.sequence && a.forwardMove == b.forwardMove && a.rightMove == b.rightMove && a.upMove == b.upMove
+			&& a.yaw == b.yaw && a.pitch == b.pitch && a.jump == b.jump;
+	}
+
+	// One command with every move field at the largest value the wire format holds, which no client quantizes to
+	bool IsCraftedMoveClamped()
+	{
+		uint8_t packet[32];
+		CBitWriter writer(packet, sizeof(packet));
+		writer.WriteBits(0, 32);
+		writer.WriteBits(1, 32);
+		writer.WriteVarUint(1);
+		writer.WriteBool(true);
+		// Change mask with only the move bit set
+		writer.WriteBits(1, 4);
+		for (int i = 0; i < 3; ++i)
+		{
+			writer.WriteBits(255, 8);
+		}
+		writer.Flush();
+
+		SCmdBatch batch;
+		if (!PMoveCmdBatch::Read(packet, writer.GetByteCount(), batch) || batch.cmdCount != 1)
+			return false;
+
+		const Cmd& cmd = batch.cmds[0];
+		return cmd.forwardMove <= 1.f && cmd.rightMove <= 1.f && cmd.upMove <= 1.f;
+	}
+
+	// Small deterministic generator so runs are comparable
+	struct SLossModel
+	{
+		uint32_t state = 12345u;
+		int lossPercent = 0;
+
+		bool IsLost()
+		{
+			state = state * 1664525u + 1013904223u;
+			return static_cast<int>((state >> 16) % 100u) < lossPercent;
+		}
+	};
+}
+
+int main(int argc, char* argv[])
+{
+	const int tickCount = argc > 1 ? std::atoi(argv[1]) : 100000;
+	const int lossPercent = argc > 2 ? std::atoi(argv[2]) : 10;
+	const int ticksPerPacket = argc > 3 ? std::atoi(argv[3]) : 2;
+
+	if (tickCount <= 0 || lossPercent < 0 || lossPercent > 100 || ticksPerPacket <= 0 || ticksPerPacket > static_cast<int>(PMoveCmdBatch::MaxCmds))
+	{
+		std::fprintf(stderr, "usage: %s [ticks] [loss %%] [ticks per packet <= %u]\n", argv[0], PMoveCmdBatch::MaxCmds);
+		return 1;
+	}
+
+	const float tickRate = 64.f;
+	const float dt = 1.f / tickRate;
+	const uint32_t redundancies[] = { 1, 2, 4, 8, 16 };
+
+	std::printf("command batching: %d ticks @ %.0f Hz, one packet every %d ticks (%.0f packets/s), %d%% loss\n",
+		tickCount, tickRate, ticksPerPacket, tickRate / ticksPerPacket, lossPercent);
+
+	int mismatches = 0;
+	for (const uint32_t redundancy : redundancies)
+	{
+		CCmdBatchWriter writer(redundancy);
+		SCmdBatch batch;
+		SLossModel lossModel;
+		lossModel.lossPercent = lossPercent;
+
+		// Which commands reached the server, indexed by sequence
+		std::vector<bool> isReceived(tickCount + 1, false);
+		std::vector<Cmd> sentCmds(tickCount + 1);
+
+		PMoveState state;
+		std::vector<uint8_t> packet(512);
+		size_t totalBytes = 0;
+		int packetCount = 0;
+		double encodeSeconds = 0.0;
+		double decodeSeconds = 0.0;
+
+		for (int tick = 0; tick < tickCount; ++tick)
+		{
+			Cmd cmd = GetScriptedCmd(0, tick, state, dt);
+			cmd.pitch = 0.4f * std::sin(tick * dt * 0.7f);
+			// Tapping jump for a few ticks every so often, the presses must not get lost
+			cmd.jump = (tick % 23) < 3;
+			cmd = PMoveCmdBatch::Quantize(cmd);
+			sentCmds[cmd.sequence] = cmd;
+			writer.Push(cmd);
+
+			if ((tick + 1) % ticksPerPacket != 0)
+				continue;
+
+			Clock::time_point start = Clock::now();
+			const size_t size = writer.Write(0, packet.data(), packet.size());
+			encodeSeconds += GetSecondsSince(start);
+			totalBytes += size;
+			++packetCount;
+
+			if (lossModel.IsLost())
+				continue;
+
+			start = Clock::now();
+			const bool isRead = PMoveCmdBatch::Read(packet.data(), size, batch);
+			decodeSeconds += GetSecondsSince(start);
+
+			for (uint32_t i = 0; isRead && i < batch.cmdCount; ++i)
+			{
+				const Cmd& received = batch.cmds[i];
+				if (received.sequence == 0 || received.sequence > static_cast<uint32_t>(tickCount) || !IsSameCmd(received, sentCmds[received.sequence]))
+				{
+					++mismatches;
+					continue;
+				}
+				isReceived[received.sequence] = true;
+			}
+			mismatches += isRead ? 0 : 1;
+		}
+
+		int lostCmds = 0;
+		int jumpPresses = 0;
+		int lostJumpPresses = 0;
+		const int sentCount = packetCount * ticksPerPacket;
+		for (int sequence = 1; sequence <= sentCount; ++sequence)
+		{
+			lostCmds += isReceived[sequence] ? 0 : 1;
+
+			const bool isPress = sentCmds[sequence].jump && (sequence == 1 || !sentCmds[sequence - 1].jump);
+			if (isPress)
+			{
+				++jumpPresses;
+				// A press survives if any command of the held stretch arrived, the server sees the edge from there
+				bool hasArrived = false;
+				for (int held = sequence; held <= sentCount && sentCmds[held].jump; ++held)
+				{
+					hasArrived = hasArrived || isReceived[held];
+				}
+				lostJumpPresses += hasArrived ? 0 : 1;
+			}
+		}
+
+		std::printf("  redundancy %2u: %5.1f bytes/packet, %.3f us encode, %.3f us decode, %5.2f%% commands lost, %d of %d jump presses lost\n",
+			redundancy, static_cast<double>(totalBytes) / packetCount, encodeSeconds * 1e6 / packetCount, decodeSeconds * 1e6 / packetCount,
+			100.0 * lostCmds / sentCount, lostJumpPresses, jumpPresses);
+	}
+
+	const bool isClamped = IsCraftedMoveClamped();
+	std::printf("  %d commands differed from what the client predicted with\n", mismatches);
+	std::printf("  crafted move beyond full deflection %s\n", isClamped ? "clamped" : "accepted");
+	return mismatches == 0 && isClamped ? 0 : 1;
+}
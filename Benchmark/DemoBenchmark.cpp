@@ -0,0 +1,161 @@
+////////////////////////////////////////////////////////
+// Headless movement demo benchmark
+// Simulates strafe jumping runs, once without recording and once
+// recording every run into its own demo, and reports what recording
+// costs the simulating thread per tick. Runs go much faster than real
+// time, so whenever half a queue is waiting for the writer thread the
+// simulation pauses, untimed, like a game at 60 Hz never gets that far
+// ahead. The demos are then memory mapped and replayed, every replay has
+// to end bit for bit where its run did, with the throughput in times
+// real time.
+//
+// Build (from the repository root):
+//   g++ -O2 -std=c++17 -pthread -I. -IBenchmark Benchmark/DemoBenchmark.cpp PlayerMovement.cpp MovementDemo.cpp -o demo_bench
+// Usage:
+//   demo_bench [runs] [ticks]
+////////////////////////////////////////////////////////
+
+#include "BenchmarkCommon.h"
+#include "MovementDemo.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	std::string GetDemoFileName(int run)
+	{
+		return "demo_bench_" + std::to_string(run) + ".pmd";
+	}
+
+	// Returns the seconds spent simulating, pWriter records the run when set
+	double SimulateRun(int run, int tickCount, const PMoveParams& params, float dt, SSimulatedPlayer& player, CMovementDemoWriter* pWriter)
+	{
+		double seconds = 0.0;
+		Clock::time_point start = Clock::now();
+		for (int tick = 0; tick < tickCount; ++tick)
+		{
+			if (pWriter != nullptr && tick - pWriter->GetWrittenCount() - pWriter->GetDroppedCount() >= CMovementDemoWriter::QueueCapacity / 2)
+			{
+				seconds += GetSecondsSince(start);
+				while (tick - pWriter->GetWrittenCount() - pWriter->GetDroppedCount() >= CMovementDemoWriter::QueueCapacity / 4)
+				{
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				}
+				start = Clock::now();
+			}
+
+			const Cmd cmd = GetScriptedCmd(run, tick, player.state, dt);
+
+			// What CPlayerMovementSystem::SetInput does before every step
+			player.state.yaw = cmd.yaw;
+			PMove::QueueJump(player.state, params, cmd);
+			if (pWriter != nullptr)
+			{
+				pWriter->Push(cmd, player.state.onGround);
+			}
+
+			player.state = PMove::Move(player.state, params, cmd, dt);
+			StepWorld(player, params, dt);
+		}
+		return seconds + GetSecondsSince(start);
+	}
+
+	bool IsSameBits(const PMoveVec3& a, const PMoveVec3& b)
+	{
+		return std::memcmp(&a, &b, sizeof(PMoveVec3)) == 0;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const int runCount = argc > 1 ? std::atoi(argv[1]) : 1000;
+	const int tickCount = argc > 2 ? std::atoi(argv[2]) : 600;
+
+	if (runCount <= 0 || tickCount <= 0)
+	{
+		std::fprintf(stderr, "usage: %s [runs] [ticks]\n", argv[0]);
+		return 1;
+	}
+
+	const PMoveParams params;
+	const float dt = 1.f / CFixedTimestep::DefaultTickRate;
+	std::printf("demo: %d runs x %d ticks, %zu bytes per tick\n", runCount, tickCount, sizeof(SMovementDemoTick));
+
+	double baselineSeconds = 0.0;
+	for (int run = 0; run < runCount; ++run)
+	{
+		std::vector<SSimulatedPlayer> players = CreatePlayers(1);
+		baselineSeconds += SimulateRun(run, tickCount, params, dt, players[0], nullptr);
+	}
+
+	// Recorded runs, kept to compare the replays against
+	std::vector<SSimulatedPlayer> endPlayers;
+	std::vector<bool> isRunComplete;
+	double recordSeconds = 0.0;
+	CMovementDemoWriter writer;
+	for (int run = 0; run < runCount; ++run)
+	{
+		std::vector<SSimulatedPlayer> players = CreatePlayers(1);
+		SSimulatedPlayer& player = players[0];
+
+		SMovementDemoFileHeader header;
+		std::snprintf(header.ruleset, sizeof(header.ruleset), "q3");
+		header.params = params;
+		header.startPosition = player.position;
+		header.startVelocity = player.state.velocity;
+		header.startFlags = player.state.onGround ? eMovementDemoFlag_OnGround : 0;
+
+		if (!writer.Start(GetDemoFileName(run).c_str(), header))
+		{
+			std::fprintf(stderr, "can't create %s\n", GetDemoFileName(run).c_str());
+			return 1;
+		}
+		recordSeconds += SimulateRun(run, tickCount, params, dt, player, &writer);
+		writer.Stop();
+
+		isRunComplete.push_back(writer.GetDroppedCount() == 0 && writer.GetWrittenCount() == static_cast<uint64_t>(tickCount));
+		endPlayers.push_back(player);
+	}
+
+	const double tickTotal = static_cast<double>(runCount) * tickCount;
+	std::printf("  %-10s %8.2f ns/tick\n", "simulate", baselineSeconds * 1e9 / tickTotal);
+	std::printf("  %-10s %8.2f ns/tick, %+7.2f ns/tick on the game thread\n", "record", recordSeconds * 1e9 / tickTotal, (recordSeconds - baselineSeconds) * 1e9 / tickTotal);
+
+	// Replays, as a corpus run after a kernel change would
+	double replaySeconds = 0.0;
+	uint32_t jumpCount = 0;
+	int errors = 0;
+	for (int run = 0; run < runCount; ++run)
+	{
+		const std::string fileName = GetDemoFileName(run);
+		CMovementDemoReader demo;
+		if (!demo.Open(fileName.c_str()))
+		{
+			++errors;
+			std::remove(fileName.c_str());
+			continue;
+		}
+
+		const Clock::time_point start = Clock::now();
+		const SMovementDemoReplay replay = PMoveDemo::Replay(demo);
+		replaySeconds += GetSecondsSince(start);
+
+		jumpCount += replay.jumpCount;
+		const SSimulatedPlayer& recorded = endPlayers[run];
+		const bool isExact = isRunComplete[run] && replay.tickCount == static_cast<uint32_t>(tickCount) && replay.groundMismatchCount == 0
+			&& IsSameBits(replay.position, recorded.position) && IsSameBits(replay.state.velocity, recorded.state.velocity);
+		errors += isExact ? 0 : 1;
+
+		demo.Close();
+		std::remove(fileName.c_str());
+	}
+
+	std::printf("  %-10s %8.2f ns/tick, %.0f times real time, %u jumps\n", "replay", replaySeconds * 1e9 / tickTotal, tickTotal * dt / replaySeconds, jumpCount);
+	std::printf("  %d of %d runs dropped ticks or didn't replay exactly\n", errors, runCount);
+	return errors == 0 ? 0 : 1;
+}
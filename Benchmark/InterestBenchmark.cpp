@@ -0,0 +1,267 @@
+////////////////////////////////////////////////////////
+// Headless interest management benchmark
+// Spreads strafe jumping players over a map that grows with the player
+// count, so the density around each player stays the same, and sends
+// every client a snapshot per tick twice: once with every player, and
+// once with the players CInterestManager picks for it. Acks come back a
+// round trip later and some packets are dropped. Reports bytes per client
+// and the server's cost per snapshot for each player count, and fails if
+// a client decodes a player differently from the server, misses its own
+// or a nearby player, or is sent one beyond the cull radius.
+//
+// Build (from the repository root):
+//   g++ -O2 -std=c++17 -I. -IBenchmark Benchmark/InterestBenchmark.cpp PlayerMovement.cpp MovementSnapshot.cpp InterestManager.cpp -o interest_bench
+// Usage:
+//   interest_bench [max players] [ticks] [square meters per player]
+////////////////////////////////////////////////////////
+
+#include "BenchmarkCommon.h"
+#include "InterestManager.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace
+{
+	const float TickRate = 64.f;
+	const uint32_t LatencyTicks = 6;
+	const uint32_t LossPercent = 5;
+
+	struct SClient
+	{
+		CSnapshotDecoder decoder;
+		// Newest decoded snapshot at each tick, the server sees it a round trip later
+		CSequenceRing<uint32_t, 64> ackHistory;
+		uint32_t ackedSequence = 0;
+	};
+
+	struct SResult
+	{
+		double fullBytes = 0.0;
+		double interestBytes = 0.0;
+		double fullSeconds = 0.0;
+		double interestSeconds = 0.0;
+		double candidates = 0.0;
+		double sent = 0.0;
+		uint32_t mismatches = 0;
+		uint32_t missingNear = 0;
+		uint32_t culledSent = 0;
+	};
+
+	void WrapPosition(float& value, float size)
+	{
+		if (value >= size)
+			value -= size;
+		else if (value < 0.f)
+			value += size;
+	}
+
+	bool IsEqual(const SSnapshotPlayer& a, const SSnapshotPlayer& b)
+	{
+		return a.id == b.id
+			&& a.position.x == b.position.x && a.position.y == b.position.y && a.position.z == b.position.z
+			&& a.velocity.x == b.velocity.x && a.velocity.y == b.velocity.y && a.velocity.z == b.velocity.z
+			&& a.yaw == b.yaw && a.pitch == b.pitch
+			&& a.onGround == b.onGround && a.wishJump == b.wishJump && a.jumpHeld == b.jumpHeld;
+	}
+
+	void Receive(SClient& client, const uint8_t* pPacket, size_t size, uint32_t tick, uint32_t clientIndex)
+	{
+		const bool isLost = (tick * 7919u + clientIndex * 104729u) % 100u < LossPercent;
+		if (!isLost && size > 0)
+		{
+			client.decoder.Read(pPacket, size);
+		}
+		client.ackHistory.Insert(tick) = client.decoder.GetSequence();
+	}
+
+	void UpdateAck(SClient& client, uint32_t tick)
+	{
+		if (tick <= LatencyTicks)
+			return;
+		if (const uint32_t* pAck = client.ackHistory.Find(tick - LatencyTicks - 1))
+		{
+			client.ackedSequence = *pAck;
+		}
+	}
+
+	SResult Run(int playerCount, int tickCount, float areaPerPlayer)
+	{
+		const float dt = 1.f / TickRate;
+		// Physics is handed kernel velocities scaled by the tick interval, so that is also the size of a kernel unit in meters
+		const float metersPerUnit = dt;
+		const float mapSize = std::sqrt(areaPerPlayer * static_cast<float>(playerCount));
+
+		const PMoveParams params;
+		const SSnapshotConfig snapshotConfig;
+		const SInterestConfig interestConfig;
+		CSnapshotEncoder encoder(snapshotConfig);
+		CInterestManager interest(interestConfig);
+
+		std::vector<SSimulatedPlayer> players = CreatePlayers(playerCount);
+		std::mt19937 random(1234u + static_cast<uint32_t>(playerCount));
+		std::uniform_real_distribution<float> coordinate(0.f, mapSize / metersPerUnit);
+		for (SSimulatedPlayer& player : players)
+		{
+			player.position = PMoveVec3(coordinate(random), coordinate(random), 0.f);
+		}
+
+		std::vector<SClient> fullClients(playerCount);
+		std::vector<SClient> interestClients(playerCount);
+		std::vector<SSnapshotPlayer> expected(playerCount);
+		std::vector<uint8_t> packet(4096);
+		SResult result;
+
+		for (int tick = 0; tick < tickCount; ++tick)
+		{
+			for (int i = 0; i < playerCount; ++i)
+			{
+				SSimulatedPlayer& player = players[i];
+				const Cmd cmd = GetScriptedCmd(i, tick, player.state, dt);
+				PMove::QueueJump(player.state, params, cmd);
+				player.state = PMove::Move(player.state, params, cmd, dt);
+				StepWorld(player, params, dt);
+				WrapPosition(player.position.x, mapSize / metersPerUnit);
+				WrapPosition(player.position.y, mapSize / metersPerUnit);
+			}
+
+			const uint32_t sequence = static_cast<uint32_t>(tick) + 1;
+			const float pitch = 0.3f * std::sin(tick * dt);
+
+			Clock::time_point start = Clock::now();
+			encoder.BeginSnapshot(sequence);
+			for (int i = 0; i < playerCount; ++i)
+			{
+				SSnapshotPlayer snapshotPlayer;
+				snapshotPlayer.id = static_cast<uint16_t>(i);
+				snapshotPlayer.position = players[i].position * metersPerUnit;
+				snapshotPlayer.velocity = players[i].state.velocity;
+				snapshotPlayer.yaw = players[i].state.yaw;
+				snapshotPlayer.pitch = pitch;
+				snapshotPlayer.onGround = players[i].state.onGround;
+				snapshotPlayer.wishJump = players[i].state.wishJump;
+				snapshotPlayer.jumpHeld = players[i].state.jumpHeld;
+				encoder.AddPlayer(snapshotPlayer);
+				expected[i] = PMoveSnapshot::Dequantize(snapshotConfig, PMoveSnapshot::Quantize(snapshotConfig, snapshotPlayer));
+			}
+			encoder.EndSnapshot();
+			const double quantizeSeconds = GetSecondsSince(start);
+
+			// Everyone to everyone, as before
+			start = Clock::now();
+			for (int c = 0; c < playerCount; ++c)
+			{
+				SClient& client = fullClients[c];
+				UpdateAck(client, static_cast<uint32_t>(tick));
+				const size_t size = encoder.Write(client.ackedSequence, packet.data(), packet.size());
+				result.fullBytes += static_cast<double>(size);
+				Receive(client, packet.data(), size, static_cast<uint32_t>(tick), static_cast<uint32_t>(c));
+			}
+			result.fullSeconds += GetSecondsSince(start) + quantizeSeconds;
+
+			start = Clock::now();
+			interest.BeginTick();
+			for (int i = 0; i < playerCount; ++i)
+			{
+				interest.AddPlayer(static_cast<uint16_t>(i), expected[i].position, players[i].state.yaw, pitch);
+			}
+			interest.EndTick();
+			double interestSeconds = GetSecondsSince(start) + quantizeSeconds;
+
+			for (int c = 0; c < playerCount; ++c)
+			{
+				SClient& client = interestClients[c];
+				UpdateAck(client, static_cast<uint32_t>(tick));
+
+				start = Clock::now();
+				const size_t size = interest.WriteSnapshot(static_cast<uint16_t>(c), encoder, client.ackedSequence, packet.data(), packet.size());
+				interestSeconds += GetSecondsSince(start);
+
+				result.interestBytes += static_cast<double>(size);
+				result.candidates += interest.GetCandidateCount();
+				result.sent += interest.GetSentCount();
+
+				const uint32_t decodedSequence = client.decoder.GetSequence();
+				Receive(client, packet.data(), size, static_cast<uint32_t>(tick), static_cast<uint32_t>(c));
+				if (client.decoder.GetSequence() == decodedSequence)
+					continue;
+
+				bool hasSelf = false;
+				for (uint32_t p = 0; p < client.decoder.GetPlayerCount(); ++p)
+				{
+					const SSnapshotPlayer decoded = client.decoder.GetPlayer(p);
+					if (decoded.id >= expected.size() || !IsEqual(decoded, expected[decoded.id]))
+					{
+						++result.mismatches;
+						continue;
+					}
+
+					const PMoveVec3 offset = expected[decoded.id].position - expected[c].position;
+					result.culledSent += offset.Dot(offset) > interestConfig.cullRadius * interestConfig.cullRadius ? 1 : 0;
+					hasSelf = hasSelf || decoded.id == c;
+				}
+				result.missingNear += hasSelf ? 0 : 1;
+
+				// Close players are due every snapshot, the default budget always fits them
+				for (int p = 0; p < playerCount; ++p)
+				{
+					const PMoveVec3 offset = expected[p].position - expected[c].position;
+					SSnapshotPlayer decoded;
+					if (p != c && offset.Dot(offset) <= interestConfig.nearRadius * interestConfig.nearRadius && !client.decoder.FindPlayer(static_cast<uint16_t>(p), decoded))
+					{
+						++result.missingNear;
+					}
+				}
+			}
+			result.interestSeconds += interestSeconds;
+		}
+
+		const double packetCount = static_cast<double>(tickCount) * playerCount;
+		result.fullBytes /= packetCount;
+		result.interestBytes /= packetCount;
+		result.candidates /= packetCount;
+		result.sent /= packetCount;
+		result.fullSeconds /= tickCount;
+		result.interestSeconds /= tickCount;
+		return result;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const int maxPlayerCount = argc > 1 ? std::atoi(argv[1]) : static_cast<int>(PMoveSnapshot::MaxPlayers);
+	const int tickCount = argc > 2 ? std::atoi(argv[2]) : 2000;
+	const float areaPerPlayer = argc > 3 ? static_cast<float>(std::atof(argv[3])) : 1500.f;
+
+	if (maxPlayerCount < 2 || maxPlayerCount > static_cast<int>(PMoveSnapshot::MaxPlayers) || tickCount <= 0 || areaPerPlayer <= 0.f)
+	{
+		std::fprintf(stderr, "usage: %s [max players 2..%u] [ticks] [square meters per player]\n", argv[0], PMoveSnapshot::MaxPlayers);
+		return 1;
+	}
+
+	const SInterestConfig config;
+	std::printf("interest: %d ticks @ %.0f Hz, %.0f m^2 per player, %u ticks latency, %u%% loss\n", tickCount, TickRate, areaPerPlayer, LatencyTicks, LossPercent);
+	std::printf("  near %.0f m, cull %.0f m, %u bytes budget\n", config.nearRadius, config.cullRadius, config.budgetBytes);
+	std::printf("  players | all players: bytes/client  us/snapshot | interest: bytes/client  us/snapshot  in range  sent\n");
+
+	uint32_t failures = 0;
+	for (int playerCount = 16; ; playerCount *= 2)
+	{
+		playerCount = playerCount > maxPlayerCount ? maxPlayerCount : playerCount;
+		const SResult result = Run(playerCount, tickCount, areaPerPlayer);
+		std::printf("  %7d | %25.1f %12.1f | %22.1f %12.1f %9.1f %5.1f\n", playerCount,
+			result.fullBytes, result.fullSeconds * 1e6, result.interestBytes, result.interestSeconds * 1e6, result.candidates, result.sent);
+		if (result.mismatches + result.missingNear + result.culledSent > 0)
+		{
+			std::printf("    %u players decoded differently, %u own or near players missing, %u players sent beyond the cull radius\n",
+				result.mismatches, result.missingNear, result.culledSent);
+			++failures;
+		}
+		if (playerCount == maxPlayerCount)
+			break;
+	}
+
+	return failures == 0 ? 0 : 1;
+}
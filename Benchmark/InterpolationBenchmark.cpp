@@ -0,0 +1,249 @@
+////////////////////////////////////////////////////////
+// Headless remote player interpolation benchmark
+// A strafe jumping player is sent at a fixed snapshot rate over a link
+// with latency, jitter and loss, and drawn at a high frame rate through
+// CRemotePlayerInterpolator. Reports how far the drawn position is from
+// where the player really was at the rendered time, for linear and
+// Hermite interpolation, along with the adapted render delay. Finally a
+// producer thread pushes snapshots at 2 kHz while a consumer samples
+// nonstop, and fails if more than 1% are dropped or a sample leaves the
+// player's path.
+//
+// Build (from the repository root):
+//   g++ -O2 -std=c++17 -pthread -I. -IBenchmark Benchmark/InterpolationBenchmark.cpp PlayerMovement.cpp RemotePlayerInterpolation.cpp -o interpolation_bench
+// Usage:
+//   interpolation_bench [ticks per snapshot] [loss %] [render Hz]
+////////////////////////////////////////////////////////
+
+#include "BenchmarkCommon.h"
+#include "RemotePlayerInterpolation.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	const float TickRate = 60.f;
+	const float TickInterval = 1.f / TickRate;
+	// Physics is handed kernel velocities scaled by the tick interval, so that is also the size of a kernel unit in meters
+	const float MetersPerUnit = TickInterval;
+
+	struct SPacket
+	{
+		double arrivalTime;
+		SInterpolationSample sample;
+	};
+
+	struct SResult
+	{
+		double meanError = 0.0;
+		double maxError = 0.0;
+		double meanDelay = 0.0;
+		double jitter = 0.0;
+		double extrapolatedShare = 0.0;
+		bool isFinite = true;
+	};
+
+	uint32_t NextRandom(uint32_t& state)
+	{
+		state = state * 1664525u + 1013904223u;
+		return state >> 8;
+	}
+
+	// The simulation moves in straight lines between ticks, so that's the truth in between
+	PMoveVec3 GetTruePosition(const std::vector<PMoveVec3>& positions, double time)
+	{
+		const double tick = time / TickInterval;
+		if (tick <= 0.0)
+			return positions.front();
+		const size_t index = static_cast<size_t>(tick);
+		if (index + 1 >= positions.size())
+			return positions.back();
+		const float alpha = static_cast<float>(tick - index);
+		return positions[index] + (positions[index + 1] - positions[index]) * alpha;
+	}
+
+	SResult Run(const std::vector<PMoveVec3>& positions, const std::vector<SInterpolationSample>& snapshots, float jitterSeconds, int lossPercent, float renderRate, bool useHermite)
+	{
+		const double latency = 0.06;
+
+		// Network: every snapshot gets its own latency, some are lost and some overtake each other
+		uint32_t random = 7;
+		std::vector<SPacket> packets;
+		for (const SInterpolationSample& snapshot : snapshots)
+		{
+			if (static_cast<int>(NextRandom(random) % 100u) < lossPercent)
+				continue;
+
+			SPacket packet;
+			packet.sample = snapshot;
+			packet.arrivalTime = snapshot.serverTime + latency + jitterSeconds * (NextRandom(random) % 1000u) / 1000.0;
+			packet.sample.arrivalTime = packet.arrivalTime;
+			packets.push_back(packet);
+		}
+		std::sort(packets.begin(), packets.end(), [](const SPacket& a, const SPacket& b) { return a.arrivalTime < b.arrivalTime; });
+
+		SInterpolationConfig config;
+		config.useHermite = useHermite;
+		config.velocityScale = MetersPerUnit;
+		CRemotePlayerInterpolator interpolator(config);
+
+		SResult result;
+		size_t nextPacket = 0;
+		int frameCount = 0;
+		const double endTime = snapshots.back().serverTime;
+		for (double localTime = 1.0; localTime < endTime; localTime += 1.0 / renderRate)
+		{
+			while (nextPacket < packets.size() && packets[nextPacket].arrivalTime <= localTime)
+			{
+				interpolator.Push(packets[nextPacket++].sample);
+			}
+
+			SInterpolationSample sample;
+			if (!interpolator.Sample(localTime, sample))
+				continue;
+
+			const PMoveVec3 error = sample.position - GetTruePosition(positions, sample.serverTime);
+			const double distance = error.GetLength();
+			result.isFinite = result.isFinite && distance == distance;
+			result.meanError += distance;
+			result.maxError = std::max(result.maxError, distance);
+			result.meanDelay += localTime - sample.serverTime;
+			++frameCount;
+		}
+
+		result.meanError /= frameCount;
+		result.meanDelay /= frameCount;
+		result.jitter = interpolator.GetJitter();
+		result.extrapolatedShare = static_cast<double>(interpolator.GetExtrapolatedCount()) / frameCount;
+		return result;
+	}
+
+	// Far above any real snapshot rate, so the consumer is kept busy, but paced so a consumer that keeps up never overflows the buffer
+	const double ThreadedSnapshotInterval = 0.0005;
+	// Share of pushes that may find the buffer full, for the odd scheduler hiccup longer than a buffer's worth of snapshots
+	const double MaxThreadedDropShare = 0.01;
+
+	// Producer and consumer threads at once on one clock, the player moves in a straight line at constant speed, which
+	// Hermite interpolation and extrapolation both reproduce exactly. The consumer must only ever see time moving forward
+	// and positions on that line, and the producer must rarely find the buffer full.
+	bool RunThreaded(int sampleCount)
+	{
+		const float speed = 3.f;
+		const double delay = 0.05;
+		CRemotePlayerInterpolator interpolator;
+		std::atomic<bool> isDone{ false };
+		int droppedCount = 0;
+
+		const Clock::time_point start = Clock::now();
+		std::thread producer([&interpolator, &isDone, &droppedCount, &start, sampleCount, speed, delay]()
+		{
+			for (int i = 1; i <= sampleCount; ++i)
+			{
+				const double serverTime = i * ThreadedSnapshotInterval;
+				while (GetSecondsSince(start) < serverTime)
+				{
+					std::this_thread::yield();
+				}
+
+				SInterpolationSample sample;
+				sample.serverTime = serverTime;
+				sample.arrivalTime = serverTime + delay;
+				sample.position = PMoveVec3(speed * static_cast<float>(serverTime), 0.f, 0.f);
+				sample.velocity = PMoveVec3(speed, 0.f, 0.f);
+				droppedCount += interpolator.Push(sample) ? 0 : 1;
+			}
+			isDone = true;
+		});
+
+		int sampleCalls = 0;
+		int backwardsCount = 0;
+		int offLineCount = 0;
+		double lastServerTime = -1.0;
+		double consumerSeconds = 0.0;
+		while (!isDone.load())
+		{
+			SInterpolationSample sample;
+			const Clock::time_point sampleStart = Clock::now();
+			const bool hasSample = interpolator.Sample(GetSecondsSince(start) + delay, sample);
+			consumerSeconds += GetSecondsSince(sampleStart);
+			++sampleCalls;
+			if (hasSample)
+			{
+				backwardsCount += sample.serverTime < lastServerTime ? 1 : 0;
+				lastServerTime = sample.serverTime;
+				offLineCount += std::abs(sample.position.x - speed * static_cast<float>(sample.serverTime)) > 1e-3f || sample.position.y != 0.f ? 1 : 0;
+			}
+			std::this_thread::yield();
+		}
+		producer.join();
+
+		const double dropShare = static_cast<double>(droppedCount) / sampleCount;
+		std::printf("  threaded: %d pushed at %.0f Hz, %d dropped (%.2f%%, at most %.0f%%), %d samples at %.0f ns each, time went backwards %d times, %d samples off the path\n",
+			sampleCount, 1.0 / ThreadedSnapshotInterval, droppedCount, dropShare * 100.0, MaxThreadedDropShare * 100.0, sampleCalls, consumerSeconds * 1e9 / sampleCalls, backwardsCount, offLineCount);
+		return backwardsCount == 0 && offLineCount == 0 && dropShare <= MaxThreadedDropShare;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const int ticksPerSnapshot = argc > 1 ? std::atoi(argv[1]) : 3;
+	const int lossPercent = argc > 2 ? std::atoi(argv[2]) : 5;
+	const float renderRate = argc > 3 ? static_cast<float>(std::atof(argv[3])) : 144.f;
+
+	if (ticksPerSnapshot <= 0 || lossPercent < 0 || lossPercent >= 100 || renderRate <= 0.f)
+	{
+		std::fprintf(stderr, "usage: %s [ticks per snapshot] [loss %%] [render Hz]\n", argv[0]);
+		return 1;
+	}
+
+	// One minute of strafe jumping, positions in meters like the entity
+	const int tickCount = static_cast<int>(TickRate) * 60;
+	const PMoveParams params;
+	std::vector<SSimulatedPlayer> players = CreatePlayers(1);
+	std::vector<PMoveVec3> positions;
+	std::vector<SInterpolationSample> snapshots;
+	for (int tick = 0; tick <= tickCount; ++tick)
+	{
+		SSimulatedPlayer& player = players[0];
+		positions.push_back(player.position * MetersPerUnit);
+		if (tick % ticksPerSnapshot == 0)
+		{
+			SInterpolationSample snapshot;
+			snapshot.serverTime = tick * TickInterval;
+			snapshot.position = player.position * MetersPerUnit;
+			snapshot.velocity = player.state.velocity;
+			snapshot.yaw = player.state.yaw;
+			snapshot.onGround = player.state.onGround;
+			snapshots.push_back(snapshot);
+		}
+
+		const Cmd cmd = GetScriptedCmd(1, tick, player.state, TickInterval);
+		PMove::QueueJump(player.state, params, cmd);
+		player.state = PMove::Move(player.state, params, cmd, TickInterval);
+		StepWorld(player, params, TickInterval);
+	}
+
+	std::printf("interpolation: snapshots at %.0f Hz, rendered at %.0f Hz, 60 ms latency, %d%% loss\n", TickRate / ticksPerSnapshot, renderRate, lossPercent);
+
+	bool isValid = true;
+	const float jitters[] = { 0.f, 0.01f, 0.03f, 0.08f };
+	for (const float jitter : jitters)
+	{
+		for (const bool useHermite : { false, true })
+		{
+			const SResult result = Run(positions, snapshots, jitter, lossPercent, renderRate, useHermite);
+			std::printf("  jitter %3.0f ms %-7s: error mean %5.2f cm max %6.2f cm, delay %5.1f ms (jitter estimate %4.1f ms), %4.1f%% frames extrapolated\n",
+				jitter * 1e3f, useHermite ? "hermite" : "linear", result.meanError * 100.0, result.maxError * 100.0,
+				result.meanDelay * 1e3, result.jitter * 1e3, result.extrapolatedShare * 100.0);
+			isValid = isValid && result.isFinite;
+		}
+	}
+
+	isValid = RunThreaded(8000) && isValid;
+	return isValid ? 0 : 1;
+}
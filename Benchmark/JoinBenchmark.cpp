@@ -0,0 +1,213 @@
+////////////////////////////////////////////////////////
+// Headless join fan-out benchmark
+// A full server reconnects after a map change: every client becomes
+// ready for gameplay at some tick within a window. Counts the messages
+// and bytes needed to tell everyone about everyone, once with one revive
+// message per pair of players and once with CJoinFanOut coalescing all
+// joins of a tick. Also checks that the world state survives encoding.
+//
+// Both schemes are charged MessageOverhead bytes per message for the
+// RMI header and reliable delivery, and EntityIdBytes per entity id.
+// A per-pair revive carries a single player world state, which matches
+// what the old position, rotation and snapshot id parameters held.
+//
+// Build (from the repository root):
+//   g++ -O2 -std=c++17 -I. -IBenchmark Benchmark/JoinBenchmark.cpp PlayerMovement.cpp MovementSnapshot.cpp WorldState.cpp -o join_bench
+// Usage:
+//   join_bench [clients] [join window in ticks]
+////////////////////////////////////////////////////////
+
+#include "BenchmarkCommon.h"
+#include "WorldState.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+	const size_t MessageOverhead = 8;
+	const size_t EntityIdBytes = 2;
+
+	struct SResult
+	{
+		uint64_t messageCount = 0;
+		uint64_t byteCount = 0;
+		double encodeSeconds = 0.0;
+		int mismatches = 0;
+	};
+
+	uint32_t NextRandom(uint32_t& state)
+	{
+		state = state * 1664525u + 1013904223u;
+		return state >> 8;
+	}
+
+	SWorldStatePlayer GetPlayer(uint32_t client)
+	{
+		SWorldStatePlayer player;
+		player.id = static_cast<uint16_t>(client);
+		player.position = PMoveVec3(static_cast<float>(client % 16) * 37.5f - 300.f, static_cast<float>(client / 16) * 41.25f - 150.f, 12.f);
+		player.yaw = static_cast<float>(client) * 0.1f - 3.f;
+		return player;
+	}
+
+	bool IsNear(const SWorldStatePlayer& a, const SWorldStatePlayer& b)
+	{
+		const PMoveVec3 delta = a.position - b.position;
+		return a.id == b.id && delta.GetLength() < 0.01f && std::fabs(std::remainder(a.yaw - b.yaw, 6.2831853f)) < 0.001f;
+	}
+
+	// Old scheme: the joiner is announced to every other client, then every alive player is announced to the joiner
+	SResult RunPerPair(const std::vector<std::vector<uint32_t>>& joinsByTick, uint32_t clientCount)
+	{
+		const SSnapshotConfig config;
+		std::vector<bool> isAlive(clientCount, false);
+		uint8_t buffer[PMoveWorldState::MaxMessageSize];
+		SResult result;
+
+		for (const std::vector<uint32_t>& joins : joinsByTick)
+		{
+			for (const uint32_t joiner : joins)
+			{
+				isAlive[joiner] = true;
+
+				const Clock::time_point start = Clock::now();
+				const SWorldStatePlayer player = GetPlayer(joiner);
+				const size_t size = PMoveWorldState::Write(config, &player, 1, buffer, sizeof(buffer));
+				result.encodeSeconds += GetSecondsSince(start);
+
+				result.messageCount += clientCount - 1;
+				result.byteCount += (clientCount - 1) * (MessageOverhead + EntityIdBytes + size);
+
+				for (uint32_t client = 0; client < clientCount; ++client)
+				{
+					if (client == joiner || !isAlive[client])
+						continue;
+
+					const Clock::time_point existingStart = Clock::now();
+					const SWorldStatePlayer existing = GetPlayer(client);
+					const size_t existingSize = PMoveWorldState::Write(config, &existing, 1, buffer, sizeof(buffer));
+					result.encodeSeconds += GetSecondsSince(existingStart);
+
+					++result.messageCount;
+					result.byteCount += MessageOverhead + EntityIdBytes + existingSize;
+				}
+			}
+		}
+
+		return result;
+	}
+
+	// New scheme: joins of a tick are coalesced, every client gets at most one message per tick
+	SResult RunFanOut(const std::vector<std::vector<uint32_t>>& joinsByTick, uint32_t clientCount)
+	{
+		const SSnapshotConfig config;
+		std::vector<bool> isAlive(clientCount, false);
+		std::vector<bool> hasJoined(clientCount, false);
+		CJoinFanOut fanOut(config);
+		SWorldStatePlayer decoded[PMoveWorldState::MaxPlayers];
+		SResult result;
+
+		for (const std::vector<uint32_t>& joins : joinsByTick)
+		{
+			if (joins.empty())
+				continue;
+
+			for (const uint32_t joiner : joins)
+			{
+				isAlive[joiner] = true;
+				hasJoined[joiner] = true;
+			}
+
+			const Clock::time_point start = Clock::now();
+			fanOut.BeginTick();
+			for (uint32_t client = 0; client < clientCount; ++client)
+			{
+				if (isAlive[client])
+				{
+					fanOut.AddPlayer(GetPlayer(client), hasJoined[client]);
+				}
+			}
+			fanOut.EndTick();
+			result.encodeSeconds += GetSecondsSince(start);
+
+			const uint32_t joinCount = fanOut.GetJoinCount();
+			const uint32_t existingCount = fanOut.GetPlayerCount() - joinCount;
+			result.messageCount += joinCount + existingCount;
+			result.byteCount += joinCount * (MessageOverhead + EntityIdBytes * fanOut.GetPlayerCount() + fanOut.GetJoinerMessageSize());
+			result.byteCount += existingCount * (MessageOverhead + EntityIdBytes * joinCount + fanOut.GetExistingMessageSize());
+
+			// What a joining client decodes has to be everyone alive, in order
+			uint32_t playerCount = 0;
+			if (!PMoveWorldState::Read(config, fanOut.GetJoinerMessage(), fanOut.GetJoinerMessageSize(), decoded, playerCount) || playerCount != fanOut.GetPlayerCount())
+			{
+				++result.mismatches;
+			}
+			else
+			{
+				uint32_t index = 0;
+				for (uint32_t client = 0; client < clientCount; ++client)
+				{
+					if (isAlive[client])
+					{
+						result.mismatches += IsNear(decoded[index++], GetPlayer(client)) ? 0 : 1;
+					}
+				}
+			}
+
+			for (const uint32_t joiner : joins)
+			{
+				hasJoined[joiner] = false;
+			}
+		}
+
+		return result;
+	}
+
+	void Print(const char* szName, const SResult& result)
+	{
+		std::printf("  %-22s %7llu messages %9.1f KB, encode %8.1f us\n", szName,
+			static_cast<unsigned long long>(result.messageCount), result.byteCount / 1024.0, result.encodeSeconds * 1e6);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const int clientCount = argc > 1 ? std::atoi(argv[1]) : static_cast<int>(PMoveWorldState::MaxPlayers);
+	const int windowTicks = argc > 2 ? std::atoi(argv[2]) : 10;
+
+	if (clientCount <= 0 || clientCount > static_cast<int>(PMoveWorldState::MaxPlayers) || windowTicks <= 0)
+	{
+		std::fprintf(stderr, "usage: %s [clients <= %u] [join window in ticks]\n", argv[0], PMoveWorldState::MaxPlayers);
+		return 1;
+	}
+
+	int mismatches = 0;
+	std::printf("joins: %d clients become ready\n", clientCount);
+
+	// All at once, the given window and a second's worth, each once
+	std::vector<int> windows = { 1, windowTicks, 60 };
+	std::sort(windows.begin(), windows.end());
+	windows.erase(std::unique(windows.begin(), windows.end()), windows.end());
+	for (const int window : windows)
+	{
+		// Every client becomes ready at a random tick of the window
+		uint32_t random = 11;
+		std::vector<std::vector<uint32_t>> joinsByTick(window);
+		for (int client = 0; client < clientCount; ++client)
+		{
+			joinsByTick[NextRandom(random) % static_cast<uint32_t>(window)].push_back(static_cast<uint32_t>(client));
+		}
+
+		std::printf(" within %d ticks:\n", window);
+		Print("revive per pair", RunPerPair(joinsByTick, static_cast<uint32_t>(clientCount)));
+		const SResult fanOut = RunFanOut(joinsByTick, static_cast<uint32_t>(clientCount));
+		Print("coalesced fan-out", fanOut);
+		mismatches += fanOut.mismatches;
+	}
+
+	std::printf("  %d players decoded away from what was sent\n", mismatches);
+	return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,152 @@
+////////////////////////////////////////////////////////
+// Headless lag compensation history benchmark
+// Records strafe jumping players every tick, skipping some ticks like a
+// server running several ticks per frame, then rewinds to random past
+// times. Reports the memory footprint, the recording cost and the cost of
+// rewinding one or all players, and checks rewound positions against the
+// simulation.
+//
+// Build (from the repository root):
+//   g++ -O2 -std=c++17 -I. -IBenchmark Benchmark/LagCompensationBenchmark.cpp PlayerMovement.cpp LagCompensation.cpp -o lag_compensation_bench
+// Usage:
+//   lag_compensation_bench [players] [ticks] [queries per tick]
+////////////////////////////////////////////////////////
+
+#include "BenchmarkCommon.h"
+#include "LagCompensation.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+namespace
+{
+	// Relative, positions of endless strafe jumping get large
+	bool IsNear(const PMoveVec3& a, const PMoveVec3& b, float tolerance)
+	{
+		const float scale = 1.f + std::fabs(b.x) + std::fabs(b.y) + std::fabs(b.z);
+		return std::fabs(a.x - b.x) <= tolerance * scale && std::fabs(a.y - b.y) <= tolerance * scale && std::fabs(a.z - b.z) <= tolerance * scale;
+	}
+
+	// Every third tick shares a frame with the one before it and isn't recorded
+	bool IsRecordedTick(uint32_t tick)
+	{
+		return tick % 3 != 2;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const int playerCount = argc > 1 ? std::atoi(argv[1]) : static_cast<int>(CLagCompensationHistory::MaxPlayers);
+	const int tickCount = argc > 2 ? std::atoi(argv[2]) : 12800;
+	const int queriesPerTick = argc > 3 ? std::atoi(argv[3]) : 4;
+
+	if (playerCount <= 0 || playerCount > static_cast<int>(CLagCompensationHistory::MaxPlayers) || tickCount <= 0 || queriesPerTick < 0)
+	{
+		std::fprintf(stderr, "usage: %s [players <= %u] [ticks] [queries per tick]\n", argv[0], CLagCompensationHistory::MaxPlayers);
+		return 1;
+	}
+
+	const float tickRate = 128.f;
+	const float dt = 1.f / tickRate;
+	const PMoveParams params;
+
+	std::vector<SSimulatedPlayer> players = CreatePlayers(playerCount);
+	// Ground truth of the last Capacity ticks, indexed like the history
+	std::vector<PMoveVec3> positions(CLagCompensationHistory::Capacity * playerCount);
+
+	// Too large for the stack
+	std::unique_ptr<CLagCompensationHistory> pHistory(new CLagCompensationHistory());
+	std::unique_ptr<CLagCompensationHistory::SWorldState> pWorldState(new CLagCompensationHistory::SWorldState());
+
+	double recordSeconds = 0.0;
+	double rewindAllSeconds = 0.0;
+	double rewindPlayerSeconds = 0.0;
+	int recordCount = 0;
+	int queryCount = 0;
+	int mismatches = 0;
+	uint32_t random = 1;
+
+	for (uint32_t tick = 1; tick <= static_cast<uint32_t>(tickCount); ++tick)
+	{
+		for (int i = 0; i < playerCount; ++i)
+		{
+			SSimulatedPlayer& player = players[i];
+			const Cmd cmd = GetScriptedCmd(i, static_cast<int>(tick), player.state, dt);
+			PMove::QueueJump(player.state, params, cmd);
+			player.state = PMove::Move(player.state, params, cmd, dt);
+			StepWorld(player, params, dt);
+			positions[(tick & (CLagCompensationHistory::Capacity - 1)) * playerCount + i] = player.position;
+		}
+
+		if (IsRecordedTick(tick))
+		{
+			const Clock::time_point start = Clock::now();
+			pHistory->BeginTick(tick);
+			for (int i = 0; i < playerCount; ++i)
+			{
+				SPlayerHistorySample sample;
+				sample.position = players[i].position;
+				sample.yaw = players[i].state.yaw;
+				sample.onGround = players[i].state.onGround;
+				pHistory->Record(static_cast<uint32_t>(i), sample);
+			}
+			recordSeconds += GetSecondsSince(start);
+			++recordCount;
+		}
+
+		if (tick < CLagCompensationHistory::Capacity)
+			continue;
+
+		for (int query = 0; query < queriesPerTick; ++query)
+		{
+			random = random * 1664525u + 1013904223u;
+			// Up to a second back, never older than the oldest recorded tick
+			const uint32_t age = 2 + (random >> 8) % (CLagCompensationHistory::Capacity - 4);
+			const uint32_t queryTick = tick - age;
+			const float fraction = static_cast<float>((random >> 4) & 0xF) / 16.f;
+			const uint32_t slot = (random >> 16) % static_cast<uint32_t>(playerCount);
+
+			Clock::time_point start = Clock::now();
+			const bool hasWorld = pHistory->Rewind(queryTick, fraction, *pWorldState);
+			rewindAllSeconds += GetSecondsSince(start);
+
+			SPlayerHistorySample sample;
+			start = Clock::now();
+			const bool hasPlayer = pHistory->RewindPlayer(slot, queryTick, fraction, sample);
+			rewindPlayerSeconds += GetSecondsSince(start);
+			++queryCount;
+
+			// Expected: linear between the recorded ticks around the query
+			uint32_t previousTick = queryTick;
+			while (!IsRecordedTick(previousTick))
+			{
+				--previousTick;
+			}
+			uint32_t nextTick = queryTick + 1;
+			while (!IsRecordedTick(nextTick))
+			{
+				++nextTick;
+			}
+			const float alpha = (static_cast<float>(queryTick - previousTick) + fraction) / static_cast<float>(nextTick - previousTick);
+			const PMoveVec3& previous = positions[(previousTick & (CLagCompensationHistory::Capacity - 1)) * playerCount + slot];
+			const PMoveVec3& next = positions[(nextTick & (CLagCompensationHistory::Capacity - 1)) * playerCount + slot];
+			const PMoveVec3 expected = previous + (next - previous) * alpha;
+
+			if (!hasWorld || !hasPlayer || !pWorldState->isValid[slot] || !IsNear(sample.position, expected, 1e-5f)
+				|| !IsNear(pWorldState->players[slot].position, sample.position, 0.f))
+			{
+				++mismatches;
+			}
+		}
+	}
+
+	std::printf("lag compensation: %d players x %d ticks @ %.0f Hz, %u ticks of history in %.1f KB\n",
+		playerCount, tickCount, tickRate, CLagCompensationHistory::Capacity, sizeof(CLagCompensationHistory) / 1024.0);
+	std::printf("  record %.3f us/tick, rewind all players %.3f us, rewind one player %.3f us\n",
+		recordSeconds * 1e6 / recordCount, rewindAllSeconds * 1e6 / queryCount, rewindPlayerSeconds * 1e6 / queryCount);
+	std::printf("  %d of %d rewinds away from the simulation\n", mismatches, queryCount);
+
+	return mismatches == 0 ? 0 : 1;
+}
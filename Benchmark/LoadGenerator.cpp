@@ -0,0 +1,592 @@
+////////////////////////////////////////////////////////
+// Headless server load generator
+// Spawns synthetic players whose hands follow a script (strafe jumping,
+// circle jumping, standing idle, or spamming keys and the mouse). Their
+// key changes and mouse deltas go through CInputTimeline the way
+// CPlayerComponent::HandleInputFlagChange does. Their clients run at
+// 144 Hz and send batched commands. The server then does what
+// CPlayerMovementUpdater does every 60 Hz tick:
+//   - receive the commands,
+//   - pop one per player,
+//   - step the batch,
+//   - validate every player's movement,
+//   - hand the result to a flat floor standing in for physics,
+//     except for players resting without input, who skip everything
+//     but the snapshots until a command wakes them,
+//   - record the lag compensation history,
+//   - send each client its interest managed snapshot.
+// Clients decode the snapshots and acknowledge them a round trip later.
+// Only the server's side is timed. For every player count up to the
+// maximum it reports:
+//   - server tick time percentiles and their share of the tick budget,
+//   - the mean time of the movement validation within the tick,
+//   - how many players rested per tick,
+//   - snapshot bytes per client,
+//   - heap allocations per tick once warmed up,
+//   - how many players fit one tick at the p99 time.
+// It fails if any server tick allocates after the warm up, if a client
+// misses commands for good, or if the validator flags one of these
+// honest players.
+// Players past PMoveSnapshot::MaxPlayers have no snapshot id, as on a
+// real server. They are simulated but not replicated, and their
+// clients are sent every replicated player.
+//
+// Build (from the repository root):
+//   g++ -O2 -std=c++17 -pthread -I. -IBenchmark Benchmark/LoadGenerator.cpp PlayerMovement.cpp PlayerMovementSystem.cpp PlayerMovementBatch.cpp MovementRuleset.cpp WorkStealingPool.cpp InputTimeline.cpp CommandBatch.cpp PlayerPrediction.cpp MovementSnapshot.cpp InterestManager.cpp LagCompensation.cpp MovementProfiler.cpp MovementValidator.cpp -o load_generator
+// Usage:
+//   load_generator [max players] [seconds] [threads] [mix|strafe|circle|idle|spam]
+////////////////////////////////////////////////////////
+
+#include "BenchmarkCommon.h"
+#include "CommandBatch.h"
+#include "InputTimeline.h"
+#include "InterestManager.h"
+#include "LagCompensation.h"
+#include "MovementProfiler.h"
+#include "MovementValidator.h"
+#include "PlayerMovementSystem.h"
+#include "PlayerPrediction.h"
+
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <random>
+#include <vector>
+
+namespace
+{
+	std::atomic<uint64_t> s_allocationCount{ 0 };
+}
+
+namespace
+{
+	// Every form of operator new goes through here, so all of them are counted and all of them pair with Free
+	void* Allocate(size_t size, size_t alignment)
+	{
+		s_allocationCount.fetch_add(1, std::memory_order_relaxed);
+		size = size > 0 ? size : 1;
+		// aligned_alloc wants a multiple of the alignment
+		return alignment > alignof(std::max_align_t) ? std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment) : std::malloc(size);
+	}
+
+	void* AllocateOrThrow(size_t size, size_t alignment)
+	{
+		if (void* pMemory = Allocate(size, alignment))
+			return pMemory;
+		throw std::bad_alloc();
+	}
+
+	void Free(void* pMemory) noexcept
+	{
+		std::free(pMemory);
+	}
+}
+
+// Counts every heap allocation of the process, the server's share is what happens between two reads
+void* operator new(size_t size) { return AllocateOrThrow(size, 0); }
+void* operator new[](size_t size) { return AllocateOrThrow(size, 0); }
+void* operator new(size_t size, std::align_val_t alignment) { return AllocateOrThrow(size, static_cast<size_t>(alignment)); }
+void* operator new[](size_t size, std::align_val_t alignment) { return AllocateOrThrow(size, static_cast<size_t>(alignment)); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return Allocate(size, 0); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return Allocate(size, 0); }
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return Allocate(size, static_cast<size_t>(alignment)); }
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return Allocate(size, static_cast<size_t>(alignment)); }
+
+void operator delete(void* pMemory) noexcept { Free(pMemory); }
+void operator delete[](void* pMemory) noexcept { Free(pMemory); }
+void operator delete(void* pMemory, size_t) noexcept { Free(pMemory); }
+void operator delete[](void* pMemory, size_t) noexcept { Free(pMemory); }
+void operator delete(void* pMemory, std::align_val_t) noexcept { Free(pMemory); }
+void operator delete[](void* pMemory, std::align_val_t) noexcept { Free(pMemory); }
+void operator delete(void* pMemory, size_t, std::align_val_t) noexcept { Free(pMemory); }
+void operator delete[](void* pMemory, size_t, std::align_val_t) noexcept { Free(pMemory); }
+void operator delete(void* pMemory, const std::nothrow_t&) noexcept { Free(pMemory); }
+void operator delete[](void* pMemory, const std::nothrow_t&) noexcept { Free(pMemory); }
+void operator delete(void* pMemory, std::align_val_t, const std::nothrow_t&) noexcept { Free(pMemory); }
+void operator delete[](void* pMemory, std::align_val_t, const std::nothrow_t&) noexcept { Free(pMemory); }
+
+namespace
+{
+	// Same bits, look limits and send rates as CPlayerComponent
+	enum EButton : uint32_t
+	{
+		eButton_MoveLeft = 1 << 0,
+		eButton_MoveRight = 1 << 1,
+		eButton_MoveForward = 1 << 2,
+		eButton_MoveBack = 1 << 3,
+		eButton_Jump = 1 << 4
+	};
+
+	const float RotationSpeed = 0.002f;
+	const float MinPitch = -0.84f;
+	const float MaxPitch = 1.5f;
+	const uint32_t CmdSendInterval = 2;
+	const uint32_t CmdRedundancy = 8;
+	const size_t MaxCmdPacketSize = 256;
+	const size_t MaxSnapshotPacketSize = 3072;
+
+	const float ClientFrameRate = 144.f;
+	const uint32_t LatencyTicks = 6;
+	const float WarmUpSeconds = 1.f;
+	// Square meters per player, so the density around each player stays the same however many there are
+	const float AreaPerPlayer = 1500.f;
+
+	enum class EPattern
+	{
+		StrafeJump,
+		CircleJump,
+		Idle,
+		KeySpam,
+		Count
+	};
+
+	const char* const PatternNames[] = { "strafe", "circle", "idle", "spam" };
+	static_assert(sizeof(PatternNames) / sizeof(PatternNames[0]) == static_cast<size_t>(EPattern::Count), "Every pattern needs a name");
+
+	// Client side of a synthetic player: hands, input timeline and the command and snapshot streams
+	struct SBot
+	{
+		EPattern pattern = EPattern::Idle;
+		std::mt19937 random;
+		uint32_t buttons = 0;
+		double nextFrameTime = 0.0;
+		double nextStrafeSwitchTime = 0.0;
+		float turnSign = 1.f;
+
+		CInputTimeline timeline{ MinPitch, MaxPitch };
+		CViewAngles tickAngles;
+		uint32_t cmdSequence = 0;
+		CCmdBatchWriter cmdWriter{ CmdRedundancy };
+
+		CSnapshotDecoder decoder;
+		// Newest decoded snapshot at each tick, the server sees it a round trip later
+		CSequenceRing<uint32_t, 64> ackHistory;
+		uint32_t ackedSnapshotSequence = 0;
+	};
+
+	// Server side of a synthetic player
+	struct SServerPlayer
+	{
+		SSimulatedPlayer simulated;
+		CPlayerMovementSystem::Handle handle = CPlayerMovementSystem::InvalidHandle;
+		CServerCmdQueue cmdQueue;
+		Cmd cmd;
+		// Kernel units the player was moved by to wrap around the map, the validator sees where it would be without
+		PMoveVec3 wrapOffset;
+		uint8_t anomalyFlags = 0;
+		// CPlayerComponent::m_isResting
+		bool isResting = false;
+		uint32_t ackedSnapshotSequence = 0;
+		std::array<uint8_t, MaxCmdPacketSize> cmdPacket;
+		size_t cmdPacketSize = 0;
+	};
+
+	struct SResult
+	{
+		CLatencyHistogram tickNanoseconds;
+		double validateSeconds = 0.0;
+		uint64_t restingTicks = 0;
+		uint64_t measuredTicks = 0;
+		uint64_t allocations = 0;
+		uint64_t allocatingTicks = 0;
+		double snapshotBytes = 0.0;
+		double cmdBytes = 0.0;
+		uint64_t skippedCmds = 0;
+		uint32_t flaggedPlayers = 0;
+	};
+
+	// CPlayerComponent::HandleInputFlagChange for held keys
+	void HandleInputFlagChange(SBot& bot, uint32_t button, bool isPressed, double time)
+	{
+		bot.buttons = isPressed ? bot.buttons | button : bot.buttons & ~button;
+		bot.timeline.PushButtons(time, bot.buttons);
+	}
+
+	// Mouse deltas are in counts, turned into radians like the component's mouse_rotate actions
+	void MoveMouse(SBot& bot, float yawCounts, float pitchCounts, double time)
+	{
+		bot.timeline.PushLook(time, -yawCounts * RotationSpeed, -pitchCounts * RotationSpeed);
+	}
+
+	void StartPattern(SBot& bot, double time)
+	{
+		switch (bot.pattern)
+		{
+		case EPattern::StrafeJump:
+			HandleInputFlagChange(bot, eButton_MoveForward, true, time);
+			HandleInputFlagChange(bot, eButton_MoveLeft, true, time);
+			HandleInputFlagChange(bot, eButton_Jump, true, time);
+			bot.turnSign = -1.f;
+			break;
+		case EPattern::CircleJump:
+			HandleInputFlagChange(bot, eButton_MoveForward, true, time);
+			HandleInputFlagChange(bot, eButton_MoveRight, true, time);
+			HandleInputFlagChange(bot, eButton_Jump, true, time);
+			break;
+		case EPattern::Idle:
+		case EPattern::KeySpam:
+		case EPattern::Count:
+			break;
+		}
+	}
+
+	// One client frame of the script, what the engine would deliver to the input component
+	void UpdateHands(SBot& bot, double time, float frameTime)
+	{
+		std::uniform_real_distribution<float> unit(0.f, 1.f);
+
+		switch (bot.pattern)
+		{
+		case EPattern::StrafeJump:
+		{
+			// Swap the strafe key and the turn every half second or so, the jump stays held for bunny hops
+			if (time >= bot.nextStrafeSwitchTime)
+			{
+				const bool isLeft = (bot.buttons & eButton_MoveLeft) != 0;
+				HandleInputFlagChange(bot, isLeft ? eButton_MoveLeft : eButton_MoveRight, false, time);
+				HandleInputFlagChange(bot, isLeft ? eButton_MoveRight : eButton_MoveLeft, true, time);
+				bot.turnSign = isLeft ? 1.f : -1.f;
+				bot.nextStrafeSwitchTime = time + 0.4 + 0.3 * unit(bot.random);
+			}
+			MoveMouse(bot, bot.turnSign * 2.5f * frameTime / RotationSpeed, 0.f, time);
+			break;
+		}
+		case EPattern::CircleJump:
+			MoveMouse(bot, 1.5f * frameTime / RotationSpeed, 0.f, time);
+			break;
+		case EPattern::Idle:
+			break;
+		case EPattern::KeySpam:
+		{
+			// A random key flips most frames, and the mouse never rests
+			static const uint32_t Buttons[] = { eButton_MoveLeft, eButton_MoveRight, eButton_MoveForward, eButton_MoveBack, eButton_Jump };
+			if (unit(bot.random) < 0.7f)
+			{
+				const uint32_t button = Buttons[bot.random() % (sizeof(Buttons) / sizeof(Buttons[0]))];
+				HandleInputFlagChange(bot, button, (bot.buttons & button) == 0, time);
+			}
+			MoveMouse(bot, (unit(bot.random) - 0.5f) * 200.f, (unit(bot.random) - 0.5f) * 50.f, time);
+			break;
+		}
+		case EPattern::Count:
+			break;
+		}
+	}
+
+	// The local client's half of CPlayerComponent::PrepareMovementTick, returns the size of the command packet to send
+	size_t BuildCmd(SBot& bot, double tickEndTime, uint8_t* pPacket)
+	{
+		const STickInput input = bot.timeline.Consume(tickEndTime, bot.tickAngles);
+		const uint32_t jumpButtons = input.buttons | input.pressedButtons;
+
+		Cmd cmd;
+		cmd.rightMove = ((input.buttons & eButton_MoveRight) ? 1.f : 0.f) - ((input.buttons & eButton_MoveLeft) ? 1.f : 0.f);
+		cmd.forwardMove = ((input.buttons & eButton_MoveForward) ? 1.f : 0.f) - ((input.buttons & eButton_MoveBack) ? 1.f : 0.f);
+		cmd.jump = (jumpButtons & eButton_Jump) != 0;
+		cmd.yaw = bot.tickAngles.GetYaw();
+		cmd.pitch = bot.tickAngles.GetPitch();
+		cmd.sequence = ++bot.cmdSequence;
+
+		bot.cmdWriter.Push(PMoveCmdBatch::Quantize(cmd));
+		if (cmd.sequence % CmdSendInterval != 0)
+			return 0;
+		return bot.cmdWriter.Write(bot.ackedSnapshotSequence, pPacket, MaxCmdPacketSize);
+	}
+
+	// Returns how far the value was moved
+	float WrapPosition(float& value, float size)
+	{
+		const float offset = value >= size ? -size : value < 0.f ? size : 0.f;
+		value += offset;
+		return offset;
+	}
+
+	EPattern GetPattern(int pattern, int player)
+	{
+		// The mix is mostly movers, with some idlers and a few key spammers
+		if (pattern >= 0)
+			return static_cast<EPattern>(pattern);
+		static const EPattern Mix[] = { EPattern::StrafeJump, EPattern::StrafeJump, EPattern::CircleJump, EPattern::StrafeJump, EPattern::Idle, EPattern::CircleJump, EPattern::Idle, EPattern::KeySpam };
+		return Mix[player % (sizeof(Mix) / sizeof(Mix[0]))];
+	}
+
+	void Run(int playerCount, int tickCount, int threadCount, int pattern, SResult& result)
+	{
+		const float dt = 1.f / CFixedTimestep::DefaultTickRate;
+		// Physics is handed kernel velocities scaled by the tick interval, so that is also the size of a kernel unit in meters
+		const float metersPerUnit = dt;
+		const float mapSize = std::sqrt(AreaPerPlayer * static_cast<float>(playerCount)) / metersPerUnit;
+		const int warmUpTicks = static_cast<int>(WarmUpSeconds / dt);
+		const double frameInterval = 1.0 / ClientFrameRate;
+
+		const PMoveParams params;
+		CWorkStealingPool pool(static_cast<uint32_t>(threadCount));
+		CPlayerMovementSystem movementSystem;
+		movementSystem.SetJobPool(threadCount > 0 ? &pool : nullptr);
+		std::unique_ptr<CLagCompensationHistory> pHistory(new CLagCompensationHistory());
+		std::unique_ptr<CInterestManager> pInterest(new CInterestManager());
+		std::unique_ptr<CSnapshotEncoder> pEncoder(new CSnapshotEncoder());
+		std::unique_ptr<CMovementValidator> pValidator(new CMovementValidator());
+
+		std::vector<SBot> bots(playerCount);
+		std::vector<SServerPlayer> players(playerCount);
+		std::mt19937 random(1234u + static_cast<uint32_t>(playerCount));
+		std::uniform_real_distribution<float> coordinate(0.f, mapSize);
+		std::uniform_real_distribution<double> phase(0.0, frameInterval);
+		for (int i = 0; i < playerCount; ++i)
+		{
+			SBot& bot = bots[i];
+			bot.pattern = GetPattern(pattern, i);
+			bot.random.seed(static_cast<uint32_t>(i) * 7919u + 17u);
+			bot.nextFrameTime = phase(random);
+			StartPattern(bot, 0.0);
+
+			SServerPlayer& player = players[i];
+			player.handle = movementSystem.Add(params);
+			movementSystem.SetAlive(player.handle, true);
+			player.simulated.state.onGround = true;
+			player.simulated.position = PMoveVec3(coordinate(random), coordinate(random), 0.f);
+		}
+
+		std::array<uint8_t, MaxSnapshotPacketSize> snapshotPacket;
+		for (int tick = 0; tick < tickCount; ++tick)
+		{
+			const double tickEndTime = static_cast<double>(tick + 1) * dt;
+
+			// Clients play their frames up to the end of the tick and send their commands, the server gets them right away
+			for (int i = 0; i < playerCount; ++i)
+			{
+				SBot& bot = bots[i];
+				while (bot.nextFrameTime < tickEndTime)
+				{
+					UpdateHands(bot, bot.nextFrameTime, static_cast<float>(frameInterval));
+					bot.nextFrameTime += frameInterval;
+				}
+				players[i].cmdPacketSize = BuildCmd(bot, tickEndTime, players[i].cmdPacket.data());
+			}
+
+			const bool isMeasured = tick >= warmUpTicks;
+			const uint64_t allocationCount = s_allocationCount.load(std::memory_order_relaxed);
+			const Clock::time_point start = Clock::now();
+			// Decoding is the client's work, it stays out of the tick time
+			Clock::duration clientDuration(0);
+
+			// ReceiveCmdsOnServer, then the remote player half of PrepareMovementTick
+			pValidator->BeginTick();
+			for (SServerPlayer& player : players)
+			{
+				SCmdBatch batch;
+				if (player.cmdPacketSize > 0 && PMoveCmdBatch::Read(player.cmdPacket.data(), player.cmdPacketSize, batch))
+				{
+					for (uint32_t c = 0; c < batch.cmdCount; ++c)
+					{
+						player.cmdQueue.Receive(batch.cmds[c]);
+					}
+					if (static_cast<int32_t>(batch.snapshotAck - player.ackedSnapshotSequence) > 0)
+					{
+						player.ackedSnapshotSequence = batch.snapshotAck;
+					}
+				}
+
+				const uint32_t lastSequence = player.cmdQueue.GetLastProcessedSequence();
+				const Cmd previousCmd = player.cmd;
+				player.cmd = player.cmdQueue.Pop();
+				result.skippedCmds += player.cmd.sequence - lastSequence > 1 ? player.cmd.sequence - lastSequence - 1 : 0;
+				if (player.isResting)
+				{
+					if (PMove::IsAtRest(player.simulated.state, player.cmd) && player.cmd.yaw == previousCmd.yaw && player.cmd.pitch == previousCmd.pitch)
+					{
+						result.restingTicks += isMeasured ? 1 : 0;
+						continue;
+					}
+					player.isResting = false;
+					movementSystem.SetAlive(player.handle, true);
+				}
+				movementSystem.SetInput(player.handle, player.cmd, player.cmd.yaw, player.simulated.state.onGround);
+
+				if (player.handle < CMovementValidator::MaxPlayers)
+				{
+					SMovementValidationInput input;
+					input.cmd = player.cmd;
+					input.state = movementSystem.GetState(player.handle);
+					input.params = params;
+					input.position = (player.simulated.position - player.wrapOffset) * metersPerUnit;
+					input.time = tickEndTime;
+					input.newestCmdSequence = player.cmdQueue.GetNewestSequence();
+					pValidator->Record(player.handle, input);
+				}
+			}
+
+			movementSystem.Step(dt);
+
+			const Clock::time_point validateStart = Clock::now();
+			pValidator->Validate(dt, threadCount > 0 ? &pool : nullptr);
+			const double validateSeconds = GetSecondsSince(validateStart);
+
+			// ApplyMovement against a flat floor
+			for (SServerPlayer& player : players)
+			{
+				if (player.isResting)
+					continue;
+
+				SSimulatedPlayer& simulated = player.simulated;
+				simulated.state = movementSystem.GetState(player.handle);
+				movementSystem.ConsumeJump(player.handle);
+				StepWorld(simulated, params, dt);
+				player.wrapOffset.x += WrapPosition(simulated.position.x, mapSize);
+				player.wrapOffset.y += WrapPosition(simulated.position.y, mapSize);
+				movementSystem.SetState(player.handle, simulated.state);
+				if (PMove::IsAtRest(simulated.state, player.cmd))
+				{
+					player.isResting = true;
+					movementSystem.SetAlive(player.handle, false);
+				}
+			}
+
+			// RecordHistory and SendSnapshots, snapshot ids are the movement handles like on the server
+			const uint32_t serverTick = static_cast<uint32_t>(tick) + 1;
+			pHistory->BeginTick(serverTick);
+			pEncoder->BeginSnapshot(serverTick);
+			pInterest->BeginTick();
+			for (const SServerPlayer& player : players)
+			{
+				SSnapshotPlayer snapshotPlayer;
+				snapshotPlayer.id = static_cast<uint16_t>(player.handle);
+				snapshotPlayer.position = player.simulated.position * metersPerUnit;
+				snapshotPlayer.velocity = player.simulated.state.velocity;
+				snapshotPlayer.yaw = player.cmd.yaw;
+				snapshotPlayer.pitch = player.cmd.pitch;
+				snapshotPlayer.onGround = player.simulated.state.onGround;
+				snapshotPlayer.wishJump = player.simulated.state.wishJump;
+				snapshotPlayer.jumpHeld = player.simulated.state.jumpHeld;
+
+				if (player.handle < CLagCompensationHistory::MaxPlayers)
+				{
+					SPlayerHistorySample sample;
+					sample.position = snapshotPlayer.position;
+					sample.yaw = snapshotPlayer.yaw;
+					sample.pitch = snapshotPlayer.pitch;
+					sample.onGround = snapshotPlayer.onGround;
+					pHistory->Record(player.handle, sample);
+				}
+				if (pEncoder->AddPlayer(snapshotPlayer))
+				{
+					pInterest->AddPlayer(snapshotPlayer.id, snapshotPlayer.position, snapshotPlayer.yaw, snapshotPlayer.pitch);
+				}
+			}
+			pEncoder->EndSnapshot();
+			pInterest->EndTick();
+
+			for (int i = 0; i < playerCount; ++i)
+			{
+				const SServerPlayer& player = players[i];
+				const uint16_t viewerId = player.handle < PMoveSnapshot::MaxPlayers ? static_cast<uint16_t>(player.handle) : 0xFFFF;
+				const size_t size = pInterest->WriteSnapshot(viewerId, *pEncoder, player.ackedSnapshotSequence, snapshotPacket.data(), snapshotPacket.size());
+
+				const Clock::time_point decodeStart = Clock::now();
+				SBot& bot = bots[i];
+				if (size > 0)
+				{
+					bot.decoder.Read(snapshotPacket.data(), size);
+				}
+				bot.ackHistory.Insert(static_cast<uint32_t>(tick)) = bot.decoder.GetSequence();
+				if (const uint32_t* pAck = tick > static_cast<int>(LatencyTicks) ? bot.ackHistory.Find(static_cast<uint32_t>(tick) - LatencyTicks) : nullptr)
+				{
+					bot.ackedSnapshotSequence = *pAck;
+				}
+				clientDuration += Clock::now() - decodeStart;
+
+				if (isMeasured)
+				{
+					result.snapshotBytes += static_cast<double>(size);
+					result.cmdBytes += static_cast<double>(player.cmdPacketSize);
+				}
+			}
+
+			const uint64_t tickNanoseconds = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start - clientDuration).count());
+			for (SServerPlayer& player : players)
+			{
+				player.anomalyFlags |= player.handle < CMovementValidator::MaxPlayers ? pValidator->GetReport(player.handle).flags : 0;
+			}
+			if (!isMeasured)
+				continue;
+
+			// Client decoding allocates nothing either, so every allocation in the window is the server's
+			const uint64_t allocations = s_allocationCount.load(std::memory_order_relaxed) - allocationCount;
+			result.tickNanoseconds.Record(tickNanoseconds);
+			result.validateSeconds += validateSeconds;
+			result.allocations += allocations;
+			result.allocatingTicks += allocations > 0 ? 1 : 0;
+			++result.measuredTicks;
+		}
+
+		for (const SServerPlayer& player : players)
+		{
+			result.flaggedPlayers += player.anomalyFlags != 0 ? 1 : 0;
+		}
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const int maxPlayerCount = argc > 1 ? std::atoi(argv[1]) : 256;
+	const float seconds = argc > 2 ? static_cast<float>(std::atof(argv[2])) : 10.f;
+	const int threadCount = argc > 3 ? std::atoi(argv[3]) : 0;
+
+	// -1 mixes the patterns
+	int pattern = argc > 4 ? static_cast<int>(EPattern::Count) : -1;
+	if (argc > 4 && std::strcmp(argv[4], "mix") == 0)
+	{
+		pattern = -1;
+	}
+	for (int p = 0; argc > 4 && p < static_cast<int>(EPattern::Count); ++p)
+	{
+		pattern = std::strcmp(argv[4], PatternNames[p]) == 0 ? p : pattern;
+	}
+
+	const int tickCount = static_cast<int>((seconds + WarmUpSeconds) * CFixedTimestep::DefaultTickRate);
+	if (maxPlayerCount < 1 || seconds <= 0.f || threadCount < 0 || pattern == static_cast<int>(EPattern::Count))
+	{
+		std::fprintf(stderr, "usage: %s [max players] [seconds] [threads] [mix|strafe|circle|idle|spam]\n", argv[0]);
+		return 1;
+	}
+
+	const double budgetMicroseconds = 1e6 / CFixedTimestep::DefaultTickRate;
+	std::printf("load: %.0f s @ %.0f Hz after %.0f s warm up, %s players, %d pool threads, %.0f Hz clients, %s\n", seconds, CFixedTimestep::DefaultTickRate, WarmUpSeconds,
+		pattern < 0 ? "mixed" : PatternNames[pattern], threadCount, ClientFrameRate, PMoveBatch::GetSimdLevelName(PMoveBatch::GetSupportedSimdLevel()));
+	std::printf("  players | tick us:    p50      p90      p99      max  budget | validate us | resting | bytes/client: snapshot  cmd | allocs/tick | players/tick at p99\n");
+
+	uint32_t failures = 0;
+	for (int playerCount = 16; ; playerCount *= 2)
+	{
+		playerCount = playerCount > maxPlayerCount ? maxPlayerCount : playerCount;
+
+		std::unique_ptr<SResult> pResult(new SResult());
+		Run(playerCount, tickCount, threadCount, pattern, *pResult);
+		const SResult& result = *pResult;
+
+		const double p99 = static_cast<double>(result.tickNanoseconds.GetPercentile(99.0)) * 1e-3;
+		const double packetCount = static_cast<double>(result.measuredTicks) * playerCount;
+		std::printf("  %7d | %15.1f %8.1f %8.1f %8.1f %6.1f%% | %11.1f | %7.1f | %22.1f %4.1f | %11.2f | %19.0f\n", playerCount,
+			static_cast<double>(result.tickNanoseconds.GetPercentile(50.0)) * 1e-3, static_cast<double>(result.tickNanoseconds.GetPercentile(90.0)) * 1e-3,
+			p99, static_cast<double>(result.tickNanoseconds.GetMax()) * 1e-3, p99 * 100.0 / budgetMicroseconds,
+			result.validateSeconds * 1e6 / static_cast<double>(result.measuredTicks), static_cast<double>(result.restingTicks) / static_cast<double>(result.measuredTicks),
+			result.snapshotBytes / packetCount, result.cmdBytes / packetCount,
+			static_cast<double>(result.allocations) / static_cast<double>(result.measuredTicks), playerCount * budgetMicroseconds / p99);
+
+		if (result.allocatingTicks + result.skippedCmds + result.flaggedPlayers > 0)
+		{
+			std::printf("    %llu ticks allocated, %llu commands were never received, %u players were flagged\n",
+				static_cast<unsigned long long>(result.allocatingTicks), static_cast<unsigned long long>(result.skippedCmds), result.flaggedPlayers);
+			++failures;
+		}
+		if (playerCount == maxPlayerCount)
+			break;
+	}
+
+	return failures == 0 ? 0 : 1;
+}
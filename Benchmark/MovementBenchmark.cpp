@@ -0,0 +1,428 @@
+////////////////////////////////////////////////////////
+// Headless movement benchmark
+// Steps thousands of simulated players on a flat floor and reports the
+// cost per player tick of each way of running the movement kernel.
+// Before timing, the SIMD batch paths are checked against the scalar
+// reference on randomized players; the process fails if they diverge.
+// They are bit identical unless the compiler contracts the scalar path
+// into FMAs (e.g. -march=native), then only the tolerance check holds.
+// It also fails if strafe jumping loses its speed on frames running
+// several ticks, where physics only steps once after all of them.
+//
+// Build (from the repository root):
+//   g++ -O2 -std=c++17 -pthread -I. -IBenchmark Benchmark/MovementBenchmark.cpp PlayerMovement.cpp PlayerMovementSystem.cpp PlayerMovementBatch.cpp MovementRuleset.cpp WorkStealingPool.cpp -o movement_bench
+// Usage:
+//   movement_bench [players] [ticks]
+////////////////////////////////////////////////////////
+
+#include "BenchmarkCommon.h"
+#include "PlayerMovementSystem.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+	struct SBenchmarkResult
+	{
+		double seconds = 0.0;
+		double checksum = 0.0;
+	};
+
+	// Plain array of kernel states, the lower bound for the scalar kernel
+	SBenchmarkResult RunKernel(int playerCount, int tickCount, const PMoveParams& params, float dt)
+	{
+		SBenchmarkResult result;
+		std::vector<SSimulatedPlayer> players = CreatePlayers(playerCount);
+		std::vector<Cmd> cmds(playerCount);
+
+		for (int tick = 0; tick < tickCount; ++tick)
+		{
+			for (int i = 0; i < playerCount; ++i)
+			{
+				cmds[i] = GetScriptedCmd(i, tick, players[i].state, dt);
+			}
+
+			const Clock::time_point start = Clock::now();
+			for (int i = 0; i < playerCount; ++i)
+			{
+				players[i].state = PMove::Move(players[i].state, params, cmds[i], dt);
+			}
+			result.seconds += GetSecondsSince(start);
+
+			for (SSimulatedPlayer& player : players)
+			{
+				StepWorld(player, params, dt);
+			}
+		}
+
+		result.checksum = GetChecksum(players);
+		return result;
+	}
+
+	// Mimics one entity component per player: individually allocated, updated through a virtual call,
+	// with the movement data interleaved with pointers and animation state like in CPlayerComponent
+	struct IComponent
+	{
+		virtual ~IComponent() = default;
+		virtual void Update(float frameTime) = 0;
+	};
+
+	struct CComponentLikePlayer final : public IComponent
+	{
+		virtual void Update(float frameTime) override
+		{
+			if (!m_isAlive)
+				return;
+
+			m_player.state = PMove::Move(m_player.state, m_params, m_cmd, frameTime);
+		}
+
+		bool m_isAlive = true;
+		void* m_pComponents[4] = {};
+		int m_fragmentIds[4] = {};
+		float m_cameraSettings[16] = {};
+		PMoveParams m_params;
+		SSimulatedPlayer m_player;
+		Cmd m_cmd;
+		float m_smoothingFilters[24] = {};
+	};
+
+	SBenchmarkResult RunComponents(int playerCount, int tickCount, const PMoveParams& params, float dt)
+	{
+		SBenchmarkResult result;
+		const std::vector<SSimulatedPlayer> initialPlayers = CreatePlayers(playerCount);
+
+		// Allocate interleaved with unrelated blocks and update in a shuffled order, like entities spread over the heap
+		std::vector<std::unique_ptr<CComponentLikePlayer>> players;
+		std::vector<std::unique_ptr<char[]>> clutter;
+		for (int i = 0; i < playerCount; ++i)
+		{
+			players.emplace_back(new CComponentLikePlayer());
+			players.back()->m_params = params;
+			players.back()->m_player = initialPlayers[i];
+			clutter.emplace_back(new char[256 + (i % 7) * 64]);
+		}
+
+		std::vector<IComponent*> updateOrder;
+		for (const std::unique_ptr<CComponentLikePlayer>& player : players)
+		{
+			updateOrder.push_back(player.get());
+		}
+		std::shuffle(updateOrder.begin(), updateOrder.end(), std::mt19937(1234));
+
+		for (int tick = 0; tick < tickCount; ++tick)
+		{
+			for (int i = 0; i < playerCount; ++i)
+			{
+				players[i]->m_cmd = GetScriptedCmd(i, tick, players[i]->m_player.state, dt);
+			}
+
+			const Clock::time_point start = Clock::now();
+			for (IComponent* pComponent : updateOrder)
+			{
+				pComponent->Update(dt);
+			}
+			result.seconds += GetSecondsSince(start);
+
+			for (const std::unique_ptr<CComponentLikePlayer>& player : players)
+			{
+				StepWorld(player->m_player, params, dt);
+			}
+		}
+
+		std::vector<SSimulatedPlayer> endPlayers;
+		for (const std::unique_ptr<CComponentLikePlayer>& player : players)
+		{
+			endPlayers.push_back(player->m_player);
+		}
+		result.checksum = GetChecksum(endPlayers);
+		return result;
+	}
+
+	SBenchmarkResult RunSystem(int playerCount, int tickCount, const PMoveParams& params, float dt, PMoveBatch::ESimdLevel simdLevel)
+	{
+		SBenchmarkResult result;
+		std::vector<SSimulatedPlayer> players = CreatePlayers(playerCount);
+
+		CPlayerMovementSystem movementSystem;
+		movementSystem.SetSimdLevel(simdLevel);
+		std::vector<CPlayerMovementSystem::Handle> handles;
+		for (int i = 0; i < playerCount; ++i)
+		{
+			handles.push_back(movementSystem.Add(params));
+			movementSystem.SetAlive(handles.back(), true);
+		}
+
+		for (int tick = 0; tick < tickCount; ++tick)
+		{
+			for (int i = 0; i < playerCount; ++i)
+			{
+				const Cmd cmd = GetScriptedCmd(i, tick, players[i].state, dt);
+				movementSystem.SetState(handles[i], players[i].state);
+				movementSystem.SetInput(handles[i], cmd, players[i].state.yaw, players[i].state.onGround);
+			}
+
+			const Clock::time_point start = Clock::now();
+			movementSystem.Step(dt);
+			result.seconds += GetSecondsSince(start);
+
+			for (int i = 0; i < playerCount; ++i)
+			{
+				players[i].state = movementSystem.GetState(handles[i]);
+				StepWorld(players[i], params, dt);
+			}
+		}
+
+		result.checksum = GetChecksum(players);
+		return result;
+	}
+
+	// Randomized players covering the corner cases of the kernel: standing still, no input, side strafing,
+	// jumping, dead players, disabled air control, slopes and slippery ground
+	void CreateRandomPlayers(CPlayerMovementSystem& movementSystem, std::vector<CPlayerMovementSystem::Handle>& handles, int playerCount, uint32_t seed)
+	{
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> speed(-1500.f, 1500.f);
+		std::uniform_real_distribution<float> angle(-10.f, 10.f);
+		std::uniform_int_distribution<int> axis(-1, 1);
+		std::uniform_int_distribution<int> chance(0, 3);
+
+		for (int i = 0; i < playerCount; ++i)
+		{
+			PMoveParams params;
+			params.airControl = chance(random) == 0 ? 0.f : 1.f;
+			params.friction = chance(random) == 0 ? 0.f : params.friction;
+
+			PMoveState state;
+			if (chance(random) != 0)
+			{
+				state.velocity = PMoveVec3(speed(random), speed(random), speed(random));
+			}
+			state.yaw = angle(random);
+			state.onGround = chance(random) < 2;
+			state.wishJump = chance(random) == 0;
+			RandomizeGround(state, random);
+
+			Cmd cmd;
+			cmd.forwardMove = static_cast<float>(axis(random));
+			cmd.rightMove = static_cast<float>(axis(random));
+
+			const CPlayerMovementSystem::Handle handle = movementSystem.Add(params);
+			movementSystem.SetState(handle, state);
+			movementSystem.SetInput(handle, cmd, state.yaw, GetGroundContact(state));
+			movementSystem.SetAlive(handle, chance(random) != 0);
+			handles.push_back(handle);
+		}
+	}
+
+	bool IsBitIdentical(float a, float b)
+	{
+		return std::memcmp(&a, &b, sizeof(float)) == 0;
+	}
+
+	bool IsWithinTolerance(float expected, float actual)
+	{
+		// Velocities are in the hundreds, so allow a small absolute error around zero where friction and clamps amplify rounding
+		return std::fabs(expected - actual) <= 1e-4f * std::max(100.f, std::fabs(expected));
+	}
+
+	// Steps the same randomized players with every SIMD level and compares them against scalar
+	bool VerifySimdLevels(float dt)
+	{
+		const int playerCount = 4099; // Not a multiple of the lane width, so the scalar tail is covered too
+		const int tickCount = 64;
+
+		const PMoveBatch::ESimdLevel supportedLevel = PMoveBatch::GetSupportedSimdLevel();
+		bool isWithinTolerance = true;
+
+		for (int level = static_cast<int>(PMoveBatch::ESimdLevel::Sse); level <= static_cast<int>(supportedLevel); ++level)
+		{
+			const PMoveBatch::ESimdLevel simdLevel = static_cast<PMoveBatch::ESimdLevel>(level);
+
+			CPlayerMovementSystem reference, candidate;
+			std::vector<CPlayerMovementSystem::Handle> referenceHandles, candidateHandles;
+			CreateRandomPlayers(reference, referenceHandles, playerCount, 42);
+			CreateRandomPlayers(candidate, candidateHandles, playerCount, 42);
+			reference.SetSimdLevel(PMoveBatch::ESimdLevel::Scalar);
+			candidate.SetSimdLevel(simdLevel);
+
+			int mismatches = 0;
+			int outOfTolerance = 0;
+			float maxError = 0.f;
+			for (int tick = 0; tick < tickCount; ++tick)
+			{
+				reference.Step(dt);
+				candidate.Step(dt);
+
+				for (int i = 0; i < playerCount; ++i)
+				{
+					const PMoveState expected = reference.GetState(referenceHandles[i]);
+					const PMoveState actual = candidate.GetState(candidateHandles[i]);
+
+					const float values[][2] = {
+						{ expected.velocity.x, actual.velocity.x }, { expected.velocity.y, actual.velocity.y }, { expected.velocity.z, actual.velocity.z },
+						{ expected.moveDirectionNorm.x, actual.moveDirectionNorm.x }, { expected.moveDirectionNorm.y, actual.moveDirectionNorm.y }, { expected.moveDirectionNorm.z, actual.moveDirectionNorm.z }
+					};
+
+					const bool areFlagsEqual = expected.wishJump == actual.wishJump && expected.jumped == actual.jumped;
+					bool isPlayerIdentical = areFlagsEqual;
+					bool isPlayerWithinTolerance = areFlagsEqual;
+					for (const float(&value)[2] : values)
+					{
+						isPlayerIdentical &= IsBitIdentical(value[0], value[1]);
+						isPlayerWithinTolerance &= IsWithinTolerance(value[0], value[1]);
+						maxError = std::max(maxError, std::fabs(value[0] - value[1]));
+					}
+					mismatches += isPlayerIdentical ? 0 : 1;
+					outOfTolerance += isPlayerWithinTolerance ? 0 : 1;
+				}
+			}
+
+			std::printf("  verify %-6s %d of %d player-ticks not bit identical, %d out of tolerance, max error %g\n",
+				PMoveBatch::GetSimdLevelName(simdLevel), mismatches, playerCount * tickCount, outOfTolerance, maxError);
+			isWithinTolerance &= outOfTolerance == 0;
+		}
+
+		return isWithinTolerance;
+	}
+
+	struct SFrameResult
+	{
+		float horizontalSpeed = 0.f;
+		int jumps = 0;
+		int groundTicksAfterJump = 0;         // Ticks run as a ground move after a jump earlier in the same frame
+	};
+
+	// One player strafe jumping without hold to bhop, tapping jump on every tick it stands on the ground, whose
+	// physics steps once per frame of ticksPerFrame ticks like the engine's. The ground is queried from physics every tick like
+	// CPlayerComponent::PrepareMovementTick does, marking the player airborne after a jump of the same frame unless isQueryOnly.
+	SFrameResult RunMultiTickFrames(int ticksPerFrame, bool isQueryOnly, float dt)
+	{
+		PMoveParams params;
+		params.holdJumpToBhop = false;
+		const int tickCount = 1200;
+
+		CPlayerMovementSystem movementSystem;
+		movementSystem.SetSimdLevel(PMoveBatch::ESimdLevel::Scalar);
+		const CPlayerMovementSystem::Handle handle = movementSystem.Add(params);
+		movementSystem.SetAlive(handle, true);
+		PMoveState script;
+		// Vertical motion belongs to physics like on the character controller, the kernel only sees the ground flag
+		float height = 0.f;
+		float verticalVelocity = 0.f;
+		bool isJumpPressed = false;
+		SFrameResult result;
+
+		for (int tick = 0; tick < tickCount; )
+		{
+			for (int i = 0; i < ticksPerFrame && tick < tickCount; ++i, ++tick)
+			{
+				const bool hasJumped = movementSystem.HasPendingJump(handle);
+				PMoveGroundContact ground;
+				if (isQueryOnly || !hasJumped)
+				{
+					ground.onGround = height <= 0.f && verticalVelocity <= 0.f;
+				}
+				result.groundTicksAfterJump += hasJumped && ground.onGround ? 1 : 0;
+
+				Cmd cmd = GetScriptedCmd(1, tick, script, dt);
+				cmd.jump = ground.onGround && !isJumpPressed;
+				isJumpPressed = cmd.jump;
+				movementSystem.SetInput(handle, cmd, cmd.yaw, ground);
+				movementSystem.Step(dt);
+			}
+
+			// The frame's physics step onto a flat floor
+			const float frameTime = dt * static_cast<float>(ticksPerFrame);
+			if (movementSystem.ConsumeJump(handle))
+			{
+				verticalVelocity = params.jumpImpulse;
+				++result.jumps;
+			}
+			verticalVelocity -= params.gravity * frameTime;
+			height += verticalVelocity * frameTime;
+			if (height < 0.f)
+			{
+				height = 0.f;
+				verticalVelocity = 0.f;
+			}
+		}
+
+		const PMoveState state = movementSystem.GetState(handle);
+		result.horizontalSpeed = std::sqrt(state.velocity.x * state.velocity.x + state.velocity.y * state.velocity.y);
+		return result;
+	}
+
+	// A tick after a jump of the same frame must not run as a ground move, its friction costs strafe jumping half its speed on slow frames.
+	// Physics noticing landings only once per frame still costs a little, up to 4 ticks per frame keep 85% of the speed of one.
+	bool VerifyMultiTickFrames(float dt)
+	{
+		const SFrameResult reference = RunMultiTickFrames(1, false, dt);
+		bool isKeepingSpeed = true;
+		for (int ticksPerFrame = 1; ticksPerFrame <= 4; ++ticksPerFrame)
+		{
+			const SFrameResult queried = RunMultiTickFrames(ticksPerFrame, true, dt);
+			const SFrameResult airborne = RunMultiTickFrames(ticksPerFrame, false, dt);
+			std::printf("  verify %d ticks/frame: ground queried only %.1f speed, %d jumps, %d ground ticks after a jump | airborne after a jump %.1f speed, %d jumps, %d ground ticks after a jump\n",
+				ticksPerFrame, queried.horizontalSpeed, queried.jumps, queried.groundTicksAfterJump, airborne.horizontalSpeed, airborne.jumps, airborne.groundTicksAfterJump);
+			isKeepingSpeed &= airborne.groundTicksAfterJump == 0 && airborne.horizontalSpeed >= 0.85f * reference.horizontalSpeed;
+		}
+		return isKeepingSpeed;
+	}
+
+	void Report(const char* szName, const SBenchmarkResult& result, const SBenchmarkResult& baseline, int playerCount, int tickCount)
+	{
+		const double playerTicks = static_cast<double>(playerCount) * tickCount;
+		std::printf("  %-12s %8.2f ns/player-tick %8.3f ms/tick %6.2fx checksum %.3f\n",
+			szName, result.seconds * 1e9 / playerTicks, result.seconds * 1e3 / tickCount, baseline.seconds / result.seconds, result.checksum);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const int playerCount = argc > 1 ? std::atoi(argv[1]) : 4096;
+	const int tickCount = argc > 2 ? std::atoi(argv[2]) : 1000;
+
+	if (playerCount <= 0 || tickCount <= 0)
+	{
+		std::fprintf(stderr, "usage: %s [players] [ticks]\n", argv[0]);
+		return 1;
+	}
+
+	const PMoveParams params;
+	const float dt = 1.f / CFixedTimestep::DefaultTickRate;
+
+	if (!VerifySimdLevels(dt))
+	{
+		std::fprintf(stderr, "SIMD movement diverges from the scalar reference\n");
+		return 1;
+	}
+	if (!VerifyMultiTickFrames(dt))
+	{
+		std::fprintf(stderr, "Strafe jumping loses speed on frames of several ticks\n");
+		return 1;
+	}
+
+	std::printf("%d players x %d ticks @ %.0f Hz, speedup relative to components\n", playerCount, tickCount, 1.f / dt);
+
+	const SBenchmarkResult components = RunComponents(playerCount, tickCount, params, dt);
+	Report("components", components, components, playerCount, tickCount);
+	Report("kernel", RunKernel(playerCount, tickCount, params, dt), components, playerCount, tickCount);
+	Report("system", RunSystem(playerCount, tickCount, params, dt, PMoveBatch::ESimdLevel::Scalar), components, playerCount, tickCount);
+
+	for (int level = static_cast<int>(PMoveBatch::ESimdLevel::Sse); level <= static_cast<int>(PMoveBatch::GetSupportedSimdLevel()); ++level)
+	{
+		const PMoveBatch::ESimdLevel simdLevel = static_cast<PMoveBatch::ESimdLevel>(level);
+		const std::string name = std::string("system-") + PMoveBatch::GetSimdLevelName(simdLevel);
+		Report(name.c_str(), RunSystem(playerCount, tickCount, params, dt, simdLevel), components, playerCount, tickCount);
+	}
+
+	return 0;
+}
@@ -0,0 +1,387 @@
+////////////////////////////////////////////////////////
+// Headless movement tuning reload benchmark
+// Checks that every ruleset's tuning survives a round trip through a
+// profile bit for bit, and that unknown names and malformed values are
+// rejected without touching the params. Then runs a server stepping
+// strafe jumping players at 60 Hz while the profile is rewritten between
+// ticks, with a broken file every few reloads, and reports how long a
+// change took to reach the players and what picking up the newest
+// profile costs the game thread. Last, the file is rewritten every few
+// polls, in place, while the game thread acquires in a tight loop,
+// every field of a profile holding the same value, so a profile freed or
+// changed while still held shows up as mixed values (or, built with
+// -fsanitize=address, as a use after free).
+//
+// Build (from the repository root):
+//   g++ -O2 -std=c++17 -pthread -I. -IBenchmark Benchmark/MovementTuningBenchmark.cpp MovementTuning.cpp PlayerMovement.cpp PlayerMovementSystem.cpp PlayerMovementBatch.cpp MovementRuleset.cpp WorkStealingPool.cpp -o movement_tuning_bench
+// Usage:
+//   movement_tuning_bench [reloads] [players] [poll interval ms]
+////////////////////////////////////////////////////////
+
+#include "BenchmarkCommon.h"
+#include "MovementRuleset.h"
+#include "MovementTuning.h"
+#include "PlayerMovementSystem.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	const char* const ProfileFileName = "movement_tuning_bench.cfg";
+	// A reload that takes longer than this counts as lost
+	const double ReloadTimeout = 2.0;
+
+	bool IsEqual(const PMoveParams& a, const PMoveParams& b)
+	{
+		const float valuesA[] = { a.gravity, a.friction, a.moveSpeed, a.runAcceleration, a.runDeacceleration, a.airAcceleration, a.airDecceleration, a.airControl, a.sideStrafeAcceleration, a.sideStrafeSpeed, a.jumpSpeed, a.jumpImpulse };
+		const float valuesB[] = { b.gravity, b.friction, b.moveSpeed, b.runAcceleration, b.runDeacceleration, b.airAcceleration, b.airDecceleration, b.airControl, b.sideStrafeAcceleration, b.sideStrafeSpeed, b.jumpSpeed, b.jumpImpulse };
+		return std::memcmp(valuesA, valuesB, sizeof(valuesA)) == 0 && a.holdJumpToBhop == b.holdJumpToBhop;
+	}
+
+	bool WriteProfile(const char* szText)
+	{
+		FILE* pFile = std::fopen(ProfileFileName, "wb");
+		if (pFile == nullptr)
+			return false;
+
+		std::fputs(szText, pFile);
+		std::fclose(pFile);
+		return true;
+	}
+
+	bool WriteProfile(const PMoveParams& params)
+	{
+		char text[1024];
+		return PMoveTuning::Write(params, text, sizeof(text)) > 0 && WriteProfile(text);
+	}
+
+	// Round trips of every ruleset, a partial profile and the malformed lines Parse has to reject
+	uint32_t CheckParse()
+	{
+		uint32_t failures = 0;
+		for (uint32_t i = 0; i < PMoveRulesets::GetCount(); ++i)
+		{
+			const SMovementRuleset& ruleset = PMoveRulesets::Get(i);
+			PMoveParams odd = ruleset.defaultParams;
+			odd.airAcceleration = 1.f / 3.f;
+			odd.gravity = 9.80665e-3f;
+			odd.holdJumpToBhop = !odd.holdJumpToBhop;
+
+			for (const PMoveParams& params : { ruleset.defaultParams, odd })
+			{
+				char text[1024];
+				char szError[128] = {};
+				PMoveParams parsed;
+				parsed.holdJumpToBhop = !params.holdJumpToBhop;
+				if (PMoveTuning::Write(params, text, sizeof(text)) == 0 || !PMoveTuning::Parse(text, parsed, szError, sizeof(szError)) || !IsEqual(parsed, params))
+				{
+					std::printf("  %s: round trip failed %s\n", ruleset.szName, szError);
+					++failures;
+				}
+			}
+		}
+
+		const PMoveParams base;
+		PMoveParams expected = base;
+		expected.airAcceleration = 12.f;
+		expected.friction = 5.5f;
+		expected.holdJumpToBhop = true;
+		PMoveParams parsed = base;
+		char szError[128] = {};
+		if (!PMoveTuning::Parse("# Faster air\n  airAcceleration = 12 # was 2\n\n\tfriction=5.5\r\nholdJumpToBhop = true", parsed, szError, sizeof(szError)) || !IsEqual(parsed, expected))
+		{
+			std::printf("  partial profile: %s\n", szError[0] != '\0' ? szError : "wrong values");
+			++failures;
+		}
+
+		const char* const malformed[] =
+		{
+			"airAcceleration = 12\nairAcceleraton = 12",
+			"friction = fast",
+			"friction =",
+			"friction 6",
+			"friction = 6 6",
+			"gravity = inf",
+			"holdJumpToBhop = 2",
+			"= 3",
+		};
+		for (const char* szText : malformed)
+		{
+			PMoveParams rejected = base;
+			szError[0] = '\0';
+			if (PMoveTuning::Parse(szText, rejected, szError, sizeof(szError)) || szError[0] == '\0' || !IsEqual(rejected, base))
+			{
+				std::printf("  accepted or changed params: \"%s\"\n", szText);
+				++failures;
+			}
+		}
+
+		char small[32];
+		if (PMoveTuning::Write(base, small, sizeof(small)) != 0)
+		{
+			std::printf("  Write overran a small buffer\n");
+			++failures;
+		}
+		return failures;
+	}
+
+	struct SReloadResult
+	{
+		int reloads = 0;
+		int rejected = 0;
+		uint32_t failures = 0;
+		std::vector<double> latencies;
+		uint64_t acquireCount = 0;
+		double acquireSeconds = 0.0;
+		double applySeconds = 0.0;
+	};
+
+	// Plays the server: acquire the newest profile at the start of every tick, apply it to every player, step
+	void RunReloads(int reloadCount, int playerCount, float pollInterval, SReloadResult& result)
+	{
+		const float dt = 1.f / CFixedTimestep::DefaultTickRate;
+		const PMoveParams base = PMoveRulesets::GetDefault().defaultParams;
+
+		std::vector<SSimulatedPlayer> players = CreatePlayers(playerCount);
+		CPlayerMovementSystem movementSystem;
+		for (int i = 0; i < playerCount; ++i)
+		{
+			const CPlayerMovementSystem::Handle handle = movementSystem.Add();
+			movementSystem.SetAlive(handle, true);
+			movementSystem.SetState(handle, players[i].state);
+		}
+
+		WriteProfile(base);
+		CMovementTuningWatcher watcher;
+		watcher.Start(ProfileFileName, base, pollInterval);
+
+		PMoveParams expected = base;
+		uint32_t appliedVersion = 0;
+		int tick = 0;
+		for (int reload = 0; reload <= reloadCount; ++reload)
+		{
+			// Every fifth reload is broken and has to leave the players as they are
+			const bool isBroken = reload > 0 && reload % 5 == 0;
+			if (reload > 0)
+			{
+				if (isBroken)
+				{
+					WriteProfile("airAcceleration = 12\nfriction = fast\n");
+				}
+				else
+				{
+					expected.airAcceleration = 10.f + reload * 0.5f;
+					expected.friction = 4.f + reload * 0.125f;
+					expected.jumpSpeed = 250.f + reload;
+					WriteProfile(expected);
+				}
+			}
+
+			const Clock::time_point writeTime = Clock::now();
+			bool isDone = false;
+			while (!isDone && GetSecondsSince(writeTime) < ReloadTimeout)
+			{
+				const Clock::time_point tickStart = Clock::now();
+				const SMovementTuningProfile* pProfile = watcher.Acquire();
+				result.acquireSeconds += GetSecondsSince(tickStart);
+				++result.acquireCount;
+
+				if (pProfile != nullptr && pProfile->version != appliedVersion)
+				{
+					appliedVersion = pProfile->version;
+					isDone = true;
+					if (pProfile->szError[0] != '\0')
+					{
+						++result.rejected;
+						if (!isBroken)
+						{
+							std::printf("  reload %d rejected: %s\n", reload, pProfile->szError);
+							++result.failures;
+						}
+					}
+					else
+					{
+						const Clock::time_point applyStart = Clock::now();
+						movementSystem.SetDefaultParams(pProfile->params);
+						result.applySeconds += GetSecondsSince(applyStart);
+						++result.reloads;
+					}
+					if (reload > 0)
+					{
+						result.latencies.push_back(GetSecondsSince(writeTime));
+					}
+				}
+
+				for (int i = 0; i < playerCount; ++i)
+				{
+					const Cmd cmd = GetScriptedCmd(i, tick, players[i].state, dt);
+					movementSystem.SetInput(static_cast<CPlayerMovementSystem::Handle>(i), cmd, players[i].state.yaw, players[i].state.onGround);
+				}
+				movementSystem.Step(dt);
+				const PMoveParams& params = movementSystem.GetDefaultParams();
+				for (int i = 0; i < playerCount; ++i)
+				{
+					const CPlayerMovementSystem::Handle handle = static_cast<CPlayerMovementSystem::Handle>(i);
+					players[i].state = movementSystem.GetState(handle);
+					players[i].state.jumped = movementSystem.ConsumeJump(handle);
+					StepWorld(players[i], params, dt);
+					movementSystem.SetState(handle, players[i].state);
+				}
+				++tick;
+
+				// Ticks at 60 Hz, the watcher gets the rest of the frame
+				const double remaining = dt - GetSecondsSince(tickStart);
+				if (remaining > 0.0)
+				{
+					std::this_thread::sleep_for(std::chrono::duration<double>(remaining));
+				}
+			}
+
+			if (!isDone)
+			{
+				std::printf("  reload %d never arrived\n", reload);
+				++result.failures;
+				continue;
+			}
+
+			uint32_t mismatches = 0;
+			for (int i = 0; i < playerCount; ++i)
+			{
+				mismatches += IsEqual(movementSystem.GetParams(static_cast<CPlayerMovementSystem::Handle>(i)), expected) ? 0 : 1;
+			}
+			if (mismatches > 0)
+			{
+				std::printf("  reload %d: %u players move by other params\n", reload, mismatches);
+				++result.failures;
+			}
+		}
+
+		// A missing file keeps the last profile in place
+		std::remove(ProfileFileName);
+		const Clock::time_point removeTime = Clock::now();
+		while (watcher.GetMissingCount() == 0 && GetSecondsSince(removeTime) < ReloadTimeout)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		const SMovementTuningProfile* pProfile = watcher.Acquire();
+		if (watcher.GetMissingCount() == 0 || pProfile == nullptr || pProfile->version != appliedVersion)
+		{
+			std::printf("  a missing file wasn't noticed or replaced the profile\n");
+			++result.failures;
+		}
+		watcher.Stop();
+	}
+
+	struct SChurnResult
+	{
+		uint64_t acquireCount = 0;
+		double acquireSeconds = 0.0;
+		uint32_t writes = 0;
+		uint32_t versions = 0;
+		uint64_t tornReads = 0;
+	};
+
+	// The file changes every poll while the game thread acquires and reads profiles nonstop
+	void RunChurn(double seconds, float pollInterval, SChurnResult& result)
+	{
+		WriteProfile("");
+		CMovementTuningWatcher watcher;
+		watcher.Start(ProfileFileName, PMoveParams(), pollInterval);
+
+		std::atomic<bool> isWriting{ true };
+		std::thread writerThread([&isWriting, &result, pollInterval]()
+		{
+			while (isWriting.load(std::memory_order_relaxed))
+			{
+				PMoveParams params;
+				const float value = static_cast<float>(++result.writes);
+				params.gravity = params.friction = params.moveSpeed = value;
+				params.runAcceleration = params.runDeacceleration = value;
+				params.airAcceleration = params.airDecceleration = params.airControl = value;
+				params.sideStrafeAcceleration = params.sideStrafeSpeed = value;
+				params.jumpSpeed = params.jumpImpulse = value;
+				WriteProfile(params);
+				// New contents are only published once they held for a poll
+				std::this_thread::sleep_for(std::chrono::duration<float>(pollInterval * 3.f));
+			}
+		});
+
+		uint32_t lastVersion = 0;
+		const Clock::time_point start = Clock::now();
+		while (GetSecondsSince(start) < seconds)
+		{
+			const Clock::time_point acquireStart = Clock::now();
+			for (int i = 0; i < 1000; ++i)
+			{
+				const SMovementTuningProfile* pProfile = watcher.Acquire();
+				if (pProfile == nullptr)
+					continue;
+
+				const PMoveParams& p = pProfile->params;
+				const float values[] = { p.friction, p.moveSpeed, p.runAcceleration, p.runDeacceleration, p.airAcceleration, p.airDecceleration, p.airControl, p.sideStrafeAcceleration, p.sideStrafeSpeed, p.jumpSpeed, p.jumpImpulse };
+				const bool isTorn = pProfile->version > 1 && std::any_of(std::begin(values), std::end(values), [&p](float value) { return value != p.gravity; });
+				result.tornReads += isTorn ? 1 : 0;
+				result.versions += pProfile->version != lastVersion ? 1 : 0;
+				lastVersion = pProfile->version;
+			}
+			result.acquireSeconds += GetSecondsSince(acquireStart);
+			result.acquireCount += 1000;
+			// Leaves the watcher the core on a single core machine
+			std::this_thread::yield();
+		}
+
+		isWriting.store(false, std::memory_order_relaxed);
+		writerThread.join();
+		watcher.Stop();
+		std::remove(ProfileFileName);
+	}
+
+	double GetPercentile(std::vector<double> values, double percentile)
+	{
+		if (values.empty())
+			return 0.0;
+
+		std::sort(values.begin(), values.end());
+		return values[std::min(values.size() - 1, static_cast<size_t>(percentile * values.size()))];
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const int reloadCount = argc > 1 ? std::atoi(argv[1]) : 20;
+	const int playerCount = argc > 2 ? std::atoi(argv[2]) : 256;
+	const int pollMilliseconds = argc > 3 ? std::atoi(argv[3]) : 50;
+
+	if (reloadCount <= 0 || playerCount <= 0 || pollMilliseconds <= 0)
+	{
+		std::fprintf(stderr, "usage: %s [reloads] [players] [poll interval ms]\n", argv[0]);
+		return 1;
+	}
+	const float pollInterval = pollMilliseconds / 1000.f;
+
+	std::printf("movement tuning: parsing\n");
+	const uint32_t parseFailures = CheckParse();
+	std::printf("  %u rulesets round trip, %u failures\n", PMoveRulesets::GetCount(), parseFailures);
+
+	SReloadResult reload;
+	RunReloads(reloadCount, playerCount, pollInterval, reload);
+	std::printf("hot reload: %d players at 60 Hz, profile polled every %d ms\n", playerCount, pollMilliseconds);
+	std::printf("  %d reloads applied, %d broken files rejected, %u failures\n", reload.reloads - 1, reload.rejected, reload.failures);
+	std::printf("  write to tick latency ms: p50 %.1f, p95 %.1f, max %.1f\n", GetPercentile(reload.latencies, 0.5) * 1e3, GetPercentile(reload.latencies, 0.95) * 1e3, GetPercentile(reload.latencies, 1.0) * 1e3);
+	std::printf("  per tick: Acquire %.1f ns, per reload: SetDefaultParams %.1f us\n", reload.acquireSeconds * 1e9 / reload.acquireCount, reload.reloads > 0 ? reload.applySeconds * 1e6 / reload.reloads : 0.0);
+
+	SChurnResult churn;
+	RunChurn(1.0, pollInterval / 10.f, churn);
+	std::printf("churn: file rewritten every %.1f ms, polled every %.1f ms, while acquiring nonstop\n", pollMilliseconds * 0.3f, pollMilliseconds / 10.f);
+	std::printf("  %u writes, %u versions acquired, %llu torn reads, Acquire %.1f ns\n", churn.writes, churn.versions, static_cast<unsigned long long>(churn.tornReads), churn.acquireSeconds * 1e9 / churn.acquireCount);
+
+	const bool hasFailed = parseFailures > 0 || reload.failures > 0 || churn.tornReads > 0 || churn.versions < 2;
+	return hasFailed ? 1 : 0;
+}
@@ -0,0 +1,343 @@
+////////////////////////////////////////////////////////
+// Headless movement validation benchmark
+// Plays scripted clients into CMovementValidator the way the server
+// records its remote players: human-like strafe jumpers, timed hoppers
+// and key spammers, and cheats that speed up their clock, script their
+// jumps or their turns, or get carried by physics. Reports when each
+// group got flagged and how long validating a tick of many players takes,
+// with and without the job pool. Fails if an honest player is ever
+// flagged, or a cheat gets away.
+//
+// Build (from the repository root):
+//   g++ -O2 -std=c++17 -pthread -I. -IBenchmark Benchmark/MovementValidatorBenchmark.cpp MovementValidator.cpp PlayerMovement.cpp PlayerMovementBatch.cpp MovementRuleset.cpp WorkStealingPool.cpp -o movement_validator_bench
+// Usage:
+//   movement_validator_bench [seconds] [players] [max threads]
+////////////////////////////////////////////////////////
+
+#include "BenchmarkCommon.h"
+#include "MovementValidator.h"
+#include "WorkStealingPool.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	enum class EScript
+	{
+		Strafe,                           // Strafe jumping by hand, jump held
+		TimedHops,                        // The same without hold to bhop, jump pressed a little before landing
+		KeySpam,
+		Timescale,                        // Strafe jumping with the client's clock 10% fast
+		ScriptedHops,                     // Jump pressed on the landing tick, every hop
+		Autostrafe,                       // The view turned for the best air acceleration every tick
+		Speed,                            // Physics carries the player farther than its velocity
+		Teleport,                         // Physics moves the player across the map once
+		Count
+	};
+
+	struct SScriptDesc
+	{
+		const char* szName;
+		const char* szRuleset;
+		int expectedAnomaly;              // -1 for honest players
+	};
+
+	const SScriptDesc Scripts[] =
+	{
+		{ "strafe", "q3", -1 },
+		{ "timed hops", "cpma", -1 },
+		{ "key spam", "q3", -1 },
+		{ "timescale", "q3", static_cast<int>(EMovementAnomaly::Timescale) },
+		{ "scripted hops", "cpma", static_cast<int>(EMovementAnomaly::PerfectBhop) },
+		{ "autostrafe", "q3", static_cast<int>(EMovementAnomaly::Autostrafe) },
+		{ "speed", "q3", static_cast<int>(EMovementAnomaly::Speed) },
+		{ "teleport", "q3", static_cast<int>(EMovementAnomaly::Teleport) },
+	};
+	static_assert(sizeof(Scripts) / sizeof(Scripts[0]) == static_cast<size_t>(EScript::Count), "Every script needs a description");
+
+	const float TimescaleRate = 1.1f;
+	const float SpeedFactor = 1.8f;
+	const float TeleportMeters = 30.f;
+	const float TeleportSeconds = 10.f;
+
+	struct SClient
+	{
+		EScript script = EScript::Strafe;
+		const SMovementRuleset* pRuleset = nullptr;
+		PMoveParams params;
+		SSimulatedPlayer player;
+		std::mt19937 random;
+
+		float yaw = 0.f;
+		float strafeSign = 1.f;
+		int nextStrafeSwitchTick = 0;
+		bool isJumpHeld = false;
+		double cmdSequence = 0.0;
+
+		uint8_t seenFlags = 0;
+		int firstFlagTick = -1;
+	};
+
+	float GetHorizontalSpeed(const PMoveVec3& velocity)
+	{
+		return std::sqrt(velocity.x * velocity.x + velocity.y * velocity.y);
+	}
+
+	// Brute force over the whole circle, then finer around the best half degree, independent of how the validator searches
+	float GetBestYaw(const SClient& client, const Cmd& cmd, float dt)
+	{
+		const int steps = 720;
+		const float step = 6.2831853f / steps;
+		float bestYaw = client.yaw;
+		float bestSpeed = -1.f;
+		for (int pass = 0; pass < 2; ++pass)
+		{
+			const float first = pass == 0 ? 0.f : bestYaw - step;
+			const float passStep = pass == 0 ? step : 2.f * step / steps;
+			for (int i = 0; i < steps; ++i)
+			{
+				PMoveState state = client.player.state;
+				state.yaw = first + passStep * static_cast<float>(i);
+				const float speed = GetHorizontalSpeed(client.pRuleset->pMove(state, client.params, cmd, dt).velocity);
+				if (speed > bestSpeed)
+				{
+					bestSpeed = speed;
+					bestYaw = state.yaw;
+				}
+			}
+		}
+		return bestYaw;
+	}
+
+	// One tick of the client's hands, what the server decodes from its commands
+	Cmd GetCmd(SClient& client, int tick, float dt)
+	{
+		std::uniform_real_distribution<float> unit(0.f, 1.f);
+		std::normal_distribution<float> jitter(0.f, 0.01f);
+		const PMoveState& state = client.player.state;
+
+		Cmd cmd;
+		cmd.forwardMove = 1.f;
+		cmd.jump = true;
+
+		// Swap the strafe key and the turn every half second or so, with an unsteady hand
+		if (tick >= client.nextStrafeSwitchTick)
+		{
+			client.strafeSign = -client.strafeSign;
+			client.nextStrafeSwitchTick = tick + 25 + static_cast<int>(unit(client.random) * 20.f);
+		}
+		cmd.rightMove = client.strafeSign;
+		client.yaw += client.strafeSign * 2.5f * (0.8f + 0.4f * unit(client.random)) * dt + jitter(client.random);
+
+		switch (client.script)
+		{
+		case EScript::TimedHops:
+			// Pressed at some point on the way down, or late on the ground, and held until the jump
+			if (!client.isJumpHeld && ((!state.onGround && state.velocity.z < 0.f && unit(client.random) < 0.15f) || (state.onGround && unit(client.random) < 0.5f)))
+			{
+				client.isJumpHeld = true;
+			}
+			else if (client.isJumpHeld && !state.onGround && state.velocity.z > 0.f)
+			{
+				client.isJumpHeld = false;
+			}
+			cmd.jump = client.isJumpHeld;
+			break;
+		case EScript::ScriptedHops:
+			cmd.jump = state.onGround;
+			break;
+		case EScript::KeySpam:
+			cmd.forwardMove = static_cast<float>(static_cast<int>(client.random() % 3) - 1);
+			cmd.rightMove = static_cast<float>(static_cast<int>(client.random() % 3) - 1);
+			cmd.jump = unit(client.random) < 0.5f;
+			client.yaw += (unit(client.random) - 0.5f) * 0.4f;
+			break;
+		case EScript::Autostrafe:
+			// Side strafing in the air, where the best angle is the narrowest
+			if (!state.onGround)
+			{
+				cmd.forwardMove = 0.f;
+				client.yaw = GetBestYaw(client, cmd, dt);
+			}
+			break;
+		default:
+			break;
+		}
+
+		cmd.yaw = client.yaw;
+		client.cmdSequence += client.script == EScript::Timescale ? TimescaleRate : 1.0;
+		cmd.sequence = static_cast<uint32_t>(client.cmdSequence);
+		return cmd;
+	}
+
+	void CreateClients(std::vector<SClient>& clients, int playerCount, EScript onlyScript)
+	{
+		clients.resize(playerCount);
+		for (int i = 0; i < playerCount; ++i)
+		{
+			SClient& client = clients[i];
+			client.script = onlyScript != EScript::Count ? onlyScript : static_cast<EScript>(i % static_cast<int>(EScript::Count));
+			client.pRuleset = PMoveRulesets::Find(Scripts[static_cast<int>(client.script)].szRuleset);
+			client.params = client.pRuleset->defaultParams;
+			client.random.seed(static_cast<uint32_t>(i) * 7919u + 13u);
+			client.yaw = 0.37f * static_cast<float>(i);
+			client.player.state.onGround = true;
+			client.player.position = PMoveVec3(static_cast<float>(i) * 1000.f, 0.f, 0.f);
+		}
+	}
+
+	// Runs the clients' ticks, records them like the server and validates every tick. Returns the seconds spent in Validate.
+	double Run(std::vector<SClient>& clients, CMovementValidator& validator, int tickCount, float dt, CWorkStealingPool* pPool)
+	{
+		double validateSeconds = 0.0;
+		for (int tick = 0; tick < tickCount; ++tick)
+		{
+			validator.BeginTick();
+			for (size_t i = 0; i < clients.size(); ++i)
+			{
+				SClient& client = clients[i];
+				SSimulatedPlayer& player = client.player;
+
+				// CPlayerMovementSystem::SetInput, then what the server records before the step
+				const Cmd cmd = GetCmd(client, tick, dt);
+				player.state.yaw = cmd.yaw;
+				PMove::QueueJump(player.state, client.params, cmd);
+
+				SMovementValidationInput input;
+				input.cmd = cmd;
+				input.state = player.state;
+				input.params = client.params;
+				// Physics is handed kernel velocities scaled by the tick interval, so that is also the size of a kernel unit in meters
+				input.position = player.position * dt;
+				input.time = static_cast<double>(tick + 1) * dt;
+				input.newestCmdSequence = cmd.sequence;
+				validator.Record(static_cast<uint32_t>(i), input);
+
+				const PMoveVec3 start = player.position;
+				player.state = client.pRuleset->pMove(player.state, client.params, cmd, dt);
+				StepWorld(player, client.params, dt);
+				if (client.script == EScript::Speed)
+				{
+					const PMoveVec3 step = player.position - start;
+					player.position.x += step.x * (SpeedFactor - 1.f);
+					player.position.y += step.y * (SpeedFactor - 1.f);
+				}
+				if (client.script == EScript::Teleport && tick == static_cast<int>(TeleportSeconds / dt))
+				{
+					player.position.x += TeleportMeters / dt;
+				}
+			}
+
+			const Clock::time_point start = Clock::now();
+			validator.Validate(dt, pPool);
+			validateSeconds += GetSecondsSince(start);
+
+			for (size_t i = 0; i < clients.size(); ++i)
+			{
+				SClient& client = clients[i];
+				const uint8_t flags = validator.GetReport(static_cast<uint32_t>(i)).flags;
+				if (flags != 0 && client.firstFlagTick < 0)
+				{
+					client.firstFlagTick = tick;
+				}
+				client.seenFlags |= flags;
+			}
+		}
+		return validateSeconds;
+	}
+
+	void PrintFlags(uint8_t flags)
+	{
+		for (uint32_t a = 0; a < static_cast<uint32_t>(EMovementAnomaly::Count); ++a)
+		{
+			if (flags & SMovementValidationReport::GetFlag(static_cast<EMovementAnomaly>(a)))
+			{
+				std::printf(" %s", CMovementValidator::GetAnomalyName(static_cast<EMovementAnomaly>(a)));
+			}
+		}
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const float seconds = argc > 1 ? static_cast<float>(std::atof(argv[1])) : 30.f;
+	const int playerCount = argc > 2 ? std::atoi(argv[2]) : 128;
+	const unsigned int hardwareThreads = std::thread::hardware_concurrency();
+	const int maxThreadCount = argc > 3 ? std::atoi(argv[3]) : static_cast<int>(hardwareThreads > 0 ? hardwareThreads : 1);
+
+	if (seconds <= 0.f || playerCount <= 0 || playerCount > static_cast<int>(CMovementValidator::MaxPlayers) || maxThreadCount <= 0)
+	{
+		std::fprintf(stderr, "usage: %s [seconds] [players, up to %u] [max threads]\n", argv[0], CMovementValidator::MaxPlayers);
+		return 1;
+	}
+
+	const float dt = 1.f / CFixedTimestep::DefaultTickRate;
+	const int tickCount = static_cast<int>(seconds / dt);
+	const int groupSize = 16;
+	uint32_t failures = 0;
+
+	std::printf("movement validation: %.0f s @ %.0f Hz, %d clients per script\n", seconds, CFixedTimestep::DefaultTickRate, groupSize);
+	std::printf("  %-14s %-5s | flagged | first flag s | cmd rate | perfect hops | strafe efficiency | flags seen\n", "script", "rules");
+	for (int s = 0; s < static_cast<int>(EScript::Count); ++s)
+	{
+		const SScriptDesc& desc = Scripts[s];
+		std::vector<SClient> clients;
+		CreateClients(clients, groupSize, static_cast<EScript>(s));
+		CMovementValidator validator;
+		validator.SetRuleset(*PMoveRulesets::Find(desc.szRuleset));
+		Run(clients, validator, tickCount, dt, nullptr);
+
+		int flaggedCount = 0;
+		int firstFlagTick = -1;
+		uint8_t seenFlags = 0;
+		bool hasFailed = false;
+		const uint8_t expectedFlag = desc.expectedAnomaly >= 0 ? SMovementValidationReport::GetFlag(static_cast<EMovementAnomaly>(desc.expectedAnomaly)) : 0;
+		SMovementValidationReport mean;
+		for (int i = 0; i < groupSize; ++i)
+		{
+			const SClient& client = clients[i];
+			const SMovementValidationReport& report = validator.GetReport(static_cast<uint32_t>(i));
+			flaggedCount += client.seenFlags != 0 ? 1 : 0;
+			firstFlagTick = client.firstFlagTick >= 0 && (firstFlagTick < 0 || client.firstFlagTick < firstFlagTick) ? client.firstFlagTick : firstFlagTick;
+			seenFlags |= client.seenFlags;
+			mean.cmdRate += report.cmdRate / groupSize;
+			mean.perfectHopShare += report.perfectHopShare / groupSize;
+			mean.strafeEfficiency += report.strafeEfficiency / groupSize;
+
+			// Cheats may trip a second check on the way, the one they are caught by is what matters
+			hasFailed = hasFailed || (expectedFlag != 0 ? (client.seenFlags & expectedFlag) == 0 : client.seenFlags != 0);
+		}
+
+		std::printf("  %-14s %-5s | %4d/%-2d | %12.2f | %8.3f | %12.2f | %17.2f |", desc.szName, desc.szRuleset, flaggedCount, groupSize,
+			firstFlagTick >= 0 ? firstFlagTick * dt : 0.f, mean.cmdRate, mean.perfectHopShare, mean.strafeEfficiency);
+		PrintFlags(seenFlags);
+		std::printf("%s\n", hasFailed ? (expectedFlag != 0 ? "  MISSED" : "  FALSE POSITIVE") : "");
+		failures += hasFailed ? 1 : 0;
+	}
+
+	// Every script mixed, the way a full server validates
+	std::printf("  validate %d players, all scripts mixed\n", playerCount);
+	for (int threads = 1; ; threads *= 2)
+	{
+		threads = threads > maxThreadCount ? maxThreadCount : threads;
+
+		// The calling thread works along, so one thread means no workers
+		std::vector<SClient> clients;
+		CreateClients(clients, playerCount, EScript::Count);
+		CMovementValidator validator;
+		CWorkStealingPool pool(static_cast<uint32_t>(threads - 1));
+		const double validateSeconds = Run(clients, validator, tickCount, dt, threads > 1 ? &pool : nullptr);
+
+		const double tickMicroseconds = validateSeconds * 1e6 / tickCount;
+		std::printf("    %2d threads: %8.2f us/tick, %6.1f ns/player, %5.2f%% of the tick budget\n", threads,
+			tickMicroseconds, tickMicroseconds * 1e3 / playerCount, tickMicroseconds * 1e-6 * CFixedTimestep::DefaultTickRate * 100.0);
+		if (threads == maxThreadCount)
+			break;
+	}
+
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,135 @@
+////////////////////////////////////////////////////////
+// Headless parallel movement benchmark
+// Runs the movement tick as the game does, gathering every player's
+// input, stepping the batch and scattering the results to a flat floor,
+// with the step split across a growing number of pool threads. Reports
+// the time per tick of each stage and the speedup of the step over one
+// thread, and fails if any thread count ends up somewhere else than the
+// single threaded run. Speedups are marked when there are more threads
+// than the hardware runs at once, and with a single hardware thread the
+// run says it doesn't measure scaling.
+//
+// Build (from the repository root):
+//   g++ -O2 -std=c++17 -pthread -I. -IBenchmark Benchmark/ParallelBenchmark.cpp PlayerMovement.cpp PlayerMovementSystem.cpp PlayerMovementBatch.cpp MovementRuleset.cpp WorkStealingPool.cpp -o parallel_bench
+// Usage:
+//   parallel_bench [players] [ticks] [max threads]
+////////////////////////////////////////////////////////
+
+#include "BenchmarkCommon.h"
+#include "PlayerMovementSystem.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	struct SStageSeconds
+	{
+		double gather = 0.0;
+		double step = 0.0;
+		double scatter = 0.0;
+		double checksum = 0.0;
+		uint64_t stolenCount = 0;
+	};
+
+	SStageSeconds Run(int playerCount, int tickCount, int threadCount, const PMoveParams& params, float dt)
+	{
+		SStageSeconds result;
+		std::vector<SSimulatedPlayer> players = CreatePlayers(playerCount);
+
+		// The calling thread works along, so one thread means no workers
+		CWorkStealingPool pool(static_cast<uint32_t>(threadCount - 1));
+		CPlayerMovementSystem movementSystem;
+		movementSystem.SetJobPool(threadCount > 1 ? &pool : nullptr);
+
+		std::vector<CPlayerMovementSystem::Handle> handles;
+		for (int i = 0; i < playerCount; ++i)
+		{
+			handles.push_back(movementSystem.Add(params));
+			movementSystem.SetAlive(handles.back(), true);
+		}
+
+		for (int tick = 0; tick < tickCount; ++tick)
+		{
+			Clock::time_point start = Clock::now();
+			for (int i = 0; i < playerCount; ++i)
+			{
+				const Cmd cmd = GetScriptedCmd(i, tick, players[i].state, dt);
+				movementSystem.SetInput(handles[i], cmd, players[i].state.yaw, players[i].state.onGround);
+			}
+			result.gather += GetSecondsSince(start);
+
+			start = Clock::now();
+			movementSystem.Step(dt);
+			result.step += GetSecondsSince(start);
+
+			start = Clock::now();
+			for (int i = 0; i < playerCount; ++i)
+			{
+				players[i].state = movementSystem.GetState(handles[i]);
+				movementSystem.ConsumeJump(handles[i]);
+				StepWorld(players[i], params, dt);
+				movementSystem.SetState(handles[i], players[i].state);
+			}
+			result.scatter += GetSecondsSince(start);
+		}
+
+		result.checksum = GetChecksum(players);
+		result.stolenCount = pool.GetStolenCount();
+		return result;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const int tickCount = argc > 2 ? std::atoi(argv[2]) : 2000;
+	const unsigned int hardwareThreads = std::thread::hardware_concurrency();
+	const int maxThreadCount = argc > 3 ? std::atoi(argv[3]) : static_cast<int>(hardwareThreads > 0 ? hardwareThreads : 1);
+
+	// Without a player count, a full server and two sizes where the step outweighs waking the pool
+	std::vector<int> playerCounts = { 128, 1024, 8192 };
+	if (argc > 1)
+	{
+		playerCounts = { std::atoi(argv[1]) };
+	}
+
+	if (playerCounts[0] <= 0 || tickCount <= 0 || maxThreadCount <= 0)
+	{
+		std::fprintf(stderr, "usage: %s [players] [ticks] [max threads]\n", argv[0]);
+		return 1;
+	}
+
+	const PMoveParams params;
+	const float dt = 1.f / CFixedTimestep::DefaultTickRate;
+	int errors = 0;
+
+	std::printf("parallel: %d ticks, %u hardware threads, %s\n", tickCount, hardwareThreads, PMoveBatch::GetSimdLevelName(PMoveBatch::GetSupportedSimdLevel()));
+	if (hardwareThreads < 2)
+	{
+		// hardware_concurrency is 0 when unknown, which is treated the same
+		std::printf("  fewer than 2 hardware threads: the pool threads share one core, the speedups below don't measure scaling\n");
+	}
+	for (const int playerCount : playerCounts)
+	{
+		std::printf("  %d players, %u per job\n", playerCount, CPlayerMovementSystem::PlayersPerJob);
+		std::printf("    %7s %12s %12s %12s %8s %8s\n", "threads", "gather us", "step us", "scatter us", "speedup", "stolen");
+
+		const SStageSeconds single = Run(playerCount, tickCount, 1, params, dt);
+		for (int threadCount = 1; threadCount <= maxThreadCount; ++threadCount)
+		{
+			const SStageSeconds result = threadCount == 1 ? single : Run(playerCount, tickCount, threadCount, params, dt);
+			const bool isSame = result.checksum == single.checksum;
+			errors += isSame ? 0 : 1;
+
+			// More threads than the hardware runs at once only time slice, their speedup is marked
+			const bool isOversubscribed = threadCount > 1 && static_cast<unsigned int>(threadCount) > hardwareThreads;
+			std::printf("    %7d %12.3f %12.3f %12.3f %7.2fx %8llu%s%s\n", threadCount,
+				result.gather * 1e6 / tickCount, result.step * 1e6 / tickCount, result.scatter * 1e6 / tickCount,
+				single.step / result.step, static_cast<unsigned long long>(result.stolenCount), isOversubscribed ? "  oversubscribed" : "", isSame ? "" : "  MISMATCH");
+		}
+	}
+
+	return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,332 @@
+////////////////////////////////////////////////////////
+// Headless physics write back benchmark
+// Strafe jumping players step through the batch every tick and hand
+// their velocity to a stand-in physical world whose calls all take one
+// world lock, while a physics thread steps every entity under the same
+// lock. Once the way ApplyMovement used to: an impulse call on jumps
+// and a velocity call per player, in between the rest of its work.
+// Once through CPhysicsWriteBack: pushed per player, then submitted in
+// one pass, a jump frame's velocity set in jump mode. Like the living
+// entity, the stand-in ignores the vertical part of a walk request, so a
+// jump only gets through as an impulse or a jump. Reports per tick the
+// physics calls, the lock acquisitions of either thread that found the
+// lock taken and the time they waited, and the time of the whole hand
+// off and of the window from the first physics call to the last, which
+// is when the physics thread can run into them. Lock contention only
+// means something with the physics thread on a core of its own, with a
+// single hardware thread the two take turns and it is marked as such.
+// Fails unless both ways leave every entity with bit identical velocities
+// and every jump reaches physics.
+//
+// Build (from the repository root):
+//   g++ -O2 -std=c++17 -pthread -I. -IBenchmark Benchmark/PhysicsWriteBackBenchmark.cpp PlayerMovement.cpp PlayerMovementSystem.cpp PlayerMovementBatch.cpp MovementRuleset.cpp WorkStealingPool.cpp -o physics_write_back_bench
+// Usage:
+//   physics_write_back_bench [players] [ticks]
+////////////////////////////////////////////////////////
+
+#include "BenchmarkCommon.h"
+#include "PhysicsWriteBack.h"
+#include "PlayerMovementSystem.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	const float Mass = 80.f;
+	// The physics thread steps every millisecond or so, holding the world lock while it does
+	const auto PhysicsInterval = std::chrono::microseconds(1000);
+
+	// Iterations of busy work per entity and step, a few microseconds like a living entity's collision checks
+	const int CollisionCost = 256;
+
+	struct SContention
+	{
+		uint64_t count = 0;
+		double seconds = 0.0;
+	};
+
+	// Stand-in for the physical world, every call from the main thread takes the world lock like a queued action
+	class CModelPhysics
+	{
+	public:
+		struct SEntity
+		{
+			PMoveVec3 requestedVelocity;      // Walk request, only its horizontal part is used
+			float pendingImpulse = 0.f;
+			bool hasPendingJump = false;
+			float jumpSpeed = 0.f;
+			PMoveVec3 velocity;
+			PMoveVec3 position;
+		};
+
+		explicit CModelPhysics(int entityCount) : m_entities(entityCount) {}
+
+		void AddImpulse(int entity, float impulse)
+		{
+			++m_callCount;
+			Lock(m_callContention);
+			m_entities[entity].pendingImpulse += impulse;
+			m_mutex.unlock();
+		}
+
+		// The controller's SetVelocity, a walk request
+		void SetVelocity(int entity, const PMoveVec3& velocity)
+		{
+			++m_callCount;
+			Lock(m_callContention);
+			m_entities[entity].requestedVelocity = velocity;
+			m_mutex.unlock();
+		}
+
+		// The controller's ChangeVelocity in jump mode, sets the velocity outright
+		void Jump(int entity, const PMoveVec3& velocity)
+		{
+			++m_callCount;
+			Lock(m_callContention);
+			SEntity& target = m_entities[entity];
+			target.requestedVelocity = velocity;
+			target.hasPendingJump = true;
+			target.jumpSpeed = velocity.z;
+			m_mutex.unlock();
+		}
+
+		// Every entity stands on the floor when a step starts, so the walk request moves it horizontally and only an impulse or a jump lifts it
+		void Step(float dt)
+		{
+			Lock(m_stepContention);
+			for (SEntity& entity : m_entities)
+			{
+				entity.velocity = PMoveVec3(entity.requestedVelocity.x, entity.requestedVelocity.y, entity.hasPendingJump ? entity.jumpSpeed : 0.f);
+				entity.velocity.z += entity.pendingImpulse / Mass;
+				entity.pendingImpulse = 0.f;
+				entity.hasPendingJump = false;
+				entity.position = entity.position + entity.velocity * dt;
+				// Stands in for collision, the part of a step that holds the lock for a while
+				for (int i = 0; i < CollisionCost; ++i)
+				{
+					entity.position.z = std::sqrt(entity.position.z * entity.position.z + 1e-6f);
+				}
+			}
+			m_mutex.unlock();
+		}
+
+		const std::vector<SEntity>& GetEntities() const { return m_entities; }
+		uint64_t GetCallCount() const { return m_callCount; }
+		// The main thread's calls waiting for a step, and the physics thread's steps waiting for a call
+		const SContention& GetCallContention() const { return m_callContention; }
+		const SContention& GetStepContention() const { return m_stepContention; }
+
+	private:
+		void Lock(SContention& contention)
+		{
+			if (m_mutex.try_lock())
+				return;
+
+			++contention.count;
+			const Clock::time_point start = Clock::now();
+			m_mutex.lock();
+			contention.seconds += GetSecondsSince(start);
+		}
+
+		std::mutex m_mutex;
+		std::vector<SEntity> m_entities;
+		uint64_t m_callCount = 0;
+		SContention m_callContention;
+		SContention m_stepContention;
+	};
+
+	struct SResult
+	{
+		uint64_t calls = 0;
+		SContention callContention;
+		SContention stepContention;
+		double handOffSeconds = 0.0;
+		double callWindowSeconds = 0.0;
+		uint64_t mismatches = 0;
+		uint64_t jumps = 0;
+		uint64_t jumpsInPhysics = 0;          // Steps that lifted an entity
+	};
+
+	// With a physics thread the hand off is timed against it, without one physics steps after every tick and both ways are compared
+	void Run(int playerCount, int tickCount, bool isThreaded, SResult& batched, SResult& perPlayer)
+	{
+		const float dt = 1.f / CFixedTimestep::DefaultTickRate;
+		const PMoveParams params;
+
+		std::vector<SSimulatedPlayer> players = CreatePlayers(playerCount);
+		CPlayerMovementSystem movementSystem;
+		for (int i = 0; i < playerCount; ++i)
+		{
+			movementSystem.SetAlive(movementSystem.Add(params), true);
+		}
+
+		CModelPhysics perPlayerPhysics(playerCount);
+		CModelPhysics batchedPhysics(playerCount);
+		CPhysicsWriteBack<int> writeBack;
+		writeBack.Reserve(playerCount);
+
+		std::atomic<bool> isRunning{ isThreaded };
+		std::atomic<CModelPhysics*> pSteppedPhysics{ nullptr };
+		std::thread physicsThread;
+		if (isThreaded)
+		{
+			physicsThread = std::thread([&isRunning, &pSteppedPhysics, dt]()
+			{
+				while (isRunning.load(std::memory_order_relaxed))
+				{
+					CModelPhysics* pPhysics = pSteppedPhysics.load(std::memory_order_acquire);
+					if (pPhysics != nullptr)
+					{
+						pPhysics->Step(dt);
+					}
+					std::this_thread::sleep_for(PhysicsInterval);
+				}
+			});
+		}
+
+		// Threaded, each way runs all ticks against the physics thread in turn, otherwise both ways share every tick
+		const int passCount = isThreaded ? 2 : 1;
+		for (int pass = 0; pass < passCount; ++pass)
+		{
+			const bool runsPerPlayer = !isThreaded || pass == 0;
+			const bool runsBatched = !isThreaded || pass == 1;
+			pSteppedPhysics.store(runsPerPlayer ? &perPlayerPhysics : &batchedPhysics, std::memory_order_release);
+
+			std::vector<SSimulatedPlayer> passPlayers = players;
+			for (int i = 0; i < playerCount; ++i)
+			{
+				movementSystem.SetState(static_cast<CPlayerMovementSystem::Handle>(i), passPlayers[i].state);
+			}
+			for (int tick = 0; tick < tickCount; ++tick)
+			{
+				for (int i = 0; i < playerCount; ++i)
+				{
+					const Cmd cmd = GetScriptedCmd(i, tick, passPlayers[i].state, dt);
+					movementSystem.SetInput(static_cast<CPlayerMovementSystem::Handle>(i), cmd, passPlayers[i].state.yaw, passPlayers[i].state.onGround);
+				}
+				movementSystem.Step(dt);
+
+				// ApplyMovement, with the flat floor as the rest of each player's per frame work
+				const Clock::time_point start = Clock::now();
+				for (int i = 0; i < playerCount; ++i)
+				{
+					const CPlayerMovementSystem::Handle handle = static_cast<CPlayerMovementSystem::Handle>(i);
+					const bool hasJumped = movementSystem.ConsumeJump(handle);
+					batched.jumps += hasJumped && !isThreaded ? 1 : 0;
+					SSimulatedPlayer& player = passPlayers[i];
+					player.state = movementSystem.GetState(handle);
+
+					if (runsPerPlayer)
+					{
+						if (hasJumped)
+						{
+							perPlayerPhysics.AddImpulse(i, params.jumpImpulse);
+						}
+						perPlayerPhysics.SetVelocity(i, player.state.velocity * dt);
+					}
+					if (runsBatched)
+					{
+						writeBack.Push(i, player.state.velocity * dt, hasJumped ? params.jumpImpulse / Mass : 0.f);
+					}
+
+					player.state.jumped = hasJumped;
+					StepWorld(player, params, dt);
+					movementSystem.SetState(handle, player.state);
+				}
+				const Clock::time_point submitStart = Clock::now();
+				writeBack.Submit([&batchedPhysics](int entity, const PMoveVec3& velocity, bool isJump)
+				{
+					if (isJump)
+					{
+						batchedPhysics.Jump(entity, velocity);
+					}
+					else
+					{
+						batchedPhysics.SetVelocity(entity, velocity);
+					}
+				});
+				SResult& result = runsPerPlayer ? perPlayer : batched;
+				result.handOffSeconds += GetSecondsSince(start);
+				result.callWindowSeconds += runsPerPlayer ? GetSecondsSince(start) : GetSecondsSince(submitStart);
+
+				if (isThreaded)
+					continue;
+
+				perPlayerPhysics.Step(dt);
+				batchedPhysics.Step(dt);
+				for (int i = 0; i < playerCount; ++i)
+				{
+					const PMoveVec3& a = perPlayerPhysics.GetEntities()[i].velocity;
+					const PMoveVec3& b = batchedPhysics.GetEntities()[i].velocity;
+					batched.mismatches += std::memcmp(&a, &b, sizeof(PMoveVec3)) == 0 ? 0 : 1;
+					perPlayer.jumpsInPhysics += a.z > 0.f ? 1 : 0;
+					batched.jumpsInPhysics += b.z > 0.f ? 1 : 0;
+				}
+			}
+		}
+
+		isRunning.store(false, std::memory_order_relaxed);
+		if (physicsThread.joinable())
+		{
+			physicsThread.join();
+		}
+
+		perPlayer.calls = perPlayerPhysics.GetCallCount();
+		perPlayer.callContention = perPlayerPhysics.GetCallContention();
+		perPlayer.stepContention = perPlayerPhysics.GetStepContention();
+		batched.calls = batchedPhysics.GetCallCount();
+		batched.callContention = batchedPhysics.GetCallContention();
+		batched.stepContention = batchedPhysics.GetStepContention();
+	}
+
+	void Print(const char* szName, const SResult& result, int tickCount)
+	{
+		std::printf("    %-33s %6.1f | %9.4f %9.3f | %9.4f %9.3f | %11.2f %14.2f\n", szName, static_cast<double>(result.calls) / tickCount,
+			static_cast<double>(result.callContention.count) / tickCount, result.callContention.seconds * 1e6 / tickCount,
+			static_cast<double>(result.stepContention.count) / tickCount, result.stepContention.seconds * 1e6 / tickCount,
+			result.handOffSeconds * 1e6 / tickCount, result.callWindowSeconds * 1e6 / tickCount);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const int playerCount = argc > 1 ? std::atoi(argv[1]) : 256;
+	const int tickCount = argc > 2 ? std::atoi(argv[2]) : 3600;
+
+	if (playerCount <= 0 || tickCount <= 0)
+	{
+		std::fprintf(stderr, "usage: %s [players] [ticks]\n", argv[0]);
+		return 1;
+	}
+
+	SResult batched, perPlayer;
+	Run(playerCount, tickCount, false, batched, perPlayer);
+	const uint64_t mismatches = batched.mismatches;
+	const uint64_t jumps = batched.jumps;
+	const uint64_t perPlayerJumps = perPlayer.jumpsInPhysics;
+	const uint64_t batchedJumps = batched.jumpsInPhysics;
+
+	batched = SResult();
+	perPlayer = SResult();
+	Run(playerCount, tickCount, true, batched, perPlayer);
+
+	const unsigned int hardwareThreads = std::thread::hardware_concurrency();
+	std::printf("physics write back: %d strafe jumping players, %d ticks, physics thread stepping every %lld us, %u hardware threads\n", playerCount, tickCount, static_cast<long long>(PhysicsInterval.count()), hardwareThreads);
+	if (hardwareThreads < 2)
+	{
+		std::printf("  single hardware thread: the physics thread never runs alongside the calls, waits are not contention\n");
+	}
+	std::printf("    per tick                           calls | calls waited   wait us | steps waited  wait us | hand off us  call window us\n");
+	Print("impulse and velocity per player", perPlayer, tickCount);
+	Print("CPhysicsWriteBack, jump mode", batched, tickCount);
+	std::printf("  %llu entity velocities differ between the two\n", static_cast<unsigned long long>(mismatches));
+	std::printf("  %llu jumps, %llu reached physics per player, %llu batched\n", static_cast<unsigned long long>(jumps), static_cast<unsigned long long>(perPlayerJumps), static_cast<unsigned long long>(batchedJumps));
+
+	return mismatches == 0 && jumps > 0 && perPlayerJumps == jumps && batchedJumps == jumps ? 0 : 1;
+}
@@ -0,0 +1,207 @@
+////////////////////////////////////////////////////////
+// Headless client prediction benchmark
+// Every tick each simulated client predicts a new command and then
+// reconciles against server state that is a fixed latency behind,
+// replaying all unacknowledged commands. Reports the cost per
+// reconcile and checks that replay reproduces the prediction exactly.
+// Then commands are delivered to a CServerCmdQueue with jitter and
+// stalls, checking that the processed sequence catches up with the
+// client after each stall and that skipped jump presses are kept.
+//
+// Build (from the repository root):
+//   g++ -O2 -std=c++17 -I. -IBenchmark Benchmark/PredictionBenchmark.cpp PlayerMovement.cpp PlayerPrediction.cpp -o prediction_bench
+// Usage:
+//   prediction_bench [players] [ticks] [latency ms]
+////////////////////////////////////////////////////////
+
+#include "BenchmarkCommon.h"
+#include "PlayerPrediction.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+	struct SPredictedClient
+	{
+		CMovementPredictor predictor;
+		PMoveState state;
+		// The server runs the same commands, so its acked states are the client's own past states
+		CSequenceRing<PMoveState, CMovementPredictor::CmdCapacity> serverStates;
+		// Vertical motion belongs to physics like on the character controller, the kernel only sees the ground flag
+		float height = 0.f;
+		float verticalVelocity = 0.f;
+	};
+
+	bool IsSameState(const PMoveState& a, const PMoveState& b)
+	{
+		return std::memcmp(&a.velocity, &b.velocity, sizeof(a.velocity)) == 0
+			&& std::memcmp(&a.moveDirectionNorm, &b.moveDirectionNorm, sizeof(a.moveDirectionNorm)) == 0
+			&& a.wishJump == b.wishJump && a.jumpHeld == b.jumpHeld;
+	}
+
+	struct SDeliveryResult
+	{
+		uint32_t maxLag = 0;                  // Most the processed sequence fell behind the sent one outside of stalls
+		uint32_t skippedCount = 0;
+		uint32_t lostJumpCount = 0;           // Pops that consumed a jump press without jumping
+	};
+
+	// One command is sent per tick and arrives up to maxJitter ticks late, except that nothing arrives for stallTicks every stallPeriod ticks.
+	// The server pops one command per tick like the player component does.
+	SDeliveryResult RunJitteredDelivery(int tickCount, int maxJitter, int stallPeriod, int stallTicks)
+	{
+		struct SInFlight
+		{
+			int arrivalTick;
+			Cmd cmd;
+		};
+
+		std::mt19937 random(7);
+		std::uniform_int_distribution<int> jitter(0, maxJitter);
+		std::vector<SInFlight> inFlight;
+		std::vector<bool> sentJumps(tickCount + 1, false);
+		CServerCmdQueue queue;
+		SDeliveryResult result;
+
+		for (int tick = 0; tick < tickCount; ++tick)
+		{
+			Cmd cmd;
+			cmd.sequence = static_cast<uint32_t>(tick) + 1;
+			cmd.forwardMove = 1.f;
+			cmd.jump = tick % 16 == 0;
+			sentJumps[cmd.sequence] = cmd.jump;
+
+			const int stallStart = tick - tick % stallPeriod;
+			const bool isStalled = tick < stallStart + stallTicks;
+			inFlight.push_back(SInFlight{ isStalled ? stallStart + stallTicks : tick + jitter(random), cmd });
+
+			for (size_t i = 0; i < inFlight.size(); )
+			{
+				if (inFlight[i].arrivalTick <= tick)
+				{
+					queue.Receive(inFlight[i].cmd);
+					inFlight[i] = inFlight.back();
+					inFlight.pop_back();
+				}
+				else
+				{
+					++i;
+				}
+			}
+
+			const uint32_t previousSequence = queue.GetLastProcessedSequence();
+			const Cmd popped = queue.Pop();
+			const uint32_t processedSequence = queue.GetLastProcessedSequence();
+
+			bool hasConsumedJump = false;
+			for (uint32_t sequence = previousSequence + 1; sequence <= processedSequence; ++sequence)
+			{
+				hasConsumedJump |= sentJumps[sequence];
+			}
+			result.lostJumpCount += hasConsumedJump && !popped.jump ? 1 : 0;
+			result.skippedCount += processedSequence > previousSequence ? processedSequence - previousSequence - 1 : 0;
+
+			// Stalled and still delivering the commands held up by the stall, the server can't help being behind
+			if (tick >= stallStart + stallTicks + maxJitter)
+			{
+				result.maxLag = std::max(result.maxLag, cmd.sequence - processedSequence);
+			}
+		}
+
+		return result;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const int playerCount = argc > 1 ? std::atoi(argv[1]) : 128;
+	const int tickCount = argc > 2 ? std::atoi(argv[2]) : 2000;
+	const int latencyMs = argc > 3 ? std::atoi(argv[3]) : 200;
+
+	const float tickRate = 128.f;
+	const float dt = 1.f / tickRate;
+	const uint32_t latencyTicks = static_cast<uint32_t>(latencyMs * tickRate / 1000.f + 0.5f);
+
+	if (playerCount <= 0 || tickCount <= 0 || latencyMs < 0 || latencyTicks >= CMovementPredictor::CmdCapacity)
+	{
+		std::fprintf(stderr, "usage: %s [players] [ticks] [latency ms < %.0f]\n", argv[0], CMovementPredictor::CmdCapacity * 1000.f / tickRate);
+		return 1;
+	}
+
+	const PMoveParams params;
+	std::vector<SPredictedClient> clients(playerCount);
+
+	double reconcileSeconds = 0.0;
+	int reconcileCount = 0;
+	int mismatches = 0;
+
+	for (int tick = 0; tick < tickCount; ++tick)
+	{
+		for (int i = 0; i < playerCount; ++i)
+		{
+			SPredictedClient& client = clients[i];
+			PMoveGroundContact ground;
+			ground.onGround = client.height <= 0.f && client.verticalVelocity <= 0.f;
+			PMove::SetGroundContact(client.state, ground);
+
+			const Cmd cmd = GetScriptedCmd(i, tick, client.state, dt);
+			client.predictor.Record(cmd, ground);
+
+			client.state.yaw = cmd.yaw;
+			PMove::QueueJump(client.state, params, cmd);
+			client.state = PMove::Move(client.state, params, cmd, dt);
+			client.serverStates.Insert(cmd.sequence) = client.state;
+
+			if (client.state.jumped)
+			{
+				client.verticalVelocity = params.jumpImpulse;
+			}
+			client.verticalVelocity -= params.gravity * dt;
+			client.height += client.verticalVelocity * dt;
+			if (client.height < 0.f)
+			{
+				client.height = 0.f;
+				client.verticalVelocity = 0.f;
+			}
+
+			if (cmd.sequence <= latencyTicks)
+				continue;
+
+			const uint32_t ackedSequence = cmd.sequence - latencyTicks;
+			PMoveState serverState = *client.serverStates.Find(ackedSequence);
+
+			PMoveState predictedState;
+			const Clock::time_point start = Clock::now();
+			const bool hasReplayed = client.predictor.Reconcile(ackedSequence, serverState, params, dt, predictedState);
+			reconcileSeconds += GetSecondsSince(start);
+			++reconcileCount;
+
+			if (!hasReplayed || !IsSameState(predictedState, client.state))
+			{
+				++mismatches;
+			}
+		}
+	}
+
+	std::printf("prediction: %d players x %d ticks @ %.0f Hz, %d ms latency (%u commands replayed per reconcile)\n",
+		playerCount, tickCount, tickRate, latencyMs, latencyTicks);
+	std::printf("  %.3f us/reconcile, %.3f ms per tick for all players, %d of %d replays diverged\n",
+		reconcileSeconds * 1e6 / reconcileCount, reconcileSeconds * 1e3 / tickCount, mismatches, reconcileCount);
+
+	// A late burst used to leave the server behind for good, it has to be back within the jitter margin once the burst is in
+	const int maxJitter = 2;
+	const int stallPeriod = 500;
+	const int stallTicks = 30;
+	const SDeliveryResult delivery = RunJitteredDelivery(std::max(tickCount, 2 * stallPeriod), maxJitter, stallPeriod, stallTicks);
+	const uint32_t allowedLag = CServerCmdQueue::JitterMargin + maxJitter;
+	std::printf("server command queue: up to %d ticks of jitter, a %d tick stall every %d ticks\n", maxJitter, stallTicks, stallPeriod);
+	std::printf("  processed sequence at most %u behind the client outside of stalls (allowed %u), %u commands skipped, %u jump presses lost\n",
+		delivery.maxLag, allowedLag, delivery.skippedCount, delivery.lostJumpCount);
+
+	return mismatches == 0 && delivery.maxLag <= allowedLag && delivery.lostJumpCount == 0 ? 0 : 1;
+}
@@ -0,0 +1,150 @@
+////////////////////////////////////////////////////////
+// Headless movement profiler benchmark
+// Measures what a profiling scope costs while the profiler is disabled
+// and enabled, checks the histogram percentiles against exact ones from
+// sorted samples, then profiles simulated strafe jumping players like a
+// server would and prints the resulting JSON line.
+//
+// Build (from the repository root):
+//   g++ -O2 -std=c++17 -I. -IBenchmark Benchmark/ProfilerBenchmark.cpp PlayerMovement.cpp MovementProfiler.cpp -o profiler_bench
+// Usage:
+//   profiler_bench [players] [ticks]
+////////////////////////////////////////////////////////
+
+#include "BenchmarkCommon.h"
+#include "MovementProfiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace
+{
+	double MeasureScope(CMovementProfiler& profiler, int scopeCount)
+	{
+		const Clock::time_point start = Clock::now();
+		for (int i = 0; i < scopeCount; ++i)
+		{
+			CMovementProfileScope profileScope(profiler, EMovementStage::LookDirection);
+		}
+		return GetSecondsSince(start) * 1e9 / scopeCount;
+	}
+
+	// Returns the number of percentiles off by more than a bucket's width
+	int VerifyPercentiles()
+	{
+		std::mt19937 random(7);
+		// Frame work spans sub-microsecond stages up to millisecond hitches
+		std::lognormal_distribution<double> duration(8.0, 1.5);
+
+		CLatencyHistogram histogram;
+		std::vector<uint64_t> samples;
+		for (int i = 0; i < 200000; ++i)
+		{
+			const uint64_t sample = static_cast<uint64_t>(duration(random));
+			samples.push_back(sample);
+			histogram.Record(sample);
+		}
+		std::sort(samples.begin(), samples.end());
+
+		int errors = 0;
+		const double percentiles[] = { 50.0, 90.0, 99.0, 99.9, 100.0 };
+		for (const double percentile : percentiles)
+		{
+			const size_t rank = static_cast<size_t>(std::ceil(percentile / 100.0 * samples.size()));
+			const uint64_t exact = samples[std::max<size_t>(rank, 1) - 1];
+			const uint64_t estimate = histogram.GetPercentile(percentile);
+			const double error = (static_cast<double>(estimate) - static_cast<double>(exact)) / static_cast<double>(std::max<uint64_t>(exact, 1));
+
+			// Buckets report their upper bound, so estimates may only be high, by at most one sub-bucket
+			const bool isWithinBucket = estimate >= exact && error <= 1.0 / (1 << CLatencyHistogram::SubBucketBits);
+			errors += isWithinBucket ? 0 : 1;
+			std::printf("  p%-5g exact %9llu ns, histogram %9llu ns (%+.1f%%)\n", percentile,
+				static_cast<unsigned long long>(exact), static_cast<unsigned long long>(estimate), error * 100.0);
+		}
+		return errors;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const int playerCount = argc > 1 ? std::atoi(argv[1]) : 64;
+	const int tickCount = argc > 2 ? std::atoi(argv[2]) : 6000;
+
+	if (playerCount <= 0 || tickCount <= 0)
+	{
+		std::fprintf(stderr, "usage: %s [players] [ticks]\n", argv[0]);
+		return 1;
+	}
+
+	CMovementProfiler profiler;
+	const int scopeCount = 1000000;
+	std::printf("profiler: %d players x %d ticks\n", playerCount, tickCount);
+	std::printf("  scope disabled %6.2f ns\n", MeasureScope(profiler, scopeCount));
+	profiler.SetEnabled(true);
+	std::printf("  scope enabled  %6.2f ns\n", MeasureScope(profiler, scopeCount));
+	profiler.Reset();
+
+	int errors = VerifyPercentiles();
+
+	// One server interval: every player ticks through the kernel with the stages and counters the game records
+	const PMoveParams params;
+	const float dt = 1.f / CFixedTimestep::DefaultTickRate;
+	std::vector<SSimulatedPlayer> players = CreatePlayers(playerCount);
+	std::vector<Cmd> cmds(playerCount);
+	uint64_t jumpCount = 0;
+
+	const Clock::time_point start = Clock::now();
+	for (int tick = 0; tick < tickCount; ++tick)
+	{
+		for (int i = 0; i < playerCount; ++i)
+		{
+			CMovementProfileScope profileScope(profiler, EMovementStage::PrepareTick);
+			cmds[i] = GetScriptedCmd(i, tick, players[i].state, dt);
+
+			const bool onGround = players[i].state.onGround;
+			profiler.Count(onGround ? EMovementCounter::GroundTicks : EMovementCounter::AirTicks);
+			if (onGround && !players[i].state.wishJump)
+			{
+				profiler.Count(EMovementCounter::FrictionTicks);
+			}
+		}
+
+		{
+			CMovementProfileScope profileScope(profiler, EMovementStage::MovementStep);
+			for (int i = 0; i < playerCount; ++i)
+			{
+				players[i].state = PMove::Move(players[i].state, params, cmds[i], dt);
+			}
+		}
+
+		for (SSimulatedPlayer& player : players)
+		{
+			CMovementProfileScope profileScope(profiler, EMovementStage::ApplyMovement);
+			if (player.state.jumped)
+			{
+				++jumpCount;
+				profiler.Count(EMovementCounter::Jumps);
+				profiler.Count(EMovementCounter::PhysicsCalls);
+			}
+			StepWorld(player, params, dt);
+			profiler.Count(EMovementCounter::PhysicsCalls);
+		}
+	}
+
+	char json[2048];
+	const size_t length = profiler.WriteJson(json, sizeof(json), GetSecondsSince(start));
+	std::printf("  %.*s\n", static_cast<int>(length), json);
+
+	const uint64_t playerTicks = static_cast<uint64_t>(playerCount) * tickCount;
+	const bool areCountersExact = profiler.GetCounter(EMovementCounter::GroundTicks) + profiler.GetCounter(EMovementCounter::AirTicks) == playerTicks
+		&& profiler.GetCounter(EMovementCounter::Jumps) == jumpCount
+		&& profiler.GetStage(EMovementStage::MovementStep).GetCount() == static_cast<uint64_t>(tickCount);
+	errors += areCountersExact && length > 0 ? 0 : 1;
+
+	std::printf("  %d checks failed\n", errors);
+	return errors == 0 ? 0 : 1;
+}
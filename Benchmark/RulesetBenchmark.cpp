@@ -0,0 +1,223 @@
+////////////////////////////////////////////////////////
+// Headless movement ruleset benchmark
+// Steps strafe jumping players with every registered ruleset, once with
+// its own instantiation and once through the default q3 instantiation
+// that still tests for every feature at runtime, with the ruleset's
+// tuning loaded. Before timing, every instantiation is checked on
+// randomized players: the batch paths against PMove::Move of the same
+// ruleset, and vq3 against q3 tuned to behave like it.
+//
+// Build (from the repository root):
+//   g++ -O2 -std=c++17 -pthread -I. -IBenchmark Benchmark/RulesetBenchmark.cpp PlayerMovement.cpp PlayerMovementSystem.cpp PlayerMovementBatch.cpp MovementRuleset.cpp WorkStealingPool.cpp -o ruleset_bench
+// Usage:
+//   ruleset_bench [players] [ticks]
+////////////////////////////////////////////////////////
+
+#include "BenchmarkCommon.h"
+#include "MovementRuleset.h"
+#include "PlayerMovementSystem.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+	struct SRandomPlayer
+	{
+		PMoveState state;
+		Cmd cmd;
+	};
+
+	// Standing still, no input, side strafing and jumping players, on slopes and slippery ground too
+	std::vector<SRandomPlayer> CreateRandomPlayers(int playerCount, uint32_t seed)
+	{
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> speed(-1500.f, 1500.f);
+		std::uniform_real_distribution<float> angle(-10.f, 10.f);
+		std::uniform_int_distribution<int> axis(-1, 1);
+		std::uniform_int_distribution<int> chance(0, 3);
+
+		std::vector<SRandomPlayer> players(playerCount);
+		for (SRandomPlayer& player : players)
+		{
+			if (chance(random) != 0)
+			{
+				player.state.velocity = PMoveVec3(speed(random), speed(random), speed(random));
+			}
+			player.state.yaw = angle(random);
+			player.state.onGround = chance(random) < 2;
+			RandomizeGround(player.state, random);
+			player.cmd.forwardMove = static_cast<float>(axis(random));
+			player.cmd.rightMove = static_cast<float>(axis(random));
+			player.cmd.jump = chance(random) == 0;
+			player.cmd.yaw = player.state.yaw;
+		}
+		return players;
+	}
+
+	bool IsEqual(const PMoveState& a, const PMoveState& b)
+	{
+		return std::memcmp(&a.velocity, &b.velocity, sizeof(a.velocity)) == 0
+			&& std::memcmp(&a.moveDirectionNorm, &b.moveDirectionNorm, sizeof(a.moveDirectionNorm)) == 0
+			&& a.wishJump == b.wishJump && a.jumped == b.jumped;
+	}
+
+	// Steps the players with pMove one by one and with the system's batch path, returns the number of differing player-ticks
+	int CompareWithKernel(const SMovementRuleset& systemRuleset, const PMoveParams& systemParams, PMove::MoveFunc pMove, const PMoveParams& params, PMoveBatch::ESimdLevel simdLevel, float dt)
+	{
+		const int playerCount = 1027; // Not a multiple of the lane width, so the scalar tail is covered too
+		const int tickCount = 64;
+
+		std::vector<SRandomPlayer> players = CreateRandomPlayers(playerCount, 42);
+
+		CPlayerMovementSystem movementSystem;
+		movementSystem.SetRuleset(systemRuleset);
+		movementSystem.SetSimdLevel(simdLevel);
+		std::vector<CPlayerMovementSystem::Handle> handles;
+		for (const SRandomPlayer& player : players)
+		{
+			handles.push_back(movementSystem.Add(systemParams));
+			movementSystem.SetState(handles.back(), player.state);
+			movementSystem.SetAlive(handles.back(), true);
+		}
+
+		int mismatches = 0;
+		for (int tick = 0; tick < tickCount; ++tick)
+		{
+			for (int i = 0; i < playerCount; ++i)
+			{
+				movementSystem.SetInput(handles[i], players[i].cmd, players[i].state.yaw, GetGroundContact(players[i].state));
+				PMove::QueueJump(players[i].state, params, players[i].cmd);
+				players[i].state = pMove(players[i].state, params, players[i].cmd, dt);
+			}
+
+			movementSystem.Step(dt);
+
+			for (int i = 0; i < playerCount; ++i)
+			{
+				mismatches += IsEqual(players[i].state, movementSystem.GetState(handles[i])) ? 0 : 1;
+
+				// Alternate between ground and air so both moves keep being covered
+				players[i].state.onGround = !players[i].state.onGround;
+				players[i].state.jumped = false;
+				movementSystem.SetState(handles[i], players[i].state);
+			}
+		}
+		return mismatches;
+	}
+
+	// Tuning that makes the q3 instantiation move like the ruleset, as far as that is possible without its code
+	PMoveParams GetRuntimeParams(const SMovementRuleset& ruleset)
+	{
+		PMoveParams params = ruleset.defaultParams;
+		if (std::strcmp(ruleset.szName, SVq3Ruleset::Name) == 0)
+		{
+			// Strafing accelerates like anything else and isn't capped
+			params.sideStrafeAcceleration = params.airAcceleration;
+			params.sideStrafeSpeed = 1e30f;
+		}
+		return params;
+	}
+
+	bool VerifyRulesets(float dt)
+	{
+		int mismatches = 0;
+		for (uint32_t index = 0; index < PMoveRulesets::GetCount(); ++index)
+		{
+			const SMovementRuleset& ruleset = PMoveRulesets::Get(index);
+			for (int level = 0; level <= static_cast<int>(PMoveBatch::GetSupportedSimdLevel()); ++level)
+			{
+				const PMoveBatch::ESimdLevel simdLevel = static_cast<PMoveBatch::ESimdLevel>(level);
+				const int levelMismatches = CompareWithKernel(ruleset, ruleset.defaultParams, ruleset.pMove, ruleset.defaultParams, simdLevel, dt);
+				std::printf("  verify %-5s %-6s %d player-ticks differ from PMove::Move\n", ruleset.szName, PMoveBatch::GetSimdLevelName(simdLevel), levelMismatches);
+				mismatches += levelMismatches;
+			}
+		}
+
+		// Without air control and side strafing, q3 has to move exactly like vq3
+		const SMovementRuleset& vq3 = *PMoveRulesets::Find(SVq3Ruleset::Name);
+		const int emulatedMismatches = CompareWithKernel(PMoveRulesets::GetDefault(), GetRuntimeParams(vq3), vq3.pMove, vq3.defaultParams, PMoveBatch::GetSupportedSimdLevel(), dt);
+		std::printf("  verify q3 tuned as vq3: %d player-ticks differ from vq3\n", emulatedMismatches);
+
+		return mismatches + emulatedMismatches == 0;
+	}
+
+	double RunSystem(const SMovementRuleset& ruleset, const PMoveParams& params, int playerCount, int tickCount, float dt, double& checksum)
+	{
+		std::vector<SSimulatedPlayer> players = CreatePlayers(playerCount);
+
+		CPlayerMovementSystem movementSystem;
+		movementSystem.SetRuleset(ruleset);
+		std::vector<CPlayerMovementSystem::Handle> handles;
+		for (int i = 0; i < playerCount; ++i)
+		{
+			handles.push_back(movementSystem.Add(params));
+			movementSystem.SetAlive(handles.back(), true);
+		}
+
+		double seconds = 0.0;
+		for (int tick = 0; tick < tickCount; ++tick)
+		{
+			for (int i = 0; i < playerCount; ++i)
+			{
+				const Cmd cmd = GetScriptedCmd(i, tick, players[i].state, dt);
+				movementSystem.SetState(handles[i], players[i].state);
+				movementSystem.SetInput(handles[i], cmd, players[i].state.yaw, players[i].state.onGround);
+			}
+
+			const Clock::time_point start = Clock::now();
+			movementSystem.Step(dt);
+			seconds += GetSecondsSince(start);
+
+			for (int i = 0; i < playerCount; ++i)
+			{
+				players[i].state = movementSystem.GetState(handles[i]);
+				StepWorld(players[i], params, dt);
+			}
+		}
+
+		checksum = GetChecksum(players);
+		return seconds;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const int playerCount = argc > 1 ? std::atoi(argv[1]) : 4096;
+	const int tickCount = argc > 2 ? std::atoi(argv[2]) : 1000;
+
+	if (playerCount <= 0 || tickCount <= 0)
+	{
+		std::fprintf(stderr, "usage: %s [players] [ticks]\n", argv[0]);
+		return 1;
+	}
+
+	const float dt = 1.f / CFixedTimestep::DefaultTickRate;
+
+	std::printf("rulesets: %d players x %d ticks @ %.0f Hz, %s\n", playerCount, tickCount, 1.f / dt, PMoveBatch::GetSimdLevelName(PMoveBatch::GetSupportedSimdLevel()));
+
+	if (!VerifyRulesets(dt))
+	{
+		std::fprintf(stderr, "ruleset instantiations diverge from their reference kernel\n");
+		return 1;
+	}
+
+	const double playerTicks = static_cast<double>(playerCount) * tickCount;
+	for (uint32_t index = 0; index < PMoveRulesets::GetCount(); ++index)
+	{
+		const SMovementRuleset& ruleset = PMoveRulesets::Get(index);
+
+		double specializedChecksum = 0.0, runtimeChecksum = 0.0;
+		const double specialized = RunSystem(ruleset, ruleset.defaultParams, playerCount, tickCount, dt, specializedChecksum);
+		const double runtime = RunSystem(PMoveRulesets::GetDefault(), GetRuntimeParams(ruleset), playerCount, tickCount, dt, runtimeChecksum);
+
+		// q3 has no way to strafe like qw on every air move, its timing only shows the cost of the features qw drops
+		std::printf("  %-5s %8.2f ns/player-tick specialized, %8.2f through q3 (%5.2fx), %s\n", ruleset.szName,
+			specialized * 1e9 / playerTicks, runtime * 1e9 / playerTicks, runtime / specialized, specializedChecksum == runtimeChecksum ? "same moves" : "different moves");
+	}
+
+	return 0;
+}
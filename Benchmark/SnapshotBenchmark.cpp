@@ -0,0 +1,219 @@
+////////////////////////////////////////////////////////
+// Headless movement snapshot benchmark
+// Simulates strafe jumping players and every tick sends each client one
+// snapshot of all players, delta encoded against whatever that client
+// acknowledged a round trip earlier. Some packets are dropped so baselines
+// go missing like on a real connection. Reports bytes per player and the
+// encode/decode cost, and checks every decoded player against the
+// simulation within the quantization step.
+//
+// Build (from the repository root):
+//   g++ -O2 -std=c++17 -I. -IBenchmark Benchmark/SnapshotBenchmark.cpp PlayerMovement.cpp MovementSnapshot.cpp -o snapshot_bench
+// Usage:
+//   snapshot_bench [players] [ticks] [latency ms] [loss %]
+////////////////////////////////////////////////////////
+
+#include "BenchmarkCommon.h"
+#include "MovementSnapshot.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+	struct SSnapshotClient
+	{
+		CSnapshotDecoder decoder;
+		// Newest decoded snapshot at each tick, the server sees it one tick plus the latency later
+		CSequenceRing<uint32_t, 64> ackHistory;
+		uint32_t ackedSequence = 0;
+	};
+
+	float GetStep(float min, float max, uint32_t bitCount)
+	{
+		return (max - min) / static_cast<float>((1u << bitCount) - 1);
+	}
+
+	bool IsWithin(float decoded, float expected, float tolerance)
+	{
+		return std::fabs(decoded - expected) <= tolerance;
+	}
+
+	float Clamp(float value, float min, float max)
+	{
+		return value < min ? min : value > max ? max : value;
+	}
+
+	float GetAngleError(float a, float b)
+	{
+		const float twoPi = 6.2831853f;
+		float error = std::fmod(std::fabs(a - b), twoPi);
+		return error > twoPi * 0.5f ? twoPi - error : error;
+	}
+
+	bool IsDecodedCorrectly(const SSnapshotConfig& config, const SSnapshotPlayer& decoded, const SSimulatedPlayer& expected, float metersPerUnit, float pitch)
+	{
+		// Half a step plus float rounding of the dequantized value
+		const float positionTolerance = GetStep(config.positionMin.x, config.positionMax.x, config.positionBits) * 0.5f + 1e-3f;
+		const float velocityTolerance = GetStep(-config.maxSpeed, config.maxSpeed, config.velocityBits) * 0.5f + 1e-3f;
+		const float angleTolerance = 6.2831853f / static_cast<float>(1u << config.angleBits) * 0.5f + 1e-5f;
+
+		const PMoveVec3 position = expected.position * metersPerUnit;
+		return IsWithin(decoded.position.x, position.x, positionTolerance)
+			&& IsWithin(decoded.position.y, position.y, positionTolerance)
+			&& IsWithin(decoded.position.z, position.z, positionTolerance)
+			&& IsWithin(decoded.velocity.x, Clamp(expected.state.velocity.x, -config.maxSpeed, config.maxSpeed), velocityTolerance)
+			&& IsWithin(decoded.velocity.y, Clamp(expected.state.velocity.y, -config.maxSpeed, config.maxSpeed), velocityTolerance)
+			&& IsWithin(decoded.velocity.z, Clamp(expected.state.velocity.z, -config.maxSpeed, config.maxSpeed), velocityTolerance)
+			&& GetAngleError(decoded.yaw, expected.state.yaw) <= angleTolerance
+			&& GetAngleError(decoded.pitch, pitch) <= angleTolerance
+			&& decoded.onGround == expected.state.onGround
+			&& decoded.wishJump == expected.state.wishJump
+			&& decoded.jumpHeld == expected.state.jumpHeld;
+	}
+
+	// Keeps the endless strafe jumping inside the quantized world by wrapping around it
+	void WrapPosition(float& value, float min, float max)
+	{
+		if (value > max)
+			value -= max - min;
+		else if (value < min)
+			value += max - min;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const int playerCount = argc > 1 ? std::atoi(argv[1]) : 64;
+	const int tickCount = argc > 2 ? std::atoi(argv[2]) : 2000;
+	const int latencyMs = argc > 3 ? std::atoi(argv[3]) : 100;
+	const int lossPercent = argc > 4 ? std::atoi(argv[4]) : 5;
+
+	const float tickRate = 64.f;
+	const float dt = 1.f / tickRate;
+	const uint32_t latencyTicks = static_cast<uint32_t>(latencyMs * tickRate / 1000.f + 0.5f);
+	// Physics is handed kernel velocities scaled by the tick interval, so that is also the size of a kernel unit in meters
+	const float metersPerUnit = dt;
+
+	if (playerCount <= 0 || playerCount > static_cast<int>(PMoveSnapshot::MaxPlayers) || tickCount <= 0 || latencyMs < 0 || latencyTicks >= 64 || lossPercent < 0 || lossPercent > 100)
+	{
+		std::fprintf(stderr, "usage: %s [players <= %u] [ticks] [latency ms < 1000] [loss %%]\n", argv[0], PMoveSnapshot::MaxPlayers);
+		return 1;
+	}
+
+	const PMoveParams params;
+	const SSnapshotConfig config;
+	std::vector<SSimulatedPlayer> players = CreatePlayers(playerCount);
+	std::vector<SSnapshotClient> clients(playerCount);
+	CSnapshotEncoder encoder(config);
+
+	std::vector<uint8_t> packet(4096);
+
+	double encodeSeconds = 0.0;
+	double decodeSeconds = 0.0;
+	size_t deltaBytes = 0;
+	size_t fullBytes = 0;
+	int packetCount = 0;
+	int decodeCount = 0;
+	int rejectedCount = 0;
+	int mismatches = 0;
+
+	for (int tick = 0; tick < tickCount; ++tick)
+	{
+		for (int i = 0; i < playerCount; ++i)
+		{
+			SSimulatedPlayer& player = players[i];
+			const Cmd cmd = GetScriptedCmd(i, tick, player.state, dt);
+			PMove::QueueJump(player.state, params, cmd);
+			player.state = PMove::Move(player.state, params, cmd, dt);
+			StepWorld(player, params, dt);
+
+			WrapPosition(player.position.x, config.positionMin.x / metersPerUnit, config.positionMax.x / metersPerUnit);
+			WrapPosition(player.position.y, config.positionMin.y / metersPerUnit, config.positionMax.y / metersPerUnit);
+		}
+
+		const uint32_t sequence = static_cast<uint32_t>(tick) + 1;
+		const float pitch = 0.3f * std::sin(tick * dt);
+
+		Clock::time_point start = Clock::now();
+		encoder.BeginSnapshot(sequence);
+		for (int i = 0; i < playerCount; ++i)
+		{
+			SSnapshotPlayer snapshotPlayer;
+			snapshotPlayer.id = static_cast<uint16_t>(i);
+			snapshotPlayer.position = players[i].position * metersPerUnit;
+			snapshotPlayer.velocity = players[i].state.velocity;
+			snapshotPlayer.yaw = players[i].state.yaw;
+			snapshotPlayer.pitch = pitch;
+			snapshotPlayer.onGround = players[i].state.onGround;
+			snapshotPlayer.wishJump = players[i].state.wishJump;
+			snapshotPlayer.jumpHeld = players[i].state.jumpHeld;
+			encoder.AddPlayer(snapshotPlayer);
+		}
+		encoder.EndSnapshot();
+		encodeSeconds += GetSecondsSince(start);
+
+		// Size of the same snapshot for a client without any baseline, for comparison
+		fullBytes += encoder.Write(0, packet.data(), packet.size());
+
+		for (int c = 0; c < playerCount; ++c)
+		{
+			SSnapshotClient& client = clients[c];
+			if (tick > static_cast<int>(latencyTicks))
+			{
+				if (const uint32_t* pAck = client.ackHistory.Find(static_cast<uint32_t>(tick) - latencyTicks - 1))
+				{
+					client.ackedSequence = *pAck;
+				}
+			}
+
+			start = Clock::now();
+			const size_t size = encoder.Write(client.ackedSequence, packet.data(), packet.size());
+			encodeSeconds += GetSecondsSince(start);
+
+			deltaBytes += size;
+			++packetCount;
+
+			// Deterministic loss pattern, spread differently per client
+			const bool isLost = static_cast<int>((static_cast<uint32_t>(tick) * 7919u + static_cast<uint32_t>(c) * 104729u) % 100u) < lossPercent;
+			if (!isLost && size > 0)
+			{
+				start = Clock::now();
+				const bool isDecoded = client.decoder.Read(packet.data(), size);
+				decodeSeconds += GetSecondsSince(start);
+
+				if (isDecoded)
+				{
+					++decodeCount;
+					for (uint32_t p = 0; p < client.decoder.GetPlayerCount(); ++p)
+					{
+						const SSnapshotPlayer decoded = client.decoder.GetPlayer(p);
+						if (decoded.id >= players.size() || !IsDecodedCorrectly(config, decoded, players[decoded.id], metersPerUnit, pitch))
+						{
+							++mismatches;
+						}
+					}
+				}
+				else
+				{
+					++rejectedCount;
+				}
+			}
+
+			client.ackHistory.Insert(static_cast<uint32_t>(tick)) = client.decoder.GetSequence();
+		}
+	}
+
+	const double playerSnapshots = static_cast<double>(packetCount) * playerCount;
+	std::printf("snapshots: %d players x %d ticks @ %.0f Hz, %d ms latency, %d%% loss\n", playerCount, tickCount, tickRate, latencyMs, lossPercent);
+	std::printf("  delta: %.2f bytes/player, %.0f bytes per client per snapshot, %.1f kbit/s per client\n",
+		deltaBytes / playerSnapshots, static_cast<double>(deltaBytes) / packetCount, deltaBytes * 8.0 / packetCount * tickRate / 1000.0);
+	std::printf("  full:  %.2f bytes/player, raw floats would be %u bytes/player\n",
+		static_cast<double>(fullBytes) / tickCount / playerCount, static_cast<unsigned>(2 + 8 * sizeof(float) + 1));
+	std::printf("  encode %.3f us/snapshot (all clients), decode %.3f us/snapshot per client\n",
+		encodeSeconds * 1e6 / tickCount, decodeSeconds * 1e6 / (decodeCount + rejectedCount));
+	std::printf("  %d decoded, %d rejected for a lost baseline, %d players outside the quantization step\n", decodeCount, rejectedCount, mismatches);
+
+	return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,148 @@
+////////////////////////////////////////////////////////
+// Headless spawn point selection benchmark
+// Scatters spawn points over a large level in clusters, like rooms, and
+// picks spawns with every selection policy while enemies run around.
+// Reports the cost per selection and checks the farthest-from-enemies
+// pick against a brute force search over all points.
+//
+// Build (from the repository root):
+//   g++ -O2 -std=c++17 -I. -IBenchmark Benchmark/SpawnPointBenchmark.cpp PlayerMovement.cpp SpawnPointRegistry.cpp -o spawn_point_bench
+// Usage:
+//   spawn_point_bench [spawn points] [enemies] [selections]
+////////////////////////////////////////////////////////
+
+#include "BenchmarkCommon.h"
+#include "SpawnPointRegistry.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+	const float LevelSize = 4096.f;
+
+	uint32_t NextRandom(uint32_t& state)
+	{
+		state = state * 1664525u + 1013904223u;
+		return state >> 8;
+	}
+
+	float GetRandom(uint32_t& state, float range)
+	{
+		return static_cast<float>(NextRandom(state) & 0xFFFF) / 65535.f * range;
+	}
+
+	float GetNearestEnemyDistanceSq(const PMoveVec3& position, const std::vector<PMoveVec3>& enemies)
+	{
+		float nearest = -1.f;
+		for (const PMoveVec3& enemy : enemies)
+		{
+			const PMoveVec3 delta = position - enemy;
+			const float distanceSq = delta.x * delta.x + delta.y * delta.y + delta.z * delta.z;
+			nearest = nearest < 0.f || distanceSq < nearest ? distanceSq : nearest;
+		}
+		return nearest;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const int spawnCount = argc > 1 ? std::atoi(argv[1]) : 256;
+	const int enemyCount = argc > 2 ? std::atoi(argv[2]) : 64;
+	const int selectionCount = argc > 3 ? std::atoi(argv[3]) : 100000;
+
+	if (spawnCount <= 0 || enemyCount <= 0 || selectionCount <= 0)
+	{
+		std::fprintf(stderr, "usage: %s [spawn points] [enemies] [selections]\n", argv[0]);
+		return 1;
+	}
+
+	uint32_t random = 3;
+	CSpawnPointRegistry registry;
+	std::vector<PMoveVec3> spawns;
+	for (int i = 0; i < spawnCount; ++i)
+	{
+		// Eight points to a room
+		if (i % 8 == 0)
+		{
+			spawns.push_back(PMoveVec3(GetRandom(random, LevelSize), GetRandom(random, LevelSize), GetRandom(random, 64.f)));
+		}
+		else
+		{
+			const PMoveVec3& room = spawns[i - i % 8];
+			spawns.push_back(room + PMoveVec3(GetRandom(random, 16.f), GetRandom(random, 16.f), 0.f));
+		}
+		registry.Add(spawns.back(), static_cast<uint32_t>(i));
+	}
+
+	std::vector<PMoveVec3> enemies;
+	for (int i = 0; i < enemyCount; ++i)
+	{
+		enemies.push_back(PMoveVec3(GetRandom(random, LevelSize), GetRandom(random, LevelSize), GetRandom(random, 64.f)));
+	}
+
+	// Builds the grid once outside of the timings, like the first join after level load
+	registry.Select(CSpawnPointRegistry::ESelection::FarthestFromEnemies, enemies.data(), enemies.size());
+
+	std::printf("spawn points: %d points in %zu cells, %d enemies, %d selections\n", spawnCount, registry.GetCellCount(), enemyCount, selectionCount);
+
+	const struct
+	{
+		CSpawnPointRegistry::ESelection selection;
+		const char* szName;
+	} policies[] =
+	{
+		{ CSpawnPointRegistry::ESelection::First, "first" },
+		{ CSpawnPointRegistry::ESelection::RoundRobin, "round robin" },
+		{ CSpawnPointRegistry::ESelection::LeastRecentlyUsed, "least recently used" },
+		{ CSpawnPointRegistry::ESelection::FarthestFromEnemies, "farthest from enemies" },
+	};
+
+	int mismatches = 0;
+	double bruteForceSeconds = 0.0;
+	for (const auto& policy : policies)
+	{
+		double selectSeconds = 0.0;
+		std::vector<int> useCounts(spawnCount, 0);
+		for (int i = 0; i < selectionCount; ++i)
+		{
+			// Enemies keep running around between joins
+			PMoveVec3& enemy = enemies[i % enemyCount];
+			enemy = enemy + PMoveVec3(GetRandom(random, 8.f) - 4.f, GetRandom(random, 8.f) - 4.f, 0.f);
+
+			const Clock::time_point start = Clock::now();
+			const CSpawnPointRegistry::Handle handle = registry.Select(policy.selection, enemies.data(), enemies.size());
+			selectSeconds += GetSecondsSince(start);
+
+			const uint32_t spawn = registry.GetUserId(handle);
+			++useCounts[spawn];
+
+			// Reference: the same search over every point without the grid
+			if (policy.selection == CSpawnPointRegistry::ESelection::FarthestFromEnemies)
+			{
+				const Clock::time_point bruteForceStart = Clock::now();
+				float best = 0.f;
+				for (const PMoveVec3& position : spawns)
+				{
+					const float distanceSq = GetNearestEnemyDistanceSq(position, enemies);
+					best = distanceSq > best ? distanceSq : best;
+				}
+				bruteForceSeconds += GetSecondsSince(bruteForceStart);
+				mismatches += GetNearestEnemyDistanceSq(spawns[spawn], enemies) < best ? 1 : 0;
+			}
+		}
+
+		int usedCount = 0;
+		for (const int useCount : useCounts)
+		{
+			usedCount += useCount > 0 ? 1 : 0;
+		}
+		std::printf("  %-22s %7.3f us/selection, %d points used\n", policy.szName, selectSeconds * 1e6 / selectionCount, usedCount);
+	}
+
+	std::printf("  %-22s %7.3f us/selection\n", "brute force farthest", bruteForceSeconds * 1e6 / selectionCount);
+	std::printf("  %d farthest picks worse than brute force\n", mismatches);
+
+	return mismatches == 0 ? 0 : 1;
+}
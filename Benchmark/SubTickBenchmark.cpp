@@ -0,0 +1,277 @@
+////////////////////////////////////////////////////////
+// Headless sub-tick input benchmark
+// Plays the same recorded hands, a 1000 Hz mouse and key changes at
+// arbitrary times while strafe jumping, into clients running at
+// different frame rates. The engine polls input once per frame, so every
+// frame receives the inputs made since the previous one. Each client
+// runs the fixed 60 Hz movement tick twice, once sampling the input once
+// per frame as the player used to, and once taking every tick's input
+// from CInputTimeline by timestamp. Reports how far each run strays from
+// the 60 Hz timeline run and the time per tick, and fails unless every
+// timeline run follows the same trajectory bit for bit.
+//
+// Build (from the repository root):
+//   g++ -O2 -std=c++17 -I. -IBenchmark Benchmark/SubTickBenchmark.cpp PlayerMovement.cpp InputTimeline.cpp -o sub_tick_bench
+// Usage:
+//   sub_tick_bench [seconds]
+////////////////////////////////////////////////////////
+
+#include "BenchmarkCommon.h"
+#include "InputTimeline.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+	// Same bits and look limits as CPlayerComponent
+	enum EButton : uint32_t
+	{
+		eButton_MoveLeft = 1 << 0,
+		eButton_MoveRight = 1 << 1,
+		eButton_MoveForward = 1 << 2,
+		eButton_MoveBack = 1 << 3,
+		eButton_Jump = 1 << 4
+	};
+
+	const float RotationSpeed = 0.002f;
+	const float MinPitch = -0.84f;
+	const float MaxPitch = 1.5f;
+
+	struct SDeviceInput
+	{
+		double time;
+		bool isLook;
+		uint32_t buttons;
+		float yawDelta;
+		float pitchDelta;
+	};
+
+	struct SClientConfig
+	{
+		const char* szName;
+		float frameRate;
+		float jitter;                     // Frame times vary by up to this fraction
+	};
+
+	struct SRunResult
+	{
+		std::vector<PMoveVec3> positions; // After every tick
+		double seconds = 0.0;
+		float endSpeed = 0.f;
+	};
+
+	// Strafe jumping: forward held, the strafe key and the turn swap every half second or so,
+	// jump mostly held for bunny hops and now and then released and tapped
+	std::vector<SDeviceInput> CreateDeviceInput(double duration)
+	{
+		std::mt19937 random(17);
+		std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+		std::vector<SDeviceInput> keys;
+		uint32_t buttons = 0;
+		auto changeButtons = [&keys, &buttons](double time, uint32_t set, uint32_t clear)
+		{
+			buttons = (buttons | set) & ~clear;
+			keys.push_back(SDeviceInput{ time, false, buttons, 0.f, 0.f });
+		};
+
+		changeButtons(0.05 + 0.01 * unit(random), eButton_MoveForward | eButton_MoveLeft | eButton_Jump, 0);
+		std::vector<double> swapTimes;
+		for (double time = 0.3 + 0.3 * unit(random); time < duration; time += 0.3 + 0.3 * unit(random))
+		{
+			swapTimes.push_back(time);
+			const bool isLeft = (buttons & eButton_MoveLeft) != 0;
+			changeButtons(time, isLeft ? eButton_MoveRight : eButton_MoveLeft, isLeft ? eButton_MoveLeft : eButton_MoveRight);
+
+			if (unit(random) < 0.2)
+			{
+				// Let go of jump, then tap it for a few milliseconds, shorter than a tick
+				const double releaseTime = time + 0.05 + 0.1 * unit(random);
+				changeButtons(releaseTime, 0, eButton_Jump);
+				changeButtons(releaseTime + 0.1, eButton_Jump, 0);
+				changeButtons(releaseTime + 0.1 + 0.002 + 0.008 * unit(random), 0, eButton_Jump);
+				changeButtons(releaseTime + 0.2, eButton_Jump, 0);
+			}
+		}
+		std::stable_sort(keys.begin(), keys.end(), [](const SDeviceInput& a, const SDeviceInput& b) { return a.time < b.time; });
+
+		// The mouse reports counts every millisecond, turning towards the held strafe key
+		std::vector<SDeviceInput> inputs;
+		size_t keyIndex = 0;
+		size_t swapIndex = 0;
+		float turnSign = -1.f;
+		for (double time = 0.0005; time < duration; time += 0.001)
+		{
+			for (; keyIndex < keys.size() && keys[keyIndex].time <= time; ++keyIndex)
+			{
+				inputs.push_back(keys[keyIndex]);
+			}
+			for (; swapIndex < swapTimes.size() && swapTimes[swapIndex] <= time; ++swapIndex)
+			{
+				turnSign = -turnSign;
+			}
+
+			const float yawCounts = turnSign * static_cast<float>(1 + (unit(random) < 0.3 ? 1 : 0));
+			const float pitchCounts = unit(random) < 0.05 ? (unit(random) < 0.5 ? 1.f : -1.f) : 0.f;
+			inputs.push_back(SDeviceInput{ time, true, 0, yawCounts * RotationSpeed, pitchCounts * RotationSpeed });
+		}
+		return inputs;
+	}
+
+	Cmd GetCmd(uint32_t buttons, uint32_t pressedButtons, const CViewAngles& view)
+	{
+		Cmd cmd;
+		cmd.forwardMove = ((buttons & eButton_MoveForward) ? 1.f : 0.f) - ((buttons & eButton_MoveBack) ? 1.f : 0.f);
+		cmd.rightMove = ((buttons & eButton_MoveRight) ? 1.f : 0.f) - ((buttons & eButton_MoveLeft) ? 1.f : 0.f);
+		cmd.jump = ((buttons | pressedButtons) & eButton_Jump) != 0;
+		cmd.yaw = view.GetYaw();
+		cmd.pitch = view.GetPitch();
+		return cmd;
+	}
+
+	// What CPlayerMovementSystem::SetInput and the physics do with every command
+	void StepTick(SSimulatedPlayer& player, const PMoveParams& params, const Cmd& cmd, float dt)
+	{
+		player.state.yaw = cmd.yaw;
+		PMove::QueueJump(player.state, params, cmd);
+		player.state = PMove::Move(player.state, params, cmd, dt);
+		StepWorld(player, params, dt);
+	}
+
+	SRunResult Run(const std::vector<SDeviceInput>& inputs, const SClientConfig& client, double duration, bool useTimeline)
+	{
+		const PMoveParams params;
+		std::mt19937 random(5);
+		std::uniform_real_distribution<float> jitter(-client.jitter, client.jitter);
+
+		SRunResult result;
+		SSimulatedPlayer player = CreatePlayers(1)[0];
+		CFixedTimestep timestep;
+		const float dt = timestep.GetTickInterval();
+		CInputTimeline timeline(MinPitch, MaxPitch);
+		CViewAngles view;
+		uint32_t frameButtons = 0;
+		uint32_t framePressedButtons = 0;
+		size_t inputIndex = 0;
+
+		const Clock::time_point start = Clock::now();
+		double frameTime = 0.0;
+		while (frameTime < duration)
+		{
+			frameTime = std::min(duration, frameTime + (1.f + jitter(random)) / client.frameRate);
+
+			// Everything made since the previous frame arrives together
+			framePressedButtons = 0;
+			for (; inputIndex < inputs.size() && inputs[inputIndex].time <= frameTime; ++inputIndex)
+			{
+				const SDeviceInput& input = inputs[inputIndex];
+				if (useTimeline)
+				{
+					if (input.isLook)
+					{
+						timeline.PushLook(input.time, input.yawDelta, input.pitchDelta);
+					}
+					else
+					{
+						timeline.PushButtons(input.time, input.buttons);
+					}
+				}
+				else if (input.isLook)
+				{
+					view.AddYaw(input.yawDelta);
+					view.AddPitch(input.pitchDelta, MinPitch, MaxPitch);
+				}
+				else
+				{
+					framePressedButtons |= input.buttons & ~frameButtons;
+					frameButtons = input.buttons;
+				}
+			}
+
+			const int ticks = timestep.AdvanceTo(frameTime);
+			for (int tick = 0; tick < ticks; ++tick)
+			{
+				Cmd cmd;
+				if (useTimeline)
+				{
+					const STickInput tickInput = timeline.Consume(timestep.GetTickEndTime(tick), view);
+					cmd = GetCmd(tickInput.buttons, tickInput.pressedButtons, view);
+				}
+				else
+				{
+					cmd = GetCmd(frameButtons, framePressedButtons, view);
+				}
+				StepTick(player, params, cmd, dt);
+				result.positions.push_back(player.position);
+			}
+		}
+		result.seconds = GetSecondsSince(start);
+		result.endSpeed = std::sqrt(player.state.velocity.x * player.state.velocity.x + player.state.velocity.y * player.state.velocity.y);
+		return result;
+	}
+
+	// Largest distance between the two trajectories, tick by tick
+	float GetMaxDeviation(const SRunResult& run, const SRunResult& reference)
+	{
+		float deviation = run.positions.size() == reference.positions.size() ? 0.f : INFINITY;
+		for (size_t i = 0; i < std::min(run.positions.size(), reference.positions.size()); ++i)
+		{
+			deviation = std::max(deviation, (run.positions[i] - reference.positions[i]).GetLength());
+		}
+		return deviation;
+	}
+
+	bool IsSameBits(const SRunResult& run, const SRunResult& reference)
+	{
+		return run.positions.size() == reference.positions.size()
+			&& std::memcmp(run.positions.data(), reference.positions.data(), run.positions.size() * sizeof(PMoveVec3)) == 0;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const double duration = argc > 1 ? std::atof(argv[1]) : 120.0;
+
+	if (duration <= 0.0)
+	{
+		std::fprintf(stderr, "usage: %s [seconds]\n", argv[0]);
+		return 1;
+	}
+
+	const std::vector<SDeviceInput> inputs = CreateDeviceInput(duration);
+	const SClientConfig clients[] =
+	{
+		{ "60 Hz", 60.f, 0.f },
+		{ "60 Hz jitter", 60.f, 0.4f },
+		{ "125 Hz", 125.f, 0.f },
+		{ "144 Hz jitter", 144.f, 0.3f },
+		{ "360 Hz", 360.f, 0.f },
+	};
+
+	std::printf("sub-tick: %.0f seconds at %.0f ticks per second, %zu inputs\n", duration, CFixedTimestep::DefaultTickRate, inputs.size());
+	std::printf("  %-14s %-10s %10s %12s %12s %s\n", "client", "input", "ns/tick", "end speed", "max off", "");
+
+	const SRunResult reference = Run(inputs, clients[0], duration, true);
+	int errors = 0;
+	for (const SClientConfig& client : clients)
+	{
+		for (const bool useTimeline : { false, true })
+		{
+			const SRunResult result = Run(inputs, client, duration, useTimeline);
+			const bool isSame = IsSameBits(result, reference);
+			errors += useTimeline && !isSame ? 1 : 0;
+
+			std::printf("  %-14s %-10s %10.2f %12.2f %12.4f %s\n", client.szName, useTimeline ? "timeline" : "per frame",
+				result.seconds * 1e9 / std::max<size_t>(result.positions.size(), 1), result.endSpeed, GetMaxDeviation(result, reference),
+				isSame ? "identical" : useTimeline ? "MISMATCH" : "");
+		}
+	}
+
+	return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,188 @@
+////////////////////////////////////////////////////////
+// Headless movement trace benchmark
+// Several threads simulate strafe jumping players and trace every player
+// tick, faster than real time but paced like server frames so the drain
+// thread gets to run in between. Once without tracing, once into the
+// binary trace and once as formatted text lines through stdio, which is
+// what the debug output used to cost. Reports the cost per record on the
+// simulating threads, then decodes the file and checks that every record
+// the trace reports as written arrived intact and in order per player.
+//
+// Build (from the repository root):
+//   g++ -O2 -std=c++17 -pthread -I. -IBenchmark Benchmark/TraceBenchmark.cpp PlayerMovement.cpp MovementTrace.cpp -o trace_bench
+// Usage:
+//   trace_bench [threads] [players per thread] [ticks] [times real time]
+////////////////////////////////////////////////////////
+
+#include "BenchmarkCommon.h"
+#include "MovementTrace.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	const char* const TraceFileName = "trace_bench.pmt";
+	const char* const TextFileName = "trace_bench.txt";
+
+	enum class EOutput
+	{
+		None,
+		Trace,
+		Text
+	};
+
+	SMovementTraceRecord GetRecord(uint32_t entityId, uint32_t tick, const PMoveState& state, const PMoveParams& params, const Cmd& cmd, float dt)
+	{
+		PMoveVec3 wishDir = PMove::GetWishDir(cmd, cmd.yaw);
+		wishDir.Normalize();
+
+		SMovementTraceRecord record;
+		record.tick = tick;
+		record.entityId = entityId;
+		record.speed = std::sqrt(state.velocity.x * state.velocity.x + state.velocity.y * state.velocity.y);
+		record.frictionDrop = PMove::GetFrictionDrop(state, params, state.wishJump ? 0.f : 1.f, dt);
+		record.wishDirX = static_cast<int16_t>(wishDir.x * PMoveTrace::WishDirScale);
+		record.wishDirY = static_cast<int16_t>(wishDir.y * PMoveTrace::WishDirScale);
+		record.flags = (state.onGround ? eMovementTraceFlag_OnGround : 0) | (state.wishJump ? eMovementTraceFlag_WishJump : 0);
+		return record;
+	}
+
+	// Returns the seconds spent simulating and tracing on this thread, without the waits between ticks
+	double RunThread(EOutput output, FILE* pTextFile, int thread, int playerCount, int tickCount, float dt, double timeScale)
+	{
+		const PMoveParams params;
+		std::vector<SSimulatedPlayer> players = CreatePlayers(playerCount);
+		char line[160];
+
+		const Clock::time_point start = Clock::now();
+		const Clock::duration tickDuration = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(dt / timeScale));
+		double seconds = 0.0;
+		for (int tick = 0; tick < tickCount; ++tick)
+		{
+			std::this_thread::sleep_until(start + tickDuration * tick);
+			const Clock::time_point tickStart = Clock::now();
+
+			for (int i = 0; i < playerCount; ++i)
+			{
+				SSimulatedPlayer& player = players[i];
+				const Cmd cmd = GetScriptedCmd(i, tick, player.state, dt);
+				const uint32_t entityId = static_cast<uint32_t>(thread * playerCount + i + 1);
+
+				if (output == EOutput::Trace)
+				{
+					PMoveTrace::Push(GetRecord(entityId, cmd.sequence, player.state, params, cmd, dt));
+				}
+				else if (output == EOutput::Text)
+				{
+					const SMovementTraceRecord record = GetRecord(entityId, cmd.sequence, player.state, params, cmd, dt);
+					std::snprintf(line, sizeof(line), "\n%u %u %s speed %.2f drop %.3f wishdir %d %d", record.tick, record.entityId,
+						player.state.onGround ? "On the ground! GroundMoving" : "Not on ground! not groundmoving.", record.speed, record.frictionDrop, record.wishDirX, record.wishDirY);
+					std::fputs(line, pTextFile);
+				}
+
+				player.state = PMove::Move(player.state, params, cmd, dt);
+				StepWorld(player, params, dt);
+			}
+
+			seconds += GetSecondsSince(tickStart);
+		}
+		return seconds;
+	}
+
+	// Mean seconds per thread
+	double Run(EOutput output, int threadCount, int playerCount, int tickCount, float dt, double timeScale)
+	{
+		FILE* pTextFile = output == EOutput::Text ? std::fopen(TextFileName, "w") : nullptr;
+
+		std::vector<double> seconds(threadCount, 0.0);
+		std::vector<std::thread> threads;
+		for (int thread = 0; thread < threadCount; ++thread)
+		{
+			threads.emplace_back([=, &seconds]() { seconds[thread] = RunThread(output, pTextFile, thread, playerCount, tickCount, dt, timeScale); });
+		}
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+
+		if (pTextFile != nullptr)
+		{
+			std::fclose(pTextFile);
+			std::remove(TextFileName);
+		}
+
+		double totalSeconds = 0.0;
+		for (const double threadSeconds : seconds)
+		{
+			totalSeconds += threadSeconds;
+		}
+		return totalSeconds / threadCount;
+	}
+
+	// Every player's ticks have to arrive in order, skipping only what was dropped
+	int Verify(const std::vector<SMovementTraceRecord>& records, int threadCount, int playerCount, int tickCount)
+	{
+		std::vector<uint32_t> lastTicks(threadCount * playerCount + 1, 0);
+		int errors = 0;
+		for (const SMovementTraceRecord& record : records)
+		{
+			if (record.entityId == 0 || record.entityId >= lastTicks.size() || record.tick <= lastTicks[record.entityId] || record.tick > static_cast<uint32_t>(tickCount)
+				|| record.event != EMovementTraceEvent::Tick || record.padding != 0)
+			{
+				++errors;
+				continue;
+			}
+			lastTicks[record.entityId] = record.tick;
+		}
+		return errors;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const int threadCount = argc > 1 ? std::atoi(argv[1]) : 4;
+	const int playerCount = argc > 2 ? std::atoi(argv[2]) : 16;
+	const int tickCount = argc > 3 ? std::atoi(argv[3]) : 6000;
+	const double timeScale = argc > 4 ? std::atof(argv[4]) : 100.0;
+
+	if (threadCount <= 0 || threadCount > static_cast<int>(PMoveTrace::MaxThreads) || playerCount <= 0 || tickCount <= 0 || timeScale <= 0.0)
+	{
+		std::fprintf(stderr, "usage: %s [threads <= %u] [players per thread] [ticks] [times real time]\n", argv[0], PMoveTrace::MaxThreads);
+		return 1;
+	}
+
+	const float dt = 1.f / CFixedTimestep::DefaultTickRate;
+	const double recordsPerThread = static_cast<double>(playerCount) * tickCount;
+
+	std::printf("trace: %d threads x %d players x %d ticks at %g times real time, %zu bytes per record\n", threadCount, playerCount, tickCount, timeScale, sizeof(SMovementTraceRecord));
+
+	const double none = Run(EOutput::None, threadCount, playerCount, tickCount, dt, timeScale);
+
+	if (!PMoveTrace::Start(TraceFileName))
+	{
+		std::fprintf(stderr, "can't create %s\n", TraceFileName);
+		return 1;
+	}
+	const double trace = Run(EOutput::Trace, threadCount, playerCount, tickCount, dt, timeScale);
+	PMoveTrace::Stop();
+
+	const double text = Run(EOutput::Text, threadCount, playerCount, tickCount, dt, timeScale);
+
+	std::printf("  %-14s %8.2f ns/player-tick\n", "no output", none * 1e9 / recordsPerThread);
+	std::printf("  %-14s %8.2f ns/player-tick, %+7.2f ns/record\n", "binary trace", trace * 1e9 / recordsPerThread, (trace - none) * 1e9 / recordsPerThread);
+	std::printf("  %-14s %8.2f ns/player-tick, %+7.2f ns/record\n", "text lines", text * 1e9 / recordsPerThread, (text - none) * 1e9 / recordsPerThread);
+
+	std::vector<SMovementTraceRecord> records;
+	const bool isReadable = PMoveTrace::ReadFile(TraceFileName, records);
+	std::remove(TraceFileName);
+
+	const int errors = isReadable ? Verify(records, threadCount, playerCount, tickCount) : 1;
+	std::printf("  %llu records written, %llu dropped, %zu decoded, %d out of order or corrupt\n",
+		static_cast<unsigned long long>(PMoveTrace::GetWrittenCount()), static_cast<unsigned long long>(PMoveTrace::GetDroppedCount()), records.size(), errors);
+
+	const bool isComplete = records.size() == PMoveTrace::GetWrittenCount() && PMoveTrace::GetWrittenCount() + PMoveTrace::GetDroppedCount() == static_cast<uint64_t>(recordsPerThread * threadCount);
+	return errors == 0 && isComplete ? 0 : 1;
+}
@@ -0,0 +1,259 @@
+////////////////////////////////////////////////////////
+// Headless view angles benchmark
+// Replays an hour of mouse look at 60 frames per second through the
+// per-frame view updates of CPlayerComponent, once as it used to work,
+// with the view stored as a quaternion and converted to angles and back
+// at every step, and once with CViewAngles. Reports the cost per frame
+// and how far each one drifted from the input summed in double
+// precision, and fails if CViewAngles drifts at all, rebuilds its cache more
+// than once per frame, or derives a basis that doesn't match the
+// matrix CCamera::CreateOrientationYPR would build.
+//
+// Build (from the repository root):
+//   g++ -O2 -std=c++17 -I. -IBenchmark Benchmark/ViewAnglesBenchmark.cpp -o view_angles_bench
+// Usage:
+//   view_angles_bench [frames]
+////////////////////////////////////////////////////////
+
+#include "BenchmarkCommon.h"
+#include "ViewAngles.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace
+{
+	const float RotationSpeed = 0.002f;
+	const float MinPitch = -0.84f;
+	const float MaxPitch = 1.5f;
+	const float TiltAngle = 0.26f;
+
+	struct SFrameInput
+	{
+		float mouseX;
+		float mouseY;
+		bool isSliding;
+	};
+
+	// Stand-ins for the CryEngine conversions the player used every frame
+	struct SMatrix33
+	{
+		float m[3][3];
+	};
+
+	SMatrix33 CreateOrientationYPR(float yaw, float pitch, float roll)
+	{
+		const float sz = std::sin(yaw), cz = std::cos(yaw);
+		const float sx = std::sin(pitch), cx = std::cos(pitch);
+		const float sy = std::sin(roll), cy = std::cos(roll);
+
+		SMatrix33 matrix;
+		matrix.m[0][0] = cy * cz - sy * sx * sz; matrix.m[0][1] = -cx * sz; matrix.m[0][2] = sy * cz + cy * sx * sz;
+		matrix.m[1][0] = cy * sz + sy * sx * cz; matrix.m[1][1] = cx * cz;  matrix.m[1][2] = sy * sz - cy * sx * cz;
+		matrix.m[2][0] = -sy * cx;               matrix.m[2][1] = sx;       matrix.m[2][2] = cy * cx;
+		return matrix;
+	}
+
+	void CreateAnglesYPR(const SMatrix33& matrix, float& yaw, float& pitch, float& roll)
+	{
+		yaw = std::atan2(-matrix.m[0][1], matrix.m[1][1]);
+		pitch = std::asin(std::max(-1.f, std::min(1.f, matrix.m[2][1])));
+		roll = std::atan2(-matrix.m[2][0], matrix.m[2][2]);
+	}
+
+	SViewQuat GetQuat(const SMatrix33& matrix)
+	{
+		const float (&m)[3][3] = matrix.m;
+		SViewQuat q;
+		const float trace = m[0][0] + m[1][1] + m[2][2];
+		if (trace > 0.f)
+		{
+			const float s = 0.5f / std::sqrt(trace + 1.f);
+			q.w = 0.25f / s;
+			q.x = (m[2][1] - m[1][2]) * s;
+			q.y = (m[0][2] - m[2][0]) * s;
+			q.z = (m[1][0] - m[0][1]) * s;
+		}
+		else if (m[0][0] > m[1][1] && m[0][0] > m[2][2])
+		{
+			const float s = 2.f * std::sqrt(1.f + m[0][0] - m[1][1] - m[2][2]);
+			q.w = (m[2][1] - m[1][2]) / s;
+			q.x = 0.25f * s;
+			q.y = (m[0][1] + m[1][0]) / s;
+			q.z = (m[0][2] + m[2][0]) / s;
+		}
+		else if (m[1][1] > m[2][2])
+		{
+			const float s = 2.f * std::sqrt(1.f + m[1][1] - m[0][0] - m[2][2]);
+			q.w = (m[0][2] - m[2][0]) / s;
+			q.x = (m[0][1] + m[1][0]) / s;
+			q.y = 0.25f * s;
+			q.z = (m[1][2] + m[2][1]) / s;
+		}
+		else
+		{
+			const float s = 2.f * std::sqrt(1.f + m[2][2] - m[0][0] - m[1][1]);
+			q.w = (m[1][0] - m[0][1]) / s;
+			q.x = (m[0][2] + m[2][0]) / s;
+			q.y = (m[1][2] + m[2][1]) / s;
+			q.z = 0.25f * s;
+		}
+		return q;
+	}
+
+	SMatrix33 GetMatrix(const SViewQuat& q)
+	{
+		SMatrix33 matrix;
+		matrix.m[0][0] = 1.f - 2.f * (q.y * q.y + q.z * q.z); matrix.m[0][1] = 2.f * (q.x * q.y - q.w * q.z); matrix.m[0][2] = 2.f * (q.x * q.z + q.w * q.y);
+		matrix.m[1][0] = 2.f * (q.x * q.y + q.w * q.z); matrix.m[1][1] = 1.f - 2.f * (q.x * q.x + q.z * q.z); matrix.m[1][2] = 2.f * (q.y * q.z - q.w * q.x);
+		matrix.m[2][0] = 2.f * (q.x * q.z - q.w * q.y); matrix.m[2][1] = 2.f * (q.y * q.z + q.w * q.x); matrix.m[2][2] = 1.f - 2.f * (q.x * q.x + q.y * q.y);
+		return matrix;
+	}
+
+	// Where the view has to end up, summed in double
+	struct SReferenceView
+	{
+		double yaw = 0.0;
+		double pitch = 0.0;
+	};
+
+	// What the outputs of a frame are folded into, so neither path can be optimized away
+	struct SFrameOutput
+	{
+		float cmdYaw = 0.f;
+		float cmdPitch = 0.f;
+		double checksum = 0.0;
+	};
+
+	// UpdateLookDirectionRequest, UpdateLookRotationZ, UpdateCamera and PrepareMovementTick as they were
+	void StepQuatView(SViewQuat& look, const SFrameInput& input, SFrameOutput& output)
+	{
+		float yaw, pitch, roll;
+		CreateAnglesYPR(GetMatrix(look), yaw, pitch, roll);
+		yaw += input.mouseX * RotationSpeed;
+		pitch = std::max(MinPitch, std::min(MaxPitch, pitch + input.mouseY * RotationSpeed));
+		look = GetQuat(CreateOrientationYPR(yaw, pitch, 0.f));
+
+		CreateAnglesYPR(GetMatrix(look), yaw, pitch, roll);
+		const SViewQuat entity = GetQuat(CreateOrientationYPR(yaw, 0.f, 0.f));
+
+		CreateAnglesYPR(GetMatrix(look), yaw, pitch, roll);
+		roll = input.isSliding ? TiltAngle : 0.f;
+		look = GetQuat(CreateOrientationYPR(yaw, pitch, roll));
+		const SMatrix33 camera = CreateOrientationYPR(0.f, pitch, roll);
+
+		CreateAnglesYPR(GetMatrix(look), yaw, pitch, roll);
+		output.cmdYaw = yaw;
+		output.cmdPitch = pitch;
+		output.checksum += entity.z * entity.z + camera.m[2][1];
+	}
+
+	// The same steps with CViewAngles
+	void StepAnglesView(CViewAngles& look, const SFrameInput& input, SFrameOutput& output)
+	{
+		look.AddYaw(input.mouseX * RotationSpeed);
+		look.AddPitch(input.mouseY * RotationSpeed, MinPitch, MaxPitch);
+
+		const SViewQuat& entity = look.GetYawOrientation();
+		const float entityZ = entity.z;
+
+		look.SetRoll(input.isSliding ? TiltAngle : 0.f);
+		// The camera transform still takes a matrix, converting a quaternion needs no trigonometry
+		const SMatrix33 camera = GetMatrix(look.GetPitchRollOrientation());
+
+		output.cmdYaw = look.GetYaw();
+		output.cmdPitch = look.GetPitch();
+		output.checksum += entityZ * entityZ + camera.m[2][1];
+	}
+
+	double GetAngleError(double a, double b)
+	{
+		return std::fabs(std::remainder(a - b, 2.0 * 3.141592653589793));
+	}
+
+	// Strafe jumping keeps turning one way, with the pitch pushed into both limits now and then
+	std::vector<SFrameInput> CreateInput(int frameCount)
+	{
+		std::mt19937 random(3);
+		std::normal_distribution<float> mouse(0.f, 4.f);
+		std::uniform_int_distribution<int> chance(0, 599);
+
+		std::vector<SFrameInput> inputs(frameCount);
+		bool isSliding = false;
+		for (SFrameInput& input : inputs)
+		{
+			isSliding = chance(random) < 3 ? !isSliding : isSliding;
+			input.mouseX = 6.f + mouse(random);
+			input.mouseY = chance(random) < 6 ? 400.f * (chance(random) < 300 ? 1.f : -1.f) : mouse(random);
+			input.isSliding = isSliding;
+		}
+		return inputs;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const int frameCount = argc > 1 ? std::atoi(argv[1]) : 60 * 60 * 60;
+
+	if (frameCount <= 0)
+	{
+		std::fprintf(stderr, "usage: %s [frames]\n", argv[0]);
+		return 1;
+	}
+
+	const std::vector<SFrameInput> inputs = CreateInput(frameCount);
+
+	SReferenceView reference;
+	SViewQuat quatView;
+	CViewAngles anglesView;
+	SFrameOutput quatOutput, anglesOutput;
+	double quatSeconds = 0.0, anglesSeconds = 0.0;
+	double quatMaxError = 0.0, anglesMaxError = 0.0;
+	uint32_t rollChangeCount = 0;
+
+	for (int frame = 0; frame < frameCount; ++frame)
+	{
+		const SFrameInput& input = inputs[frame];
+		reference.yaw += static_cast<double>(input.mouseX * RotationSpeed);
+		reference.pitch = std::max<double>(MinPitch, std::min<double>(MaxPitch, reference.pitch + static_cast<double>(input.mouseY * RotationSpeed)));
+		rollChangeCount += frame > 0 && input.isSliding != inputs[frame - 1].isSliding ? 1 : 0;
+
+		Clock::time_point start = Clock::now();
+		StepQuatView(quatView, input, quatOutput);
+		quatSeconds += GetSecondsSince(start);
+
+		start = Clock::now();
+		StepAnglesView(anglesView, input, anglesOutput);
+		anglesSeconds += GetSecondsSince(start);
+
+		quatMaxError = std::max(quatMaxError, std::max(GetAngleError(quatOutput.cmdYaw, reference.yaw), std::fabs(quatOutput.cmdPitch - reference.pitch)));
+		anglesMaxError = std::max(anglesMaxError, std::max(GetAngleError(anglesOutput.cmdYaw, reference.yaw), std::fabs(anglesOutput.cmdPitch - reference.pitch)));
+	}
+
+	// The cached basis has to match the matrix built directly from the stored angles
+	const SMatrix33 expected = CreateOrientationYPR(anglesView.GetYaw(), anglesView.GetPitch(), anglesView.GetRoll());
+	const PMoveVec3 basis[3] = { anglesView.GetRight(), anglesView.GetForward(), anglesView.GetUp() };
+	float basisError = 0.f;
+	for (int column = 0; column < 3; ++column)
+	{
+		basisError = std::max(basisError, std::fabs(basis[column].x - expected.m[0][column]));
+		basisError = std::max(basisError, std::fabs(basis[column].y - expected.m[1][column]));
+		basisError = std::max(basisError, std::fabs(basis[column].z - expected.m[2][column]));
+	}
+
+	const double minutes = frameCount / 3600.0;
+	std::printf("view angles: %d frames (%.0f minutes at 60 fps), checksums %.3f %.3f\n", frameCount, minutes, quatOutput.checksum, anglesOutput.checksum);
+	std::printf("  %-14s %8.2f ns/frame, drifted %.3g rad\n", "quaternion", quatSeconds * 1e9 / frameCount, quatMaxError);
+	std::printf("  %-14s %8.2f ns/frame, drifted %.3g rad, %u cache refreshes, basis off by %.3g\n", "view angles", anglesSeconds * 1e9 / frameCount, anglesMaxError,
+		anglesView.GetRefreshCount(), basisError);
+
+	// Only the rounding to float may remain, half a float step at Pi
+	const bool hasDrifted = anglesMaxError > 2e-7;
+	const bool hasRefreshedTooOften = anglesView.GetRefreshCount() > static_cast<uint32_t>(frameCount) + rollChangeCount;
+	const bool isBasisWrong = basisError > 1e-5f;
+	return hasDrifted || hasRefreshedTooOften || isBasisWrong ? 1 : 0;
+}
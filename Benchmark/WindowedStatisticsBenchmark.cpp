@@ -0,0 +1,233 @@
+////////////////////////////////////////////////////////
+// Headless windowed statistics benchmark
+// Times a push and a read of the old per-player MovingAverage (a modulo
+// index and a float running sum that is never re-summed) next to
+// CWindowedStatistics, one CWindowedMeanBatch lane per player against
+// a window each, and the mouse filters. Then pushes a jittery angular
+// velocity with occasional fast flicks, 10^8 samples by default, and
+// compares both averages with the exact mean of the window in double.
+// Fails if CWindowedStatistics drifts, or if a batch lane differs from a
+// window of its own.
+//
+// Build (from the repository root):
+//   g++ -O2 -std=c++17 -I. -IBenchmark Benchmark/WindowedStatisticsBenchmark.cpp -o windowed_statistics_bench
+// Usage:
+//   windowed_statistics_bench [drift samples] [players]
+////////////////////////////////////////////////////////
+
+#include "BenchmarkCommon.h"
+#include "WindowedStatistics.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+	const uint32_t WindowSize = 8;
+
+	// CPlayerComponent::MovingAverage as it was, for comparison
+	template<typename T, size_t SAMPLES_COUNT>
+	class CLegacyMovingAverage
+	{
+	public:
+		void Push(const T& value)
+		{
+			if (m_cursor == SAMPLES_COUNT)
+			{
+				m_values.fill(value);
+				m_cursor = 0;
+				m_accumulator = value * T(SAMPLES_COUNT);
+			}
+			else
+			{
+				m_accumulator -= m_values[m_cursor];
+				m_values[m_cursor] = value;
+				m_accumulator += m_values[m_cursor];
+				m_cursor = (m_cursor + 1) % SAMPLES_COUNT;
+			}
+		}
+
+		T Get() const { return m_accumulator / T(SAMPLES_COUNT); }
+
+	private:
+		std::array<T, SAMPLES_COUNT> m_values{};
+		size_t m_cursor = SAMPLES_COUNT;
+		T m_accumulator = T(0);
+	};
+
+	// Horizontal angular velocity in radians per second: small jitter, now and then a flick a thousand times faster
+	std::vector<float> CreateSignal(size_t count, uint32_t seed)
+	{
+		std::mt19937 random(seed);
+		std::normal_distribution<float> jitter(0.f, 3.f);
+		std::uniform_real_distribution<float> flick(-4000.f, 4000.f);
+		std::uniform_int_distribution<int> chance(0, 99);
+
+		std::vector<float> signal(count);
+		for (float& value : signal)
+		{
+			value = chance(random) == 0 ? flick(random) : jitter(random);
+		}
+		return signal;
+	}
+
+	struct SDriftResult
+	{
+		double legacyMaxError = 0.0;
+		double windowMaxError = 0.0;
+		double legacyEndError = 0.0;
+		double windowEndError = 0.0;
+	};
+
+	SDriftResult MeasureDrift(uint64_t sampleCount)
+	{
+		// A repeating block of signal, so 10^8 samples don't need 400 MB
+		const std::vector<float> signal = CreateSignal(1 << 20, 7);
+		CLegacyMovingAverage<float, WindowSize> legacy;
+		CWindowedStatistics<float, WindowSize> window;
+		std::array<float, WindowSize> exact{};
+
+		SDriftResult result;
+		for (uint64_t i = 0; i < sampleCount; ++i)
+		{
+			const float value = signal[i & (signal.size() - 1)];
+			legacy.Push(value);
+			window.Push(value);
+			exact[i % WindowSize] = value;
+
+			// Checking every sample would dominate the run, every 4096th still sees every stretch of it
+			if ((i & 4095) != 4095 && i + 1 != sampleCount)
+				continue;
+
+			double sum = 0.0;
+			for (const float sample : exact)
+			{
+				sum += sample;
+			}
+			const double mean = sum / WindowSize;
+			result.legacyEndError = std::fabs(legacy.Get() - mean);
+			result.windowEndError = std::fabs(window.GetMean() - mean);
+			result.legacyMaxError = std::max(result.legacyMaxError, result.legacyEndError);
+			result.windowMaxError = std::max(result.windowMaxError, result.windowEndError);
+		}
+		return result;
+	}
+
+	template<typename TPush>
+	double TimePushes(int sampleCount, TPush&& push)
+	{
+		const Clock::time_point start = Clock::now();
+		for (int i = 0; i < sampleCount; ++i)
+		{
+			push(i);
+		}
+		return GetSecondsSince(start) * 1e9 / sampleCount;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const double driftSamples = argc > 1 ? std::atof(argv[1]) : 1e8;
+	const int playerCount = argc > 2 ? std::atoi(argv[2]) : 128;
+
+	if (driftSamples < 1.0 || playerCount <= 0)
+	{
+		std::fprintf(stderr, "usage: %s [drift samples] [players]\n", argv[0]);
+		return 1;
+	}
+
+	const int sampleCount = 1 << 22;
+	const std::vector<float> signal = CreateSignal(sampleCount, 3);
+	const int mask = sampleCount - 1;
+	volatile float sink = 0.f;
+
+	std::printf("windowed statistics: %u sample window, %d players\n", WindowSize, playerCount);
+	{
+		CLegacyMovingAverage<float, WindowSize> legacy;
+		CWindowedStatistics<float, WindowSize> window;
+		CExponentialFilter<float> exponential(10.f);
+		COneEuroFilter<float> oneEuro(1.f, 0.01f);
+		const float dt = 1.f / 144.f;
+
+		const double legacyNs = TimePushes(sampleCount, [&](int i) { legacy.Push(signal[i]); sink = legacy.Get(); });
+		const double windowNs = TimePushes(sampleCount, [&](int i) { window.Push(signal[i]); sink = window.GetMean(); });
+		const double statisticsNs = TimePushes(sampleCount / 16, [&](int i) { window.Push(signal[i]); sink = window.GetMin() + window.GetMax() + window.GetVariance(); });
+		const double exponentialNs = TimePushes(sampleCount, [&](int i) { sink = exponential.Filter(signal[i], dt); });
+		const double oneEuroNs = TimePushes(sampleCount, [&](int i) { sink = oneEuro.Filter(signal[i], dt); });
+
+		std::printf("  push and read, ns/sample\n");
+		std::printf("    MovingAverage           %7.2f\n", legacyNs);
+		std::printf("    CWindowedStatistics     %7.2f mean, %7.2f with min, max and variance\n", windowNs, statisticsNs);
+		std::printf("    CExponentialFilter      %7.2f\n", exponentialNs);
+		std::printf("    COneEuroFilter          %7.2f\n", oneEuroNs);
+	}
+
+	uint32_t failures = 0;
+	{
+		// Every player's angular velocity once per frame, one window each against one batch.
+		// The frames are laid out before timing, so both loops time only pushing and reading.
+		const int frameCount = std::max(1, sampleCount / playerCount);
+		std::vector<CWindowedStatistics<float, WindowSize>> windows(playerCount);
+		CWindowedMeanBatch<WindowSize> batch(static_cast<uint32_t>(playerCount));
+		std::vector<float> frames(static_cast<size_t>(frameCount) * playerCount);
+		for (size_t i = 0; i < frames.size(); ++i)
+		{
+			frames[i] = signal[i & mask];
+		}
+		std::vector<float> windowMeans(playerCount);
+		std::vector<float> batchMeans(playerCount);
+
+		Clock::time_point start = Clock::now();
+		for (int f = 0; f < frameCount; ++f)
+		{
+			const float* pFrame = frames.data() + static_cast<size_t>(f) * playerCount;
+			for (int p = 0; p < playerCount; ++p)
+			{
+				windows[p].Push(pFrame[p]);
+				windowMeans[p] = windows[p].GetMean();
+			}
+		}
+		const double windowsNs = GetSecondsSince(start) * 1e9 / (static_cast<double>(frameCount) * playerCount);
+
+		start = Clock::now();
+		for (int f = 0; f < frameCount; ++f)
+		{
+			batch.Push(frames.data() + static_cast<size_t>(f) * playerCount);
+			batch.GetMeans(batchMeans.data());
+		}
+		const double batchNs = GetSecondsSince(start) * 1e9 / (static_cast<double>(frameCount) * playerCount);
+
+		// Same order of operations, so every lane matches the window fed the same samples bit for bit
+		uint32_t mismatches = 0;
+		for (int p = 0; p < playerCount; ++p)
+		{
+			mismatches += std::memcmp(&windowMeans[p], &batchMeans[p], sizeof(float)) == 0 ? 0 : 1;
+		}
+
+		std::printf("  all players per frame, ns/player\n");
+		std::printf("    a window per player     %7.2f\n", windowsNs);
+		std::printf("    CWindowedMeanBatch      %7.2f (%.2fx), %u lanes differ from their window\n", batchNs, windowsNs / batchNs, mismatches);
+		failures += mismatches > 0 ? 1 : 0;
+	}
+
+	{
+		const Clock::time_point start = Clock::now();
+		const SDriftResult drift = MeasureDrift(static_cast<uint64_t>(driftSamples));
+		// Flicks reach 4000, one rounding step of a sum around them is about 5e-4
+		const double tolerance = 1e-3;
+		const bool hasDrifted = drift.windowMaxError > tolerance;
+
+		std::printf("  drift over %.0f samples (%.1f s), error of the mean against double\n", driftSamples, GetSecondsSince(start));
+		std::printf("    MovingAverage           max %10.6f, at the end %10.6f\n", drift.legacyMaxError, drift.legacyEndError);
+		std::printf("    CWindowedStatistics     max %10.6f, at the end %10.6f%s\n", drift.windowMaxError, drift.windowEndError, hasDrifted ? "  DRIFTED" : "");
+		failures += hasDrifted ? 1 : 0;
+	}
+
+	return failures == 0 ? 0 : 1;
+}
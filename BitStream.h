@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+////////////////////////////////////////////////////////
+// Minimal bit packing over a caller owned buffer, least significant bit first
+// Writes past the end set an overflow flag instead of touching memory,
+// reads past the end return zeros and set the same flag.
+////////////////////////////////////////////////////////
+
+class CBitWriter
+{
+public:
+	CBitWriter(uint8_t* pBuffer, size_t capacity)
+		: m_pBuffer(pBuffer)
+		, m_capacity(capacity)
+	{
+	}
+
+	void WriteBits(uint32_t value, uint32_t bitCount)
+	{
+		const uint64_t mask = bitCount < 32 ? (uint64_t(1) << bitCount) - 1 : 0xFFFFFFFFull;
+		m_scratch |= (value & mask) << m_scratchBitCount;
+		m_scratchBitCount += bitCount;
+		m_bitCount += bitCount;
+
+		// Emit whole bytes, the partial last byte is kept in scratch and written by Flush
+		while (m_scratchBitCount >= 8)
+		{
+			PutByte(static_cast<uint8_t>(m_scratch));
+			m_scratch >>= 8;
+			m_scratchBitCount -= 8;
+		}
+	}
+
+	// Writes the trailing partial byte, call once after the last write
+	void Flush()
+	{
+		if (m_scratchBitCount > 0)
+		{
+			PutByte(static_cast<uint8_t>(m_scratch));
+			m_scratch = 0;
+			m_scratchBitCount = 0;
+		}
+	}
+
+	void WriteBool(bool value) { WriteBits(value ? 1u : 0u, 1); }
+
+	// Small values take few bits: a 2 bit width class followed by 4, 8, 16 or 32 bits
+	void WriteVarUint(uint32_t value)
+	{
+		const uint32_t widthClass = value < (1u << 4) ? 0 : value < (1u << 8) ? 1 : value < (1u << 16) ? 2 : 3;
+		WriteBits(widthClass, 2);
+		WriteBits(value, 4u << widthClass);
+	}
+
+	// Signed values are zig-zag mapped so small magnitudes of either sign stay small
+	void WriteVarInt(int32_t value) { WriteVarUint((static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31)); }
+
+	size_t GetBitCount() const { return m_bitCount; }
+	size_t GetByteCount() const { return (m_bitCount + 7) >> 3; }
+	bool HasOverflowed() const { return m_hasOverflowed; }
+
+private:
+	void PutByte(uint8_t value)
+	{
+		if (m_byteCount < m_capacity)
+			m_pBuffer[m_byteCount++] = value;
+		else
+			m_hasOverflowed = true;
+	}
+
+	uint8_t* m_pBuffer;
+	size_t m_capacity;
+	size_t m_byteCount = 0;
+	size_t m_bitCount = 0;
+	uint64_t m_scratch = 0;
+	uint32_t m_scratchBitCount = 0;
+	bool m_hasOverflowed = false;
+};
+
+class CBitReader
+{
+public:
+	CBitReader(const uint8_t* pBuffer, size_t size)
+		: m_pBuffer(pBuffer)
+		, m_size(size)
+	{
+	}
+
+	uint32_t ReadBits(uint32_t bitCount)
+	{
+		while (m_scratchBitCount < bitCount)
+		{
+			if (m_byteCount >= m_size)
+			{
+				m_hasOverflowed = true;
+				return 0;
+			}
+			m_scratch |= uint64_t(m_pBuffer[m_byteCount++]) << m_scratchBitCount;
+			m_scratchBitCount += 8;
+		}
+
+		const uint64_t mask = bitCount < 32 ? (uint64_t(1) << bitCount) - 1 : 0xFFFFFFFFull;
+		const uint32_t value = static_cast<uint32_t>(m_scratch & mask);
+		m_scratch >>= bitCount;
+		m_scratchBitCount -= bitCount;
+		return value;
+	}
+
+	bool ReadBool() { return ReadBits(1) != 0; }
+
+	uint32_t ReadVarUint()
+	{
+		const uint32_t widthClass = ReadBits(2);
+		return ReadBits(4u << widthClass);
+	}
+
+	int32_t ReadVarInt()
+	{
+		const uint32_t value = ReadVarUint();
+		return static_cast<int32_t>((value >> 1) ^ (0u - (value & 1u)));
+	}
+
+	bool HasOverflowed() const { return m_hasOverflowed; }
+
+private:
+	const uint8_t* m_pBuffer;
+	size_t m_size;
+	size_t m_byteCount = 0;
+	uint64_t m_scratch = 0;
+	uint32_t m_scratchBitCount = 0;
+	bool m_hasOverflowed = false;
+};
@@ -0,0 +1,192 @@
+#include "CommandBatch.h"
+#include "BitStream.h"
+#include "Quantization.h"
+
+namespace
+{
+	enum EChangeBit : uint32_t
+	{
+		eChange_Move = 1 << 0,
+		eChange_Yaw = 1 << 1,
+		eChange_Pitch = 1 << 2,
+		eChange_Jump = 1 << 3,
+
+		eChange_BitCount = 4
+	};
+
+	const uint32_t MoveBits = 8;
+	const float MoveScale = 127.f;
+
+	struct SQuantizedCmd
+	{
+		uint32_t forwardMove = 0;
+		uint32_t rightMove = 0;
+		uint32_t upMove = 0;
+		uint32_t yaw = 0;
+		uint32_t pitch = 0;
+		bool jump = false;
+	};
+
+	// Symmetric around zero, so idle and full deflection survive exactly
+	uint32_t QuantizeMove(float value)
+	{
+		const float clamped = value < -1.f ? -1.f : value > 1.f ? 1.f : value;
+		// Also catches NaN
+		if (!(clamped == clamped))
+			return static_cast<uint32_t>(MoveScale);
+		return static_cast<uint32_t>(static_cast<int32_t>(std::lround(clamped * MoveScale)) + static_cast<int32_t>(MoveScale));
+	}
+
+	// Clients only ever send 0 to 254, a crafted 255 must not decode past full deflection
+	float DequantizeMove(uint32_t value)
+	{
+		const float move = static_cast<float>(static_cast<int32_t>(value) - static_cast<int32_t>(MoveScale)) / MoveScale;
+		return move > 1.f ? 1.f : move;
+	}
+
+	SQuantizedCmd QuantizeCmd(const Cmd& cmd)
+	{
+		SQuantizedCmd quantized;
+		quantized.forwardMove = QuantizeMove(cmd.forwardMove);
+		quantized.rightMove = QuantizeMove(cmd.rightMove);
+		quantized.upMove = QuantizeMove(cmd.upMove);
+		quantized.yaw = PMoveQuantize::QuantizeAngle(cmd.yaw, PMoveCmdBatch::AngleBits);
+		quantized.pitch = PMoveQuantize::QuantizeAngle(cmd.pitch, PMoveCmdBatch::AngleBits);
+		quantized.jump = cmd.jump;
+		return quantized;
+	}
+
+	Cmd DequantizeCmd(const SQuantizedCmd& quantized, uint32_t sequence)
+	{
+		Cmd cmd;
+		cmd.sequence = sequence;
+		cmd.forwardMove = DequantizeMove(quantized.forwardMove);
+		cmd.rightMove = DequantizeMove(quantized.rightMove);
+		cmd.upMove = DequantizeMove(quantized.upMove);
+		cmd.yaw = PMoveQuantize::DequantizeAngle(quantized.yaw, PMoveCmdBatch::AngleBits);
+		cmd.pitch = PMoveQuantize::DequantizeAngle(quantized.pitch, PMoveCmdBatch::AngleBits);
+		cmd.jump = quantized.jump;
+		return cmd;
+	}
+
+	uint32_t GetChangeMask(const SQuantizedCmd& cmd, const SQuantizedCmd& previous)
+	{
+		uint32_t mask = 0;
+		mask |= cmd.forwardMove != previous.forwardMove || cmd.rightMove != previous.rightMove || cmd.upMove != previous.upMove ? eChange_Move : 0u;
+		mask |= cmd.yaw != previous.yaw ? eChange_Yaw : 0u;
+		mask |= cmd.pitch != previous.pitch ? eChange_Pitch : 0u;
+		mask |= cmd.jump != previous.jump ? eChange_Jump : 0u;
+		return mask;
+	}
+}
+
+namespace PMoveCmdBatch
+{
+
+Cmd Quantize(const Cmd& cmd)
+{
+	return DequantizeCmd(QuantizeCmd(cmd), cmd.sequence);
+}
+
+bool Read(const uint8_t* pBuffer, size_t size, SCmdBatch& batch)
+{
+	CBitReader reader(pBuffer, size);
+	batch.snapshotAck = reader.ReadBits(32);
+	const uint32_t newestSequence = reader.ReadBits(32);
+	batch.cmdCount = reader.ReadVarUint();
+	if (reader.HasOverflowed() || batch.cmdCount == 0 || batch.cmdCount > MaxCmds)
+		return false;
+
+	// Every command is encoded against the one before it, held buttons and a still mouse cost a single bit
+	SQuantizedCmd previous = QuantizeCmd(Cmd());
+	const uint32_t firstSequence = newestSequence - batch.cmdCount + 1;
+	for (uint32_t i = 0; i < batch.cmdCount; ++i)
+	{
+		SQuantizedCmd cmd = previous;
+		if (reader.ReadBool())
+		{
+			const uint32_t changeMask = reader.ReadBits(eChange_BitCount);
+			if (changeMask & eChange_Move)
+			{
+				cmd.forwardMove = reader.ReadBits(MoveBits);
+				cmd.rightMove = reader.ReadBits(MoveBits);
+				cmd.upMove = reader.ReadBits(MoveBits);
+			}
+			if (changeMask & eChange_Yaw)
+				cmd.yaw = reader.ReadBits(AngleBits);
+			if (changeMask & eChange_Pitch)
+				cmd.pitch = reader.ReadBits(AngleBits);
+			if (changeMask & eChange_Jump)
+				cmd.jump = !cmd.jump;
+		}
+
+		batch.cmds[i] = DequantizeCmd(cmd, firstSequence + i);
+		previous = cmd;
+	}
+
+	return !reader.HasOverflowed();
+}
+
+}
+
+void CCmdBatchWriter::SetRedundancy(uint32_t redundancy)
+{
+	m_redundancy = redundancy < 1 ? 1 : redundancy > PMoveCmdBatch::MaxCmds ? PMoveCmdBatch::MaxCmds : redundancy;
+}
+
+void CCmdBatchWriter::Push(const Cmd& cmd)
+{
+	if (m_cmdCount > 0 && cmd.sequence != m_newestSequence + 1)
+	{
+		m_cmdCount = 0;
+	}
+
+	m_cmds.Insert(cmd.sequence) = cmd;
+	m_newestSequence = cmd.sequence;
+	m_cmdCount = m_cmdCount < PMoveCmdBatch::MaxCmds ? m_cmdCount + 1 : m_cmdCount;
+}
+
+size_t CCmdBatchWriter::Write(uint32_t snapshotAck, uint8_t* pBuffer, size_t capacity) const
+{
+	const uint32_t cmdCount = m_cmdCount < m_redundancy ? m_cmdCount : m_redundancy;
+	if (cmdCount == 0)
+		return 0;
+
+	CBitWriter writer(pBuffer, capacity);
+	writer.WriteBits(snapshotAck, 32);
+	writer.WriteBits(m_newestSequence, 32);
+	writer.WriteVarUint(cmdCount);
+
+	SQuantizedCmd previous = QuantizeCmd(Cmd());
+	for (uint32_t sequence = m_newestSequence - cmdCount + 1; sequence != m_newestSequence + 1; ++sequence)
+	{
+		const SQuantizedCmd cmd = QuantizeCmd(*m_cmds.Find(sequence));
+		const uint32_t changeMask = GetChangeMask(cmd, previous);
+		writer.WriteBool(changeMask != 0);
+		if (changeMask != 0)
+		{
+			writer.WriteBits(changeMask, eChange_BitCount);
+			if (changeMask & eChange_Move)
+			{
+				writer.WriteBits(cmd.forwardMove, MoveBits);
+				writer.WriteBits(cmd.rightMove, MoveBits);
+				writer.WriteBits(cmd.upMove, MoveBits);
+			}
+			if (changeMask & eChange_Yaw)
+				writer.WriteBits(cmd.yaw, PMoveCmdBatch::AngleBits);
+			if (changeMask & eChange_Pitch)
+				writer.WriteBits(cmd.pitch, PMoveCmdBatch::AngleBits);
+		}
+		previous = cmd;
+	}
+
+	writer.Flush();
+	return writer.HasOverflowed() ? 0 : writer.GetByteCount();
+}
+
+void CCmdBatchWriter::Reset()
+{
+	m_cmds.Clear();
+	m_newestSequence = 0;
+	m_cmdCount = 0;
+}
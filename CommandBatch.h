@@ -0,0 +1,63 @@
+#pragma once
+
+#include "PlayerMovement.h"
+#include "SequenceRing.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+////////////////////////////////////////////////////////
+// Batched, redundant movement commands from client to server
+// The client sends its newest commands at a fixed rate and every packet
+// repeats the ones before it, so a command is only lost if all packets
+// carrying it are. The server hands everything to its CServerCmdQueue,
+// which drops the sequences it already has.
+////////////////////////////////////////////////////////
+
+namespace PMoveCmdBatch
+{
+	static constexpr uint32_t MaxCmds = 32;
+	static constexpr uint32_t DefaultRedundancy = 8;
+	static constexpr uint32_t AngleBits = 16;
+
+	// Rounds a command to what the server decodes, predicting with it keeps client and server bit identical
+	Cmd Quantize(const Cmd& cmd);
+}
+
+struct SCmdBatch
+{
+	uint32_t snapshotAck = 0;             // Newest movement snapshot the client decoded
+	uint32_t cmdCount = 0;
+	std::array<Cmd, PMoveCmdBatch::MaxCmds> cmds;   // Consecutive sequences, oldest first
+};
+
+namespace PMoveCmdBatch
+{
+	// Returns false for malformed packets
+	bool Read(const uint8_t* pBuffer, size_t size, SCmdBatch& batch);
+}
+
+// Client: remembers the newest commands and packs the last few of them into each packet
+class CCmdBatchWriter
+{
+public:
+	explicit CCmdBatchWriter(uint32_t redundancy = PMoveCmdBatch::DefaultRedundancy) { SetRedundancy(redundancy); }
+
+	// Number of commands per packet, should cover at least the ticks between two packets
+	void SetRedundancy(uint32_t redundancy);
+	uint32_t GetRedundancy() const { return m_redundancy; }
+
+	// Commands are expected in sequence order, a gap restarts the batch
+	void Push(const Cmd& cmd);
+
+	// Returns the number of bytes written, 0 if there is nothing to send or the buffer was too small
+	size_t Write(uint32_t snapshotAck, uint8_t* pBuffer, size_t capacity) const;
+	void Reset();
+
+private:
+	CSequenceRing<Cmd, PMoveCmdBatch::MaxCmds> m_cmds;
+	uint32_t m_newestSequence = 0;
+	uint32_t m_cmdCount = 0;
+	uint32_t m_redundancy = PMoveCmdBatch::DefaultRedundancy;
+};
@@ -0,0 +1,70 @@
+#include "InputTimeline.h"
+
+void CInputTimeline::PushButtons(double time, uint32_t buttons)
+{
+	Push(STimedInput{ time, 0.f, 0.f, buttons, false });
+	m_latestButtons = buttons;
+}
+
+void CInputTimeline::PushLook(double time, float yawDelta, float pitchDelta)
+{
+	Push(STimedInput{ time, yawDelta, pitchDelta, 0, true });
+}
+
+void CInputTimeline::Push(const STimedInput& input)
+{
+	m_inputs.push_back(input);
+	if (m_inputs.size() > 1 && m_inputs.back().time < m_inputs[m_inputs.size() - 2].time)
+	{
+		// Keeps the timeline ordered, Consume stops at the first input past the tick
+		m_inputs.back().time = m_inputs[m_inputs.size() - 2].time;
+	}
+}
+
+STickInput CInputTimeline::Consume(double time, CViewAngles& view)
+{
+	STickInput tickInput;
+	for (; m_readIndex < m_inputs.size() && m_inputs[m_readIndex].time <= time; ++m_readIndex)
+	{
+		const STimedInput& input = m_inputs[m_readIndex];
+		if (input.isLook)
+		{
+			view.AddYaw(input.yawDelta);
+			view.AddPitch(input.pitchDelta, m_minPitch, m_maxPitch);
+		}
+		else
+		{
+			tickInput.pressedButtons |= input.buttons & ~m_tickButtons;
+			m_tickButtons = input.buttons;
+		}
+	}
+	tickInput.buttons = m_tickButtons;
+
+	if (m_readIndex == m_inputs.size())
+	{
+		m_inputs.clear();
+		m_readIndex = 0;
+	}
+	return tickInput;
+}
+
+void CInputTimeline::ApplyPending(CViewAngles& view) const
+{
+	for (uint32_t i = m_readIndex; i < m_inputs.size(); ++i)
+	{
+		const STimedInput& input = m_inputs[i];
+		if (input.isLook)
+		{
+			view.AddYaw(input.yawDelta);
+			view.AddPitch(input.pitchDelta, m_minPitch, m_maxPitch);
+		}
+	}
+}
+
+void CInputTimeline::Reset(uint32_t buttons)
+{
+	m_inputs.clear();
+	m_readIndex = 0;
+	m_tickButtons = buttons;
+	m_latestButtons = buttons;
+}
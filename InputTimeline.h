@@ -0,0 +1,66 @@
+#pragma once
+
+#include "ViewAngles.h"
+
+#include <cstdint>
+#include <vector>
+
+////////////////////////////////////////////////////////
+// Timestamped player input, consumed one fixed tick at a time
+// Button changes and mouse deltas are recorded with the time they were
+// made instead of being sampled once per frame. Every tick takes exactly
+// the inputs made before it ended (see CFixedTimestep::GetTickEndTime),
+// so a 60 Hz and a 360 Hz client build the same commands from the same
+// hands on the keyboard, and strafe jumping gains no longer depend on the
+// frame rate. Inputs no tick has reached yet can still be shown, the view
+// renders ahead of the simulation without changing it.
+////////////////////////////////////////////////////////
+
+// Buttons of one tick
+struct STickInput
+{
+	uint32_t buttons = 0;                 // Held when the tick ended
+	uint32_t pressedButtons = 0;          // Went down at some point during the tick, so taps shorter than a tick aren't lost
+};
+
+class CInputTimeline
+{
+public:
+	CInputTimeline(float minPitch, float maxPitch) : m_minPitch(minPitch), m_maxPitch(maxPitch) {}
+
+	// Times are in seconds on the clock the ticks run on. Inputs stamped before the previous one count as made together with it.
+	void PushButtons(double time, uint32_t buttons);
+	void PushLook(double time, float yawDelta, float pitchDelta);
+
+	// Applies the look inputs made up to time to the tick's view and returns its buttons
+	STickInput Consume(double time, CViewAngles& view);
+	// Applies the look inputs no tick consumed yet, for the view rendered ahead of the ticks
+	void ApplyPending(CViewAngles& view) const;
+
+	// Buttons after every input pushed so far
+	uint32_t GetLatestButtons() const { return m_latestButtons; }
+	uint32_t GetPendingCount() const { return static_cast<uint32_t>(m_inputs.size() - m_readIndex); }
+
+	// Drops pending inputs and starts over with the given buttons held
+	void Reset(uint32_t buttons = 0);
+
+private:
+	struct STimedInput
+	{
+		double time;
+		float yawDelta;
+		float pitchDelta;
+		uint32_t buttons;
+		bool isLook;
+	};
+
+	void Push(const STimedInput& input);
+
+	float m_minPitch;
+	float m_maxPitch;
+	// Consumed from m_readIndex on, the storage is reused once a tick consumed everything
+	std::vector<STimedInput> m_inputs;
+	uint32_t m_readIndex = 0;
+	uint32_t m_tickButtons = 0;
+	uint32_t m_latestButtons = 0;
+};
@@ -0,0 +1,220 @@
+#include "InterestManager.h"
+#include "ViewAngles.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	// Sequence, baseline distance and player count, rounded up
+	const uint32_t SnapshotHeaderBits = 64;
+}
+
+CInterestManager::CInterestManager(const SInterestConfig& config)
+	: m_config(config)
+	, m_viewers(MaxPlayers)
+{
+	m_candidates.reserve(MaxPlayers);
+	Reset();
+}
+
+void CInterestManager::BeginTick()
+{
+	m_present.reset();
+	m_playerCount = 0;
+}
+
+bool CInterestManager::AddPlayer(uint16_t id, const PMoveVec3& position, float yaw, float pitch)
+{
+	if (id >= MaxPlayers || m_present.test(id))
+		return false;
+
+	m_present.set(id);
+	m_positions[id] = position;
+	m_forwards[id] = CViewAngles(yaw, pitch).GetForward();
+	m_ids[m_playerCount++] = id;
+	return true;
+}
+
+void CInterestManager::EndTick()
+{
+	// Counting sort of the players by bucket
+	m_bucketStart.fill(0);
+	for (uint32_t i = 0; i < m_playerCount; ++i)
+	{
+		const uint16_t id = m_ids[i];
+		m_bucketById[id] = GetBucket(GetCell(m_positions[id].x), GetCell(m_positions[id].y));
+		++m_bucketStart[m_bucketById[id] + 1];
+	}
+	for (uint32_t bucket = 0; bucket < BucketCount; ++bucket)
+	{
+		m_bucketStart[bucket + 1] += m_bucketStart[bucket];
+	}
+
+	std::array<uint32_t, BucketCount> cursor;
+	std::copy(m_bucketStart.begin(), m_bucketStart.end() - 1, cursor.begin());
+	for (uint32_t i = 0; i < m_playerCount; ++i)
+	{
+		const uint16_t id = m_ids[i];
+		m_bucketPlayers[cursor[m_bucketById[id]]++] = id;
+	}
+}
+
+size_t CInterestManager::WriteSnapshot(uint16_t viewerId, const CSnapshotEncoder& encoder, uint32_t baselineSequence, uint8_t* pBuffer, size_t capacity)
+{
+	m_candidateCount = 0;
+	m_sentCount = 0;
+
+	if (viewerId >= MaxPlayers)
+		return encoder.Write(baselineSequence, pBuffer, capacity);
+
+	SViewer& viewer = m_viewers[viewerId];
+
+	// Without a record of the baseline the client may not have any of its players
+	const PMoveSnapshot::PlayerMask noPlayers;
+	const PMoveSnapshot::PlayerMask* pBaselineSelection = viewer.sent.Find(baselineSequence);
+	if (pBaselineSelection == nullptr)
+	{
+		pBaselineSelection = &noPlayers;
+	}
+
+	PMoveSnapshot::PlayerMask selection;
+	if (!m_isEnabled || !m_present.test(viewerId))
+	{
+		// Viewers that aren't playing, e.g. dead ones, have no position to be interested around
+		selection = m_present;
+		m_sentCount = static_cast<uint32_t>(selection.count());
+	}
+	else
+	{
+		GatherCandidates(viewerId, viewer);
+
+		// The client's own player carries its acknowledged state, it goes out every snapshot
+		int64_t remainingBits = static_cast<int64_t>(m_config.budgetBytes) * 8 - SnapshotHeaderBits;
+		remainingBits -= encoder.GetPlayerBitCount(viewerId, baselineSequence, pBaselineSelection);
+		selection.set(viewerId);
+
+		const auto isDue = [](const SCandidate& candidate) { return candidate.priority >= 1.f; };
+		const auto dueEnd = std::partition(m_candidates.begin(), m_candidates.end(), isDue);
+		std::sort(m_candidates.begin(), dueEnd, [](const SCandidate& a, const SCandidate& b)
+		{
+			return a.priority != b.priority ? a.priority > b.priority : a.distanceSq < b.distanceSq;
+		});
+
+		// Most overdue first, players that don't fit keep their priority and go first next time
+		for (auto it = m_candidates.begin(); it != dueEnd && remainingBits > 0; ++it)
+		{
+			const uint32_t bitCount = encoder.GetPlayerBitCount(it->id, baselineSequence, pBaselineSelection);
+			if (bitCount == 0 || static_cast<int64_t>(bitCount) > remainingBits)
+				continue;
+
+			remainingBits -= bitCount;
+			selection.set(it->id);
+		}
+		m_sentCount = static_cast<uint32_t>(selection.count()) - 1;
+	}
+
+	const size_t size = encoder.Write(baselineSequence, selection, pBaselineSelection, pBuffer, capacity);
+	if (size == 0)
+		return 0;
+
+	for (uint32_t i = 0; i < m_candidateCount; ++i)
+	{
+		const uint16_t id = m_candidates[i].id;
+		viewer.priority[id] = selection.test(id) ? 0.f : viewer.priority[id];
+	}
+	viewer.sent.Insert(encoder.GetSequence()) = selection;
+	return size;
+}
+
+void CInterestManager::ResetViewer(uint16_t viewerId)
+{
+	if (viewerId >= MaxPlayers)
+		return;
+
+	SViewer& viewer = m_viewers[viewerId];
+	viewer.priority.fill(1.f);
+	viewer.wasCandidate.reset();
+	viewer.sent.Clear();
+}
+
+void CInterestManager::Reset()
+{
+	for (uint16_t id = 0; id < MaxPlayers; ++id)
+	{
+		ResetViewer(id);
+	}
+	m_present.reset();
+	m_playerCount = 0;
+	m_bucketStart.fill(0);
+	m_candidates.clear();
+	m_candidateCount = 0;
+	m_sentCount = 0;
+}
+
+uint32_t CInterestManager::GetBucket(int32_t cellX, int32_t cellY) const
+{
+	const uint32_t hash = static_cast<uint32_t>(cellX) * 73856093u ^ static_cast<uint32_t>(cellY) * 19349663u;
+	return hash & (BucketCount - 1);
+}
+
+int32_t CInterestManager::GetCell(float coordinate) const
+{
+	return static_cast<int32_t>(std::floor(coordinate / m_config.cullRadius));
+}
+
+void CInterestManager::GatherCandidates(uint16_t viewerId, SViewer& viewer)
+{
+	const PMoveVec3& viewerPosition = m_positions[viewerId];
+	const PMoveVec3& forward = m_forwards[viewerId];
+	const float nearRadiusSq = m_config.nearRadius * m_config.nearRadius;
+	const float cullRadiusSq = m_config.cullRadius * m_config.cullRadius;
+
+	// Cells of the 3x3 around the viewer can share a bucket, each bucket is only walked once
+	std::array<uint32_t, 9> buckets;
+	uint32_t bucketCount = 0;
+	const int32_t cellX = GetCell(viewerPosition.x);
+	const int32_t cellY = GetCell(viewerPosition.y);
+	for (int32_t y = cellY - 1; y <= cellY + 1; ++y)
+	{
+		for (int32_t x = cellX - 1; x <= cellX + 1; ++x)
+		{
+			const uint32_t bucket = GetBucket(x, y);
+			if (std::find(buckets.begin(), buckets.begin() + bucketCount, bucket) == buckets.begin() + bucketCount)
+			{
+				buckets[bucketCount++] = bucket;
+			}
+		}
+	}
+
+	m_candidates.clear();
+	PMoveSnapshot::PlayerMask isCandidate;
+	for (uint32_t b = 0; b < bucketCount; ++b)
+	{
+		for (uint32_t i = m_bucketStart[buckets[b]]; i < m_bucketStart[buckets[b] + 1]; ++i)
+		{
+			const uint16_t id = m_bucketPlayers[i];
+			const PMoveVec3 offset = m_positions[id] - viewerPosition;
+			const float distanceSq = offset.Dot(offset);
+			if (id == viewerId || distanceSq > cullRadiusSq)
+				continue;
+
+			float rate = 1.f;
+			if (distanceSq > nearRadiusSq)
+			{
+				// Compared without normalizing the offset, both sides scale with its length
+				const float alignment = forward.Dot(offset);
+				const bool isVisible = alignment > 0.f && alignment * alignment >= m_config.viewCosine * m_config.viewCosine * distanceSq;
+				rate = isVisible ? m_config.visibleRate : m_config.hiddenRate;
+			}
+
+			float& priority = viewer.priority[id];
+			priority = viewer.wasCandidate.test(id) ? priority + rate : 1.f;
+			isCandidate.set(id);
+			m_candidates.push_back(SCandidate{ priority, distanceSq, id });
+		}
+	}
+
+	viewer.wasCandidate = isCandidate;
+	m_candidateCount = static_cast<uint32_t>(m_candidates.size());
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "MovementSnapshot.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+////////////////////////////////////////////////////////
+// Interest management: which players each client is sent, and how often
+// All players are bucketed into a grid once per snapshot, so a client
+// only looks at the players in the cells around it. Players close by are
+// sent every snapshot, farther ones in a share of them, fewer when they
+// are behind the viewer, and beyond the cull radius not at all. Every
+// player a client is interested in accumulates priority per snapshot it
+// isn't sent in, and the most overdue players are packed first until the
+// client's byte budget is spent. What each client was sent is kept per
+// snapshot, so deltas only reference players the client actually has.
+////////////////////////////////////////////////////////
+
+struct SInterestConfig
+{
+	float nearRadius = 16.f;              // Meters, closer players are sent every snapshot
+	float cullRadius = 96.f;              // Meters, farther players aren't sent at all
+	float viewCosine = 0.5f;              // Cosine of half the view cone, players inside it count as visible
+	float visibleRate = 0.5f;             // Share of snapshots a visible player beyond nearRadius is sent in
+	float hiddenRate = 0.25f;             // The same for players outside the view cone
+	uint32_t budgetBytes = 1024;          // Per client and snapshot, the client's own player is always sent
+};
+
+class CInterestManager
+{
+public:
+	// Player ids double as indices, they have to be below this
+	static constexpr uint32_t MaxPlayers = PMoveSnapshot::MaxPlayers;
+
+	explicit CInterestManager(const SInterestConfig& config = SInterestConfig());
+
+	// Once per snapshot, with the players that were added to the snapshot encoder
+	void BeginTick();
+	// Returns false for ids from MaxPlayers up
+	bool AddPlayer(uint16_t id, const PMoveVec3& position, float yaw, float pitch);
+	void EndTick();
+
+	// Writes the encoder's current snapshot for the client viewing through player viewerId, with the players it is
+	// interested in that are due and fit the budget, delta encoded against what it was sent in baselineSequence.
+	// Returns the number of bytes written, 0 if the buffer was too small.
+	size_t WriteSnapshot(uint16_t viewerId, const CSnapshotEncoder& encoder, uint32_t baselineSequence, uint8_t* pBuffer, size_t capacity);
+
+	// Disabled, every client is sent every player. What was sent is still tracked, so toggling doesn't break deltas.
+	void SetEnabled(bool isEnabled) { m_isEnabled = isEnabled; }
+	bool IsEnabled() const { return m_isEnabled; }
+
+	// Forgets what was sent to a viewer, for when its player is revived for a new client
+	void ResetViewer(uint16_t viewerId);
+	void Reset();
+
+	const SInterestConfig& GetConfig() const { return m_config; }
+	// Of the last WriteSnapshot: players within the cull radius, and how many of them were sent
+	uint32_t GetCandidateCount() const { return m_candidateCount; }
+	uint32_t GetSentCount() const { return m_sentCount; }
+
+private:
+	struct SViewer
+	{
+		// Grows by the player's rate every snapshot it isn't sent in, due from 1 on
+		std::array<float, MaxPlayers> priority;
+		// Players that were within the cull radius the snapshot before, ones coming back are due right away
+		PMoveSnapshot::PlayerMask wasCandidate;
+		CSequenceRing<PMoveSnapshot::PlayerMask, PMoveSnapshot::HistoryCapacity> sent;
+	};
+
+	struct SCandidate
+	{
+		float priority;
+		float distanceSq;
+		uint16_t id;
+	};
+
+	uint32_t GetBucket(int32_t cellX, int32_t cellY) const;
+	int32_t GetCell(float coordinate) const;
+	// Players within the cull radius of the viewer, from the buckets of the cells around it
+	void GatherCandidates(uint16_t viewerId, SViewer& viewer);
+
+	SInterestConfig m_config;
+	bool m_isEnabled = true;
+
+	std::vector<SViewer> m_viewers;
+
+	// This tick's players by id
+	PMoveSnapshot::PlayerMask m_present;
+	std::array<PMoveVec3, MaxPlayers> m_positions;
+	std::array<PMoveVec3, MaxPlayers> m_forwards;
+	std::array<uint16_t, MaxPlayers> m_ids;
+	uint32_t m_playerCount = 0;
+
+	// Players grouped by the hash of their cell, cells are as wide as the cull radius so a viewer only needs the 3x3 around it
+	static constexpr uint32_t BucketCount = 256;
+	std::array<uint32_t, BucketCount + 1> m_bucketStart;
+	std::array<uint16_t, MaxPlayers> m_bucketPlayers;
+	std::array<uint32_t, MaxPlayers> m_bucketById;
+
+	std::vector<SCandidate> m_candidates;
+	uint32_t m_candidateCount = 0;
+	uint32_t m_sentCount = 0;
+};
@@ -0,0 +1,150 @@
+#include "LagCompensation.h"
+#include "Quantization.h"
+
+namespace
+{
+	const uint32_t AngleBits = 16;
+}
+
+void CLagCompensationHistory::BeginTick(uint32_t serverTick)
+{
+	// A server that went back in time restarted, whatever was recorded before doesn't line up anymore
+	if (m_hasFrames && static_cast<int32_t>(serverTick - m_newestTick) < 0)
+	{
+		Reset();
+	}
+
+	m_pCurrent = &m_frames[serverTick & (Capacity - 1)];
+	m_pCurrent->tick = serverTick;
+	m_pCurrent->isRecorded = true;
+	m_pCurrent->flags.fill(0);
+
+	m_newestTick = serverTick;
+	m_hasFrames = true;
+}
+
+void CLagCompensationHistory::Record(uint32_t slot, const SPlayerHistorySample& sample)
+{
+	if (m_pCurrent == nullptr || slot >= MaxPlayers)
+		return;
+
+	m_pCurrent->positions[slot] = sample.position;
+	m_pCurrent->yaw[slot] = static_cast<uint16_t>(PMoveQuantize::QuantizeAngle(sample.yaw, AngleBits));
+	m_pCurrent->pitch[slot] = static_cast<uint16_t>(PMoveQuantize::QuantizeAngle(sample.pitch, AngleBits));
+	m_pCurrent->flags[slot] = eFlag_Valid | (sample.onGround ? eFlag_OnGround : 0);
+}
+
+bool CLagCompensationHistory::Rewind(uint32_t serverTick, float fraction, SWorldState& state) const
+{
+	const SFrame* pPrevious;
+	const SFrame* pNext;
+	float alpha;
+	if (!FindFrames(serverTick, fraction, pPrevious, pNext, alpha))
+		return false;
+
+	for (uint32_t slot = 0; slot < MaxPlayers; ++slot)
+	{
+		state.isValid[slot] = (pPrevious->flags[slot] & eFlag_Valid) != 0;
+		if (state.isValid[slot])
+		{
+			state.players[slot] = Interpolate(*pPrevious, pNext, slot, alpha);
+		}
+	}
+
+	return true;
+}
+
+bool CLagCompensationHistory::RewindPlayer(uint32_t slot, uint32_t serverTick, float fraction, SPlayerHistorySample& sample) const
+{
+	const SFrame* pPrevious;
+	const SFrame* pNext;
+	float alpha;
+	if (slot >= MaxPlayers || !FindFrames(serverTick, fraction, pPrevious, pNext, alpha) || (pPrevious->flags[slot] & eFlag_Valid) == 0)
+		return false;
+
+	sample = Interpolate(*pPrevious, pNext, slot, alpha);
+	return true;
+}
+
+void CLagCompensationHistory::Reset()
+{
+	for (SFrame& frame : m_frames)
+	{
+		frame.isRecorded = false;
+	}
+	m_pCurrent = nullptr;
+	m_newestTick = 0;
+	m_hasFrames = false;
+}
+
+bool CLagCompensationHistory::FindFrames(uint32_t serverTick, float fraction, const SFrame*& pPrevious, const SFrame*& pNext, float& alpha) const
+{
+	const int32_t age = static_cast<int32_t>(m_newestTick - serverTick);
+	if (!m_hasFrames || age < 0 || age >= static_cast<int32_t>(Capacity))
+		return false;
+
+	// Frames can be missing when several ticks ran in one frame, so search for the nearest recorded ones
+	pPrevious = nullptr;
+	for (uint32_t tick = serverTick; static_cast<int32_t>(m_newestTick - tick) < static_cast<int32_t>(Capacity); --tick)
+	{
+		const SFrame& frame = m_frames[tick & (Capacity - 1)];
+		if (frame.isRecorded && frame.tick == tick)
+		{
+			pPrevious = &frame;
+			break;
+		}
+	}
+	if (pPrevious == nullptr)
+		return false;
+
+	pNext = nullptr;
+	for (uint32_t tick = serverTick + 1; static_cast<int32_t>(m_newestTick - tick) >= 0; ++tick)
+	{
+		const SFrame& frame = m_frames[tick & (Capacity - 1)];
+		if (frame.isRecorded && frame.tick == tick)
+		{
+			pNext = &frame;
+			break;
+		}
+	}
+
+	// Past the newest frame the newest state is the best there is
+	alpha = 0.f;
+	if (pNext != nullptr)
+	{
+		alpha = (static_cast<float>(serverTick - pPrevious->tick) + fraction) / static_cast<float>(pNext->tick - pPrevious->tick);
+		alpha = alpha < 0.f ? 0.f : alpha > 1.f ? 1.f : alpha;
+	}
+
+	return true;
+}
+
+SPlayerHistorySample CLagCompensationHistory::GetSample(const SFrame& frame, uint32_t slot)
+{
+	SPlayerHistorySample sample;
+	sample.position = frame.positions[slot];
+	sample.yaw = PMoveQuantize::DequantizeAngle(frame.yaw[slot], AngleBits);
+	sample.pitch = PMoveQuantize::DequantizeAngle(frame.pitch[slot], AngleBits);
+	sample.onGround = (frame.flags[slot] & eFlag_OnGround) != 0;
+	return sample;
+}
+
+SPlayerHistorySample CLagCompensationHistory::Interpolate(const SFrame& previous, const SFrame* pNext, uint32_t slot, float alpha)
+{
+	// Players that left in between stay where they were last seen
+	if (pNext == nullptr || alpha == 0.f || (pNext->flags[slot] & eFlag_Valid) == 0)
+		return GetSample(previous, slot);
+
+	SPlayerHistorySample sample;
+	sample.position = previous.positions[slot] + (pNext->positions[slot] - previous.positions[slot]) * alpha;
+
+	// Angles take the short way around, the 16 bit difference wraps on its own
+	const float radiansPerStep = static_cast<float>(PMoveQuantize::TwoPi / (1u << AngleBits));
+	const int16_t yawDelta = static_cast<int16_t>(pNext->yaw[slot] - previous.yaw[slot]);
+	const int16_t pitchDelta = static_cast<int16_t>(pNext->pitch[slot] - previous.pitch[slot]);
+	sample.yaw = PMoveQuantize::DequantizeAngle(previous.yaw[slot], AngleBits) + yawDelta * alpha * radiansPerStep;
+	sample.pitch = PMoveQuantize::DequantizeAngle(previous.pitch[slot], AngleBits) + pitchDelta * alpha * radiansPerStep;
+
+	sample.onGround = ((alpha < 0.5f ? previous.flags[slot] : pNext->flags[slot]) & eFlag_OnGround) != 0;
+	return sample;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "PlayerMovement.h"
+
+#include <array>
+#include <cstdint>
+
+////////////////////////////////////////////////////////
+// Server side history of where every player was, for lag compensation
+// Once per recorded tick all players are written into one frame of a
+// fixed ring, so rewinding the whole world to a past tick only reads
+// the two frames around it. Angles are kept as 16 bit turns to keep
+// the default history (128 players, 1 s at 128 Hz) under 300 KB.
+////////////////////////////////////////////////////////
+
+struct SPlayerHistorySample
+{
+	PMoveVec3 position;
+	float yaw = 0.f;
+	float pitch = 0.f;
+	bool onGround = false;
+};
+
+class CLagCompensationHistory
+{
+public:
+	static constexpr uint32_t MaxPlayers = 128;
+	static constexpr uint32_t Capacity = 128;   // Ticks, must be a power of two
+
+	static_assert((Capacity & (Capacity - 1)) == 0, "Capacity shall be a power of two!");
+
+	// All players at one point in time, indexed by slot
+	struct SWorldState
+	{
+		std::array<SPlayerHistorySample, MaxPlayers> players;
+		std::array<bool, MaxPlayers> isValid = {};
+	};
+
+	// Starts recording the frame of serverTick, overwriting the oldest one. Ticks must increase.
+	void BeginTick(uint32_t serverTick);
+	// Slots are stable per player for as long as they're recorded, e.g. the snapshot id
+	void Record(uint32_t slot, const SPlayerHistorySample& sample);
+
+	// Reconstructs all players at serverTick + fraction, interpolating between the recorded frames around it.
+	// Returns false if that time isn't covered by the history.
+	bool Rewind(uint32_t serverTick, float fraction, SWorldState& state) const;
+	bool RewindPlayer(uint32_t slot, uint32_t serverTick, float fraction, SPlayerHistorySample& sample) const;
+
+	uint32_t GetNewestTick() const { return m_newestTick; }
+	void Reset();
+
+private:
+	enum EFlag : uint8_t
+	{
+		eFlag_Valid = 1 << 0,
+		eFlag_OnGround = 1 << 1
+	};
+
+	struct SFrame
+	{
+		uint32_t tick = 0;
+		bool isRecorded = false;
+		std::array<PMoveVec3, MaxPlayers> positions;
+		std::array<uint16_t, MaxPlayers> yaw;
+		std::array<uint16_t, MaxPlayers> pitch;
+		std::array<uint8_t, MaxPlayers> flags;
+	};
+
+	// Finds the recorded frames at or before and after the requested time, pNext is null past the newest frame
+	bool FindFrames(uint32_t serverTick, float fraction, const SFrame*& pPrevious, const SFrame*& pNext, float& alpha) const;
+	static SPlayerHistorySample GetSample(const SFrame& frame, uint32_t slot);
+	static SPlayerHistorySample Interpolate(const SFrame& previous, const SFrame* pNext, uint32_t slot, float alpha);
+
+	std::array<SFrame, Capacity> m_frames;
+	SFrame* m_pCurrent = nullptr;
+	uint32_t m_newestTick = 0;
+	bool m_hasFrames = false;
+};
@@ -0,0 +1,286 @@
+#include "MovementDemo.h"
+
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#if defined(_WIN32)
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+namespace
+{
+	const float MoveScale = 127.f;
+
+	int8_t QuantizeMove(float value)
+	{
+		const float clamped = value < -1.f ? -1.f : value > 1.f ? 1.f : value;
+		// Also catches NaN
+		if (!(clamped == clamped))
+			return 0;
+		return static_cast<int8_t>(std::lround(clamped * MoveScale));
+	}
+
+	// Stands in for the character controller, like Benchmark/BenchmarkCommon.h's StepWorld with a floor at floorHeight
+	void StepFloor(PMoveState& state, PMoveVec3& position, const PMoveParams& params, float floorHeight, float dt)
+	{
+		if (state.jumped)
+		{
+			state.velocity.z += params.jumpImpulse;
+			state.jumped = false;
+		}
+
+		position = position + state.velocity * dt;
+
+		state.onGround = position.z <= floorHeight && state.velocity.z <= 0.f;
+		if (position.z < floorHeight)
+		{
+			position.z = floorHeight;
+		}
+	}
+}
+
+namespace PMoveDemo
+{
+
+SMovementDemoTick MakeTick(const Cmd& cmd, bool onGround)
+{
+	SMovementDemoTick tick;
+	tick.sequence = cmd.sequence;
+	tick.yaw = cmd.yaw;
+	tick.pitch = cmd.pitch;
+	tick.forwardMove = QuantizeMove(cmd.forwardMove);
+	tick.rightMove = QuantizeMove(cmd.rightMove);
+	tick.upMove = QuantizeMove(cmd.upMove);
+	tick.flags = (cmd.jump ? eMovementDemoFlag_Jump : 0) | (onGround ? eMovementDemoFlag_OnGround : 0);
+	return tick;
+}
+
+Cmd GetCmd(const SMovementDemoTick& tick)
+{
+	Cmd cmd;
+	cmd.sequence = tick.sequence;
+	cmd.yaw = tick.yaw;
+	cmd.pitch = tick.pitch;
+	cmd.forwardMove = tick.forwardMove / MoveScale;
+	cmd.rightMove = tick.rightMove / MoveScale;
+	cmd.upMove = tick.upMove / MoveScale;
+	cmd.jump = (tick.flags & eMovementDemoFlag_Jump) != 0;
+	return cmd;
+}
+
+SMovementDemoReplay Replay(const CMovementDemoReader& demo, PMove::MoveFunc pMove)
+{
+	SMovementDemoReplay replay;
+	if (!demo.IsOpen())
+		return replay;
+
+	const SMovementDemoFileHeader& header = demo.GetHeader();
+	const PMoveParams& params = header.params;
+	const float dt = 1.f / header.tickRate;
+	const float floorHeight = header.startPosition.z;
+
+	PMoveState& state = replay.state;
+	state.velocity = header.startVelocity;
+	state.onGround = (header.startFlags & eMovementDemoFlag_OnGround) != 0;
+	state.wishJump = (header.startFlags & eMovementDemoFlag_WishJump) != 0;
+	state.jumpHeld = (header.startFlags & eMovementDemoFlag_JumpHeld) != 0;
+	replay.position = header.startPosition;
+
+	const SMovementDemoTick* pTicks = demo.GetTicks();
+	for (uint32_t i = 0; i < demo.GetTickCount(); ++i)
+	{
+		const SMovementDemoTick& tick = pTicks[i];
+		const Cmd cmd = GetCmd(tick);
+
+		if (state.onGround != ((tick.flags & eMovementDemoFlag_OnGround) != 0) && replay.groundMismatchCount++ == 0)
+		{
+			replay.firstGroundMismatch = tick.sequence;
+		}
+
+		// What CPlayerMovementSystem::SetInput does before every step
+		state.yaw = cmd.yaw;
+		PMove::QueueJump(state, params, cmd);
+		state = pMove(state, params, cmd, dt);
+		replay.jumpCount += state.jumped ? 1 : 0;
+
+		StepFloor(state, replay.position, params, floorHeight, dt);
+	}
+
+	replay.tickCount = demo.GetTickCount();
+	return replay;
+}
+
+}
+
+bool CMovementDemoWriter::Start(const char* szPath, const SMovementDemoFileHeader& header)
+{
+	if (IsRecording())
+		return false;
+
+	FILE* pFile = std::fopen(szPath, "wb");
+	if (pFile == nullptr)
+		return false;
+
+	if (std::fwrite(&header, sizeof(header), 1, pFile) != 1)
+	{
+		std::fclose(pFile);
+		return false;
+	}
+
+	m_pFile = pFile;
+	m_writtenCount.store(0, std::memory_order_relaxed);
+	m_droppedCount.store(0, std::memory_order_relaxed);
+	m_isRecording.store(true, std::memory_order_release);
+	m_writerThread = std::thread(&CMovementDemoWriter::RunWriterThread, this);
+	return true;
+}
+
+void CMovementDemoWriter::Stop()
+{
+	if (!IsRecording())
+		return;
+
+	m_isRecording.store(false, std::memory_order_release);
+	m_writerThread.join();
+
+	std::fclose(m_pFile);
+	m_pFile = nullptr;
+}
+
+void CMovementDemoWriter::Push(const Cmd& cmd, bool onGround)
+{
+	if (!IsRecording())
+		return;
+
+	if (!m_ticks.Push(PMoveDemo::MakeTick(cmd, onGround)))
+	{
+		m_droppedCount.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+uint32_t CMovementDemoWriter::Drain()
+{
+	std::array<SMovementDemoTick, 256> buffer;
+	uint32_t drainedCount = 0;
+
+	uint32_t count;
+	do
+	{
+		count = 0;
+		while (count < buffer.size() && m_ticks.Pop(buffer[count]))
+		{
+			++count;
+		}
+		if (count > 0)
+		{
+			const size_t writtenCount = std::fwrite(buffer.data(), sizeof(SMovementDemoTick), count, m_pFile);
+			m_writtenCount.fetch_add(writtenCount, std::memory_order_relaxed);
+		}
+		drainedCount += count;
+	} while (count == buffer.size());
+
+	return drainedCount;
+}
+
+void CMovementDemoWriter::RunWriterThread()
+{
+	bool isRecording = true;
+	while (isRecording)
+	{
+		// Read before draining, so the last pass picks up everything pushed before Stop
+		isRecording = m_isRecording.load(std::memory_order_acquire);
+
+		if (Drain() == 0 && isRecording)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		}
+	}
+}
+
+bool CMovementDemoReader::Open(const char* szPath)
+{
+	Close();
+
+#if defined(_WIN32)
+	HANDLE hFile = CreateFileA(szPath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (hFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	HANDLE hMapping = GetFileSizeEx(hFile, &size) && size.QuadPart >= static_cast<LONGLONG>(sizeof(SMovementDemoFileHeader))
+		? CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+	const void* pData = hMapping != nullptr ? MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (pData == nullptr)
+	{
+		if (hMapping != nullptr)
+			CloseHandle(hMapping);
+		CloseHandle(hFile);
+		return false;
+	}
+
+	m_hFile = hFile;
+	m_hMapping = hMapping;
+	m_size = static_cast<size_t>(size.QuadPart);
+#else
+	const int file = open(szPath, O_RDONLY);
+	if (file < 0)
+		return false;
+
+	struct stat status;
+	void* pData = fstat(file, &status) == 0 && status.st_size >= static_cast<off_t>(sizeof(SMovementDemoFileHeader))
+		? mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0) : MAP_FAILED;
+	// The mapping keeps the file alive
+	close(file);
+	if (pData == MAP_FAILED)
+		return false;
+
+	// Replays walk the ticks front to back
+	madvise(pData, static_cast<size_t>(status.st_size), MADV_SEQUENTIAL);
+	m_size = static_cast<size_t>(status.st_size);
+#endif
+
+	m_pData = static_cast<const uint8_t*>(pData);
+	m_tickCount = static_cast<uint32_t>((m_size - sizeof(SMovementDemoFileHeader)) / sizeof(SMovementDemoTick));
+
+	const SMovementDemoFileHeader expected;
+	const SMovementDemoFileHeader& header = GetHeader();
+	const bool isValid = std::memcmp(header.magic, expected.magic, sizeof(header.magic)) == 0
+		&& header.version == expected.version
+		&& header.tickSize == expected.tickSize
+		&& header.tickRate > 0.f;
+
+	if (!isValid)
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void CMovementDemoReader::Close()
+{
+	if (m_pData == nullptr)
+		return;
+
+#if defined(_WIN32)
+	UnmapViewOfFile(m_pData);
+	CloseHandle(m_hMapping);
+	CloseHandle(m_hFile);
+	m_hMapping = nullptr;
+	m_hFile = nullptr;
+#else
+	munmap(const_cast<uint8_t*>(m_pData), m_size);
+#endif
+
+	m_pData = nullptr;
+	m_size = 0;
+	m_tickCount = 0;
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include "PlayerMovement.h"
+#include "SpscQueue.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+
+////////////////////////////////////////////////////////
+// Demo recording of a player's movement commands
+// A demo is the player's starting state followed by every command the
+// kernel was handed, one fixed size record per tick, so the movement can
+// be replayed headlessly at many times real time. The game thread hands
+// records to a lock-free queue and a writer thread appends them to the
+// file, a demo cut short still holds every complete tick. Replays read
+// the file memory mapped, Tools/MovementDemoReplay.cpp runs a whole
+// corpus of them and prints where every run ended up.
+////////////////////////////////////////////////////////
+
+enum EMovementDemoFlag : uint8_t
+{
+	eMovementDemoFlag_Jump = 1 << 0,      // Cmd::jump
+	eMovementDemoFlag_OnGround = 1 << 1,  // What physics reported when the command was simulated
+	eMovementDemoFlag_WishJump = 1 << 2,  // Start state only
+	eMovementDemoFlag_JumpHeld = 1 << 3   // Start state only
+};
+
+// Written to the file as is, little endian
+struct SMovementDemoTick
+{
+	uint32_t sequence = 0;
+	float yaw = 0.f;                      // Radians, kept exact since the kernel turns with it
+	float pitch = 0.f;
+	int8_t forwardMove = 0;               // In steps of 1/127, which keys and quantized client commands hit exactly
+	int8_t rightMove = 0;
+	int8_t upMove = 0;
+	uint8_t flags = 0;                    // EMovementDemoFlag
+};
+
+static_assert(sizeof(SMovementDemoTick) == 16, "The file format depends on the record layout");
+static_assert(sizeof(PMoveParams) == 52, "The file format depends on the params layout");
+
+struct SMovementDemoFileHeader
+{
+	char magic[4] = { 'P', 'M', 'D', 'M' };
+	uint16_t version = 1;
+	uint16_t tickSize = sizeof(SMovementDemoTick);
+	float tickRate = CFixedTimestep::DefaultTickRate;
+	char ruleset[16] = {};                // See PMoveRulesets::Find
+	PMoveParams params;
+	PMoveVec3 startPosition;              // Recordings start on the ground, replays use this height as the floor
+	PMoveVec3 startVelocity;
+	uint8_t startFlags = eMovementDemoFlag_OnGround;
+	uint8_t padding[3] = {};
+};
+
+static_assert(sizeof(SMovementDemoFileHeader) == 108, "The file format depends on the header layout");
+
+namespace PMoveDemo
+{
+	SMovementDemoTick MakeTick(const Cmd& cmd, bool onGround);
+	Cmd GetCmd(const SMovementDemoTick& tick);
+}
+
+// Records one player, Push is called from the game thread only
+class CMovementDemoWriter
+{
+public:
+	// Ticks in flight before the writer thread catches up, about a minute at 60 Hz
+	static constexpr uint32_t QueueCapacity = 4096;
+
+	CMovementDemoWriter() = default;
+	~CMovementDemoWriter() { Stop(); }
+
+	CMovementDemoWriter(const CMovementDemoWriter&) = delete;
+	CMovementDemoWriter& operator=(const CMovementDemoWriter&) = delete;
+
+	// Writes the header and starts the writer thread, returns false if already recording or the file can't be created
+	bool Start(const char* szPath, const SMovementDemoFileHeader& header);
+	// Writes everything still queued and closes the file
+	void Stop();
+	bool IsRecording() const { return m_isRecording.load(std::memory_order_relaxed); }
+
+	// Never blocks, a full queue drops the tick and counts it. Ignored while not recording.
+	void Push(const Cmd& cmd, bool onGround);
+
+	// Since the last Start, a demo with dropped ticks won't replay what was played
+	uint64_t GetWrittenCount() const { return m_writtenCount.load(std::memory_order_relaxed); }
+	uint64_t GetDroppedCount() const { return m_droppedCount.load(std::memory_order_relaxed); }
+
+private:
+	void RunWriterThread();
+	uint32_t Drain();
+
+	CSpscQueue<SMovementDemoTick, QueueCapacity> m_ticks;
+	std::atomic<bool> m_isRecording{ false };
+	std::atomic<uint64_t> m_writtenCount{ 0 };
+	std::atomic<uint64_t> m_droppedCount{ 0 };
+	std::thread m_writerThread;
+	FILE* m_pFile = nullptr;
+};
+
+// Maps a demo file into memory read only, ticks are used in place
+class CMovementDemoReader
+{
+public:
+	CMovementDemoReader() = default;
+	~CMovementDemoReader() { Close(); }
+
+	CMovementDemoReader(const CMovementDemoReader&) = delete;
+	CMovementDemoReader& operator=(const CMovementDemoReader&) = delete;
+
+	// Returns false if the file can't be mapped or isn't a demo this version can read
+	bool Open(const char* szPath);
+	void Close();
+	bool IsOpen() const { return m_pData != nullptr; }
+
+	const SMovementDemoFileHeader& GetHeader() const { return *reinterpret_cast<const SMovementDemoFileHeader*>(m_pData); }
+	// A trailing partial tick of a demo cut short is left out
+	uint32_t GetTickCount() const { return m_tickCount; }
+	const SMovementDemoTick* GetTicks() const { return reinterpret_cast<const SMovementDemoTick*>(m_pData + sizeof(SMovementDemoFileHeader)); }
+
+private:
+	const uint8_t* m_pData = nullptr;
+	size_t m_size = 0;
+	uint32_t m_tickCount = 0;
+#if defined(_WIN32)
+	void* m_hFile = nullptr;
+	void* m_hMapping = nullptr;
+#endif
+};
+
+struct SMovementDemoReplay
+{
+	PMoveState state;
+	PMoveVec3 position;
+	uint32_t tickCount = 0;
+	uint32_t jumpCount = 0;
+	// Ticks whose replayed ground contact differs from the recorded one, from the first on the replay left the recorded path
+	uint32_t groundMismatchCount = 0;
+	uint32_t firstGroundMismatch = 0;     // Sequence, 0 if there was none
+};
+
+namespace PMoveDemo
+{
+	// Steps every tick through pMove against a flat floor at the start height standing in for physics,
+	// the same demo always ends in the same place until the kernel or the ruleset changes
+	SMovementDemoReplay Replay(const CMovementDemoReader& demo, PMove::MoveFunc pMove = &PMove::Move);
+}
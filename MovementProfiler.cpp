@@ -0,0 +1,184 @@
+#include "MovementProfiler.h"
+
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+
+#if defined(_MSC_VER)
+	#include <intrin.h>
+#endif
+
+namespace
+{
+	inline uint32_t GetHighestBit(uint64_t value)
+	{
+	#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanReverse64(&index, value);
+		return static_cast<uint32_t>(index);
+	#else
+		return 63u - static_cast<uint32_t>(__builtin_clzll(value));
+	#endif
+	}
+
+	// snprintf that keeps track of the remaining space, any overflow makes the whole write fail
+	struct SJsonWriter
+	{
+		char* pBuffer;
+		size_t capacity;
+		size_t length = 0;
+		bool hasOverflowed = false;
+
+		void Append(const char* szFormat, ...)
+		{
+			if (hasOverflowed)
+				return;
+
+			va_list args;
+			va_start(args, szFormat);
+			const int written = std::vsnprintf(pBuffer + length, capacity - length, szFormat, args);
+			va_end(args);
+
+			if (written < 0 || static_cast<size_t>(written) >= capacity - length)
+			{
+				hasOverflowed = true;
+				return;
+			}
+			length += static_cast<size_t>(written);
+		}
+	};
+}
+
+uint32_t CLatencyHistogram::GetBucket(uint64_t nanoseconds)
+{
+	if (nanoseconds < LinearCount)
+		return static_cast<uint32_t>(nanoseconds);
+
+	const uint32_t exponent = GetHighestBit(nanoseconds);
+	const uint32_t subBucket = static_cast<uint32_t>(nanoseconds >> (exponent - SubBucketBits)) & ((1 << SubBucketBits) - 1);
+	return LinearCount + ((exponent - 4) << SubBucketBits) + subBucket;
+}
+
+uint64_t CLatencyHistogram::GetBucketUpperBound(uint32_t bucket)
+{
+	if (bucket < LinearCount)
+		return bucket;
+
+	const uint32_t exponent = 4 + ((bucket - LinearCount) >> SubBucketBits);
+	const uint64_t subBucket = (bucket - LinearCount) & ((1 << SubBucketBits) - 1);
+	const uint64_t lowerBound = ((uint64_t(1) << SubBucketBits) + subBucket) << (exponent - SubBucketBits);
+	return lowerBound + (uint64_t(1) << (exponent - SubBucketBits)) - 1;
+}
+
+double CLatencyHistogram::GetMean() const
+{
+	const uint64_t count = GetCount();
+	return count > 0 ? static_cast<double>(m_sum.load(std::memory_order_relaxed)) / static_cast<double>(count) : 0.0;
+}
+
+uint64_t CLatencyHistogram::GetPercentile(double percentile) const
+{
+	// Summed from the buckets, so concurrent records can't push the rank past the end
+	uint64_t count = 0;
+	for (const std::atomic<uint32_t>& bucket : m_buckets)
+	{
+		count += bucket.load(std::memory_order_relaxed);
+	}
+	if (count == 0)
+		return 0;
+
+	const double rank = std::ceil(percentile / 100.0 * static_cast<double>(count));
+	const uint64_t target = rank < 1.0 ? 1 : static_cast<uint64_t>(rank);
+
+	uint64_t cumulative = 0;
+	for (uint32_t bucket = 0; bucket < BucketCount; ++bucket)
+	{
+		cumulative += m_buckets[bucket].load(std::memory_order_relaxed);
+		if (cumulative >= target)
+		{
+			const uint64_t upperBound = GetBucketUpperBound(bucket);
+			const uint64_t max = GetMax();
+			return upperBound < max ? upperBound : max;
+		}
+	}
+	return GetMax();
+}
+
+void CLatencyHistogram::Reset()
+{
+	for (std::atomic<uint32_t>& bucket : m_buckets)
+	{
+		bucket.store(0, std::memory_order_relaxed);
+	}
+	m_count.store(0, std::memory_order_relaxed);
+	m_sum.store(0, std::memory_order_relaxed);
+	m_max.store(0, std::memory_order_relaxed);
+}
+
+size_t CMovementProfiler::WriteJson(char* pBuffer, size_t capacity, double intervalSeconds) const
+{
+	SJsonWriter writer{ pBuffer, capacity };
+	writer.Append("{\"interval_s\":%.3f,\"stages\":{", intervalSeconds);
+
+	for (uint32_t i = 0; i < static_cast<uint32_t>(EMovementStage::Count); ++i)
+	{
+		const CLatencyHistogram& histogram = m_stages[i];
+		writer.Append("%s\"%s\":{\"count\":%llu,\"mean_us\":%.3f,\"p50_us\":%.3f,\"p99_us\":%.3f,\"max_us\":%.3f}",
+			i > 0 ? "," : "", GetStageName(static_cast<EMovementStage>(i)), static_cast<unsigned long long>(histogram.GetCount()),
+			histogram.GetMean() * 1e-3, histogram.GetPercentile(50.0) * 1e-3, histogram.GetPercentile(99.0) * 1e-3, histogram.GetMax() * 1e-3);
+	}
+
+	writer.Append("},\"counters\":{");
+	for (uint32_t i = 0; i < static_cast<uint32_t>(EMovementCounter::Count); ++i)
+	{
+		writer.Append("%s\"%s\":%llu", i > 0 ? "," : "", GetCounterName(static_cast<EMovementCounter>(i)), static_cast<unsigned long long>(m_counters[i].load(std::memory_order_relaxed)));
+	}
+	writer.Append("}}");
+
+	return writer.hasOverflowed ? 0 : writer.length;
+}
+
+void CMovementProfiler::Reset()
+{
+	for (CLatencyHistogram& histogram : m_stages)
+	{
+		histogram.Reset();
+	}
+	for (std::atomic<uint64_t>& counter : m_counters)
+	{
+		counter.store(0, std::memory_order_relaxed);
+	}
+}
+
+const char* CMovementProfiler::GetStageName(EMovementStage stage)
+{
+	switch (stage)
+	{
+	case EMovementStage::LookDirection: return "look_direction";
+	case EMovementStage::LookRotation: return "look_rotation";
+	case EMovementStage::Camera: return "camera";
+	case EMovementStage::PrepareTick: return "prepare_tick";
+	case EMovementStage::MovementStep: return "movement_step";
+	case EMovementStage::ValidateMovement: return "validate_movement";
+	case EMovementStage::ApplyMovement: return "apply_movement";
+	case EMovementStage::PhysicsWriteBack: return "physics_write_back";
+	case EMovementStage::Reconcile: return "reconcile";
+	case EMovementStage::SendSnapshots: return "send_snapshots";
+	default: return "unknown";
+	}
+}
+
+const char* CMovementProfiler::GetCounterName(EMovementCounter counter)
+{
+	switch (counter)
+	{
+	case EMovementCounter::GroundTicks: return "ground_ticks";
+	case EMovementCounter::AirTicks: return "air_ticks";
+	case EMovementCounter::Jumps: return "jumps";
+	case EMovementCounter::FrictionTicks: return "friction_ticks";
+	case EMovementCounter::PhysicsCalls: return "physics_calls";
+	case EMovementCounter::DeadTicks: return "dead_ticks";
+	case EMovementCounter::RestingTicks: return "resting_ticks";
+	default: return "unknown";
+	}
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+////////////////////////////////////////////////////////
+// Timing and counters of the per-frame movement work
+// RAII scopes record how long each stage took into a fixed size
+// histogram per stage, next to counters of what the players did. Both
+// are summarized and reset once per interval as one line of JSON, so
+// servers under load can be watched for regressions. Everything is
+// atomic and allocation free, while disabled a scope only tests a flag.
+////////////////////////////////////////////////////////
+
+// Log-linear histogram of durations in nanoseconds: exact below 16 ns, then 8 buckets per power of two (at most 12.5% off)
+class CLatencyHistogram
+{
+public:
+	static constexpr uint32_t LinearCount = 16;
+	static constexpr uint32_t SubBucketBits = 3;
+	static constexpr uint32_t BucketCount = LinearCount + (64 - 4) * (1 << SubBucketBits);
+
+	void Record(uint64_t nanoseconds)
+	{
+		m_buckets[GetBucket(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+		m_count.fetch_add(1, std::memory_order_relaxed);
+		m_sum.fetch_add(nanoseconds, std::memory_order_relaxed);
+
+		uint64_t max = m_max.load(std::memory_order_relaxed);
+		while (nanoseconds > max && !m_max.compare_exchange_weak(max, nanoseconds, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	uint64_t GetCount() const { return m_count.load(std::memory_order_relaxed); }
+	uint64_t GetMax() const { return m_max.load(std::memory_order_relaxed); }
+	double GetMean() const;
+	// Upper bound of the bucket holding the percentile, clamped to the max, 0 when empty
+	uint64_t GetPercentile(double percentile) const;
+
+	// Records racing with a reset may land in either interval
+	void Reset();
+
+	static uint32_t GetBucket(uint64_t nanoseconds);
+	// Largest duration that falls into the bucket
+	static uint64_t GetBucketUpperBound(uint32_t bucket);
+
+private:
+	std::array<std::atomic<uint32_t>, BucketCount> m_buckets{};
+	std::atomic<uint64_t> m_count{ 0 };
+	std::atomic<uint64_t> m_sum{ 0 };
+	std::atomic<uint64_t> m_max{ 0 };
+};
+
+enum class EMovementStage : uint32_t
+{
+	LookDirection,                        // CPlayerComponent::UpdateLookDirectionRequest, per player
+	LookRotation,                         // UpdateLookRotationZ, per player
+	Camera,                               // UpdateCamera, local player
+	PrepareTick,                          // Command gathering before a tick, per player
+	MovementStep,                         // Ground and air moves of every player, one batch per tick
+	ValidateMovement,                     // Server, re-simulation and checks of every remote player, per tick
+	ApplyMovement,                        // Pushing the result to the physics write back, per player
+	PhysicsWriteBack,                     // Every player's velocity submitted to physics, one pass per frame
+	Reconcile,                            // Client prediction replay, per snapshot
+	SendSnapshots,                        // Server, per tick
+	Count
+};
+
+enum class EMovementCounter : uint32_t
+{
+	GroundTicks,
+	AirTicks,
+	Jumps,
+	FrictionTicks,                        // Ground ticks that lost speed to friction, every one is a missed hop
+	PhysicsCalls,
+	DeadTicks,                            // Ticks of players that weren't alive, only dispatched to return right away
+	RestingTicks,                         // Ticks of players standing still without input, left out of the step and physics
+	Count
+};
+
+class CMovementProfiler
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	void SetEnabled(bool isEnabled) { m_isEnabled.store(isEnabled, std::memory_order_relaxed); }
+	bool IsEnabled() const { return m_isEnabled.load(std::memory_order_relaxed); }
+
+	void Record(EMovementStage stage, uint64_t nanoseconds) { m_stages[static_cast<uint32_t>(stage)].Record(nanoseconds); }
+	void Count(EMovementCounter counter, uint64_t amount = 1)
+	{
+		if (IsEnabled())
+		{
+			m_counters[static_cast<uint32_t>(counter)].fetch_add(amount, std::memory_order_relaxed);
+		}
+	}
+
+	const CLatencyHistogram& GetStage(EMovementStage stage) const { return m_stages[static_cast<uint32_t>(stage)]; }
+	uint64_t GetCounter(EMovementCounter counter) const { return m_counters[static_cast<uint32_t>(counter)].load(std::memory_order_relaxed); }
+
+	// One JSON object on a single line, durations in microseconds. Returns the length, 0 if the buffer was too small.
+	size_t WriteJson(char* pBuffer, size_t capacity, double intervalSeconds) const;
+	void Reset();
+
+	static const char* GetStageName(EMovementStage stage);
+	static const char* GetCounterName(EMovementCounter counter);
+
+private:
+	std::atomic<bool> m_isEnabled{ false };
+	std::array<CLatencyHistogram, static_cast<size_t>(EMovementStage::Count)> m_stages;
+	std::array<std::atomic<uint64_t>, static_cast<size_t>(EMovementCounter::Count)> m_counters{};
+};
+
+// Times its own lifetime into a stage, doesn't read the clock while the profiler is disabled
+class CMovementProfileScope
+{
+public:
+	CMovementProfileScope(CMovementProfiler& profiler, EMovementStage stage)
+		: m_pProfiler(profiler.IsEnabled() ? &profiler : nullptr)
+		, m_stage(stage)
+	{
+		if (m_pProfiler != nullptr)
+		{
+			m_start = CMovementProfiler::Clock::now();
+		}
+	}
+
+	~CMovementProfileScope()
+	{
+		if (m_pProfiler != nullptr)
+		{
+			const auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(CMovementProfiler::Clock::now() - m_start);
+			m_pProfiler->Record(m_stage, static_cast<uint64_t>(duration.count()));
+		}
+	}
+
+	CMovementProfileScope(const CMovementProfileScope&) = delete;
+	CMovementProfileScope& operator=(const CMovementProfileScope&) = delete;
+
+private:
+	CMovementProfiler* m_pProfiler;
+	EMovementStage m_stage;
+	CMovementProfiler::Clock::time_point m_start;
+};
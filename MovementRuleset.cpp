@@ -0,0 +1,51 @@
+#include "MovementRuleset.h"
+
+#include <cstring>
+
+namespace
+{
+	template<typename TRuleset>
+	constexpr SMovementRuleset MakeRuleset()
+	{
+		return SMovementRuleset{ TRuleset::Name, TRuleset::GetDefaultParams(), &PMove::Move<TRuleset>, &PMoveBatch::Step<TRuleset> };
+	}
+
+	// The first one is the default
+	const SMovementRuleset s_rulesets[] =
+	{
+		MakeRuleset<SQ3Ruleset>(),
+		MakeRuleset<SCpmaRuleset>(),
+		MakeRuleset<SQwRuleset>(),
+		MakeRuleset<SVq3Ruleset>(),
+	};
+}
+
+namespace PMoveRulesets
+{
+
+uint32_t GetCount()
+{
+	return static_cast<uint32_t>(sizeof(s_rulesets) / sizeof(s_rulesets[0]));
+}
+
+const SMovementRuleset& Get(uint32_t index)
+{
+	return s_rulesets[index];
+}
+
+const SMovementRuleset& GetDefault()
+{
+	return s_rulesets[0];
+}
+
+const SMovementRuleset* Find(const char* szName)
+{
+	for (const SMovementRuleset& ruleset : s_rulesets)
+	{
+		if (std::strcmp(ruleset.szName, szName) == 0)
+			return &ruleset;
+	}
+	return nullptr;
+}
+
+}
@@ -0,0 +1,173 @@
+#pragma once
+
+#include "PlayerMovement.h"
+#include "PlayerMovementBatch.h"
+
+#include <cstdint>
+
+////////////////////////////////////////////////////////
+// Movement rulesets, one kernel instantiation per game mode
+// A ruleset decides at compile time which parts of the air move exist,
+// so a mode without air control or strafe acceleration doesn't test for
+// them every tick, not even in the SIMD batch path. Tuning values stay
+// runtime PMoveParams, each ruleset only provides its defaults. A server
+// picks one instantiation by name through the registry below.
+////////////////////////////////////////////////////////
+
+// When the air move swaps airAcceleration for sideStrafeAcceleration, capping the wish speed at sideStrafeSpeed
+enum class EAirStrafe
+{
+	Off,                                  // Never, vanilla Quake 3
+	Sideways,                             // Only while holding nothing but a strafe key, like CPMA
+	Always                                // Every air move, QuakeWorld style air strafing
+};
+
+// Quake 3 as this sample always played: air control, side strafing and hold to bhop
+struct SQ3Ruleset
+{
+	static constexpr const char* Name = "q3";
+	static constexpr bool AirControl = true;
+	static constexpr EAirStrafe AirStrafe = EAirStrafe::Sideways;
+
+	static constexpr PMoveParams GetDefaultParams() { return PMoveParams(); }
+};
+
+// Challenge ProMode: same features, every jump has to be timed and turning against the velocity stops harder
+struct SCpmaRuleset
+{
+	static constexpr const char* Name = "cpma";
+	static constexpr bool AirControl = true;
+	static constexpr EAirStrafe AirStrafe = EAirStrafe::Sideways;
+
+	static constexpr PMoveParams GetDefaultParams()
+	{
+		PMoveParams params;
+		params.airDecceleration = 0.75f;
+		params.holdJumpToBhop = false;
+		return params;
+	}
+};
+
+// QuakeWorld: no air control, every air move is a capped strafe with a strong acceleration
+struct SQwRuleset
+{
+	static constexpr const char* Name = "qw";
+	static constexpr bool AirControl = false;
+	static constexpr EAirStrafe AirStrafe = EAirStrafe::Always;
+
+	static constexpr PMoveParams GetDefaultParams()
+	{
+		PMoveParams params;
+		params.airControl = 0;
+		params.sideStrafeAcceleration = 10;
+		params.holdJumpToBhop = false;
+		return params;
+	}
+};
+
+// Vanilla Quake 3: a single weak air acceleration and nothing else
+struct SVq3Ruleset
+{
+	static constexpr const char* Name = "vq3";
+	static constexpr bool AirControl = false;
+	static constexpr EAirStrafe AirStrafe = EAirStrafe::Off;
+
+	static constexpr PMoveParams GetDefaultParams()
+	{
+		PMoveParams params;
+		params.airDecceleration = params.airAcceleration;
+		params.airControl = 0;
+		params.holdJumpToBhop = false;
+		return params;
+	}
+};
+
+namespace PMove
+{
+	template<typename TRuleset>
+	inline bool IsAirStrafing(float forwardMove, float rightMove)
+	{
+		if constexpr (TRuleset::AirStrafe == EAirStrafe::Always)
+			return true;
+		else if constexpr (TRuleset::AirStrafe == EAirStrafe::Sideways)
+			return forwardMove == 0 && rightMove != 0;
+		else
+			return false;
+	}
+
+	template<typename TRuleset>
+	void AirMove(PMoveState& state, const PMoveParams& params, const Cmd& cmd, float dt)
+	{
+		float accel;
+
+		PMoveVec3 wishdir = GetWishDir(cmd, state.yaw);
+
+		float wishspeed = wishdir.GetLength();
+		wishspeed *= params.moveSpeed;
+
+		wishdir.Normalize();
+		state.moveDirectionNorm = wishdir;
+
+		//Aircontrol
+		float wishspeed2 = wishspeed;
+		if (state.velocity.Dot(wishdir) < 0) {
+			accel = params.airDecceleration;
+		}
+		else {
+			accel = params.airAcceleration;
+		}
+		if (IsAirStrafing<TRuleset>(cmd.forwardMove, cmd.rightMove)) {
+			if (wishspeed > params.sideStrafeSpeed) {
+				wishspeed = params.sideStrafeSpeed;
+			}
+			accel = params.sideStrafeAcceleration;
+		}
+		Accelerate(state, wishdir, wishspeed, accel, dt);
+		if constexpr (TRuleset::AirControl) {
+			if (params.airControl > 0) {
+				AirControl(state, params, cmd, wishdir, wishspeed2, dt);
+			}
+		}
+		state.velocity.z -= params.gravity * dt;
+
+		// Slide down planes too steep to stand on instead of falling into them
+		if (state.onSteepPlane && state.velocity.Dot(state.groundNormal) < 0) {
+			state.velocity = ClipVelocity(state.velocity, state.groundNormal, Overclip);
+		}
+	}
+
+	template<typename TRuleset>
+	PMoveState Move(const PMoveState& from, const PMoveParams& params, const Cmd& cmd, float dt)
+	{
+		PMoveState to = from;
+		to.jumped = false;
+
+		if (to.onGround)
+			GroundMove(to, params, cmd, dt);
+		else
+			AirMove<TRuleset>(to, params, cmd, dt);
+
+		return to;
+	}
+}
+
+// One ruleset's instantiations, what a server stores after picking it by name
+struct SMovementRuleset
+{
+	using StepFunc = void (*)(const SPlayerMovementArrays& arrays, uint32_t count, float dt, PMoveBatch::ESimdLevel level);
+
+	const char* szName;
+	PMoveParams defaultParams;
+	PMove::MoveFunc pMove;                // PMove::Move<TRuleset>, for prediction and single players
+	StepFunc pStep;                       // PMoveBatch::Step<TRuleset>, for CPlayerMovementSystem
+};
+
+namespace PMoveRulesets
+{
+	uint32_t GetCount();
+	const SMovementRuleset& Get(uint32_t index);
+	// SQ3Ruleset, which behaves exactly like the untemplated PMove::Move
+	const SMovementRuleset& GetDefault();
+	// Case sensitive, returns nullptr for unknown names
+	const SMovementRuleset* Find(const char* szName);
+}
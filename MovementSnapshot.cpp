@@ -0,0 +1,472 @@
+#include "MovementSnapshot.h"
+#include "BitStream.h"
+#include "Quantization.h"
+
+#include <algorithm>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace
+{
+	enum EChangeBit : uint32_t
+	{
+		eChange_PositionX = 1 << 0,
+		eChange_PositionY = 1 << 1,
+		eChange_PositionZ = 1 << 2,
+		eChange_VelocityX = 1 << 3,
+		eChange_VelocityY = 1 << 4,
+		eChange_VelocityZ = 1 << 5,
+		eChange_Yaw = 1 << 6,
+		eChange_Pitch = 1 << 7,
+		eChange_Flags = 1 << 8,
+
+		eChange_BitCount = 9
+	};
+
+	enum EPlayerFlag : uint32_t
+	{
+		ePlayerFlag_OnGround = 1 << 0,
+		ePlayerFlag_WishJump = 1 << 1,
+		ePlayerFlag_JumpHeld = 1 << 2,
+
+		ePlayerFlag_BitCount = 3
+	};
+
+	uint32_t GetBitLength(uint32_t value)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		return _BitScanReverse(&index, value) ? index + 1 : 0;
+#else
+		return value != 0 ? 32 - __builtin_clz(value) : 0;
+#endif
+	}
+
+	// Deltas of changed fields are never zero, so they are zig-zag mapped and sent as their bit length
+	// followed by everything below the leading one. A field that moved by a handful of steps costs a few bits,
+	// one that jumped across the world at most a few bits more than sending it in full.
+	void WriteDeltaValue(CBitWriter& writer, int32_t delta, uint32_t fieldBitCount)
+	{
+		const uint32_t zigZag = (static_cast<uint32_t>(delta) << 1) ^ static_cast<uint32_t>(delta >> 31);
+		const uint32_t length = GetBitLength(zigZag);
+		writer.WriteBits(length - 1, GetBitLength(fieldBitCount));
+		writer.WriteBits(zigZag, length - 1);
+	}
+
+	int32_t ReadDeltaValue(CBitReader& reader, uint32_t fieldBitCount)
+	{
+		const uint32_t length = reader.ReadBits(GetBitLength(fieldBitCount)) + 1;
+		if (length > 32)
+			return 0;
+		const uint32_t zigZag = (length < 32 ? 1u << (length - 1) : 0x80000000u) | reader.ReadBits(length - 1);
+		return static_cast<int32_t>((zigZag >> 1) ^ (0u - (zigZag & 1u)));
+	}
+
+	// Shortest signed distance around the circle, so a yaw crossing the wrap point stays a small delta
+	int32_t GetAngleDelta(uint32_t value, uint32_t baseline, uint32_t bitCount)
+	{
+		const uint32_t mask = PMoveQuantize::GetMask(bitCount);
+		const uint32_t delta = (value - baseline) & mask;
+		return delta > (mask >> 1) ? static_cast<int32_t>(delta) - static_cast<int32_t>(mask) - 1 : static_cast<int32_t>(delta);
+	}
+
+	uint32_t GetChangeMask(const PMoveSnapshot::SQuantizedPlayer& player, const PMoveSnapshot::SQuantizedPlayer& baseline)
+	{
+		uint32_t mask = 0;
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			mask |= player.position[axis] != baseline.position[axis] ? eChange_PositionX << axis : 0u;
+			mask |= player.velocity[axis] != baseline.velocity[axis] ? eChange_VelocityX << axis : 0u;
+		}
+		mask |= player.yaw != baseline.yaw ? eChange_Yaw : 0u;
+		mask |= player.pitch != baseline.pitch ? eChange_Pitch : 0u;
+		mask |= player.flags != baseline.flags ? eChange_Flags : 0u;
+		return mask;
+	}
+
+	void WriteFull(CBitWriter& writer, const SSnapshotConfig& config, const PMoveSnapshot::SQuantizedPlayer& player)
+	{
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			writer.WriteBits(player.position[axis], config.positionBits);
+		}
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			writer.WriteBits(player.velocity[axis], config.velocityBits);
+		}
+		writer.WriteBits(player.yaw, config.angleBits);
+		writer.WriteBits(player.pitch, config.angleBits);
+		writer.WriteBits(player.flags, ePlayerFlag_BitCount);
+	}
+
+	void ReadFull(CBitReader& reader, const SSnapshotConfig& config, PMoveSnapshot::SQuantizedPlayer& player)
+	{
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			player.position[axis] = reader.ReadBits(config.positionBits);
+		}
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			player.velocity[axis] = reader.ReadBits(config.velocityBits);
+		}
+		player.yaw = reader.ReadBits(config.angleBits);
+		player.pitch = reader.ReadBits(config.angleBits);
+		player.flags = reader.ReadBits(ePlayerFlag_BitCount);
+	}
+
+	void WriteDelta(CBitWriter& writer, const SSnapshotConfig& config, const PMoveSnapshot::SQuantizedPlayer& player, const PMoveSnapshot::SQuantizedPlayer& baseline)
+	{
+		const uint32_t changeMask = GetChangeMask(player, baseline);
+		writer.WriteBool(changeMask != 0);
+		if (changeMask == 0)
+			return;
+
+		writer.WriteBits(changeMask, eChange_BitCount);
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			if (changeMask & (eChange_PositionX << axis))
+				WriteDeltaValue(writer, static_cast<int32_t>(player.position[axis] - baseline.position[axis]), config.positionBits);
+		}
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			if (changeMask & (eChange_VelocityX << axis))
+				WriteDeltaValue(writer, static_cast<int32_t>(player.velocity[axis] - baseline.velocity[axis]), config.velocityBits);
+		}
+		if (changeMask & eChange_Yaw)
+			WriteDeltaValue(writer, GetAngleDelta(player.yaw, baseline.yaw, config.angleBits), config.angleBits);
+		if (changeMask & eChange_Pitch)
+			WriteDeltaValue(writer, GetAngleDelta(player.pitch, baseline.pitch, config.angleBits), config.angleBits);
+		if (changeMask & eChange_Flags)
+			writer.WriteBits(player.flags, ePlayerFlag_BitCount);
+	}
+
+	void ReadDelta(CBitReader& reader, const SSnapshotConfig& config, PMoveSnapshot::SQuantizedPlayer& player, const PMoveSnapshot::SQuantizedPlayer& baseline)
+	{
+		const uint32_t id = player.id;
+		player = baseline;
+		player.id = id;
+
+		if (!reader.ReadBool())
+			return;
+
+		const uint32_t changeMask = reader.ReadBits(eChange_BitCount);
+		const uint32_t positionMask = PMoveQuantize::GetMask(config.positionBits);
+		const uint32_t velocityMask = PMoveQuantize::GetMask(config.velocityBits);
+		const uint32_t angleMask = PMoveQuantize::GetMask(config.angleBits);
+
+		// Masking keeps corrupt deltas inside the quantized range
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			if (changeMask & (eChange_PositionX << axis))
+				player.position[axis] = (baseline.position[axis] + static_cast<uint32_t>(ReadDeltaValue(reader, config.positionBits))) & positionMask;
+		}
+		for (uint32_t axis = 0; axis < 3; ++axis)
+		{
+			if (changeMask & (eChange_VelocityX << axis))
+				player.velocity[axis] = (baseline.velocity[axis] + static_cast<uint32_t>(ReadDeltaValue(reader, config.velocityBits))) & velocityMask;
+		}
+		if (changeMask & eChange_Yaw)
+			player.yaw = (baseline.yaw + static_cast<uint32_t>(ReadDeltaValue(reader, config.angleBits))) & angleMask;
+		if (changeMask & eChange_Pitch)
+			player.pitch = (baseline.pitch + static_cast<uint32_t>(ReadDeltaValue(reader, config.angleBits))) & angleMask;
+		if (changeMask & eChange_Flags)
+			player.flags = reader.ReadBits(ePlayerFlag_BitCount);
+	}
+}
+
+namespace PMoveSnapshot
+{
+
+SQuantizedPlayer Quantize(const SSnapshotConfig& config, const SSnapshotPlayer& player)
+{
+	const float positionMin[3] = { config.positionMin.x, config.positionMin.y, config.positionMin.z };
+	const float positionMax[3] = { config.positionMax.x, config.positionMax.y, config.positionMax.z };
+	const float position[3] = { player.position.x, player.position.y, player.position.z };
+	const float velocity[3] = { player.velocity.x, player.velocity.y, player.velocity.z };
+
+	SQuantizedPlayer quantized;
+	quantized.id = player.id;
+	for (uint32_t axis = 0; axis < 3; ++axis)
+	{
+		quantized.position[axis] = PMoveQuantize::QuantizeRange(position[axis], positionMin[axis], positionMax[axis], config.positionBits);
+		quantized.velocity[axis] = PMoveQuantize::QuantizeRange(velocity[axis], -config.maxSpeed, config.maxSpeed, config.velocityBits);
+	}
+	quantized.yaw = PMoveQuantize::QuantizeAngle(player.yaw, config.angleBits);
+	quantized.pitch = PMoveQuantize::QuantizeAngle(player.pitch, config.angleBits);
+	quantized.flags = (player.onGround ? ePlayerFlag_OnGround : 0u) | (player.wishJump ? ePlayerFlag_WishJump : 0u) | (player.jumpHeld ? ePlayerFlag_JumpHeld : 0u);
+	return quantized;
+}
+
+SSnapshotPlayer Dequantize(const SSnapshotConfig& config, const SQuantizedPlayer& quantized)
+{
+	SSnapshotPlayer player;
+	player.id = static_cast<uint16_t>(quantized.id);
+	player.position.x = PMoveQuantize::DequantizeRange(quantized.position[0], config.positionMin.x, config.positionMax.x, config.positionBits);
+	player.position.y = PMoveQuantize::DequantizeRange(quantized.position[1], config.positionMin.y, config.positionMax.y, config.positionBits);
+	player.position.z = PMoveQuantize::DequantizeRange(quantized.position[2], config.positionMin.z, config.positionMax.z, config.positionBits);
+	player.velocity.x = PMoveQuantize::DequantizeRange(quantized.velocity[0], -config.maxSpeed, config.maxSpeed, config.velocityBits);
+	player.velocity.y = PMoveQuantize::DequantizeRange(quantized.velocity[1], -config.maxSpeed, config.maxSpeed, config.velocityBits);
+	player.velocity.z = PMoveQuantize::DequantizeRange(quantized.velocity[2], -config.maxSpeed, config.maxSpeed, config.velocityBits);
+	player.yaw = PMoveQuantize::DequantizeAngle(quantized.yaw, config.angleBits);
+	player.pitch = PMoveQuantize::DequantizeAngle(quantized.pitch, config.angleBits);
+	player.onGround = (quantized.flags & ePlayerFlag_OnGround) != 0;
+	player.wishJump = (quantized.flags & ePlayerFlag_WishJump) != 0;
+	player.jumpHeld = (quantized.flags & ePlayerFlag_JumpHeld) != 0;
+	return player;
+}
+
+}
+
+void CSnapshotEncoder::BeginSnapshot(uint32_t sequence)
+{
+	m_sequence = sequence;
+	m_pCurrent = &m_history.Insert(sequence);
+	m_pCurrent->playerCount = 0;
+	m_hasSnapshot = false;
+}
+
+bool CSnapshotEncoder::AddPlayer(const SSnapshotPlayer& player)
+{
+	if (m_pCurrent == nullptr || m_pCurrent->playerCount == PMoveSnapshot::MaxPlayers)
+		return false;
+
+	m_pCurrent->players[m_pCurrent->playerCount++] = PMoveSnapshot::Quantize(m_config, player);
+	return true;
+}
+
+void CSnapshotEncoder::EndSnapshot()
+{
+	if (m_pCurrent == nullptr)
+		return;
+
+	std::sort(m_pCurrent->players.begin(), m_pCurrent->players.begin() + m_pCurrent->playerCount,
+		[](const PMoveSnapshot::SQuantizedPlayer& a, const PMoveSnapshot::SQuantizedPlayer& b) { return a.id < b.id; });
+
+	m_pCurrent = nullptr;
+	m_hasSnapshot = true;
+}
+
+size_t CSnapshotEncoder::Write(uint32_t baselineSequence, uint8_t* pBuffer, size_t capacity) const
+{
+	return WritePlayers(baselineSequence, nullptr, nullptr, pBuffer, capacity);
+}
+
+size_t CSnapshotEncoder::Write(uint32_t baselineSequence, const PMoveSnapshot::PlayerMask& selection, const PMoveSnapshot::PlayerMask* pBaselineSelection, uint8_t* pBuffer, size_t capacity) const
+{
+	return WritePlayers(baselineSequence, &selection, pBaselineSelection, pBuffer, capacity);
+}
+
+uint32_t CSnapshotEncoder::GetPlayerBitCount(uint16_t id, uint32_t baselineSequence, const PMoveSnapshot::PlayerMask* pBaselineSelection) const
+{
+	const PMoveSnapshot::SQuantizedSnapshot* pSnapshot = m_hasSnapshot ? m_history.Find(m_sequence) : nullptr;
+	if (pSnapshot == nullptr)
+		return 0;
+
+	const auto byId = [](const PMoveSnapshot::SQuantizedPlayer& quantized, uint32_t value) { return quantized.id < value; };
+	const auto end = pSnapshot->players.begin() + pSnapshot->playerCount;
+	const auto it = std::lower_bound(pSnapshot->players.begin(), end, id, byId);
+	if (it == end || it->id != id)
+		return 0;
+
+	const PMoveSnapshot::SQuantizedSnapshot* pBaseline = FindBaseline(baselineSequence);
+	const bool isInBaselineSelection = pBaselineSelection == nullptr || (id < PMoveSnapshot::MaxPlayers && pBaselineSelection->test(id));
+	const PMoveSnapshot::SQuantizedPlayer* pBaselinePlayer = nullptr;
+	if (pBaseline != nullptr && isInBaselineSelection)
+	{
+		const auto baselineEnd = pBaseline->players.begin() + pBaseline->playerCount;
+		const auto baselineIt = std::lower_bound(pBaseline->players.begin(), baselineEnd, id, byId);
+		pBaselinePlayer = baselineIt != baselineEnd && baselineIt->id == id ? &*baselineIt : nullptr;
+	}
+
+	// A writer without a buffer only counts, the id gap is assumed to fit the smallest varint class
+	CBitWriter counter(nullptr, 0);
+	counter.WriteVarUint(0);
+	counter.WriteBool(pBaselinePlayer != nullptr);
+	if (pBaselinePlayer != nullptr)
+	{
+		WriteDelta(counter, m_config, *it, *pBaselinePlayer);
+	}
+	else
+	{
+		WriteFull(counter, m_config, *it);
+	}
+	return static_cast<uint32_t>(counter.GetBitCount());
+}
+
+const PMoveSnapshot::SQuantizedSnapshot* CSnapshotEncoder::FindBaseline(uint32_t baselineSequence) const
+{
+	// Acks from the future or of the snapshot itself can't be delta encoded against
+	const bool isBaselineOlder = static_cast<int32_t>(m_sequence - baselineSequence) > 0;
+	return isBaselineOlder ? m_history.Find(baselineSequence) : nullptr;
+}
+
+size_t CSnapshotEncoder::WritePlayers(uint32_t baselineSequence, const PMoveSnapshot::PlayerMask* pSelection, const PMoveSnapshot::PlayerMask* pBaselineSelection, uint8_t* pBuffer, size_t capacity) const
+{
+	const PMoveSnapshot::SQuantizedSnapshot* pSnapshot = m_hasSnapshot ? m_history.Find(m_sequence) : nullptr;
+	if (pSnapshot == nullptr)
+		return 0;
+
+	const PMoveSnapshot::SQuantizedSnapshot* pBaseline = FindBaseline(baselineSequence);
+	const auto isSelected = [](const PMoveSnapshot::PlayerMask* pMask, uint32_t id) { return pMask == nullptr || (id < PMoveSnapshot::MaxPlayers && pMask->test(id)); };
+
+	uint32_t playerCount = pSnapshot->playerCount;
+	if (pSelection != nullptr)
+	{
+		playerCount = 0;
+		for (uint32_t i = 0; i < pSnapshot->playerCount; ++i)
+		{
+			playerCount += isSelected(pSelection, pSnapshot->players[i].id) ? 1 : 0;
+		}
+	}
+
+	CBitWriter writer(pBuffer, capacity);
+	writer.WriteBits(m_sequence, 32);
+	writer.WriteBool(pBaseline != nullptr);
+	if (pBaseline != nullptr)
+	{
+		writer.WriteVarUint(m_sequence - baselineSequence);
+	}
+	writer.WriteVarUint(playerCount);
+
+	uint32_t baselineIndex = 0;
+	uint32_t nextId = 0;
+	for (uint32_t i = 0; i < pSnapshot->playerCount; ++i)
+	{
+		const PMoveSnapshot::SQuantizedPlayer& player = pSnapshot->players[i];
+		if (!isSelected(pSelection, player.id))
+			continue;
+
+		writer.WriteVarUint(player.id - nextId);
+		nextId = player.id + 1;
+
+		// Players missing from the baseline joined since, players missing from this snapshot left
+		while (pBaseline != nullptr && baselineIndex < pBaseline->playerCount && pBaseline->players[baselineIndex].id < player.id)
+		{
+			++baselineIndex;
+		}
+
+		// The client only decoded the players it was sent in the baseline
+		if (pBaseline != nullptr && baselineIndex < pBaseline->playerCount && pBaseline->players[baselineIndex].id == player.id && isSelected(pBaselineSelection, player.id))
+		{
+			writer.WriteBool(true);
+			WriteDelta(writer, m_config, player, pBaseline->players[baselineIndex]);
+		}
+		else
+		{
+			writer.WriteBool(false);
+			WriteFull(writer, m_config, player);
+		}
+	}
+
+	writer.Flush();
+	return writer.HasOverflowed() ? 0 : writer.GetByteCount();
+}
+
+void CSnapshotEncoder::Reset()
+{
+	m_history.Clear();
+	m_pCurrent = nullptr;
+	m_sequence = 0;
+	m_hasSnapshot = false;
+}
+
+bool CSnapshotDecoder::Read(const uint8_t* pBuffer, size_t size)
+{
+	CBitReader reader(pBuffer, size);
+	const uint32_t sequence = reader.ReadBits(32);
+	if (m_hasSnapshot && static_cast<int32_t>(sequence - m_sequence) <= 0)
+		return false;
+
+	const PMoveSnapshot::SQuantizedSnapshot* pBaseline = nullptr;
+	if (reader.ReadBool())
+	{
+		const uint32_t baselineDistance = reader.ReadVarUint();
+		pBaseline = baselineDistance != 0 ? m_history.Find(sequence - baselineDistance) : nullptr;
+		if (pBaseline == nullptr)
+			return false;
+	}
+
+	const uint32_t playerCount = reader.ReadVarUint();
+	if (reader.HasOverflowed() || playerCount > PMoveSnapshot::MaxPlayers)
+		return false;
+
+	// Decode into a scratch copy first, the history is only touched once the whole snapshot is known to be valid
+	PMoveSnapshot::SQuantizedSnapshot snapshot;
+	snapshot.playerCount = playerCount;
+
+	uint32_t baselineIndex = 0;
+	uint32_t nextId = 0;
+	for (uint32_t i = 0; i < playerCount; ++i)
+	{
+		PMoveSnapshot::SQuantizedPlayer& player = snapshot.players[i];
+		player.id = nextId + reader.ReadVarUint();
+		if (player.id < nextId || player.id > UINT16_MAX)
+			return false;
+		nextId = player.id + 1;
+
+		if (reader.ReadBool())
+		{
+			while (pBaseline != nullptr && baselineIndex < pBaseline->playerCount && pBaseline->players[baselineIndex].id < player.id)
+			{
+				++baselineIndex;
+			}
+
+			if (pBaseline == nullptr || baselineIndex == pBaseline->playerCount || pBaseline->players[baselineIndex].id != player.id)
+				return false;
+
+			ReadDelta(reader, m_config, player, pBaseline->players[baselineIndex]);
+		}
+		else
+		{
+			ReadFull(reader, m_config, player);
+		}
+
+		if (reader.HasOverflowed())
+			return false;
+	}
+
+	m_history.Insert(sequence) = snapshot;
+	m_sequence = sequence;
+	m_hasSnapshot = true;
+	return true;
+}
+
+uint32_t CSnapshotDecoder::GetPlayerCount() const
+{
+	const PMoveSnapshot::SQuantizedSnapshot* pSnapshot = m_hasSnapshot ? m_history.Find(m_sequence) : nullptr;
+	return pSnapshot != nullptr ? pSnapshot->playerCount : 0;
+}
+
+SSnapshotPlayer CSnapshotDecoder::GetPlayer(uint32_t index) const
+{
+	const PMoveSnapshot::SQuantizedSnapshot* pSnapshot = m_hasSnapshot ? m_history.Find(m_sequence) : nullptr;
+	if (pSnapshot == nullptr || index >= pSnapshot->playerCount)
+		return SSnapshotPlayer();
+
+	return PMoveSnapshot::Dequantize(m_config, pSnapshot->players[index]);
+}
+
+bool CSnapshotDecoder::FindPlayer(uint16_t id, SSnapshotPlayer& player) const
+{
+	const PMoveSnapshot::SQuantizedSnapshot* pSnapshot = m_hasSnapshot ? m_history.Find(m_sequence) : nullptr;
+	if (pSnapshot == nullptr)
+		return false;
+
+	const auto end = pSnapshot->players.begin() + pSnapshot->playerCount;
+	const auto it = std::lower_bound(pSnapshot->players.begin(), end, id,
+		[](const PMoveSnapshot::SQuantizedPlayer& quantized, uint16_t value) { return quantized.id < value; });
+	if (it == end || it->id != id)
+		return false;
+
+	player = PMoveSnapshot::Dequantize(m_config, *it);
+	return true;
+}
+
+void CSnapshotDecoder::Reset()
+{
+	m_history.Clear();
+	m_sequence = 0;
+	m_hasSnapshot = false;
+}
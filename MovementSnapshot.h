@@ -0,0 +1,131 @@
+#pragma once
+
+#include "PlayerMovement.h"
+#include "SequenceRing.h"
+
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+
+////////////////////////////////////////////////////////
+// Compact movement snapshots of all players
+// The server quantizes every player once per snapshot and keeps a short
+// history. Each client is then sent one bitstream holding all players,
+// delta encoded against the newest snapshot that client acknowledged.
+// Clients that have no usable baseline get everything in full.
+////////////////////////////////////////////////////////
+
+// Quantization ranges and bit widths, must match on both ends
+struct SSnapshotConfig
+{
+	PMoveVec3 positionMin = PMoveVec3(-4096.f, -4096.f, -4096.f);
+	PMoveVec3 positionMax = PMoveVec3(4096.f, 4096.f, 4096.f);
+	uint32_t positionBits = 22;           // 2 mm steps over the default 8 km range
+	float maxSpeed = 8192.f;              // Kernel velocities, clamped to [-maxSpeed, maxSpeed] per axis
+	uint32_t velocityBits = 16;
+	uint32_t angleBits = 16;              // Yaw and pitch wrap around a full turn
+};
+
+// Movement state of one player as sent to clients
+struct SSnapshotPlayer
+{
+	uint16_t id = 0;                      // Assigned by the server, unique among the players of a snapshot
+	PMoveVec3 position;
+	PMoveVec3 velocity;
+	float yaw = 0.f;
+	float pitch = 0.f;
+	bool onGround = false;
+	bool wishJump = false;
+	bool jumpHeld = false;
+};
+
+namespace PMoveSnapshot
+{
+	static constexpr uint32_t MaxPlayers = 128;
+	// Snapshots go out at most once per tick, so a little over half a second at the default 60 Hz. Older acknowledgements fall back to a full snapshot.
+	static constexpr uint32_t HistoryCapacity = 32;
+	static_assert(HistoryCapacity >= CFixedTimestep::DefaultTickRate / 2, "The history shall hold half a second of snapshots!");
+
+	struct SQuantizedPlayer
+	{
+		uint32_t id = 0;
+		std::array<uint32_t, 3> position = {};
+		std::array<uint32_t, 3> velocity = {};
+		uint32_t yaw = 0;
+		uint32_t pitch = 0;
+		uint32_t flags = 0;
+	};
+
+	// Players are kept sorted by id so a snapshot and its baseline can be walked side by side
+	struct SQuantizedSnapshot
+	{
+		uint32_t playerCount = 0;
+		std::array<SQuantizedPlayer, MaxPlayers> players;
+	};
+
+	// Players of a snapshot sent to one client, by id. Ids from MaxPlayers up can't be selected.
+	using PlayerMask = std::bitset<MaxPlayers>;
+
+	SQuantizedPlayer Quantize(const SSnapshotConfig& config, const SSnapshotPlayer& player);
+	SSnapshotPlayer Dequantize(const SSnapshotConfig& config, const SQuantizedPlayer& player);
+}
+
+// Server: builds one snapshot per network tick and writes it for each client
+class CSnapshotEncoder
+{
+public:
+	explicit CSnapshotEncoder(const SSnapshotConfig& config = SSnapshotConfig()) : m_config(config) {}
+
+	void BeginSnapshot(uint32_t sequence);
+	// Returns false once MaxPlayers were added
+	bool AddPlayer(const SSnapshotPlayer& player);
+	void EndSnapshot();
+
+	// Writes the current snapshot delta encoded against baselineSequence, or in full if that snapshot is no longer known.
+	// Returns the number of bytes written, 0 if the buffer was too small.
+	size_t Write(uint32_t baselineSequence, uint8_t* pBuffer, size_t capacity) const;
+	// Writes only the selected players. pBaselineSelection are the players the client was sent in the baseline, nullptr if it got all of them.
+	size_t Write(uint32_t baselineSequence, const PMoveSnapshot::PlayerMask& selection, const PMoveSnapshot::PlayerMask* pBaselineSelection, uint8_t* pBuffer, size_t capacity) const;
+	// Bits the player adds to a snapshot written against baselineSequence, 0 if it isn't part of the current snapshot
+	uint32_t GetPlayerBitCount(uint16_t id, uint32_t baselineSequence, const PMoveSnapshot::PlayerMask* pBaselineSelection) const;
+
+	uint32_t GetSequence() const { return m_sequence; }
+	const SSnapshotConfig& GetConfig() const { return m_config; }
+	void Reset();
+
+private:
+	size_t WritePlayers(uint32_t baselineSequence, const PMoveSnapshot::PlayerMask* pSelection, const PMoveSnapshot::PlayerMask* pBaselineSelection, uint8_t* pBuffer, size_t capacity) const;
+	// The baseline a client can decode deltas against, nullptr if it has none
+	const PMoveSnapshot::SQuantizedSnapshot* FindBaseline(uint32_t baselineSequence) const;
+
+	SSnapshotConfig m_config;
+	CSequenceRing<PMoveSnapshot::SQuantizedSnapshot, PMoveSnapshot::HistoryCapacity> m_history;
+	PMoveSnapshot::SQuantizedSnapshot* m_pCurrent = nullptr;
+	uint32_t m_sequence = 0;
+	bool m_hasSnapshot = false;
+};
+
+// Client: decodes snapshots and keeps the ones it may be sent deltas against
+class CSnapshotDecoder
+{
+public:
+	explicit CSnapshotDecoder(const SSnapshotConfig& config = SSnapshotConfig()) : m_config(config) {}
+
+	// Returns false for malformed, stale or duplicate snapshots and for deltas against an unknown baseline
+	bool Read(const uint8_t* pBuffer, size_t size);
+
+	// Newest decoded snapshot, the sequence is acknowledged back to the server
+	uint32_t GetSequence() const { return m_sequence; }
+	bool HasSnapshot() const { return m_hasSnapshot; }
+	uint32_t GetPlayerCount() const;
+	SSnapshotPlayer GetPlayer(uint32_t index) const;
+	bool FindPlayer(uint16_t id, SSnapshotPlayer& player) const;
+	void Reset();
+
+private:
+	SSnapshotConfig m_config;
+	CSequenceRing<PMoveSnapshot::SQuantizedSnapshot, PMoveSnapshot::HistoryCapacity> m_history;
+	uint32_t m_sequence = 0;
+	bool m_hasSnapshot = false;
+};
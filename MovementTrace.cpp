@@ -0,0 +1,227 @@
+#include "MovementTrace.h"
+#include "SpscQueue.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+namespace
+{
+	struct SThreadRing
+	{
+		CSpscQueue<SMovementTraceRecord, PMoveTrace::RingCapacity> records;
+		std::atomic<uint64_t> droppedCount{ 0 };
+	};
+
+	// Claimed once per thread and never freed, so the drain thread can't see a ring go away
+	std::array<std::atomic<SThreadRing*>, PMoveTrace::MaxThreads> s_rings{};
+	std::atomic<uint32_t> s_ringCount{ 0 };
+	// Records of threads that didn't get a ring
+	std::atomic<uint64_t> s_unclaimedDroppedCount{ 0 };
+
+	thread_local SThreadRing* t_pRing = nullptr;
+	thread_local bool t_hasClaimedRing = false;
+
+	std::atomic<bool> s_isRunning{ false };
+	std::thread s_drainThread;
+	FILE* s_pFile = nullptr;
+	std::atomic<uint64_t> s_writtenCount{ 0 };
+	uint64_t s_droppedCountAtStart = 0;
+
+	SThreadRing* ClaimRing()
+	{
+		t_hasClaimedRing = true;
+
+		const uint32_t index = s_ringCount.fetch_add(1, std::memory_order_relaxed);
+		if (index >= PMoveTrace::MaxThreads)
+			return nullptr;
+
+		t_pRing = new SThreadRing();
+		s_rings[index].store(t_pRing, std::memory_order_release);
+		return t_pRing;
+	}
+
+	uint32_t GetRingCount()
+	{
+		const uint32_t ringCount = s_ringCount.load(std::memory_order_acquire);
+		return ringCount < PMoveTrace::MaxThreads ? ringCount : PMoveTrace::MaxThreads;
+	}
+
+	uint64_t GetTotalDroppedCount()
+	{
+		uint64_t droppedCount = s_unclaimedDroppedCount.load(std::memory_order_relaxed);
+		for (uint32_t i = 0; i < GetRingCount(); ++i)
+		{
+			if (const SThreadRing* pRing = s_rings[i].load(std::memory_order_acquire))
+			{
+				droppedCount += pRing->droppedCount.load(std::memory_order_relaxed);
+			}
+		}
+		return droppedCount;
+	}
+
+	// Consumer side of every ring, only ever called by one thread at a time
+	template<typename TFunc>
+	uint32_t DrainRings(TFunc&& write)
+	{
+		std::array<SMovementTraceRecord, 256> buffer;
+		uint32_t drainedCount = 0;
+
+		for (uint32_t i = 0; i < GetRingCount(); ++i)
+		{
+			SThreadRing* pRing = s_rings[i].load(std::memory_order_acquire);
+			if (pRing == nullptr)
+				continue;
+
+			uint32_t count;
+			do
+			{
+				count = 0;
+				while (count < buffer.size() && pRing->records.Pop(buffer[count]))
+				{
+					++count;
+				}
+				write(buffer.data(), count);
+				drainedCount += count;
+			} while (count == buffer.size());
+		}
+
+		return drainedCount;
+	}
+
+	void WriteRecords(const SMovementTraceRecord* pRecords, uint32_t count)
+	{
+		if (count == 0)
+			return;
+
+		const size_t writtenCount = std::fwrite(pRecords, sizeof(SMovementTraceRecord), count, s_pFile);
+		s_writtenCount.fetch_add(writtenCount, std::memory_order_relaxed);
+	}
+
+	void RunDrainThread()
+	{
+		bool isRunning = true;
+		while (isRunning)
+		{
+			// Read before draining, so the last pass picks up everything pushed before Stop
+			isRunning = s_isRunning.load(std::memory_order_acquire);
+
+			if (DrainRings(&WriteRecords) == 0 && isRunning)
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(5));
+			}
+		}
+	}
+}
+
+namespace PMoveTrace
+{
+
+bool Start(const char* szPath)
+{
+	if (s_isRunning.load(std::memory_order_relaxed))
+		return false;
+
+	FILE* pFile = std::fopen(szPath, "wb");
+	if (pFile == nullptr)
+		return false;
+
+	const SMovementTraceFileHeader header;
+	if (std::fwrite(&header, sizeof(header), 1, pFile) != 1)
+	{
+		std::fclose(pFile);
+		return false;
+	}
+
+	// Whatever was pushed while the previous trace stopped doesn't belong to this one
+	DrainRings([](const SMovementTraceRecord*, uint32_t) {});
+
+	s_pFile = pFile;
+	s_writtenCount.store(0, std::memory_order_relaxed);
+	s_droppedCountAtStart = GetTotalDroppedCount();
+	s_isRunning.store(true, std::memory_order_release);
+	s_drainThread = std::thread(&RunDrainThread);
+	return true;
+}
+
+void Stop()
+{
+	if (!s_isRunning.load(std::memory_order_relaxed))
+		return;
+
+	s_isRunning.store(false, std::memory_order_release);
+	s_drainThread.join();
+
+	std::fclose(s_pFile);
+	s_pFile = nullptr;
+}
+
+bool IsRunning()
+{
+	return s_isRunning.load(std::memory_order_relaxed);
+}
+
+void Push(const SMovementTraceRecord& record)
+{
+	if (!s_isRunning.load(std::memory_order_relaxed))
+		return;
+
+	SThreadRing* pRing = t_pRing;
+	if (pRing == nullptr && !t_hasClaimedRing)
+	{
+		pRing = ClaimRing();
+	}
+
+	if (pRing == nullptr)
+	{
+		s_unclaimedDroppedCount.fetch_add(1, std::memory_order_relaxed);
+	}
+	else if (!pRing->records.Push(record))
+	{
+		pRing->droppedCount.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+uint64_t GetWrittenCount()
+{
+	return s_writtenCount.load(std::memory_order_relaxed);
+}
+
+uint64_t GetDroppedCount()
+{
+	return GetTotalDroppedCount() - s_droppedCountAtStart;
+}
+
+bool ReadFile(const char* szPath, std::vector<SMovementTraceRecord>& records)
+{
+	records.clear();
+
+	FILE* pFile = std::fopen(szPath, "rb");
+	if (pFile == nullptr)
+		return false;
+
+	const SMovementTraceFileHeader expected;
+	SMovementTraceFileHeader header;
+	const bool isValid = std::fread(&header, sizeof(header), 1, pFile) == 1
+		&& std::memcmp(header.magic, expected.magic, sizeof(header.magic)) == 0
+		&& header.version == expected.version
+		&& header.recordSize == expected.recordSize;
+
+	if (isValid)
+	{
+		// A trace cut short by a crash still holds every complete record
+		SMovementTraceRecord record;
+		while (std::fread(&record, sizeof(record), 1, pFile) == 1)
+		{
+			records.push_back(record);
+		}
+	}
+
+	std::fclose(pFile);
+	return isValid;
+}
+
+}
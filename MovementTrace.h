@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+////////////////////////////////////////////////////////
+// Binary movement trace for diagnosing movement complaints
+// Records are pushed into a lock-free ring owned by the calling thread,
+// a background thread drains every ring into a compact file. Pushing
+// never blocks and never allocates after a thread's first record, a
+// full ring drops the record and counts it. Release builds compile the
+// whole thing out, see PMOVE_TRACE. Tools/MovementTraceDump.cpp decodes
+// the files.
+////////////////////////////////////////////////////////
+
+// Builds without the trace pay nothing for it, not even the records' construction
+#ifndef PMOVE_TRACE
+	#if defined(_RELEASE)
+		#define PMOVE_TRACE 0
+	#else
+		#define PMOVE_TRACE 1
+	#endif
+#endif
+
+enum class EMovementTraceEvent : uint8_t
+{
+	Tick,                                 // Input handed to the movement solver
+	JumpPressed,                          // Jump button went down
+	Jumped                                // A ground jump was handed to physics
+};
+
+enum EMovementTraceFlag : uint8_t
+{
+	eMovementTraceFlag_OnGround = 1 << 0,
+	eMovementTraceFlag_WishJump = 1 << 1,
+	eMovementTraceFlag_JumpHeld = 1 << 2
+};
+
+// Written to the file as is, little endian
+struct SMovementTraceRecord
+{
+	uint32_t tick = 0;                    // Command sequence the record belongs to
+	uint32_t entityId = 0;
+	float speed = 0.f;                    // Along the ground, Tick records are taken before the tick
+	float frictionDrop = 0.f;             // Speed friction takes away during the tick
+	int16_t wishDirX = 0;                 // Normalized wish direction scaled by WishDirScale
+	int16_t wishDirY = 0;
+	EMovementTraceEvent event = EMovementTraceEvent::Tick;
+	uint8_t flags = 0;                    // EMovementTraceFlag
+	uint16_t padding = 0;
+};
+
+static_assert(sizeof(SMovementTraceRecord) == 24, "The file format depends on the record layout");
+
+struct SMovementTraceFileHeader
+{
+	char magic[4] = { 'P', 'M', 'T', 'R' };
+	uint16_t version = 1;
+	uint16_t recordSize = sizeof(SMovementTraceRecord);
+};
+
+namespace PMoveTrace
+{
+	static constexpr float WishDirScale = 32767.f;
+	// Records each thread can have in flight before the drain thread catches up, two seconds of 64 players at 60 Hz
+	static constexpr uint32_t RingCapacity = 8192;
+	// Threads beyond this drop everything they push
+	static constexpr uint32_t MaxThreads = 16;
+
+	// Starts the drain thread writing to szPath, returns false if already running or the file can't be created
+	bool Start(const char* szPath);
+	// Writes everything still queued and closes the file
+	void Stop();
+	bool IsRunning();
+
+	// Any thread. Ignored while not running.
+	void Push(const SMovementTraceRecord& record);
+
+	// Since the last Start
+	uint64_t GetWrittenCount();
+	uint64_t GetDroppedCount();
+
+	// Whole file at once, returns false if it isn't a trace this version can read
+	bool ReadFile(const char* szPath, std::vector<SMovementTraceRecord>& records);
+}
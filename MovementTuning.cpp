@@ -0,0 +1,287 @@
+#include "MovementTuning.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+	struct SFloatParam
+	{
+		const char* szName;
+		float PMoveParams::* pValue;
+	};
+
+	// Named like the members, so a profile reads like the code it tunes
+	const SFloatParam FloatParams[] =
+	{
+		{ "gravity", &PMoveParams::gravity },
+		{ "friction", &PMoveParams::friction },
+		{ "moveSpeed", &PMoveParams::moveSpeed },
+		{ "runAcceleration", &PMoveParams::runAcceleration },
+		{ "runDeacceleration", &PMoveParams::runDeacceleration },
+		{ "airAcceleration", &PMoveParams::airAcceleration },
+		{ "airDecceleration", &PMoveParams::airDecceleration },
+		{ "airControl", &PMoveParams::airControl },
+		{ "sideStrafeAcceleration", &PMoveParams::sideStrafeAcceleration },
+		{ "sideStrafeSpeed", &PMoveParams::sideStrafeSpeed },
+		{ "jumpSpeed", &PMoveParams::jumpSpeed },
+		{ "jumpImpulse", &PMoveParams::jumpImpulse },
+	};
+	const char* const HoldJumpToBhopName = "holdJumpToBhop";
+
+	// Profiles are a few hundred bytes, anything this large isn't one
+	const size_t MaxFileSize = 64 * 1024;
+	// Slices the watcher sleeps in between reads, so Stop doesn't wait out a whole poll interval
+	const std::chrono::milliseconds SleepSlice(10);
+
+	bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+	// Trims [begin, end) in place
+	void Trim(const char*& begin, const char*& end)
+	{
+		while (begin < end && IsSpace(*begin))
+		{
+			++begin;
+		}
+		while (end > begin && IsSpace(end[-1]))
+		{
+			--end;
+		}
+	}
+
+	bool IsName(const char* begin, const char* end, const char* szName)
+	{
+		const size_t length = std::strlen(szName);
+		return static_cast<size_t>(end - begin) == length && std::strncmp(begin, szName, length) == 0;
+	}
+
+	bool ParseFloat(const char* begin, const char* end, float& value)
+	{
+		char buffer[64];
+		const size_t length = static_cast<size_t>(end - begin);
+		if (length == 0 || length >= sizeof(buffer))
+			return false;
+
+		std::memcpy(buffer, begin, length);
+		buffer[length] = '\0';
+		char* pEnd = nullptr;
+		const float parsed = std::strtof(buffer, &pEnd);
+		if (pEnd != buffer + length || !std::isfinite(parsed))
+			return false;
+
+		value = parsed;
+		return true;
+	}
+
+	bool ParseBool(const char* begin, const char* end, bool& value)
+	{
+		if (IsName(begin, end, "1") || IsName(begin, end, "true"))
+		{
+			value = true;
+			return true;
+		}
+		if (IsName(begin, end, "0") || IsName(begin, end, "false"))
+		{
+			value = false;
+			return true;
+		}
+		return false;
+	}
+
+	bool ReadFile(const std::string& path, std::string& text)
+	{
+		FILE* pFile = std::fopen(path.c_str(), "rb");
+		if (pFile == nullptr)
+			return false;
+
+		char buffer[4096];
+		text.clear();
+		size_t readSize;
+		while ((readSize = std::fread(buffer, 1, sizeof(buffer), pFile)) > 0 && text.size() < MaxFileSize)
+		{
+			text.append(buffer, readSize);
+		}
+		std::fclose(pFile);
+		return true;
+	}
+}
+
+namespace PMoveTuning
+{
+
+bool Parse(const char* szText, PMoveParams& params, char* szError, size_t errorSize)
+{
+	// Applied only once every line parsed, a broken profile changes nothing
+	PMoveParams parsed = params;
+	uint32_t lineNumber = 0;
+	for (const char* pLine = szText; *pLine != '\0'; )
+	{
+		++lineNumber;
+		const char* pLineEnd = std::strchr(pLine, '\n');
+		pLineEnd = pLineEnd != nullptr ? pLineEnd : pLine + std::strlen(pLine);
+		const char* pNext = *pLineEnd == '\n' ? pLineEnd + 1 : pLineEnd;
+
+		const char* pComment = std::find(pLine, pLineEnd, '#');
+		const char* pNameBegin = pLine;
+		const char* pValueEnd = pComment;
+		Trim(pNameBegin, pValueEnd);
+		pLine = pNext;
+		if (pNameBegin == pValueEnd)
+			continue;
+
+		const char* pEquals = std::find(pNameBegin, pValueEnd, '=');
+		const char* pNameEnd = pEquals;
+		const char* pValueBegin = pEquals != pValueEnd ? pEquals + 1 : pValueEnd;
+		Trim(pNameBegin, pNameEnd);
+		Trim(pValueBegin, pValueEnd);
+
+		bool isKnown = false;
+		bool isValid = false;
+		for (const SFloatParam& param : FloatParams)
+		{
+			if (IsName(pNameBegin, pNameEnd, param.szName))
+			{
+				isKnown = true;
+				isValid = ParseFloat(pValueBegin, pValueEnd, parsed.*param.pValue);
+			}
+		}
+		if (IsName(pNameBegin, pNameEnd, HoldJumpToBhopName))
+		{
+			isKnown = true;
+			isValid = ParseBool(pValueBegin, pValueEnd, parsed.holdJumpToBhop);
+		}
+
+		if (!isValid)
+		{
+			if (errorSize > 0)
+			{
+				std::snprintf(szError, errorSize, "line %u: %s %.*s", lineNumber, isKnown ? "malformed value of" : "unknown name", static_cast<int>(pNameEnd - pNameBegin), pNameBegin);
+			}
+			return false;
+		}
+	}
+
+	params = parsed;
+	return true;
+}
+
+size_t Write(const PMoveParams& params, char* pBuffer, size_t capacity)
+{
+	size_t length = 0;
+	for (const SFloatParam& param : FloatParams)
+	{
+		// 9 significant digits bring every float back bit for bit
+		const int written = std::snprintf(pBuffer + length, capacity - length, "%s = %.9g\n", param.szName, params.*param.pValue);
+		if (written < 0 || static_cast<size_t>(written) >= capacity - length)
+			return 0;
+		length += static_cast<size_t>(written);
+	}
+
+	const int written = std::snprintf(pBuffer + length, capacity - length, "%s = %d\n", HoldJumpToBhopName, params.holdJumpToBhop ? 1 : 0);
+	if (written < 0 || static_cast<size_t>(written) >= capacity - length)
+		return 0;
+	return length + static_cast<size_t>(written);
+}
+
+}
+
+void CMovementTuningWatcher::Start(const char* szPath, const PMoveParams& base, float pollInterval)
+{
+	Stop();
+
+	m_path = szPath;
+	m_base = base;
+	m_pollInterval = pollInterval;
+	m_missingCount.store(0, std::memory_order_relaxed);
+	m_isWatching.store(true, std::memory_order_release);
+	m_watcherThread = std::thread(&CMovementTuningWatcher::RunWatcherThread, this);
+}
+
+void CMovementTuningWatcher::Stop()
+{
+	if (!IsWatching())
+		return;
+
+	m_isWatching.store(false, std::memory_order_release);
+	m_watcherThread.join();
+
+	m_pCurrent.store(nullptr, std::memory_order_relaxed);
+	m_readVersion.store(0, std::memory_order_relaxed);
+	m_profiles.clear();
+}
+
+const SMovementTuningProfile* CMovementTuningWatcher::Acquire()
+{
+	const SMovementTuningProfile* pProfile = m_pCurrent.load(std::memory_order_acquire);
+	if (pProfile != nullptr)
+	{
+		// Releases every older profile, the game thread is done reading them
+		m_readVersion.store(pProfile->version, std::memory_order_release);
+	}
+	return pProfile;
+}
+
+void CMovementTuningWatcher::Publish(const std::string& text)
+{
+	const SMovementTuningProfile* pPrevious = m_profiles.empty() ? nullptr : m_profiles.back().get();
+
+	std::unique_ptr<SMovementTuningProfile> pProfile(new SMovementTuningProfile());
+	pProfile->version = pPrevious != nullptr ? pPrevious->version + 1 : 1;
+	pProfile->params = m_base;
+	if (!PMoveTuning::Parse(text.c_str(), pProfile->params, pProfile->szError, sizeof(pProfile->szError)))
+	{
+		pProfile->params = pPrevious != nullptr ? pPrevious->params : m_base;
+	}
+
+	m_pCurrent.store(pProfile.get(), std::memory_order_release);
+	m_profiles.push_back(std::move(pProfile));
+
+	// Older than what the game thread holds, it can't reach them anymore. The current profile always stays.
+	const uint32_t readVersion = m_readVersion.load(std::memory_order_acquire);
+	m_profiles.erase(std::remove_if(m_profiles.begin(), m_profiles.end() - 1, [readVersion](const std::unique_ptr<SMovementTuningProfile>& pOld)
+	{
+		return pOld->version < readVersion;
+	}), m_profiles.end() - 1);
+}
+
+void CMovementTuningWatcher::RunWatcherThread()
+{
+	using Clock = std::chrono::steady_clock;
+	const auto pollInterval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(m_pollInterval));
+
+	std::string text;
+	std::string previousText;
+	std::string publishedText;
+	bool hasPrevious = false;
+	bool hasPublished = false;
+	while (IsWatching())
+	{
+		if (!ReadFile(m_path, text))
+		{
+			m_missingCount.fetch_add(1, std::memory_order_relaxed);
+			hasPrevious = false;
+		}
+		else
+		{
+			// A file read while an editor was saving it differs from the next read, only text that held for a poll is published
+			if (hasPrevious && text == previousText && (!hasPublished || text != publishedText))
+			{
+				Publish(text);
+				publishedText = text;
+				hasPublished = true;
+			}
+			previousText.swap(text);
+			hasPrevious = true;
+		}
+
+		const Clock::time_point wakeTime = Clock::now() + pollInterval;
+		while (IsWatching() && Clock::now() < wakeTime)
+		{
+			std::this_thread::sleep_for(SleepSlice);
+		}
+	}
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "PlayerMovement.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+////////////////////////////////////////////////////////
+// Movement tuning profiles, reloaded while the game runs
+// A profile is a small text file of PMoveParams values, one
+// "name = value" per line with # starting a comment. Names it leaves out
+// keep the ruleset's defaults, so a profile only lists what it changes.
+// A watcher thread reads the file every poll interval, and once new
+// contents held for a whole poll, so a file caught halfway through being
+// saved never counts, parses them off the game thread into a new
+// immutable profile it publishes with one atomic store. The game thread
+// picks up the newest profile with one atomic load at the start of a
+// tick. A replaced profile is only freed once the game thread has moved
+// past it, read-copy-update with a single reader. A file that doesn't
+// parse is published with its error and the last values that did.
+////////////////////////////////////////////////////////
+
+struct SMovementTuningProfile
+{
+	uint32_t version = 0;                 // Increases with every profile published
+	PMoveParams params;
+	char szError[128] = {};               // Empty when the file parsed, otherwise params are the last ones that did
+};
+
+namespace PMoveTuning
+{
+	// Only the names in the text change params. Returns false for an unknown name or a malformed value, with its line in szError.
+	bool Parse(const char* szText, PMoveParams& params, char* szError, size_t errorSize);
+	// Every name with its value in the format Parse reads, floats round trip exactly. Returns the length, 0 if the buffer was too small.
+	size_t Write(const PMoveParams& params, char* pBuffer, size_t capacity);
+}
+
+class CMovementTuningWatcher
+{
+public:
+	CMovementTuningWatcher() = default;
+	~CMovementTuningWatcher() { Stop(); }
+
+	CMovementTuningWatcher(const CMovementTuningWatcher&) = delete;
+	CMovementTuningWatcher& operator=(const CMovementTuningWatcher&) = delete;
+
+	// Starts the watcher thread, the file is loaded after one poll. Names the file leaves out come from base.
+	void Start(const char* szPath, const PMoveParams& base, float pollInterval = 0.5f);
+	// Frees every profile, nothing Acquire returned may be used afterwards
+	void Stop();
+	bool IsWatching() const { return m_isWatching.load(std::memory_order_relaxed); }
+
+	// Game thread only, never blocks. The newest profile, nullptr until the file was first read. Stays valid until the next Acquire.
+	const SMovementTuningProfile* Acquire();
+
+	// Reads of the file that found it missing, the current profile stays in place until it is back
+	uint64_t GetMissingCount() const { return m_missingCount.load(std::memory_order_relaxed); }
+
+private:
+	void RunWatcherThread();
+	// Watcher thread: parses the text and publishes it as the next version
+	void Publish(const std::string& text);
+
+	std::string m_path;
+	PMoveParams m_base;
+	float m_pollInterval = 0.5f;
+
+	std::atomic<const SMovementTuningProfile*> m_pCurrent{ nullptr };
+	// The version the game thread last acquired, every profile older than it is free to go
+	std::atomic<uint32_t> m_readVersion{ 0 };
+	// Watcher thread: the current profile and the replaced ones the game thread may still hold
+	std::vector<std::unique_ptr<SMovementTuningProfile>> m_profiles;
+
+	std::atomic<bool> m_isWatching{ false };
+	std::atomic<uint64_t> m_missingCount{ 0 };
+	std::thread m_watcherThread;
+};
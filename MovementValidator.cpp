@@ -0,0 +1,268 @@
+#include "MovementValidator.h"
+#include "WorkStealingPool.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	// Players per pool chunk, checking one costs a few dozen kernel steps
+	const uint32_t PlayersPerJob = 8;
+	// The best air move is searched over the angles that can still gain speed, down to about 1e-4 radians
+	const uint32_t StrafeSearchSteps = 22;
+	const float MaxStrafeAngle = 1.7f;
+	// Kernel units per tick, below this the best turn gains too little to tell players apart
+	const float MinStrafeGain = 0.001f;
+
+	float GetHorizontalSpeed(const PMoveVec3& velocity)
+	{
+		return std::sqrt(velocity.x * velocity.x + velocity.y * velocity.y);
+	}
+}
+
+CMovementValidator::CMovementValidator(const SMovementValidatorConfig& config)
+	: m_config(config)
+	, m_players(MaxPlayers)
+{
+}
+
+void CMovementValidator::BeginTick()
+{
+	m_recordedCount = 0;
+}
+
+void CMovementValidator::Record(uint32_t slot, const SMovementValidationInput& input)
+{
+	if (slot >= MaxPlayers || m_recordedCount == MaxPlayers)
+		return;
+
+	m_players[slot].input = input;
+	m_recordedSlots[m_recordedCount++] = static_cast<uint16_t>(slot);
+}
+
+void CMovementValidator::Validate(float dt, CWorkStealingPool* pPool)
+{
+	// Evidence counts half as much scoreHalfLife seconds later
+	const float decay = std::pow(0.5f, dt / m_config.scoreHalfLife);
+
+	if (pPool == nullptr || m_recordedCount <= PlayersPerJob)
+	{
+		for (uint32_t i = 0; i < m_recordedCount; ++i)
+		{
+			ValidatePlayer(m_players[m_recordedSlots[i]], m_recordedSlots[i], dt, decay);
+		}
+		return;
+	}
+
+	pPool->ParallelFor(m_recordedCount, PlayersPerJob, [this, dt, decay](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t i = begin; i < end; ++i)
+		{
+			ValidatePlayer(m_players[m_recordedSlots[i]], m_recordedSlots[i], dt, decay);
+		}
+	});
+}
+
+void CMovementValidator::ResetPlayer(uint32_t slot)
+{
+	if (slot < MaxPlayers)
+	{
+		m_players[slot] = SPlayer();
+	}
+}
+
+void CMovementValidator::Reset()
+{
+	std::fill(m_players.begin(), m_players.end(), SPlayer());
+	m_recordedCount = 0;
+}
+
+const char* CMovementValidator::GetAnomalyName(EMovementAnomaly anomaly)
+{
+	switch (anomaly)
+	{
+	case EMovementAnomaly::Speed: return "speed";
+	case EMovementAnomaly::Teleport: return "teleport";
+	case EMovementAnomaly::Timescale: return "timescale";
+	case EMovementAnomaly::PerfectBhop: return "perfect_bhop";
+	case EMovementAnomaly::Autostrafe: return "autostrafe";
+	default: return "unknown";
+	}
+}
+
+void CMovementValidator::ValidatePlayer(SPlayer& player, uint32_t slot, float dt, float decay) const
+{
+	const SMovementValidationInput& input = player.input;
+	// The tick as the batch stepped it
+	const PMoveState after = m_pMove(input.state, input.params, input.cmd, dt);
+
+	std::array<float, static_cast<size_t>(EMovementAnomaly::Count)> evidence = {};
+	evidence[static_cast<size_t>(EMovementAnomaly::Speed)] = CheckDisplacement(player, after, dt, evidence[static_cast<size_t>(EMovementAnomaly::Teleport)]);
+	evidence[static_cast<size_t>(EMovementAnomaly::Timescale)] = CheckCmdRate(player, dt);
+	evidence[static_cast<size_t>(EMovementAnomaly::PerfectBhop)] = CheckHop(player);
+	evidence[static_cast<size_t>(EMovementAnomaly::Autostrafe)] = CheckStrafe(player, slot, after, dt);
+
+	SMovementValidationReport& report = player.report;
+	report.flags = 0;
+	for (uint32_t i = 0; i < static_cast<uint32_t>(EMovementAnomaly::Count); ++i)
+	{
+		report.scores[i] = report.scores[i] * decay + evidence[i];
+		report.flags |= report.scores[i] >= m_config.flagScore ? SMovementValidationReport::GetFlag(static_cast<EMovementAnomaly>(i)) : 0;
+	}
+
+	++player.tick;
+}
+
+float CMovementValidator::CheckDisplacement(SPlayer& player, const PMoveState& after, float dt, float& teleportEvidence) const
+{
+	const uint32_t index = player.tick & (PositionWindow - 1);
+	const PMoveVec3& position = player.input.position;
+
+	float evidence = 0.f;
+	if (player.tick >= PositionWindow)
+	{
+		// The oldest position against how far the velocities of the ticks since then carried the player
+		float reach = 0.f;
+		for (const float tickReach : player.reach)
+		{
+			reach += tickReach;
+		}
+		const float allowed = reach * m_config.speedTolerance + m_config.speedSlack;
+
+		const PMoveVec3 displacement = position - player.positions[index];
+		const float excess = GetHorizontalSpeed(displacement) - allowed;
+		evidence = excess > 0.f ? 1.f : 0.f;
+		teleportEvidence = excess > m_config.teleportDistance ? m_config.flagScore : 0.f;
+	}
+
+	// Physics is handed kernel velocities scaled by the tick interval and moves by them for a tick
+	player.positions[index] = position;
+	player.reach[index] = GetHorizontalSpeed(after.velocity) * dt * dt;
+	return evidence;
+}
+
+float CMovementValidator::CheckCmdRate(SPlayer& player, float dt) const
+{
+	const SMovementValidationInput& input = player.input;
+
+	// Starts with the first command received, the client's sequence carries on from its previous life
+	if (player.rateStartSequence == 0)
+	{
+		player.rateStartSequence = input.newestCmdSequence;
+		player.rateStartTime = input.time;
+		return 0.f;
+	}
+
+	// Against the clock, not ticks, so a server that dropped ticks in a hitch doesn't blame its clients for it
+	const double elapsed = input.time - player.rateStartTime;
+	if (elapsed >= RateInterval)
+	{
+		const uint32_t cmdCount = input.newestCmdSequence - player.rateStartSequence;
+		player.cmdRates.Push(static_cast<float>(cmdCount * static_cast<double>(dt) / elapsed));
+		player.rateStartSequence = input.newestCmdSequence;
+		player.rateStartTime = input.time;
+		player.report.cmdRate = player.cmdRates.GetMean();
+	}
+
+	const bool isFull = player.cmdRates.GetCount() == player.cmdRates.Capacity;
+	return isFull && player.cmdRates.GetMean() > 1.f + m_config.timescaleTolerance ? 1.f : 0.f;
+}
+
+float CMovementValidator::CheckHop(SPlayer& player) const
+{
+	const SMovementValidationInput& input = player.input;
+	const bool onGround = input.state.onGround;
+
+	if (input.cmd.jump && !player.wasJumpHeld)
+	{
+		player.pressTick = player.tick;
+	}
+	if (onGround && !player.wasOnGround)
+	{
+		player.landingTick = player.tick;
+	}
+	player.wasJumpHeld = input.cmd.jump;
+	player.wasOnGround = onGround;
+
+	// Holding jump hops on the landing tick by design there
+	if (input.params.holdJumpToBhop)
+		return 0.f;
+
+	// A press held through the landing jumps on it just the same, only a press on the very tick is suspicious
+	if (onGround && input.state.wishJump && player.tick - player.landingTick <= MaxHopGroundTicks)
+	{
+		const bool isPerfect = player.landingTick == player.tick && player.pressTick == player.tick;
+		player.perfectHops.Push(isPerfect ? 1.f : 0.f);
+		player.report.perfectHopShare = player.perfectHops.GetMean();
+	}
+
+	const bool isFull = player.perfectHops.GetCount() == player.perfectHops.Capacity;
+	return isFull && player.perfectHops.GetMean() >= m_config.perfectHopShare ? 1.f : 0.f;
+}
+
+float CMovementValidator::CheckStrafe(SPlayer& player, uint32_t slot, const PMoveState& after, float dt) const
+{
+	const SMovementValidationInput& input = player.input;
+	const Cmd& cmd = input.cmd;
+	const float speed = GetHorizontalSpeed(input.state.velocity);
+
+	// Sampled, the search costs a few dozen kernel steps
+	const bool isSampled = (player.tick + slot) % m_config.strafeSampleInterval == 0;
+	if (isSampled && !input.state.onGround && !input.state.onSteepPlane && (cmd.forwardMove != 0.f || cmd.rightMove != 0.f) && speed > 0.f)
+	{
+		const float velocityAngle = std::atan2(input.state.velocity.y, input.state.velocity.x);
+		// GetWishDir turns (rightMove, forwardMove) by the yaw
+		const float wishAngle = std::atan2(cmd.forwardMove, cmd.rightMove);
+
+		// Golden section search over the angle between the wish direction and the velocity. Turned less than the peak the
+		// kernel doesn't accelerate at all, past it the gain falls off, so ties move towards wider angles.
+		const float straightSpeed = GetTurnedSpeed(input, velocityAngle, wishAngle, 0.f, dt);
+		const float tolerance = speed * 1e-6f;
+		const float ratio = 0.618034f;
+		float low = 0.f;
+		float high = MaxStrafeAngle;
+		float a = high - ratio * (high - low);
+		float b = low + ratio * (high - low);
+		float speedA = GetTurnedSpeed(input, velocityAngle, wishAngle, a, dt);
+		float speedB = GetTurnedSpeed(input, velocityAngle, wishAngle, b, dt);
+		for (uint32_t i = 0; i < StrafeSearchSteps; ++i)
+		{
+			if (speedA <= speedB + tolerance)
+			{
+				low = a;
+				a = b;
+				speedA = speedB;
+				b = low + ratio * (high - low);
+				speedB = GetTurnedSpeed(input, velocityAngle, wishAngle, b, dt);
+			}
+			else
+			{
+				high = b;
+				b = a;
+				speedB = speedA;
+				a = high - ratio * (high - low);
+				speedA = GetTurnedSpeed(input, velocityAngle, wishAngle, a, dt);
+			}
+		}
+		const float bestSpeed = std::max(straightSpeed, std::max(speedA, speedB));
+
+		// Only counts where the angle matters, holding the keys along the velocity is as good as any turn at low speed
+		const float bestGain = bestSpeed - speed;
+		if (bestGain > MinStrafeGain && straightSpeed - speed < 0.5f * bestGain)
+		{
+			const float gain = GetHorizontalSpeed(after.velocity) - speed;
+			player.strafeEfficiencies.Push(std::min(std::max(gain / bestGain, 0.f), 1.f));
+			player.report.strafeEfficiency = player.strafeEfficiencies.GetMean();
+		}
+	}
+
+	const bool isFull = player.strafeEfficiencies.GetCount() == player.strafeEfficiencies.Capacity;
+	return isFull && player.strafeEfficiencies.GetMean() >= m_config.strafeEfficiency ? 1.f : 0.f;
+}
+
+float CMovementValidator::GetTurnedSpeed(const SMovementValidationInput& input, float velocityAngle, float wishAngle, float angle, float dt) const
+{
+	PMoveState from = input.state;
+	from.yaw = velocityAngle + angle - wishAngle;
+	return GetHorizontalSpeed(m_pMove(from, input.params, input.cmd, dt).velocity);
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include "MovementRuleset.h"
+#include "PlayerMovement.h"
+#include "WindowedStatistics.h"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+class CWorkStealingPool;
+
+////////////////////////////////////////////////////////
+// Server side movement validation
+// The server simulates every client's commands itself, so no client can
+// claim a state the kernel wouldn't produce. What a cheat can still do
+// is send commands faster than real time, or have a script time jumps
+// and turn the view for the best air acceleration every tick. And
+// physics can still carry a player farther than its velocity, through
+// a collision bug or a misplaced SetPos. Every tick the server records
+// each client's command, state and position, then Validate re-simulates
+// all of them with the reference kernel in one pass, on the job pool
+// when there is one. A single odd tick proves nothing: every check feeds
+// a score that decays with time, and only sustained anomalies are
+// flagged. Flagging is all it does, what to do about it is up to the
+// server.
+////////////////////////////////////////////////////////
+
+enum class EMovementAnomaly : uint8_t
+{
+	Speed,                                // Moved farther than the kernel's velocity carries it, tick after tick
+	Teleport,                             // Jumped across a distance no velocity explains
+	Timescale,                            // Sends commands faster than the tick rate
+	PerfectBhop,                          // Presses jump on the very tick it lands, hop after hop
+	Autostrafe,                           // Turns for the best possible air acceleration, tick after tick
+	Count
+};
+
+struct SMovementValidatorConfig
+{
+	float speedTolerance = 1.5f;          // Share of the kernel's displacement physics may reach, collisions only ever take away
+	float speedSlack = 0.5f;              // Meters on top, for frames that ran a little more physics time than ticks
+	float teleportDistance = 8.f;         // Meters beyond the allowed displacement that count as a teleport right away
+	float timescaleTolerance = 0.05f;     // Commands per tick above 1 before the client counts as sped up
+	float perfectHopShare = 0.8f;         // Share of hops with jump pressed on the landing tick, only for rulesets without hold to bhop
+	float strafeEfficiency = 0.95f;       // Mean share of the best air acceleration a player reached
+	uint32_t strafeSampleInterval = 8;    // Ticks between air acceleration checks of a player, staggered across players
+	float scoreHalfLife = 5.f;            // Seconds
+	float flagScore = 30.f;               // Half a second of sustained evidence at 60 Hz
+};
+
+// What the server knows about one player's tick
+struct SMovementValidationInput
+{
+	Cmd cmd;
+	PMoveState state;                     // With the command's yaw, jump and ground applied, right before the step
+	PMoveParams params;
+	PMoveVec3 position;                   // Meters, where physics has the player when the tick starts
+	double time = 0.0;                    // Seconds, when the tick ends on the server's clock
+	uint32_t newestCmdSequence = 0;       // Newest command the client has sent so far
+};
+
+struct SMovementValidationReport
+{
+	std::array<float, static_cast<size_t>(EMovementAnomaly::Count)> scores = {};
+	uint8_t flags = 0;                    // Bit per anomaly whose score reached flagScore
+	float cmdRate = 0.f;                  // Commands per tick over the last few seconds
+	float perfectHopShare = 0.f;          // Over the last hops
+	float strafeEfficiency = 0.f;         // Mean share of the best air acceleration over the last samples
+
+	bool IsFlagged(EMovementAnomaly anomaly) const { return (flags & GetFlag(anomaly)) != 0; }
+	static uint8_t GetFlag(EMovementAnomaly anomaly) { return static_cast<uint8_t>(1u << static_cast<uint32_t>(anomaly)); }
+};
+
+class CMovementValidator
+{
+public:
+	// Slots are stable per player for as long as they're recorded, e.g. the snapshot id
+	static constexpr uint32_t MaxPlayers = 128;
+
+	explicit CMovementValidator(const SMovementValidatorConfig& config = SMovementValidatorConfig());
+
+	// Re-simulates with the server's ruleset, PMove::Move until set
+	void SetRuleset(const SMovementRuleset& ruleset) { m_pMove = ruleset.pMove; }
+
+	// Once per tick before the players are recorded
+	void BeginTick();
+	void Record(uint32_t slot, const SMovementValidationInput& input);
+	// Checks every player recorded since BeginTick. Players only touch their own slot, so the pool splits them without locks.
+	void Validate(float dt, CWorkStealingPool* pPool = nullptr);
+
+	const SMovementValidationReport& GetReport(uint32_t slot) const { return m_players[slot].report; }
+	uint32_t GetRecordedCount() const { return m_recordedCount; }
+
+	// For a slot taken over by another player, or a player that was revived somewhere else
+	void ResetPlayer(uint32_t slot);
+	void Reset();
+
+	void SetEnabled(bool isEnabled) { m_isEnabled = isEnabled; }
+	bool IsEnabled() const { return m_isEnabled; }
+
+	const SMovementValidatorConfig& GetConfig() const { return m_config; }
+	static const char* GetAnomalyName(EMovementAnomaly anomaly);
+
+private:
+	// Ticks of displacement compared at once, frames and ticks don't line up tick by tick
+	static constexpr uint32_t PositionWindow = 8;
+	// Seconds per command rate sample, 8 samples are averaged
+	static constexpr double RateInterval = 1.0;
+	// A jump more than this many ticks after landing isn't a hop
+	static constexpr uint32_t MaxHopGroundTicks = 8;
+
+	struct SPlayer
+	{
+		SMovementValidationInput input;
+		SMovementValidationReport report;
+		uint32_t tick = 0;                // Ticks validated since the slot was reset
+
+		std::array<PMoveVec3, PositionWindow> positions;
+		// Meters the kernel's velocity carried the player in each of those ticks
+		std::array<float, PositionWindow> reach;
+
+		double rateStartTime = 0.0;
+		uint32_t rateStartSequence = 0;
+		CWindowedStatistics<float, 8> cmdRates;
+
+		bool wasOnGround = false;
+		bool wasJumpHeld = false;
+		uint32_t landingTick = 0;
+		uint32_t pressTick = 0;
+		CWindowedStatistics<float, 16> perfectHops;
+
+		CWindowedStatistics<float, 32> strafeEfficiencies;
+	};
+
+	void ValidatePlayer(SPlayer& player, uint32_t slot, float dt, float decay) const;
+	// Each check returns the evidence of the tick, 1 while the player looks off
+	float CheckDisplacement(SPlayer& player, const PMoveState& after, float dt, float& teleportEvidence) const;
+	float CheckCmdRate(SPlayer& player, float dt) const;
+	float CheckHop(SPlayer& player) const;
+	float CheckStrafe(SPlayer& player, uint32_t slot, const PMoveState& after, float dt) const;
+	// Horizontal speed after one move of the command with its wish direction turned by angle from the velocity
+	float GetTurnedSpeed(const SMovementValidationInput& input, float velocityAngle, float wishAngle, float angle, float dt) const;
+
+	SMovementValidatorConfig m_config;
+	PMove::MoveFunc m_pMove = &PMove::Move;
+	std::vector<SPlayer> m_players;
+	std::array<uint16_t, MaxPlayers> m_recordedSlots;
+	uint32_t m_recordedCount = 0;
+	bool m_isEnabled = true;
+};
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "PlayerMovement.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+////////////////////////////////////////////////////////
+// Per frame command buffer of what movement hands to physics
+// Applying a player's movement used to call into physics up to twice,
+// an impulse on the frame it jumped and then its new velocity, in
+// between the rest of its per player work. Players now push their
+// velocity here instead, and the buffer is submitted in one pass once
+// all of them are done, one call per physics entity. The living entity
+// ignores the vertical part of a walk request, so a jump can't ride
+// along in it: a jump write is flagged and carries the speed the impulse
+// would have given the standing entity as its vertical part, for the
+// submit function to hand over as a jump rather than a walk request.
+// TTarget is whatever the submit function calls into, e.g. the
+// character controller, or an index in the headless benchmark.
+////////////////////////////////////////////////////////
+template<typename TTarget>
+class CPhysicsWriteBack
+{
+public:
+	struct SWrite
+	{
+		TTarget target;
+		PMoveVec3 velocity;               // Meters per second, on a jump the vertical part is the jump's speed
+		bool isJump;                      // Set the velocity as a jump, otherwise it is a walk request
+	};
+
+	// Capacity is kept across frames, so pushing stays allocation free once every player has been pushed once
+	void Reserve(size_t count) { m_writes.reserve(count); }
+
+	// One write per target and frame, jumpSpeed is 0 on frames without a jump and replaces the vertical velocity otherwise
+	void Push(const TTarget& target, const PMoveVec3& velocity, float jumpSpeed)
+	{
+		const bool isJump = jumpSpeed != 0.f;
+		m_writes.push_back(SWrite{ target, PMoveVec3(velocity.x, velocity.y, isJump ? jumpSpeed : velocity.z), isJump });
+		m_jumpCount += isJump ? 1 : 0;
+	}
+
+	// Calls submit(target, velocity, isJump) for every write in push order and clears the buffer
+	template<typename TSubmit>
+	void Submit(TSubmit&& submit)
+	{
+		for (const SWrite& write : m_writes)
+		{
+			submit(write.target, write.velocity, write.isJump);
+		}
+		Clear();
+	}
+
+	void Clear()
+	{
+		m_writes.clear();
+		m_jumpCount = 0;
+	}
+
+	size_t GetCount() const { return m_writes.size(); }
+	// Pending writes handed over as a jump
+	uint32_t GetJumpCount() const { return m_jumpCount; }
+
+private:
+	std::vector<SWrite> m_writes;
+	uint32_t m_jumpCount = 0;
+};
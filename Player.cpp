@@ -7,11 +7,16 @@
 #include <CrySchematyc/Env/Elements/EnvComponent.h>
 #include <CryCore/StaticInstanceList.h>
 #include <CryNetwork/Rmi.h>
-
-#define MOUSE_DELTA_TRESHOLD 0.0001f
+#include <CryGame/IGameFramework.h>
 
 namespace
 {
+	// Clock shared by input timestamps and the movement ticks, see CInputTimeline
+	double GetInputTime()
+	{
+		return static_cast<double>(gEnv->pTimer->GetAsyncTime().GetValue()) / CTimeValue::TIMEVALUE_PRECISION;
+	}
+
 	static void RegisterPlayerComponent(Schematyc::IEnvRegistrar& registrar)
 	{
 		Schematyc::CEnvRegistrationScope scope = registrar.Scope(IEntity::GetEntityScopeGUID());
@@ -21,6 +26,527 @@ namespace
 	}
 
 	CRY_STATIC_AUTO_REGISTER_FUNCTION(&RegisterPlayerComponent);
+
+	Quat ToQuat(const SViewQuat& q)
+	{
+		return Quat(q.w, q.x, q.y, q.z);
+	}
+
+	// Steps the movement of every player once per frame, after all player components gathered their input during the entity update
+	class CPlayerMovementUpdater final : public IGameFrameworkListener
+	{
+	public:
+		void AddPlayer()
+		{
+			if (m_playerCount++ == 0)
+			{
+				gEnv->pGameFramework->RegisterListener(this, "CPlayerMovementUpdater", FRAMEWORKLISTENERPRIORITY_GAME);
+				m_timestep.Reset(GetInputTime());
+				RegisterCVars();
+				SelectRuleset();
+			}
+		}
+
+		void RemovePlayer()
+		{
+			if (--m_playerCount == 0)
+			{
+				gEnv->pGameFramework->UnregisterListener(this);
+				m_timestep.Reset();
+				m_pendingJoins.clear();
+				CPlayerComponent::GetLagCompensationHistory().Reset();
+				CPlayerComponent::GetInterestManager().Reset();
+				CPlayerComponent::GetMovementValidator().Reset();
+				StopDemo();
+				m_tuningWatcher.Stop();
+				m_tuningPath.clear();
+				CPlayerComponent::GetMovementSystem().SetJobPool(nullptr);
+				m_pJobPool.reset();
+#if PMOVE_TRACE
+				StopTrace();
+#endif
+			}
+		}
+
+		void QueueJoin(EntityId entityId)
+		{
+			m_pendingJoins.push_back(entityId);
+		}
+
+		// IGameFrameworkListener
+		virtual void OnPostUpdate(float fDeltaTime) override
+		{
+#if PMOVE_TRACE
+			UpdateTrace();
+#endif
+			UpdateProfile(fDeltaTime);
+			UpdateDemo();
+			UpdateJobPool();
+			if (gEnv->bServer)
+			{
+				UpdateTuning();
+			}
+
+			if (gEnv->bServer && !m_pendingJoins.empty())
+			{
+				FlushJoins();
+			}
+
+			// Ticks run on the input clock, so each one picks up exactly the input made before it ended
+			const int ticks = m_timestep.AdvanceTo(GetInputTime());
+			const float tickInterval = m_timestep.GetTickInterval();
+
+			CPlayerMovementSystem& movementSystem = CPlayerComponent::GetMovementSystem();
+			CMovementValidator& validator = CPlayerComponent::GetMovementValidator();
+			validator.SetEnabled(gEnv->bServer && m_pValidateCVar->GetIVal() != 0);
+			for (int i = 0; i < ticks; ++i)
+			{
+				const double tickEndTime = m_timestep.GetTickEndTime(i);
+				validator.BeginTick();
+				CGamePlugin::GetInstance()->IterateOverPlayers([tickEndTime](CPlayerComponent& player)
+				{
+					player.PrepareMovementTick(tickEndTime);
+				});
+
+				{
+					CMovementProfileScope profileScope(CPlayerComponent::GetMovementProfiler(), EMovementStage::MovementStep);
+					movementSystem.Step(tickInterval);
+				}
+
+				if (validator.IsEnabled())
+				{
+					CMovementProfileScope profileScope(CPlayerComponent::GetMovementProfiler(), EMovementStage::ValidateMovement);
+					validator.Validate(tickInterval, m_pJobPool.get());
+				}
+			}
+
+			CGamePlugin::GetInstance()->IterateOverPlayers([tickInterval](CPlayerComponent& player)
+			{
+				player.ApplyMovement(tickInterval);
+			});
+			SubmitPhysicsWriteBack();
+
+			if (gEnv->bServer && ticks > 0)
+			{
+				m_serverTick += static_cast<uint32>(ticks);
+				RecordHistory();
+				SendSnapshots();
+			}
+		}
+		virtual void OnSaveGame(ISaveGame* pSaveGame) override {}
+		virtual void OnLoadGame(ILoadGame* pLoadGame) override {}
+		virtual void OnLevelEnd(const char* nextLevel) override {}
+		virtual void OnActionEvent(const SActionEvent& event) override {}
+		// ~IGameFrameworkListener
+
+	private:
+		// One call into physics per player, in one pass after all of them applied their movement
+		void SubmitPhysicsWriteBack()
+		{
+			CMovementProfiler& profiler = CPlayerComponent::GetMovementProfiler();
+			CMovementProfileScope profileScope(profiler, EMovementStage::PhysicsWriteBack);
+
+			CPlayerComponent::PhysicsWriteBack& writeBack = CPlayerComponent::GetPhysicsWriteBack();
+			profiler.Count(EMovementCounter::PhysicsCalls, writeBack.GetCount());
+			writeBack.Submit([](Cry::DefaultComponents::CCharacterControllerComponent* pCharacterController, const PMoveVec3& velocity, bool isJump)
+			{
+				// A walk request's vertical part is ignored on the ground, a jump has to set the velocity outright
+				using EChangeVelocityMode = Cry::DefaultComponents::CCharacterControllerComponent::EChangeVelocityMode;
+				pCharacterController->ChangeVelocity(Vec3(velocity.x, velocity.y, velocity.z), isJump ? EChangeVelocityMode::Jump : EChangeVelocityMode::SetAsTarget);
+			});
+		}
+
+		// Revives everyone who became ready since the last frame, then sends one world state per client
+		void FlushJoins()
+		{
+			// Everyone already playing is gathered once, joiners are added as they spawn
+			m_enemyPositions.clear();
+			m_enemyPositions.reserve(m_playerCount);
+			CGamePlugin::GetInstance()->IterateOverPlayers([this](CPlayerComponent& player)
+			{
+				if (player.IsAlive() && std::find(m_pendingJoins.begin(), m_pendingJoins.end(), player.GetEntityId()) == m_pendingJoins.end())
+				{
+					const Vec3 position = player.GetEntity()->GetWorldPos();
+					m_enemyPositions.push_back(PMoveVec3(position.x, position.y, position.z));
+				}
+			});
+
+			// One by one, so each joiner's spawn point accounts for the ones revived before it
+			for (const EntityId entityId : m_pendingJoins)
+			{
+				IEntity* pEntity = gEnv->pEntitySystem->GetEntity(entityId);
+				if (CPlayerComponent* pPlayer = pEntity != nullptr ? pEntity->GetComponent<CPlayerComponent>() : nullptr)
+				{
+					pPlayer->ReviveOnServer(m_enemyPositions.data(), m_enemyPositions.size());
+					const Vec3 position = pEntity->GetWorldPos();
+					m_enemyPositions.push_back(PMoveVec3(position.x, position.y, position.z));
+				}
+			}
+
+			uint32 playerCount = 0;
+			uint32 joinCount = 0;
+			m_joinFanOut.BeginTick();
+			CGamePlugin::GetInstance()->IterateOverPlayers([this, &playerCount, &joinCount](CPlayerComponent& player)
+			{
+				SWorldStatePlayer worldStatePlayer;
+				if (!player.GetWorldStatePlayer(worldStatePlayer))
+					return;
+
+				const bool hasJoined = std::find(m_pendingJoins.begin(), m_pendingJoins.end(), player.GetEntityId()) != m_pendingJoins.end();
+				if (m_joinFanOut.AddPlayer(worldStatePlayer, hasJoined))
+				{
+					m_playerEntityIds[playerCount++] = player.GetEntityId();
+					if (hasJoined)
+					{
+						m_joinerEntityIds[joinCount++] = player.GetEntityId();
+					}
+				}
+			});
+			m_joinFanOut.EndTick();
+
+			// Joiners learn about everyone, everyone else only about the joiners
+			const bool isTuned = m_tuningWatcher.IsWatching();
+			CGamePlugin::GetInstance()->IterateOverPlayers([this, playerCount, joinCount, isTuned](CPlayerComponent& player)
+			{
+				if (std::find(m_pendingJoins.begin(), m_pendingJoins.end(), player.GetEntityId()) != m_pendingJoins.end())
+				{
+					// Ahead of the world state, so the joiner predicts its first tick with the server's tuning
+					if (isTuned)
+					{
+						player.SendTuning(CPlayerComponent::GetMovementSystem().GetDefaultParams());
+					}
+					player.SendWorldState(m_joinFanOut.GetJoinerMessage(), m_joinFanOut.GetJoinerMessageSize(), m_playerEntityIds.data(), playerCount);
+				}
+				else if (joinCount > 0)
+				{
+					player.SendWorldState(m_joinFanOut.GetExistingMessage(), m_joinFanOut.GetExistingMessageSize(), m_joinerEntityIds.data(), joinCount);
+				}
+			});
+
+			m_pendingJoins.clear();
+		}
+
+		void RegisterCVars()
+		{
+			if (m_pRulesetCVar != nullptr)
+				return;
+
+			m_pRulesetCVar = REGISTER_STRING("pm_ruleset", PMoveRulesets::GetDefault().szName, VF_REQUIRE_NET_SYNC, "Movement ruleset: q3, cpma, qw or vq3. Applied on level load.");
+			m_pThreadsCVar = REGISTER_INT("pm_threads", 0, VF_NULL, "Worker threads the movement step of every player is split across, 0 steps on the main thread. Only pays off with hundreds of players.");
+			m_pDemoCVar = REGISTER_STRING("pm_demo", "", VF_NULL, "Records the local player's movement commands into this file while set, replay it with Tools/MovementDemoReplay.cpp");
+			m_pInterestCVar = REGISTER_INT("pm_interest", 1, VF_NULL, "Sends each client only the players near it or in its view, far ones less often. 0 sends every player every snapshot.");
+			m_pProfileCVar = REGISTER_FLOAT("pm_profile", 0.f, VF_NULL, "Seconds between movement profile dumps to movement_profile.jsonl, 0 disables profiling");
+			m_pValidateCVar = REGISTER_INT("pm_validate", 1, VF_NULL, "Server: re-simulates every client's movement and logs players flagged for speed, teleports, a fast clock, scripted jumps or scripted strafing. 0 disables.");
+			m_pTuningCVar = REGISTER_STRING("pm_tuning", "", VF_NULL, "Server: movement tuning profile, \"name = value\" lines of the ruleset's params. Reloaded on every change while set, clients get the values.");
+#if PMOVE_TRACE
+			m_pTraceCVar = REGISTER_INT("pm_trace", 0, VF_NULL, "Writes a binary movement trace of every simulated player to movement_trace.pmt while enabled, decode it with Tools/MovementTraceDump.cpp");
+#endif
+		}
+
+		// Picked once per level by the first player, clients get the server's value when connecting
+		void SelectRuleset()
+		{
+			const SMovementRuleset* pRuleset = PMoveRulesets::Find(m_pRulesetCVar->GetString());
+			if (pRuleset == nullptr)
+			{
+				CryWarning(VALIDATOR_MODULE_GAME, VALIDATOR_WARNING, "Unknown movement ruleset %s, using %s", m_pRulesetCVar->GetString(), PMoveRulesets::GetDefault().szName);
+				pRuleset = &PMoveRulesets::GetDefault();
+			}
+			CPlayerComponent::GetMovementSystem().SetRuleset(*pRuleset);
+			CPlayerComponent::GetMovementValidator().SetRuleset(*pRuleset);
+			// The profile is loaded on top of the new ruleset's defaults
+			m_tuningWatcher.Stop();
+			m_tuningPath.clear();
+		}
+
+		// Follows pm_tuning. The watcher thread reads and parses the profile, picking up its newest version is one atomic load.
+		void UpdateTuning()
+		{
+			CPlayerMovementSystem& movementSystem = CPlayerComponent::GetMovementSystem();
+			const char* szPath = m_pTuningCVar->GetString();
+			if (m_tuningPath != szPath)
+			{
+				const bool wasTuned = m_tuningWatcher.IsWatching();
+				m_tuningWatcher.Stop();
+				m_tuningPath = szPath;
+				m_tuningVersion = 0;
+				if (szPath[0] != '\0')
+				{
+					m_tuningWatcher.Start(szPath, movementSystem.GetRuleset().defaultParams);
+				}
+				else if (wasTuned)
+				{
+					ApplyTuning(movementSystem.GetRuleset().defaultParams);
+				}
+			}
+
+			const SMovementTuningProfile* pProfile = m_tuningWatcher.IsWatching() ? m_tuningWatcher.Acquire() : nullptr;
+			if (pProfile == nullptr || pProfile->version == m_tuningVersion)
+				return;
+
+			m_tuningVersion = pProfile->version;
+			if (pProfile->szError[0] != '\0')
+			{
+				CryWarning(VALIDATOR_MODULE_GAME, VALIDATOR_WARNING, "Movement tuning %s: %s, keeping the current values", m_tuningPath.c_str(), pProfile->szError);
+				return;
+			}
+			ApplyTuning(pProfile->params);
+			CryLog("Movement tuning: %s applied", m_tuningPath.c_str());
+		}
+
+		// Takes effect on the next tick, clients follow once the reliable message arrives
+		void ApplyTuning(const PMoveParams& params)
+		{
+			CPlayerComponent::GetMovementSystem().SetDefaultParams(params);
+			CGamePlugin::GetInstance()->IterateOverPlayers([&params](CPlayerComponent& player)
+			{
+				player.SendTuning(params);
+			});
+		}
+
+#if PMOVE_TRACE
+		// Follows pm_trace, the drain thread only exists while tracing
+		void UpdateTrace()
+		{
+			const bool shouldTrace = m_pTraceCVar->GetIVal() != 0;
+			if (shouldTrace && !PMoveTrace::IsRunning())
+			{
+				if (!PMoveTrace::Start(TraceFileName))
+				{
+					CryWarning(VALIDATOR_MODULE_GAME, VALIDATOR_WARNING, "Can't write the movement trace to %s", TraceFileName);
+					m_pTraceCVar->Set(0);
+				}
+			}
+			else if (!shouldTrace)
+			{
+				StopTrace();
+			}
+		}
+
+		void StopTrace()
+		{
+			if (!PMoveTrace::IsRunning())
+				return;
+
+			PMoveTrace::Stop();
+			CryLog("Movement trace: %llu records written to %s, %llu dropped", static_cast<unsigned long long>(PMoveTrace::GetWrittenCount()), TraceFileName, static_cast<unsigned long long>(PMoveTrace::GetDroppedCount()));
+		}
+#endif
+
+		// Follows pm_threads. Gathering input and handing results to physics touch the engine and stay on the main thread,
+		// only the batch step in between runs on the pool.
+		void UpdateJobPool()
+		{
+			const int threadCount = m_pThreadsCVar->GetIVal();
+			const uint32 workerCount = threadCount > 0 ? static_cast<uint32>(threadCount) : 0;
+			if (workerCount == (m_pJobPool != nullptr ? m_pJobPool->GetWorkerCount() : 0))
+				return;
+
+			CPlayerMovementSystem& movementSystem = CPlayerComponent::GetMovementSystem();
+			movementSystem.SetJobPool(nullptr);
+			m_pJobPool.reset(workerCount > 0 ? new CWorkStealingPool(workerCount) : nullptr);
+			movementSystem.SetJobPool(m_pJobPool.get());
+		}
+
+		// Follows pm_demo, a new file name ends the current demo and starts the next
+		void UpdateDemo()
+		{
+			CMovementDemoWriter& writer = CPlayerComponent::GetDemoWriter();
+			const char* szPath = m_pDemoCVar->GetString();
+			if (writer.IsRecording() && m_demoPath != szPath)
+			{
+				StopDemo();
+			}
+			if (writer.IsRecording() || szPath[0] == '\0')
+				return;
+
+			// Waits for the local player to stand on the ground, replays use that height as the floor
+			SMovementDemoFileHeader header;
+			bool hasHeader = false;
+			CGamePlugin::GetInstance()->IterateOverPlayers([&header, &hasHeader](CPlayerComponent& player)
+			{
+				hasHeader = hasHeader || (player.IsLocalClient() && player.GetDemoHeader(header));
+			});
+			if (!hasHeader)
+				return;
+
+			if (!writer.Start(szPath, header))
+			{
+				CryWarning(VALIDATOR_MODULE_GAME, VALIDATOR_WARNING, "Can't write the movement demo to %s", szPath);
+				m_pDemoCVar->Set("");
+				return;
+			}
+			m_demoPath = szPath;
+		}
+
+		void StopDemo()
+		{
+			CMovementDemoWriter& writer = CPlayerComponent::GetDemoWriter();
+			if (!writer.IsRecording())
+				return;
+
+			writer.Stop();
+			CryLog("Movement demo: %llu ticks written to %s, %llu dropped", static_cast<unsigned long long>(writer.GetWrittenCount()), m_demoPath.c_str(), static_cast<unsigned long long>(writer.GetDroppedCount()));
+		}
+
+		// Appends one line per interval while pm_profile is set, every line only covers its own interval
+		void UpdateProfile(float frameTime)
+		{
+			CMovementProfiler& profiler = CPlayerComponent::GetMovementProfiler();
+			const float interval = m_pProfileCVar->GetFVal();
+			if (interval <= 0.f)
+			{
+				if (profiler.IsEnabled())
+				{
+					profiler.SetEnabled(false);
+					profiler.Reset();
+				}
+				return;
+			}
+
+			if (!profiler.IsEnabled())
+			{
+				profiler.Reset();
+				profiler.SetEnabled(true);
+				m_profileTime = 0.f;
+				return;
+			}
+
+			m_profileTime += frameTime;
+			if (m_profileTime < interval)
+				return;
+
+			char json[2048];
+			const size_t length = profiler.WriteJson(json, sizeof(json), m_profileTime);
+			if (FILE* pFile = length > 0 ? fopen(ProfileFileName, "a") : nullptr)
+			{
+				fwrite(json, 1, length, pFile);
+				fputc('\n', pFile);
+				fclose(pFile);
+			}
+			profiler.Reset();
+			m_profileTime = 0.f;
+		}
+
+		// Physics has moved the players by now, ticks that ran within the same frame share one history frame
+		void RecordHistory()
+		{
+			CLagCompensationHistory& history = CPlayerComponent::GetLagCompensationHistory();
+			history.BeginTick(m_serverTick);
+			CGamePlugin::GetInstance()->IterateOverPlayers([&history](CPlayerComponent& player)
+			{
+				player.RecordHistory(history);
+			});
+		}
+
+		// Quantizes all players once, then every client gets the players it is interested in, delta encoded against its own acknowledged snapshot
+		void SendSnapshots()
+		{
+			CMovementProfileScope profileScope(CPlayerComponent::GetMovementProfiler(), EMovementStage::SendSnapshots);
+
+			CInterestManager& interestManager = CPlayerComponent::GetInterestManager();
+			interestManager.SetEnabled(m_pInterestCVar->GetIVal() != 0);
+
+			// Sequenced by server tick, which tells clients when each snapshot was taken
+			m_snapshotEncoder.BeginSnapshot(m_serverTick);
+			interestManager.BeginTick();
+			CGamePlugin::GetInstance()->IterateOverPlayers([this, &interestManager](CPlayerComponent& player)
+			{
+				SSnapshotPlayer snapshotPlayer;
+				if (player.GetSnapshotPlayer(snapshotPlayer) && m_snapshotEncoder.AddPlayer(snapshotPlayer))
+				{
+					interestManager.AddPlayer(snapshotPlayer.id, snapshotPlayer.position, snapshotPlayer.yaw, snapshotPlayer.pitch);
+				}
+			});
+			m_snapshotEncoder.EndSnapshot();
+			interestManager.EndTick();
+
+			CGamePlugin::GetInstance()->IterateOverPlayers([this, &interestManager](CPlayerComponent& player)
+			{
+				player.SendSnapshot(m_snapshotEncoder, interestManager);
+			});
+		}
+
+		int m_playerCount = 0;
+		CFixedTimestep m_timestep;
+		uint32 m_serverTick = 0;
+		CSnapshotEncoder m_snapshotEncoder;
+		std::vector<EntityId> m_pendingJoins;
+		CJoinFanOut m_joinFanOut;
+		std::array<EntityId, PMoveWorldState::MaxPlayers> m_playerEntityIds;
+		std::array<EntityId, PMoveWorldState::MaxPlayers> m_joinerEntityIds;
+		// Players a joiner spawns away from, kept across joins so reviving doesn't allocate
+		std::vector<PMoveVec3> m_enemyPositions;
+		ICVar* m_pRulesetCVar = nullptr;
+		ICVar* m_pThreadsCVar = nullptr;
+		ICVar* m_pInterestCVar = nullptr;
+		ICVar* m_pValidateCVar = nullptr;
+		ICVar* m_pTuningCVar = nullptr;
+		CMovementTuningWatcher m_tuningWatcher;
+		string m_tuningPath;
+		uint32 m_tuningVersion = 0;
+		std::unique_ptr<CWorkStealingPool> m_pJobPool;
+		ICVar* m_pDemoCVar = nullptr;
+		string m_demoPath;
+		static constexpr const char* ProfileFileName = "movement_profile.jsonl";
+		ICVar* m_pProfileCVar = nullptr;
+		float m_profileTime = 0.f;
+#if PMOVE_TRACE
+		static constexpr const char* TraceFileName = "movement_trace.pmt";
+		ICVar* m_pTraceCVar = nullptr;
+#endif
+	};
+
+	static CPlayerMovementUpdater s_movementUpdater;
+
+	// Snapshots received by this client, shared by all player entities
+	CSnapshotDecoder& GetSnapshotDecoder()
+	{
+		static CSnapshotDecoder snapshotDecoder;
+		return snapshotDecoder;
+	}
+}
+
+CPlayerMovementSystem& CPlayerComponent::GetMovementSystem()
+{
+	static CPlayerMovementSystem movementSystem;
+	return movementSystem;
+}
+
+CPlayerComponent::PhysicsWriteBack& CPlayerComponent::GetPhysicsWriteBack()
+{
+	static PhysicsWriteBack physicsWriteBack;
+	return physicsWriteBack;
+}
+
+CMovementProfiler& CPlayerComponent::GetMovementProfiler()
+{
+	static CMovementProfiler movementProfiler;
+	return movementProfiler;
+}
+
+CMovementDemoWriter& CPlayerComponent::GetDemoWriter()
+{
+	static CMovementDemoWriter demoWriter;
+	return demoWriter;
+}
+
+CLagCompensationHistory& CPlayerComponent::GetLagCompensationHistory()
+{
+	static CLagCompensationHistory lagCompensationHistory;
+	return lagCompensationHistory;
+}
+
+CInterestManager& CPlayerComponent::GetInterestManager()
+{
+	static CInterestManager interestManager;
+	return interestManager;
+}
+
+CMovementValidator& CPlayerComponent::GetMovementValidator()
+{
+	static CMovementValidator movementValidator;
+	return movementValidator;
 }
 
 void CPlayerComponent::Initialize()
@@ -33,8 +559,14 @@ void CPlayerComponent::Initialize()
 	// Mark the entity to be replicated over the network
 	m_pEntity->GetNetEntity()->BindToNetwork();
 	
-	// Register the RemoteReviveOnClient function as a Remote Method Invocation (RMI) that can be executed by the server on clients
-	SRmi<RMI_WRAP(&CPlayerComponent::RemoteReviveOnClient)>::Register(this, eRAT_NoAttach, false, eNRT_ReliableOrdered);
+	// Register the ReceiveWorldStateOnClient function as a Remote Method Invocation (RMI) that can be executed by the server on clients
+	SRmi<RMI_WRAP(&CPlayerComponent::ReceiveWorldStateOnClient)>::Register(this, eRAT_NoAttach, false, eNRT_ReliableOrdered);
+	// Tuning only changes when a profile is reloaded, and every client has to end up with the last one
+	SRmi<RMI_WRAP(&CPlayerComponent::ReceiveTuningOnClient)>::Register(this, eRAT_NoAttach, false, eNRT_ReliableOrdered);
+	// Snapshots are superseded every tick, a lost one is simply covered by the next
+	SRmi<RMI_WRAP(&CPlayerComponent::ReceiveSnapshotOnClient)>::Register(this, eRAT_NoAttach, false, eNRT_UnreliableUnordered);
+	// Commands are repeated across packets, so they don't need reliable delivery either
+	SRmi<RMI_WRAP(&CPlayerComponent::ReceiveCmdsOnServer)>::Register(this, eRAT_NoAttach, true, eNRT_UnreliableUnordered);
 	pe_player_dynamics params;
 	//params.gravity = ZERO;
 	params.kInertia = 0;
@@ -43,6 +575,21 @@ void CPlayerComponent::Initialize()
 	params.kAirControl = 3;
 	GetEntity()->GetPhysics()->SetParams(&params);
 	// Process mouse input to update look orientation.
+
+	// Register with the batched movement solver, stays inactive until revived. The first player selects the ruleset.
+	s_movementUpdater.AddPlayer();
+	m_movementHandle = GetMovementSystem().Add();
+	GetMovementSystem().SetAlive(m_movementHandle, false);
+}
+
+void CPlayerComponent::OnShutDown()
+{
+	if (m_movementHandle != CPlayerMovementSystem::InvalidHandle)
+	{
+		GetMovementSystem().Remove(m_movementHandle);
+		m_movementHandle = CPlayerMovementSystem::InvalidHandle;
+		s_movementUpdater.RemovePlayer();
+	}
 }
 
 void CPlayerComponent::InitializeLocalPlayer()
@@ -50,6 +597,10 @@ void CPlayerComponent::InitializeLocalPlayer()
 	// Create the camera component, will automatically update the viewport every frame
 	m_pCameraComponent = m_pEntity->GetOrCreateComponent<Cry::DefaultComponents::CCameraComponent>();
 
+	// Deltas from a previous session can't be applied anymore
+	GetSnapshotDecoder().Reset();
+	m_ackedSnapshotSequence = 0;
+
 	// Create the audio listener component.
 	m_pAudioListenerComponent = m_pEntity->GetOrCreateComponent<Cry::Audio::DefaultComponents::CListenerComponent>();
 
@@ -70,20 +621,26 @@ void CPlayerComponent::InitializeLocalPlayer()
 	m_pInputComponent->RegisterAction("player", "moveback", [this](int activationMode, float value) { HandleInputFlagChange(EInputFlag::MoveBack, (EActionActivationMode)activationMode);  }); 
 	m_pInputComponent->BindAction("player", "moveback", eAID_KeyboardMouse, EKeyId::eKI_S);
 
-	m_pInputComponent->RegisterAction("player", "mouse_rotateyaw", [this](int activationMode, float value) { m_mouseDeltaRotation.x -= value; });
+	m_pInputComponent->RegisterAction("player", "mouse_rotateyaw", [this](int activationMode, float value) {
+		m_mouseDeltaRotation.x -= value;
+		m_inputTimeline.PushLook(GetInputTime(), -value * m_rotationSpeed, 0.f);
+		}
+	);
 	m_pInputComponent->BindAction("player", "mouse_rotateyaw", eAID_KeyboardMouse, EKeyId::eKI_MouseX);
 
-	m_pInputComponent->RegisterAction("player", "mouse_rotatepitch", [this](int activationMode, float value) { m_mouseDeltaRotation.y -= value; });
+	m_pInputComponent->RegisterAction("player", "mouse_rotatepitch", [this](int activationMode, float value) {
+		m_mouseDeltaRotation.y -= value;
+		m_inputTimeline.PushLook(GetInputTime(), 0.f, -value * m_rotationSpeed);
+		}
+	);
 	m_pInputComponent->BindAction("player", "mouse_rotatepitch", eAID_KeyboardMouse, EKeyId::eKI_MouseY);
 
 	m_pInputComponent->RegisterAction("player", "jump", [this](int activationMode, float value) {
-		if (activationMode == eAAM_OnPress) {
-			wishJump = true;
-		}
-		else if (activationMode == eAAM_OnRelease) {
-			wishJump = false;
+		HandleInputFlagChange(EInputFlag::Jump, (EActionActivationMode)activationMode);
+		if (activationMode == eAAM_OnPress)
+		{
+			TraceMovement(EMovementTraceEvent::JumpPressed);
 		}
-		OutputDebugString("Jump pressed");
 		}
 	);
 
@@ -93,38 +650,50 @@ void CPlayerComponent::InitializeLocalPlayer()
 
 Cry::Entity::EventFlags CPlayerComponent::GetEventMask() const
 {
-	return
+	Cry::Entity::EventFlags flags =
 		Cry::Entity::EEvent::BecomeLocalPlayer |
-		Cry::Entity::EEvent::Update |
 		Cry::Entity::EEvent::Reset;
+
+	// Dead and resting players drop out of the entity system's update list, instead of being dispatched every frame to return
+	if (m_isAlive && !m_isResting)
+	{
+		flags |= Cry::Entity::EEvent::Update;
+	}
+	// Resting players only listen for being moved or hit by something other than their own commands
+	if (m_isAlive && m_isResting)
+	{
+		flags |= Cry::Entity::EEvent::TransformChanged | Cry::Entity::EEvent::PhysicsCollision;
+	}
+	return flags;
 }
 void CPlayerComponent::Update(float frameTime) {
 	// Start by updating the movement request we want to send to the character controller
 	// This results in the physical representation of the character moving
 	m_frametime = frameTime;
 	
+	if (!IsSimulatedLocally())
+	{
+		UpdateRemotePlayer();
+	}
 	
-	UpdateLookDirectionRequest(frameTime);
+	CMovementProfiler& profiler = GetMovementProfiler();
+	{
+		CMovementProfileScope profileScope(profiler, EMovementStage::LookDirection);
+		UpdateLookDirectionRequest(frameTime);
+	}
 
 	// Update the animation state of the character
-	UpdateLookRotationZ(frameTime);
+	{
+		CMovementProfileScope profileScope(profiler, EMovementStage::LookRotation);
+		UpdateLookRotationZ(frameTime);
+	}
 
 	if (IsLocalClient())
 	{
 		// Update the camera component offset
+		CMovementProfileScope profileScope(profiler, EMovementStage::Camera);
 		UpdateCamera(frameTime);
 	}
-
-	QueueJump();
-	if (m_pCharacterController->IsOnGround()) {
-		GroundMove();
-		OutputDebugString("\nOn the ground! GroundMoving");
-	}
-	else if (!m_pCharacterController->IsOnGround()) {
-		AirMove();
-		OutputDebugString("\nNot on ground! not groundmoving.");
-	}
-
 }
 void CPlayerComponent::ProcessEvent(const SEntityEvent& event)
 {
@@ -137,80 +706,58 @@ void CPlayerComponent::ProcessEvent(const SEntityEvent& event)
 	break;
 	case Cry::Entity::EEvent::Update:
 	{
-		// Don't update the player if we haven't spawned yet
-		if(!m_isAlive)
-			return;
-		
+		// Only received while alive and not resting, see GetEventMask
 		const float frameTime = event.fParam[0];
 		Update(frameTime);
 
 	}
 	break;
+	case Cry::Entity::EEvent::TransformChanged:
+	{
+		// Physics may still post steps that leave a resting player in place, only moving it wakes it
+		if (GetEntity()->GetWorldPos().GetSquaredDistance(m_restPosition) > RestWakeDistance * RestWakeDistance)
+		{
+			WakeMovement();
+		}
+	}
+	break;
+	case Cry::Entity::EEvent::PhysicsCollision:
+	{
+		// Hit by something while resting, see GetEventMask
+		WakeMovement();
+	}
+	break;
 	case Cry::Entity::EEvent::Reset:
 	{
 		// Disable player when leaving game mode.
 		m_isAlive = event.nParam[0] != 0;
+		m_isResting = false;
+		GetMovementSystem().SetAlive(m_movementHandle, m_isAlive && IsSimulatedLocally());
+		m_pEntity->UpdateComponentEventMask(this);
 	}
 	break;
 	}
 }
 
-bool CPlayerComponent::NetSerialize(TSerialize ser, EEntityAspects aspect, uint8 profile, int flags)
-{
-	if(aspect == InputAspect)
-	{
-		ser.BeginGroup("PlayerInput");
-
-		const CEnumFlags<EInputFlag> prevInputFlags = m_inputFlags;
-
-		ser.Value("m_inputFlags", m_inputFlags.UnderlyingValue(), 'ui8');
-
-		if (ser.IsReading())
-		{
-			const CEnumFlags<EInputFlag> changedKeys = prevInputFlags ^ m_inputFlags;
-
-			const CEnumFlags<EInputFlag> pressedKeys = changedKeys & prevInputFlags;
-			if (!pressedKeys.IsEmpty())
-			{
-				HandleInputFlagChange(pressedKeys, eAAM_OnPress);
-			}
-
-			const CEnumFlags<EInputFlag> releasedKeys = changedKeys & prevInputFlags;
-			if (!releasedKeys.IsEmpty())
-			{
-				HandleInputFlagChange(pressedKeys, eAAM_OnRelease);
-			}
-		}
-
-		// Serialize the player look orientation
-		ser.Value("m_lookOrientation", m_lookOrientation, 'ori3');
-
-		ser.EndGroup();
-	}
-
-	return true;
-}
-
-
-void CPlayerComponent::SetMovementDir()
+void CPlayerComponent::SetMovementDir(const CEnumFlags<EInputFlag> inputFlags)
 {
 
 	_cmd.rightMove = 0;
 	_cmd.forwardMove = 0;
 
-	if (m_inputFlags & EInputFlag::MoveLeft)
+	if (inputFlags & EInputFlag::MoveLeft)
 	{
 		_cmd.rightMove -= 1;
 	}
-	if (m_inputFlags & EInputFlag::MoveRight)
+	if (inputFlags & EInputFlag::MoveRight)
 	{
 		_cmd.rightMove += 1;
 	}
-	if (m_inputFlags & EInputFlag::MoveForward)
+	if (inputFlags & EInputFlag::MoveForward)
 	{
 		_cmd.forwardMove += 1;
 	}
-	if (m_inputFlags & EInputFlag::MoveBack)
+	if (inputFlags & EInputFlag::MoveBack)
 	{
 		_cmd.forwardMove -= 1;
 	}
@@ -220,229 +767,463 @@ void CPlayerComponent::SetMovementDir()
 
 }
 
-void CPlayerComponent::QueueJump() {
-		//wishJump = (m_inputFlags & EInputFlag::Jump) ? true : false;
+void CPlayerComponent::QueueJump(const CEnumFlags<EInputFlag> inputFlags) {
+		_cmd.jump = (inputFlags & EInputFlag::Jump) ? true : false;
 }
 
-void CPlayerComponent::AirMove() {
-	Vec3 wishdir;
-	//float wishvel = airAcceleration;
-	float accel;
+void CPlayerComponent::UpdateGroundContact()
+{
+	pe_status_living living;
+	if (GetEntity()->GetPhysics()->GetStatus(&living) == 0)
+	{
+		m_groundContact = PMoveGroundContact();
+		return;
+	}
+
+	PMoveGroundContact& ground = m_groundContact;
+	const bool isTouching = living.bFlying == 0;
+	ground.normal = isTouching ? PMoveVec3(living.groundSlope.x, living.groundSlope.y, living.groundSlope.z) : PMoveVec3(0.f, 0.f, 1.f);
+	ground.distance = GetEntity()->GetWorldPos().z - living.groundHeight;
+	ground.onGround = isTouching && ground.normal.z >= PMove::MinWalkNormal;
+	ground.onSteepPlane = isTouching && !ground.onGround;
+
+	// Friction is relative to the default surface, so ordinary ground moves exactly as before
+	ground.surfaceFriction = 1.f;
+	float bounciness, friction, defaultFriction;
+	unsigned int flags;
+	if (isTouching
+		&& gEnv->pPhysicalWorld->GetSurfaceParameters(living.groundSurfaceIdx, bounciness, friction, flags)
+		&& gEnv->pPhysicalWorld->GetSurfaceParameters(0, bounciness, defaultFriction, flags)
+		&& defaultFriction > 0.f)
+	{
+		ground.surfaceFriction = friction / defaultFriction;
+	}
+}
+
+void CPlayerComponent::PrepareMovementTick(double tickEndTime)
+{
+	CMovementProfiler& profiler = GetMovementProfiler();
+	if (!m_isAlive)
+	{
+		profiler.Count(EMovementCounter::DeadTicks);
+		return;
+	}
+	if (!IsSimulatedLocally())
+		return;
 
-	SetMovementDir();
-	wishdir = Vec3(_cmd.rightMove, _cmd.forwardMove, 0);
-	wishdir = GetEntity()->GetWorldRotation() * wishdir;
+	CMovementProfileScope profileScope(profiler, EMovementStage::PrepareTick);
 
-	float wishspeed = wishdir.GetLength();
-	wishspeed *= m_moveSpeed;
+	if (IsLocalClient())
+	{
+		// The buttons and view as they were when the tick ended, a jump tapped within the tick still counts
+		const STickInput tickInput = m_inputTimeline.Consume(tickEndTime, m_tickLookAngles);
+		SetMovementDir(CEnumFlags<EInputFlag>(static_cast<EInputFlag>(tickInput.buttons)));
+		QueueJump(CEnumFlags<EInputFlag>(static_cast<EInputFlag>(tickInput.buttons | tickInput.pressedButtons)));
 
-	wishdir.Normalize();
-	moveDirectionNorm = wishdir;
+		_cmd.yaw = m_tickLookAngles.GetYaw();
+		_cmd.pitch = m_tickLookAngles.GetPitch();
+	}
+	else
+	{
+		// Remote player on the server, simulate exactly the commands the client predicted with
+		const Cmd previousCmd = _cmd;
+		_cmd = m_serverCmdQueue.Pop();
+		if (m_isResting)
+		{
+			// Still idle and looking the same way, the tick would leave everything as it is
+			if (PMove::IsAtRest(GetMovementSystem().GetState(m_movementHandle), _cmd) && _cmd.yaw == previousCmd.yaw && _cmd.pitch == previousCmd.pitch)
+			{
+				profiler.Count(EMovementCounter::RestingTicks);
+				return;
+			}
+			SetResting(false);
+		}
+		m_lookAngles.Set(_cmd.yaw, _cmd.pitch, 0.f);
+	}
 
-	//Aircontrol
-	float wishspeed2 = wishspeed;
-	if (playerVelocity.dot(wishdir) < 0) {
-		accel = airDecceleration;
+	// The only ground query of the tick, everything after reads the cached contact.
+	// Physics only steps once per frame, after a tick of this frame jumped the ground under the entity is from before the jump.
+	if (GetMovementSystem().HasPendingJump(m_movementHandle))
+	{
+		m_groundContact = PMoveGroundContact();
 	}
-	else {
-		accel = airAcceleration;
+	else
+	{
+		UpdateGroundContact();
+		profiler.Count(EMovementCounter::PhysicsCalls);
 	}
-	if (_cmd.forwardMove == 0 && _cmd.rightMove != 0) {
-		if (wishspeed > sideStrafeSpeed) {
-			wishspeed = sideStrafeSpeed;
+	const bool onGround = m_groundContact.onGround;
+
+	if (IsLocalClient())
+	{
+		_cmd.sequence = ++m_cmdSequence;
+		if (!gEnv->bServer)
+		{
+			// Predict with the command as the server will decode it
+			_cmd = PMoveCmdBatch::Quantize(_cmd);
+			m_cmdBatchWriter.Push(_cmd);
+			if (++m_ticksSinceCmdSend >= CmdSendInterval)
+			{
+				SendCmds();
+				m_ticksSinceCmdSend = 0;
+			}
 		}
-		accel = sideStrafeAcceleration;
+		m_movementPredictor.Record(_cmd, m_groundContact);
 	}
-	Accelerate(wishdir, wishspeed, accel);
-	if (airControl > 0) {
-		AirControl(wishdir, wishspeed2);
+
+	GetMovementSystem().SetInput(m_movementHandle, _cmd, _cmd.yaw, m_groundContact);
+	if (!IsLocalClient())
+	{
+		RecordValidation(tickEndTime);
+	}
+	TraceMovement(EMovementTraceEvent::Tick);
+	if (IsLocalClient())
+	{
+		GetDemoWriter().Push(_cmd, onGround);
+	}
+
+	if (profiler.IsEnabled())
+	{
+		// A ground move that doesn't jump right away applies friction
+		profiler.Count(onGround ? EMovementCounter::GroundTicks : EMovementCounter::AirTicks);
+		if (onGround && !GetMovementSystem().GetState(m_movementHandle).wishJump)
+		{
+			profiler.Count(EMovementCounter::FrictionTicks);
+		}
 	}
-	playerVelocity.z -= gravity * m_frametime;
-	pe_action_move moveAction;
-	
-	moveAction.dir = playerVelocity * m_frametime;
-	//GetEntity()->GetPhysics()->Action(&moveAction);
-	m_pCharacterController->SetVelocity(playerVelocity * m_frametime);
 }
 
-void CPlayerComponent::Accelerate(Vec3 wishdir, float wishspeed, float accel)
+void CPlayerComponent::RecordValidation(double tickEndTime)
 {
-	float addspeed, accelspeed, currentspeed;
+	CMovementValidator& validator = GetMovementValidator();
+	if (!validator.IsEnabled() || m_snapshotId >= CMovementValidator::MaxPlayers)
+		return;
+
+	// Flagged by the previous tick's validation, every anomaly is logged once per life
+	const uint8 newFlags = validator.GetReport(m_snapshotId).flags & ~m_reportedAnomalies;
+	for (uint32 i = 0; i < static_cast<uint32>(EMovementAnomaly::Count); ++i)
+	{
+		const EMovementAnomaly anomaly = static_cast<EMovementAnomaly>(i);
+		if (newFlags & SMovementValidationReport::GetFlag(anomaly))
+		{
+			CryWarning(VALIDATOR_MODULE_GAME, VALIDATOR_WARNING, "Movement validation flagged %s for %s", m_pEntity->GetName(), CMovementValidator::GetAnomalyName(anomaly));
+		}
+	}
+	m_reportedAnomalies |= newFlags;
+
+	const CPlayerMovementSystem& movementSystem = GetMovementSystem();
+	const Vec3 position = GetEntity()->GetWorldPos();
+
+	SMovementValidationInput input;
+	input.cmd = _cmd;
+	input.state = movementSystem.GetState(m_movementHandle);
+	input.params = movementSystem.GetParams(m_movementHandle);
+	input.position = PMoveVec3(position.x, position.y, position.z);
+	input.time = tickEndTime;
+	input.newestCmdSequence = m_serverCmdQueue.GetNewestSequence();
+	validator.Record(m_snapshotId, input);
+}
 
-	currentspeed = playerVelocity.dot(wishdir);
-	addspeed = wishspeed - currentspeed;
-	if (addspeed <= 0)
+void CPlayerComponent::SetResting(bool isResting)
+{
+	if (m_isResting == isResting)
 		return;
-	accelspeed = accel * m_frametime * wishspeed;
-	if (accelspeed > addspeed)
-		accelspeed = addspeed;
-	playerVelocity.x += accelspeed * wishdir.x;
-	playerVelocity.y += accelspeed * wishdir.y;
 
+	m_isResting = isResting;
+	m_restPosition = GetEntity()->GetWorldPos();
+	GetMovementSystem().SetAlive(m_movementHandle, m_isAlive && !m_isResting && IsSimulatedLocally());
+	m_pEntity->UpdateComponentEventMask(this);
 }
 
-void CPlayerComponent::AirControl(Vec3 wishdir, float wishspeed)
+void CPlayerComponent::SendCmds()
 {
-	float zspeed, speed, dot, k;
-	if (_cmd.forwardMove == 0 || wishspeed == 0) {
+	CmdBatchParams params;
+	params.size = static_cast<uint16>(m_cmdBatchWriter.Write(m_ackedSnapshotSequence, params.data.data(), params.data.size()));
+	if (params.size == 0)
 		return;
-	}
-	zspeed = playerVelocity.z;
-	playerVelocity.z = 0;
-	speed = playerVelocity.GetLength();
-	playerVelocity.Normalize();
 
-	dot = playerVelocity.dot(wishdir);
-	k = 32;
-	k *= airControl * dot * dot * m_frametime;
+	SRmi<RMI_WRAP(&CPlayerComponent::ReceiveCmdsOnServer)>::InvokeOnServer(this, std::move(params));
+}
+
+bool CPlayerComponent::ReceiveCmdsOnServer(CmdBatchParams&& params, INetChannel* pNetChannel)
+{
+	// Only the owning client may drive this player
+	if (gEnv->pGameFramework->GetGameChannelId(pNetChannel) != m_pEntity->GetNetEntity()->GetChannelId())
+		return true;
+
+	SCmdBatch batch;
+	if (!PMoveCmdBatch::Read(params.data.data(), params.size, batch))
+		return true;
+
+	// Commands repeat across packets, the queue drops every sequence it already has
+	for (uint32 i = 0; i < batch.cmdCount; ++i)
+	{
+		m_serverCmdQueue.Receive(batch.cmds[i]);
+	}
 
-	if (dot > 0)
+	if (static_cast<int32>(batch.snapshotAck - m_ackedSnapshotSequence) > 0)
 	{
-		playerVelocity.x = playerVelocity.x * speed + wishdir.x * k;
-		playerVelocity.y = playerVelocity.y * speed + wishdir.y * k;
-		playerVelocity.z = playerVelocity.z * speed + wishdir.z * k;
-		
-		playerVelocity.Normalize();
-		moveDirectionNorm = playerVelocity;
+		m_ackedSnapshotSequence = batch.snapshotAck;
 	}
 
-	playerVelocity.x *= speed;
-	playerVelocity.z = zspeed;
-	playerVelocity.y *= speed;
+	return true;
 }
 
-void CPlayerComponent::GroundMove() {
-	Vec3 wishdir;
-	
-	if (!wishJump)
-		ApplyFriction(1.0f);
-	else {
+void CPlayerComponent::ReconcileMovement(uint32 ackedSequence, const PMoveState& serverState, const Vec3& serverPosition)
+{
+	CMovementProfileScope profileScope(GetMovementProfiler(), EMovementStage::Reconcile);
+	CPlayerMovementSystem& movementSystem = GetMovementSystem();
+	const float tickInterval = 1.f / CFixedTimestep::DefaultTickRate;
 
-		OutputDebugString("\nI desire to jump\n");
-		ApplyFriction(0);
+	PMoveState predictedState;
+	if (m_movementPredictor.Reconcile(ackedSequence, serverState, movementSystem.GetParams(m_movementHandle), tickInterval, predictedState, movementSystem.GetRuleset().pMove))
+	{
+		movementSystem.SetState(m_movementHandle, predictedState);
 	}
-	SetMovementDir();
-
-	wishdir = Vec3(_cmd.rightMove, _cmd.forwardMove, 0);
-	wishdir = GetEntity()->GetWorldRotation() * wishdir;
-	wishdir.Normalize();
-	moveDirectionNorm = wishdir;
 
-	float wishspeed = wishdir.GetLength();
-	wishspeed *= m_moveSpeed;
-
-	Accelerate(wishdir, wishspeed, runAcceleration);
-	
-	playerVelocity.z = 0;
-	pe_action_move moveAction;
-	moveAction.dir = playerVelocity * m_frametime;
-	if (wishJump) {
-		pe_action_impulse jumpAction;
-		jumpAction.impulse.z = 800;
-		GetEntity()->GetPhysics()->Action(&jumpAction);
-		wishJump = false;
+	// Replaces the previous correction, positions recorded since then already include what was applied of it
+	PMoveVec3 positionError;
+	if (m_movementPredictor.GetPositionError(ackedSequence, PMoveVec3(serverPosition.x, serverPosition.y, serverPosition.z), positionError))
+	{
+		m_positionCorrection = Vec3(positionError.x, positionError.y, positionError.z);
 	}
-	//GetEntity()->GetPhysics()->Action(&moveAction);
-	m_pCharacterController->SetVelocity(playerVelocity * m_frametime);
+}
+
+#if PMOVE_TRACE
+void CPlayerComponent::TraceMovement(EMovementTraceEvent event) const
+{
+	if (!PMoveTrace::IsRunning())
+		return;
 
+	const CPlayerMovementSystem& movementSystem = GetMovementSystem();
+	const PMoveState state = movementSystem.GetState(m_movementHandle);
+	PMoveVec3 wishDir = PMove::GetWishDir(_cmd, _cmd.yaw);
+	wishDir.Normalize();
 
+	SMovementTraceRecord record;
+	record.tick = _cmd.sequence;
+	record.entityId = GetEntityId();
+	record.speed = std::sqrt(state.velocity.x * state.velocity.x + state.velocity.y * state.velocity.y);
+	if (event == EMovementTraceEvent::Tick)
+	{
+		record.frictionDrop = PMove::GetFrictionDrop(state, movementSystem.GetParams(m_movementHandle), state.wishJump ? 0.f : 1.f, 1.f / CFixedTimestep::DefaultTickRate);
+	}
+	record.wishDirX = static_cast<int16>(wishDir.x * PMoveTrace::WishDirScale);
+	record.wishDirY = static_cast<int16>(wishDir.y * PMoveTrace::WishDirScale);
+	record.event = event;
+	record.flags = (state.onGround ? eMovementTraceFlag_OnGround : 0) | (state.wishJump ? eMovementTraceFlag_WishJump : 0) | (state.jumpHeld ? eMovementTraceFlag_JumpHeld : 0);
+	PMoveTrace::Push(record);
 }
+#else
+void CPlayerComponent::TraceMovement(EMovementTraceEvent) const {}
+#endif
 
-void CPlayerComponent::ApplyFriction(float t) {
-	Vec3 vec = playerVelocity;
-	float speed, newspeed, control, drop;
-	vec.y = 0.0f;
-	speed = vec.GetLength();
-	drop = 0.0f;
+void CPlayerComponent::ApplyMovement(float tickInterval)
+{
+	if (!m_isAlive || m_isResting || !IsSimulatedLocally())
+		return;
+
+	CMovementProfiler& profiler = GetMovementProfiler();
+	CMovementProfileScope profileScope(profiler, EMovementStage::ApplyMovement);
 
-	if (m_pCharacterController->IsOnGround()) {
-		control = speed < runDeacceleration ? runDeacceleration : speed;
-		drop = control * friction * m_frametime * t;
+	CPlayerMovementSystem& movementSystem = GetMovementSystem();
+	float jumpSpeed = 0.f;
+	if (movementSystem.ConsumeJump(m_movementHandle)) {
+		// Handed over as a jump with the velocity instead of an impulse call of its own, the speed the impulse gave the standing entity
+		jumpSpeed = movementSystem.GetParams(m_movementHandle).jumpImpulse / m_physicsMass;
+		TraceMovement(EMovementTraceEvent::Jumped);
+		profiler.Count(EMovementCounter::Jumps);
 	}
-	newspeed = speed - drop;
-	playerFriction = newspeed;
-	if (newspeed < 0) {
-		newspeed = 0;
+
+	const PMoveState state = movementSystem.GetState(m_movementHandle);
+	GetPhysicsWriteBack().Push(m_pCharacterController, state.velocity * tickInterval, jumpSpeed);
+
+	if (gEnv->bServer && !IsLocalClient() && PMove::IsAtRest(state, _cmd))
+	{
+		// Physics is told to stand still this frame, nothing changes until the client presses something or turns
+		SetResting(true);
 	}
-	if (speed > 0) {
-		newspeed /= speed;
+
+	if (!gEnv->bServer && IsLocalClient())
+	{
+		// Smooth out prediction errors, only teleport-sized errors snap
+		const float snapDistance = 4.f;
+		const float correctionRate = 0.1f;
+		const Vec3 correction = m_positionCorrection.GetLengthSquared() > snapDistance * snapDistance ? m_positionCorrection : m_positionCorrection * correctionRate;
+		if (!correction.IsZero())
+		{
+			GetEntity()->SetPos(GetEntity()->GetWorldPos() + correction);
+			m_positionCorrection -= correction;
+			profiler.Count(EMovementCounter::PhysicsCalls);
+		}
+
+		const Vec3 position = GetEntity()->GetWorldPos();
+		m_movementPredictor.RecordPosition(m_cmdSequence, PMoveVec3(position.x, position.y, position.z));
 	}
-	playerVelocity.x *= newspeed;
-	playerVelocity.y *= newspeed;
 }
-void CPlayerComponent::UpdateLookDirectionRequest(float frameTime)
+
+bool CPlayerComponent::GetSnapshotPlayer(SSnapshotPlayer& player) const
 {
-	const float rotationSpeed = 0.002f;
-	const float rotationLimitsMinPitch = -0.84f;
-	const float rotationLimitsMaxPitch = 1.5f;
-	
-	// Update angular velocity metrics
-	m_horizontalAngularVelocity = (m_mouseDeltaRotation.x * rotationSpeed) / frameTime;
-	m_averagedHorizontalAngularVelocity.Push(m_horizontalAngularVelocity);
+	if (!m_isAlive || m_snapshotId == InvalidSnapshotId)
+		return false;
+
+	const PMoveState state = GetMovementSystem().GetState(m_movementHandle);
+	const Vec3 position = GetEntity()->GetWorldPos();
+
+	player.id = m_snapshotId;
+	player.position = PMoveVec3(position.x, position.y, position.z);
+	player.velocity = state.velocity;
+	player.yaw = m_lookAngles.GetYaw();
+	player.pitch = m_lookAngles.GetPitch();
+	player.onGround = m_groundContact.onGround;
+	player.wishJump = state.wishJump;
+	player.jumpHeld = state.jumpHeld;
+	return true;
+}
 
-	if (m_mouseDeltaRotation.IsEquivalent(ZERO, MOUSE_DELTA_TRESHOLD))
+bool CPlayerComponent::GetDemoHeader(SMovementDemoFileHeader& header) const
+{
+	if (!m_isAlive || !IsSimulatedLocally() || !m_groundContact.onGround)
+		return false;
+
+	const CPlayerMovementSystem& movementSystem = GetMovementSystem();
+	const PMoveState state = movementSystem.GetState(m_movementHandle);
+	const Vec3 position = GetEntity()->GetWorldPos();
+
+	header = SMovementDemoFileHeader();
+	cry_strcpy(header.ruleset, movementSystem.GetRuleset().szName);
+	header.params = movementSystem.GetParams(m_movementHandle);
+	header.startPosition = PMoveVec3(position.x, position.y, position.z);
+	header.startVelocity = state.velocity;
+	header.startFlags = eMovementDemoFlag_OnGround | (state.wishJump ? eMovementDemoFlag_WishJump : 0) | (state.jumpHeld ? eMovementDemoFlag_JumpHeld : 0);
+	return true;
+}
+
+void CPlayerComponent::RecordHistory(CLagCompensationHistory& history) const
+{
+	// Snapshot ids are small server assigned numbers, they double as history slots
+	if (!m_isAlive || m_snapshotId >= CLagCompensationHistory::MaxPlayers)
 		return;
 
-	// Start with updating look orientation from the latest input
-	Ang3 ypr = CCamera::CreateAnglesYPR(Matrix33(m_lookOrientation));
+	const Vec3 position = GetEntity()->GetWorldPos();
+
+	SPlayerHistorySample sample;
+	sample.position = PMoveVec3(position.x, position.y, position.z);
+	sample.yaw = m_lookAngles.GetYaw();
+	sample.pitch = m_lookAngles.GetPitch();
+	sample.onGround = m_groundContact.onGround;
+	history.Record(m_snapshotId, sample);
+}
+
+void CPlayerComponent::SendSnapshot(const CSnapshotEncoder& encoder, CInterestManager& interestManager)
+{
+	// Only players owned by a remote client receive snapshots, the server's own player already has the authoritative state
+	const int channelId = m_pEntity->GetNetEntity()->GetChannelId();
+	if (IsLocalClient() || channelId == 0)
+		return;
 
-	// Yaw
-	ypr.x += m_mouseDeltaRotation.x * rotationSpeed;
+	SnapshotParams params;
+	params.ackedCmdSequence = m_serverCmdQueue.GetLastProcessedSequence();
+	params.size = static_cast<uint16>(interestManager.WriteSnapshot(m_snapshotId, encoder, m_ackedSnapshotSequence, params.data.data(), params.data.size()));
+	if (params.size == 0)
+		return;
 
-	// Pitch
-	// TODO: Perform soft clamp here instead of hard wall, should reduce rot speed in this direction when close to limit.
-	ypr.y = CLAMP(ypr.y + m_mouseDeltaRotation.y * rotationSpeed, rotationLimitsMinPitch, rotationLimitsMaxPitch);
+	SRmi<RMI_WRAP(&CPlayerComponent::ReceiveSnapshotOnClient)>::InvokeOnClient(this, std::move(params), channelId);
+}
 
-	// Roll (skip)
-	ypr.z = 0;
+bool CPlayerComponent::ReceiveSnapshotOnClient(SnapshotParams&& params, INetChannel* pNetChannel)
+{
+	CSnapshotDecoder& snapshotDecoder = GetSnapshotDecoder();
+	if (!snapshotDecoder.Read(params.data.data(), params.size))
+		return true;
 
-	m_lookOrientation = Quat(CCamera::CreateOrientationYPR(ypr));
+	m_ackedSnapshotSequence = snapshotDecoder.GetSequence();
 
-	// Reset the mouse delta accumulator every frame
-	m_mouseDeltaRotation = ZERO;
+	const uint32 ackedCmdSequence = params.ackedCmdSequence;
+	const double serverTime = static_cast<double>(snapshotDecoder.GetSequence()) / CFixedTimestep::DefaultTickRate;
+	CGamePlugin::GetInstance()->IterateOverPlayers([&snapshotDecoder, ackedCmdSequence, serverTime](CPlayerComponent& player)
+	{
+		SSnapshotPlayer snapshotPlayer;
+		if (player.m_snapshotId != InvalidSnapshotId && snapshotDecoder.FindPlayer(player.m_snapshotId, snapshotPlayer))
+		{
+			player.ApplySnapshotPlayer(snapshotPlayer, ackedCmdSequence, serverTime);
+		}
+	});
+
+	return true;
 }
 
-void CPlayerComponent::UpdateLookRotationZ(float frameTime) {
-	Ang3 ypr = CCamera::CreateAnglesYPR(Matrix33(m_lookOrientation));
-	ypr.y = 0;
-	ypr.z = 0;
-	const Quat correctedOrientation = Quat(CCamera::CreateOrientationYPR(ypr));
+void CPlayerComponent::ApplySnapshotPlayer(const SSnapshotPlayer& player, uint32 ackedCmdSequence, double serverTime)
+{
+	if (!m_isAlive)
+		return;
 
-	// Send updated transform to the entity, only orientation changes
-	GetEntity()->SetPosRotScale(GetEntity()->GetWorldPos(), correctedOrientation, Vec3(1, 1, 1));
+	if (IsLocalClient())
+	{
+		PMoveState state = GetMovementSystem().GetState(m_movementHandle);
+		state.velocity = player.velocity;
+		state.wishJump = player.wishJump;
+		state.jumpHeld = player.jumpHeld;
+		ReconcileMovement(ackedCmdSequence, state, Vec3(player.position.x, player.position.y, player.position.z));
+		return;
+	}
+
+	// Other players are drawn a little in the past between two snapshots, see UpdateRemotePlayer
+	SInterpolationSample sample;
+	sample.serverTime = serverTime;
+	sample.arrivalTime = gEnv->pTimer->GetAsyncCurTime();
+	sample.position = player.position;
+	sample.velocity = player.velocity;
+	sample.yaw = player.yaw;
+	sample.pitch = player.pitch;
+	sample.onGround = player.onGround;
+	m_remoteInterpolator.Push(sample);
 }
 
-void CPlayerComponent::UpdateCamera(float frameTime)
+void CPlayerComponent::UpdateRemotePlayer()
 {
-	// Start with updating look orientation from the latest input
-	Ang3 ypr = CCamera::CreateAnglesYPR(Matrix33(m_lookOrientation));
+	SInterpolationSample sample;
+	if (!m_remoteInterpolator.Sample(gEnv->pTimer->GetAsyncCurTime(), sample))
+		return;
 
-	ypr.x += m_mouseDeltaRotation.x * m_rotationSpeed;
+	m_lookAngles.Set(sample.yaw, sample.pitch, 0.f);
+	GetEntity()->SetPos(Vec3(sample.position.x, sample.position.y, sample.position.z));
+}
 
-	const float rotationLimitsMinPitch = -0.84f;
-	const float rotationLimitsMaxPitch = 1.5f;
+void CPlayerComponent::UpdateLookDirectionRequest(float frameTime)
+{
+	// Update angular velocity metrics
+	m_horizontalAngularVelocity = (m_mouseDeltaRotation.x * m_rotationSpeed) / frameTime;
+	m_averagedHorizontalAngularVelocity.Push(m_horizontalAngularVelocity);
 
-	// TODO: Perform soft clamp here instead of hard wall, should reduce rot speed in this direction when close to limit.
-	ypr.y = CLAMP(ypr.y + m_mouseDeltaRotation.y * m_rotationSpeed, rotationLimitsMinPitch, rotationLimitsMaxPitch);
-	// Skip roll
-	if (m_bSliding) {
-		ypr.z = m_TiltAngle;
-	}
-	else {
-		ypr.z = 0;
+	if (IsLocalClient())
+	{
+		// The view of the last tick plus the input no tick reached yet, rendering stays as current as the mouse
+		// while movement only sees input by its timestamp. Roll is left to UpdateCamera.
+		m_lookAngles = m_tickLookAngles;
+		m_inputTimeline.ApplyPending(m_lookAngles);
 	}
 
-	m_lookOrientation = Quat(CCamera::CreateOrientationYPR(ypr));
-
-	// Reset every frame
+	// Reset the mouse delta accumulator every frame
 	m_mouseDeltaRotation = ZERO;
+}
+
+void CPlayerComponent::UpdateLookRotationZ(float frameTime) {
+	const Quat correctedOrientation = ToQuat(m_lookAngles.GetYawOrientation());
+
+	// Send updated transform to the entity, only orientation changes
+	GetEntity()->SetPosRotScale(GetEntity()->GetWorldPos(), correctedOrientation, Vec3(1, 1, 1));
+}
+
+void CPlayerComponent::UpdateCamera(float frameTime)
+{
+	// Yaw and pitch follow the input in UpdateLookDirectionRequest, tilt the view while sliding
+	m_lookAngles.SetRoll(m_bSliding ? m_TiltAngle : 0.f);
 
 	// Ignore z-axis rotation, that's set by CPlayerAnimations
-	ypr.x = 0;
-	
 	// Start with changing view rotation to the requested mouse look orientation
 	Matrix34 localTransform = IDENTITY;
-	localTransform.SetRotation33(CCamera::CreateOrientationYPR(ypr));
+	localTransform.SetRotation33(Matrix33(ToQuat(m_lookAngles.GetPitchRollOrientation())));
 	localTransform.SetTranslation(Vec3(0,0,1.9));
 	const float viewOffsetForward = 0.01f;
 
@@ -454,42 +1235,98 @@ void CPlayerComponent::OnReadyForGameplayOnServer()
 {
 	CRY_ASSERT(gEnv->bServer, "This function should only be called on the server!");
 
-	const Matrix34 newTransform = CSpawnPointComponent::GetFirstSpawnPointTransform();
+	s_movementUpdater.QueueJoin(GetEntityId());
+}
+
+void CPlayerComponent::ReviveOnServer(const PMoveVec3* pEnemyPositions, size_t enemyCount)
+{
+	// Spawn as far away from everyone already playing as the level allows
+	const Matrix34 newTransform = CSpawnPointComponent::GetSpawnPointTransform(CSpawnPointRegistry::ESelection::FarthestFromEnemies, pEnemyPositions, enemyCount);
 	
+	// Movement handles are small and unique among the server's players, so they double as snapshot ids
+	m_snapshotId = static_cast<uint16>(m_movementHandle);
+	// The id may have belonged to a client that left, whose snapshots this one never decoded
+	GetInterestManager().ResetViewer(m_snapshotId);
+	// Spawning moves the player and restarts its commands, nothing validated before carries over
+	GetMovementValidator().ResetPlayer(m_snapshotId);
+
 	Revive(newTransform);
-	
-	// Invoke the RemoteReviveOnClient function on all remote clients, to ensure that Revive is called across the network
-	SRmi<RMI_WRAP(&CPlayerComponent::RemoteReviveOnClient)>::InvokeOnOtherClients(this, RemoteReviveParams{ newTransform.GetTranslation(), Quat(newTransform) });
+}
+
+bool CPlayerComponent::GetWorldStatePlayer(SWorldStatePlayer& player) const
+{
+	if (!m_isAlive || m_snapshotId == InvalidSnapshotId)
+		return false;
+
+	const Vec3 position = GetEntity()->GetWorldPos();
+	player.id = m_snapshotId;
+	player.position = PMoveVec3(position.x, position.y, position.z);
+	player.yaw = m_lookAngles.GetYaw();
+	return true;
+}
 
-	// Go through all other players, and send the RemoteReviveOnClient on their instances to the new player that is ready for gameplay
+void CPlayerComponent::SendWorldState(const uint8* pData, size_t size, const EntityId* pEntityIds, uint32 playerCount)
+{
+	// The server's own player was revived directly
 	const int channelId = m_pEntity->GetNetEntity()->GetChannelId();
-	CGamePlugin::GetInstance()->IterateOverPlayers([this, channelId](CPlayerComponent& player)
-	{
-		// Don't send the event for the player itself (handled in the RemoteReviveOnClient event above sent to all clients)
-		if (player.GetEntityId() == GetEntityId())
-			return;
+	if (IsLocalClient() || channelId == 0 || size == 0 || size > PMoveWorldState::MaxMessageSize || playerCount > PMoveWorldState::MaxPlayers)
+		return;
 
-		// Only send the Revive event to players that have already respawned on the server
-		if (!player.m_isAlive)
-			return;
+	WorldStateParams params;
+	params.playerCount = static_cast<uint8>(playerCount);
+	std::copy(pEntityIds, pEntityIds + playerCount, params.entityIds.begin());
+	params.size = static_cast<uint16>(size);
+	std::copy(pData, pData + size, params.data.begin());
 
-		// Revive this player on the new player's machine, on the location the existing player was currently at
-		const QuatT currentOrientation = QuatT(player.GetEntity()->GetWorldTM());
-		SRmi<RMI_WRAP(&CPlayerComponent::RemoteReviveOnClient)>::InvokeOnClient(&player, RemoteReviveParams{ currentOrientation.t, currentOrientation.q }, channelId);
-	});
+	SRmi<RMI_WRAP(&CPlayerComponent::ReceiveWorldStateOnClient)>::InvokeOnClient(this, std::move(params), channelId);
+}
+
+bool CPlayerComponent::ReceiveWorldStateOnClient(WorldStateParams&& params, INetChannel* pNetChannel)
+{
+	std::array<SWorldStatePlayer, PMoveWorldState::MaxPlayers> players;
+	uint32 playerCount = 0;
+	if (!PMoveWorldState::Read(SSnapshotConfig(), params.data.data(), params.size, players.data(), playerCount) || playerCount != params.playerCount)
+		return true;
+
+	// Revive every listed player on this client, where the server placed it
+	for (uint32 i = 0; i < playerCount; ++i)
+	{
+		IEntity* pEntity = gEnv->pEntitySystem->GetEntity(params.entityIds[i]);
+		CPlayerComponent* pPlayer = pEntity != nullptr ? pEntity->GetComponent<CPlayerComponent>() : nullptr;
+		if (pPlayer == nullptr)
+			continue;
+
+		const SWorldStatePlayer& player = players[i];
+		pPlayer->m_snapshotId = player.id;
+		pPlayer->Revive(Matrix34::Create(Vec3(1.f), Quat::CreateRotationZ(player.yaw), Vec3(player.position.x, player.position.y, player.position.z)));
+	}
+
+	return true;
 }
 
-bool CPlayerComponent::RemoteReviveOnClient(RemoteReviveParams&& params, INetChannel* pNetChannel)
+void CPlayerComponent::SendTuning(const PMoveParams& params)
 {
-	// Call the Revive function on this client
-	Revive(Matrix34::Create(Vec3(1.f), params.rotation, params.position));
+	// The server's own player moves by the server's tuning already
+	const int channelId = m_pEntity->GetNetEntity()->GetChannelId();
+	if (IsLocalClient() || channelId == 0)
+		return;
+
+	TuningParams tuningParams;
+	tuningParams.params = params;
+	SRmi<RMI_WRAP(&CPlayerComponent::ReceiveTuningOnClient)>::InvokeOnClient(this, std::move(tuningParams), channelId);
+}
 
+bool CPlayerComponent::ReceiveTuningOnClient(TuningParams&& params, INetChannel* pNetChannel)
+{
+	GetMovementSystem().SetDefaultParams(params.params);
 	return true;
 }
 
 void CPlayerComponent::Revive(const Matrix34& transform)
 {
 	m_isAlive = true;
+	m_isResting = false;
+	m_pEntity->UpdateComponentEventMask(this);
 	
 	// Set the entity transformation, except if we are in the editor
 	// In the editor case we always prefer to spawn where the viewport is
@@ -500,15 +1337,31 @@ void CPlayerComponent::Revive(const Matrix34& transform)
 	
 	// Apply the character to the entity and queue animations
 	m_pCharacterController->Physicalize();
+	pe_status_dynamics dynamics;
+	if (GetEntity()->GetPhysics()->GetStatus(&dynamics) != 0 && dynamics.mass > 0.f)
+	{
+		m_physicsMass = dynamics.mass;
+	}
 
 	// Reset input now that the player respawned
 	m_inputFlags.Clear();
-	NetMarkAspectsDirty(InputAspect);
 	
 	m_mouseDeltaRotation = ZERO;
-	m_lookOrientation = IDENTITY;
-
-	m_mouseDeltaSmoothingFilter.Reset();
+	m_lookAngles = CViewAngles();
+	m_tickLookAngles = CViewAngles();
+	m_inputTimeline.Reset();
+
+	GetMovementSystem().SetState(m_movementHandle, PMoveState());
+	m_groundContact = PMoveGroundContact();
+	GetMovementSystem().SetAlive(m_movementHandle, IsSimulatedLocally());
+	m_movementPredictor.Reset();
+	m_cmdBatchWriter.Reset();
+	m_ticksSinceCmdSend = 0;
+	m_serverCmdQueue.Reset();
+	m_reportedAnomalies = 0;
+	m_positionCorrection = ZERO;
+	m_ackedSnapshotSequence = 0;
+	m_remoteInterpolator.Reset();
 
 	m_activeFragmentId = FRAGMENT_ID_INVALID;
 
@@ -543,9 +1396,6 @@ void CPlayerComponent::HandleInputFlagChange(const CEnumFlags<EInputFlag> flags,
 	}
 	break;
 	}
-	
-	if(IsLocalClient())
-	{
-		NetMarkAspectsDirty(InputAspect);
-	}
+
+	m_inputTimeline.PushButtons(GetInputTime(), static_cast<uint32>(m_inputFlags.UnderlyingValue()));
 }
@@ -1,7 +1,7 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
-#include <numeric>
 
 #include <CryEntitySystem/IEntityComponent.h>
 #include <CryMath/Cry_Camera.h>
@@ -15,17 +15,28 @@
 #include <DefaultComponents/Input/InputComponent.h>
 #include <DefaultComponents/Audio/ListenerComponent.h>
 
+#include "CommandBatch.h"
+#include "InputTimeline.h"
+#include "InterestManager.h"
+#include "LagCompensation.h"
+#include "MovementDemo.h"
+#include "MovementProfiler.h"
+#include "MovementSnapshot.h"
+#include "MovementTrace.h"
+#include "MovementTuning.h"
+#include "MovementValidator.h"
+#include "PhysicsWriteBack.h"
+#include "PlayerMovementSystem.h"
+#include "PlayerPrediction.h"
+#include "RemotePlayerInterpolation.h"
+#include "ViewAngles.h"
+#include "WindowedStatistics.h"
+#include "WorldState.h"
+
 ////////////////////////////////////////////////////////
 // Represents a player participating in gameplay
 ////////////////////////////////////////////////////////
 
-struct Cmd
-{
-	float forwardMove;
-	float rightMove;
-	float upMove;
-};
-
 class CPlayerComponent final : public IEntityComponent
 {
 	
@@ -44,59 +55,14 @@ class CPlayerComponent final : public IEntityComponent
 		MoveBack = 1 << 3,
 		Jump = 1 << 4
 	};
-	
-	static constexpr EEntityAspects InputAspect = eEA_GameClientD;
-
-	template<typename T, size_t SAMPLES_COUNT>
-	class MovingAverage
-	{
-		static_assert(SAMPLES_COUNT > 0, "SAMPLES_COUNT shall be larger than zero!");
-
-	public:
 
-		MovingAverage()
-			: m_values()
-			, m_cursor(SAMPLES_COUNT)
-			, m_accumulator()
-		{
-		}
+	// Commands go out every second tick, each one repeated in four packets
+	static constexpr uint32 CmdSendInterval = 2;
+	static constexpr uint32 CmdRedundancy = 8;
 
-		MovingAverage& Push(const T& value)
-		{
-			if (m_cursor == SAMPLES_COUNT)
-			{
-				m_values.fill(value);
-				m_cursor = 0;
-				m_accumulator = std::accumulate(m_values.begin(), m_values.end(), T(0));
-			}
-			else
-			{
-				m_accumulator -= m_values[m_cursor];
-				m_values[m_cursor] = value;
-				m_accumulator += m_values[m_cursor];
-				m_cursor = (m_cursor + 1) % SAMPLES_COUNT;
-			}
-
-			return *this;
-		}
-
-		T Get() const
-		{
-			return m_accumulator / T(SAMPLES_COUNT);
-		}
-
-		void Reset()
-		{
-			m_cursor = SAMPLES_COUNT;
-		}
-
-	private:
-
-		std::array<T, SAMPLES_COUNT> m_values;
-		size_t m_cursor;
-
-		T m_accumulator;
-	};
+	// TODO: Perform soft clamp instead of hard wall, should reduce rot speed in this direction when close to limit.
+	static constexpr float MinLookPitch = -0.84f;
+	static constexpr float MaxLookPitch = 1.5f;
 
 public:
 	CPlayerComponent() = default;
@@ -104,12 +70,10 @@ public:
 
 	// IEntityComponent
 	virtual void Initialize() override;
+	virtual void OnShutDown() override;
 
 	virtual Cry::Entity::EventFlags GetEventMask() const override;
 	virtual void ProcessEvent(const SEntityEvent& event) override;
-	
-	virtual bool NetSerialize(TSerialize ser, EEntityAspects aspect, uint8 profile, int flags) override;
-	virtual NetworkAspectType GetNetSerializeAspectMask() const override { return InputAspect; }
 	// ~IEntityComponent
 
 	// Reflect type to set a unique identifier for this component
@@ -118,23 +82,78 @@ public:
 		desc.SetGUID("{63F4C0C6-32AF-4ACB-8FB0-57D45DD14725}"_cry_guid);
 	}
 
+	// Queues the join, every player that became ready within a tick is revived and announced together
 	void OnReadyForGameplayOnServer();
+	// Called by the join fan-out on the server: picks the spawn point farthest from the given players and revives the player
+	void ReviveOnServer(const PMoveVec3* pEnemyPositions, size_t enemyCount);
+	bool GetWorldStatePlayer(SWorldStatePlayer& player) const;
+	// Sends an encoded world state to the client owning this player, pEntityIds lists the players in message order
+	void SendWorldState(const uint8* pData, size_t size, const EntityId* pEntityIds, uint32 playerCount);
 	bool IsLocalClient() const { return (m_pEntity->GetFlags() & ENTITY_FLAG_LOCAL_PLAYER) != 0; }
+	// Clients only simulate their own player, everyone else is drawn from interpolated snapshots
+	bool IsSimulatedLocally() const { return gEnv->bServer || IsLocalClient(); }
+	bool IsAlive() const { return m_isAlive; }
+
+	// Movement of all players is solved in one batch, components only hold a handle into it
+	static CPlayerMovementSystem& GetMovementSystem();
+	// Stage timings and counters of every player, dumped while pm_profile is set
+	static CMovementProfiler& GetMovementProfiler();
+	// Records the local player's commands while pm_demo names a file
+	static CMovementDemoWriter& GetDemoWriter();
+	// Demos start on the ground, returns false while the player is dead or in the air
+	bool GetDemoHeader(SMovementDemoFileHeader& header) const;
+	// Called before every movement tick to hand this player's command to the movement system, with the time the tick ends on the input clock
+	void PrepareMovementTick(double tickEndTime);
+	// Ground under the player as of the last movement tick, queried from physics once per tick
+	const PMoveGroundContact& GetGroundContact() const { return m_groundContact; }
+	// Called once per frame after the movement system was stepped, pushes the result to the physics write back
+	void ApplyMovement(float tickInterval);
+	// Every player's velocity for physics, submitted once per frame after all players applied their movement
+	using PhysicsWriteBack = CPhysicsWriteBack<Cry::DefaultComponents::CCharacterControllerComponent*>;
+	static PhysicsWriteBack& GetPhysicsWriteBack();
+	// Server: wakes a player resting without input. Pushes, collisions and teleports do so through the entity events, see GetEventMask.
+	void WakeMovement() { SetResting(false); }
+
+	// Movement state of all players is replicated in one snapshot per client instead of per entity aspects
+	static constexpr uint16 InvalidSnapshotId = 0xFFFF;
+	bool GetSnapshotPlayer(SSnapshotPlayer& player) const;
+	// Sends the players this client is interested in
+	void SendSnapshot(const CSnapshotEncoder& encoder, CInterestManager& interestManager);
+	void ApplySnapshotPlayer(const SSnapshotPlayer& player, uint32 ackedCmdSequence, double serverTime);
+
+	// Server: where every player was over the last second, for rewinding hit tests to what a client saw
+	static CLagCompensationHistory& GetLagCompensationHistory();
+	void RecordHistory(CLagCompensationHistory& history) const;
+
+	// Server: which players each client is sent and how often, everyone while pm_interest is 0
+	static CInterestManager& GetInterestManager();
+
+	// Server: re-simulates every remote player's ticks and flags cheats, while pm_validate is set
+	static CMovementValidator& GetMovementValidator();
+
+	// Server: sends the tuning every player moves by to the client owning this player, so its prediction matches a reloaded pm_tuning profile
+	void SendTuning(const PMoveParams& params);
 
 protected:
 	void Revive(const Matrix34& transform);
 
-	void SetMovementDir();
-	void QueueJump();
-	void AirMove();
-	void Accelerate(Vec3 wishdir, float wishspeed, float accel);
-	void AirControl(Vec3 wishdir, float wishspeed);
-	void GroundMove();
-	void ApplyFriction(float t);
+	void SetMovementDir(CEnumFlags<EInputFlag> inputFlags);
+	void QueueJump(CEnumFlags<EInputFlag> inputFlags);
+	// Queries physics for the ground under the player, once per movement tick
+	void UpdateGroundContact();
+	void SendCmds();
+	void ReconcileMovement(uint32 ackedSequence, const PMoveState& serverState, const Vec3& serverPosition);
+	// Server: hands a remote player's tick to the movement validator and logs what it flagged
+	void RecordValidation(double tickEndTime);
+	// Server: takes a remote player out of the movement step and the entity update list, or puts it back
+	void SetResting(bool isResting);
+	// Pushes the current movement state to the binary trace while one is being written, compiled out without PMOVE_TRACE
+	void TraceMovement(EMovementTraceEvent event) const;
 	void UpdateLookDirectionRequest(float frameTime);
 	void UpdateAnimation(float frameTime);
 	void UpdateLookRotationZ(float frameTime);
 	void UpdateCamera(float frameTime);
+	void UpdateRemotePlayer();
 	void Update(float frameTime);
 	void HandleInputFlagChange(CEnumFlags<EInputFlag> flags, CEnumFlags<EActionActivationMode> activationMode, EInputFlagType type = EInputFlagType::Hold);
 
@@ -145,27 +164,111 @@ protected:
 	
 	// Start remote method declarations
 protected:
-	// Parameters to be passed to the RemoteReviveOnClient function
-	struct RemoteReviveParams
+	// Players revived on the server, written by CJoinFanOut
+	struct WorldStateParams
+	{
+		void SerializeWith(TSerialize ser)
+		{
+			// Entity ids need the network's mapping, the rest is a bitstream
+			ser.Value("count", playerCount, 'ui8');
+			playerCount = std::min(playerCount, static_cast<uint8>(PMoveWorldState::MaxPlayers));
+			for (uint8 i = 0; i < playerCount; ++i)
+			{
+				ser.Value("entity", entityIds[i], 'eid');
+			}
+			ser.Value("size", size, 'ui16');
+			size = std::min(size, static_cast<uint16>(PMoveWorldState::MaxMessageSize));
+			for (uint16 i = 0; i < size; ++i)
+			{
+				ser.Value("data", data[i], 'ui8');
+			}
+		}
+
+		uint8 playerCount = 0;
+		std::array<EntityId, PMoveWorldState::MaxPlayers> entityIds;
+		uint16 size = 0;
+		std::array<uint8, PMoveWorldState::MaxMessageSize> data;
+	};
+	// Remote method called on a client once per server tick in which players joined
+	bool ReceiveWorldStateOnClient(WorldStateParams&& params, INetChannel* pNetChannel);
+
+	// Tuning of every player, see CPlayerMovementSystem::SetDefaultParams
+	struct TuningParams
 	{
-		// Called once on the server to serialize data to the other clients
-		// Then called once on the other side to deserialize
 		void SerializeWith(TSerialize ser)
 		{
-			// Serialize the position with the 'wrld' compression policy
-			ser.Value("pos", position, 'wrld');
-			// Serialize the rotation with the 'ori0' compression policy
-			ser.Value("rot", rotation, 'ori0');
+			ser.Value("gravity", params.gravity);
+			ser.Value("friction", params.friction);
+			ser.Value("moveSpeed", params.moveSpeed);
+			ser.Value("runAcceleration", params.runAcceleration);
+			ser.Value("runDeacceleration", params.runDeacceleration);
+			ser.Value("airAcceleration", params.airAcceleration);
+			ser.Value("airDecceleration", params.airDecceleration);
+			ser.Value("airControl", params.airControl);
+			ser.Value("sideStrafeAcceleration", params.sideStrafeAcceleration);
+			ser.Value("sideStrafeSpeed", params.sideStrafeSpeed);
+			ser.Value("jumpSpeed", params.jumpSpeed);
+			ser.Value("jumpImpulse", params.jumpImpulse);
+			ser.Value("holdJumpToBhop", params.holdJumpToBhop);
 		}
-		
-		Vec3 position;
-		Quat rotation;
+
+		PMoveParams params;
 	};
-	// Remote method intended to be called on all remote clients when a player spawns on the server
-	bool RemoteReviveOnClient(RemoteReviveParams&& params, INetChannel* pNetChannel);
+	// Remote method called on a client whenever the server's tuning changed, and on joining while a profile is applied
+	bool ReceiveTuningOnClient(TuningParams&& params, INetChannel* pNetChannel);
+
+	// Snapshot bitstream written by CSnapshotEncoder for one client
+	struct SnapshotParams
+	{
+		static constexpr uint16 MaxSize = 3072;
+
+		void SerializeWith(TSerialize ser)
+		{
+			// The owning client's last processed command, the snapshot holds the state right after it
+			ser.Value("ackedCmd", ackedCmdSequence);
+			ser.Value("size", size, 'ui16');
+			size = std::min(size, MaxSize);
+			for (uint16 i = 0; i < size; ++i)
+			{
+				ser.Value("data", data[i], 'ui8');
+			}
+		}
+
+		uint32 ackedCmdSequence = 0;
+		uint16 size = 0;
+		std::array<uint8, MaxSize> data;
+	};
+	// Remote method called on the owning client of this player, once per network tick
+	bool ReceiveSnapshotOnClient(SnapshotParams&& params, INetChannel* pNetChannel);
+
+	// Newest commands of the owning client written by CCmdBatchWriter
+	struct CmdBatchParams
+	{
+		static constexpr uint16 MaxSize = 256;
+
+		void SerializeWith(TSerialize ser)
+		{
+			ser.Value("size", size, 'ui16');
+			size = std::min(size, MaxSize);
+			for (uint16 i = 0; i < size; ++i)
+			{
+				ser.Value("data", data[i], 'ui8');
+			}
+		}
+
+		uint16 size = 0;
+		std::array<uint8, MaxSize> data;
+	};
+	// Remote method called on the server by the owning client every CmdSendInterval ticks
+	bool ReceiveCmdsOnServer(CmdBatchParams&& params, INetChannel* pNetChannel);
 	
 protected:
 	bool m_isAlive = false;
+	// Server: a remote player standing still without input, until a command with input, a new view, a collision or being moved wakes it
+	bool m_isResting = false;
+	// Where the player came to rest, moving farther than RestWakeDistance from it wakes the player
+	Vec3 m_restPosition = ZERO;
+	static constexpr float RestWakeDistance = 0.01f;
 
 	Cry::DefaultComponents::CCameraComponent* m_pCameraComponent = nullptr;
 	Cry::DefaultComponents::CCharacterControllerComponent* m_pCharacterController = nullptr;
@@ -178,7 +281,8 @@ protected:
 
 	CEnumFlags<EInputFlag> m_inputFlags;
 	Vec2 m_mouseDeltaRotation;
-	MovingAverage<Vec2, 10> m_mouseDeltaSmoothingFilter;
+	// Local client: buttons and mouse input by timestamp, consumed by the movement ticks
+	CInputTimeline m_inputTimeline{ MinLookPitch, MaxLookPitch };
 	float m_TiltAngle = 0.26;
 	bool m_bSliding = false;
 	bool m_bSprinting = false;
@@ -192,32 +296,28 @@ protected:
 	float m_CrouchingViewOffset = 0.1f;
 	CryTransform::CAngle m_sprintFOV = 95_degrees;
 	CryTransform::CAngle m_defaultFOV = 90_degrees;
-	float m_moveSpeed = 1000;
-
-	 float gravity = 2000;
-
-	 float friction = 6; //Ground friction
 
 	/* Movement stuff */
-	 float moveSpeed = 70;                // Ground move speed
-	 float runAcceleration = 140;         // Ground accel
-	 float runDeacceleration = 600;       // Deacceleration that occurs when running on the ground
-	 float airAcceleration = 0.3;        // Air accel
-	 float airDecceleration = 0.3;
-
-       // Deacceleration experienced when ooposite strafing
-	 float airControl = 1;               // How precise air control is
-	 float sideStrafeAcceleration = 5;  // How fast acceleration occurs to get up to sideStrafeSpeed when
-	 float sideStrafeSpeed = 10;          // What the max speed to generate when side strafing
-	 float jumpSpeed = 80;                // The speed at which the character's up axis gains when hitting jump
-	 bool holdJumpToBhop = true;           // When enabled allows player to just hold jump button to keep on bhopping perfectly. Beware: smells like casual.
-
-	 bool wishJump;
-	 float playerFriction;
-	 Vec3 moveDirectionNorm = ZERO;
-	 Vec3 playerVelocity = ZERO;
-	 
-	 Cmd _cmd;
+	CPlayerMovementSystem::Handle m_movementHandle = CPlayerMovementSystem::InvalidHandle;
+	PMoveGroundContact m_groundContact;
+	// Of the living entity, jumps reach physics as the speed their impulse adds
+	float m_physicsMass = 80.f;
+
+	Cmd _cmd;
+	uint32 m_cmdSequence = 0;
+	CCmdBatchWriter m_cmdBatchWriter{ CmdRedundancy };
+	uint32 m_ticksSinceCmdSend = 0;
+	CMovementPredictor m_movementPredictor;
+	CServerCmdQueue m_serverCmdQueue;
+	// Server: anomalies of this life already logged
+	uint8 m_reportedAnomalies = 0;
+	// Remaining offset towards the server position, blended in over a few frames instead of snapping
+	Vec3 m_positionCorrection = ZERO;
+	uint16 m_snapshotId = InvalidSnapshotId;
+	// Client: newest decoded snapshot, sent back with the commands. Server: what the owning client acknowledged
+	uint32 m_ackedSnapshotSequence = 0;
+	// Client: snapshots of a player simulated elsewhere, velocities convert to meters per second with the tick interval like in ApplyMovement
+	CRemotePlayerInterpolator m_remoteInterpolator{ SInterpolationConfig{ 0.f, 0.5f, 3.f, 0.1f, 0.1f, true, 1.f / CFixedTimestep::DefaultTickRate } };
 
 
 	const float m_rotationSpeed = 0.002f;
@@ -226,7 +326,9 @@ protected:
 
 	FragmentID m_activeFragmentId;
 
-	Quat m_lookOrientation; //!< Should translate to head orientation in the future
+	CViewAngles m_lookAngles; //!< Should translate to head orientation in the future
+	// Local client: the view as of the last movement tick, m_lookAngles renders ahead of it
+	CViewAngles m_tickLookAngles;
 	float m_horizontalAngularVelocity;
-	MovingAverage<float, 10> m_averagedHorizontalAngularVelocity;
+	CWindowedStatistics<float, 8> m_averagedHorizontalAngularVelocity;
 };
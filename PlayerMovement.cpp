@@ -0,0 +1,179 @@
+#include "PlayerMovement.h"
+#include "MovementRuleset.h"
+
+namespace PMove
+{
+
+void SetGroundContact(PMoveState& state, const PMoveGroundContact& ground)
+{
+	state.onGround = ground.onGround;
+	state.onSteepPlane = ground.onSteepPlane;
+	state.groundNormal = ground.normal;
+	state.surfaceFriction = ground.surfaceFriction;
+}
+
+PMoveVec3 ClipVelocity(const PMoveVec3& velocity, const PMoveVec3& normal, float overbounce)
+{
+	float backoff = velocity.Dot(normal);
+	if (backoff < 0)
+		backoff *= overbounce;
+	else
+		backoff /= overbounce;
+	return velocity - normal * backoff;
+}
+
+PMoveVec3 GetWishDir(const Cmd& cmd, float yaw)
+{
+	const float c = std::cos(yaw);
+	const float s = std::sin(yaw);
+
+	return PMoveVec3(cmd.rightMove * c - cmd.forwardMove * s, cmd.rightMove * s + cmd.forwardMove * c, 0.f);
+}
+
+void QueueJump(PMoveState& state, const PMoveParams& params, const Cmd& cmd)
+{
+	if (params.holdJumpToBhop)
+	{
+		state.wishJump = cmd.jump;
+	}
+	else if (cmd.jump && !state.jumpHeld)
+	{
+		state.wishJump = true;
+	}
+	else if (!cmd.jump)
+	{
+		state.wishJump = false;
+	}
+
+	state.jumpHeld = cmd.jump;
+}
+
+void Accelerate(PMoveState& state, const PMoveVec3& wishdir, float wishspeed, float accel, float dt)
+{
+	float addspeed, accelspeed, currentspeed;
+
+	currentspeed = state.velocity.Dot(wishdir);
+	addspeed = wishspeed - currentspeed;
+	if (addspeed <= 0)
+		return;
+	accelspeed = accel * dt * wishspeed;
+	if (accelspeed > addspeed)
+		accelspeed = addspeed;
+	state.velocity.x += accelspeed * wishdir.x;
+	state.velocity.y += accelspeed * wishdir.y;
+}
+
+void AirControl(PMoveState& state, const PMoveParams& params, const Cmd& cmd, const PMoveVec3& wishdir, float wishspeed, float dt)
+{
+	float zspeed, speed, dot, k;
+	if (cmd.forwardMove == 0 || wishspeed == 0) {
+		return;
+	}
+	PMoveVec3& velocity = state.velocity;
+
+	zspeed = velocity.z;
+	velocity.z = 0;
+	speed = velocity.GetLength();
+	velocity.Normalize();
+
+	dot = velocity.Dot(wishdir);
+	k = 32;
+	k *= params.airControl * dot * dot * dt;
+
+	if (dot > 0)
+	{
+		velocity.x = velocity.x * speed + wishdir.x * k;
+		velocity.y = velocity.y * speed + wishdir.y * k;
+		velocity.z = velocity.z * speed + wishdir.z * k;
+
+		velocity.Normalize();
+		state.moveDirectionNorm = velocity;
+	}
+
+	velocity.x *= speed;
+	velocity.z = zspeed;
+	velocity.y *= speed;
+}
+
+void ApplyFriction(PMoveState& state, const PMoveParams& params, float t, float dt)
+{
+	PMoveVec3 vec = state.velocity;
+	float speed, newspeed, drop;
+	vec.y = 0.0f;
+	speed = vec.GetLength();
+	drop = GetFrictionDrop(state, params, t, dt);
+
+	newspeed = speed - drop;
+	if (newspeed < 0) {
+		newspeed = 0;
+	}
+	if (speed > 0) {
+		newspeed /= speed;
+	}
+	state.velocity.x *= newspeed;
+	state.velocity.y *= newspeed;
+}
+
+float GetFrictionDrop(const PMoveState& state, const PMoveParams& params, float t, float dt)
+{
+	if (!state.onGround)
+		return 0.0f;
+
+	PMoveVec3 vec = state.velocity;
+	vec.y = 0.0f;
+	const float speed = vec.GetLength();
+	const float control = speed < params.runDeacceleration ? params.runDeacceleration : speed;
+	return control * params.friction * dt * t * state.surfaceFriction;
+}
+
+void GroundMove(PMoveState& state, const PMoveParams& params, const Cmd& cmd, float dt)
+{
+	if (!state.wishJump)
+		ApplyFriction(state, params, 1.0f, dt);
+	else
+		ApplyFriction(state, params, 0, dt);
+
+	PMoveVec3 wishdir = GetWishDir(cmd, state.yaw);
+	wishdir.Normalize();
+	state.moveDirectionNorm = wishdir;
+
+	float wishspeed = wishdir.GetLength();
+	wishspeed *= params.moveSpeed;
+
+	Accelerate(state, wishdir, wishspeed, params.runAcceleration, dt);
+
+	state.velocity.z = 0;
+	if (state.groundNormal.z < 1.f)
+	{
+		// Follow the slope at the same speed, like PM_WalkMove, instead of running into or off it
+		const float speed = state.velocity.GetLength();
+		state.velocity = ClipVelocity(state.velocity, state.groundNormal, Overclip);
+		state.velocity.Normalize();
+		state.velocity = state.velocity * speed;
+	}
+	if (state.wishJump) {
+		state.jumped = true;
+		state.wishJump = false;
+	}
+}
+
+void AirMove(PMoveState& state, const PMoveParams& params, const Cmd& cmd, float dt)
+{
+	AirMove<SQ3Ruleset>(state, params, cmd, dt);
+}
+
+PMoveState Move(const PMoveState& from, const PMoveParams& params, const Cmd& cmd, float dt)
+{
+	return Move<SQ3Ruleset>(from, params, cmd, dt);
+}
+
+bool IsAtRest(const PMoveState& state, const Cmd& cmd)
+{
+	return state.onGround && !state.onSteepPlane
+		&& state.velocity.x == 0.f && state.velocity.y == 0.f && state.velocity.z == 0.f
+		&& state.moveDirectionNorm.x == 0.f && state.moveDirectionNorm.y == 0.f && state.moveDirectionNorm.z == 0.f
+		&& !state.wishJump && !state.jumpHeld && !state.jumped
+		&& cmd.forwardMove == 0.f && cmd.rightMove == 0.f && cmd.upMove == 0.f && !cmd.jump;
+}
+
+}
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+////////////////////////////////////////////////////////
+// Engine independent Quake 3 movement kernel
+// Only depends on the standard library so that it can be stepped
+// headlessly, see Benchmark/MovementBenchmark.cpp
+////////////////////////////////////////////////////////
+
+struct PMoveVec3
+{
+	float x = 0.f;
+	float y = 0.f;
+	float z = 0.f;
+
+	PMoveVec3() = default;
+	PMoveVec3(float x_, float y_, float z_) : x(x_), y(y_), z(z_) {}
+
+	PMoveVec3 operator+(const PMoveVec3& other) const { return PMoveVec3(x + other.x, y + other.y, z + other.z); }
+	PMoveVec3 operator-(const PMoveVec3& other) const { return PMoveVec3(x - other.x, y - other.y, z - other.z); }
+	PMoveVec3 operator*(float scale) const { return PMoveVec3(x * scale, y * scale, z * scale); }
+
+	float Dot(const PMoveVec3& other) const { return x * other.x + y * other.y + z * other.z; }
+	float GetLength() const { return std::sqrt(x * x + y * y + z * z); }
+
+	// Zero length vectors are left untouched, matching Vec3::Normalize
+	void Normalize()
+	{
+		const float length = GetLength();
+		if (length > 0.f)
+		{
+			const float invLength = 1.f / length;
+			x *= invLength;
+			y *= invLength;
+			z *= invLength;
+		}
+	}
+};
+
+// Input for a single movement tick
+struct Cmd
+{
+	uint32_t sequence = 0;                // Increases by one per tick, used to acknowledge and replay commands
+	float forwardMove = 0.f;
+	float rightMove = 0.f;
+	float upMove = 0.f;
+	float yaw = 0.f;                      // View angles in radians
+	float pitch = 0.f;
+	bool jump = false;                    // Jump button held
+};
+
+// Movement tuning, previously individual members of CPlayerComponent
+struct PMoveParams
+{
+	float gravity = 2000;
+	float friction = 6;                   // Ground friction
+	float moveSpeed = 1000;               // Scale applied to the wish direction
+	float runAcceleration = 140;          // Ground accel
+	float runDeacceleration = 600;        // Deacceleration that occurs when running on the ground
+	float airAcceleration = 0.3f;         // Air accel
+	float airDecceleration = 0.3f;        // Deacceleration experienced when ooposite strafing
+	float airControl = 1;                 // How precise air control is
+	float sideStrafeAcceleration = 5;     // How fast acceleration occurs to get up to sideStrafeSpeed when
+	float sideStrafeSpeed = 10;           // What the max speed to generate when side strafing
+	float jumpSpeed = 80;                 // The speed at which the character's up axis gains when hitting jump
+	float jumpImpulse = 800;              // Vertical impulse handed to physics when a ground jump triggers
+	bool holdJumpToBhop = true;           // When enabled allows player to just hold jump button to keep on bhopping perfectly. Beware: smells like casual.
+};
+
+// The ground below a player, sampled once per tick and shared by everything that asks for it
+struct PMoveGroundContact
+{
+	bool onGround = false;                // Standing on a plane flat enough to walk on
+	bool onSteepPlane = false;            // Touching a plane too steep to stand on, air moves slide along it
+	PMoveVec3 normal = PMoveVec3(0.f, 0.f, 1.f);
+	float surfaceFriction = 1.f;          // Scales ground friction, 1 on default surfaces
+	float distance = 0.f;                 // Height above the plane
+};
+
+// Everything the kernel reads and writes for a single player
+struct PMoveState
+{
+	PMoveVec3 velocity;
+	PMoveVec3 moveDirectionNorm;
+	float yaw = 0.f;                      // World rotation around the up axis, in radians
+	PMoveVec3 groundNormal = PMoveVec3(0.f, 0.f, 1.f);
+	float surfaceFriction = 1.f;
+	bool onGround = false;
+	bool onSteepPlane = false;
+	bool wishJump = false;
+	bool jumpHeld = false;                // Jump button state of the previous command
+	bool jumped = false;                  // Set on the tick a ground jump was triggered, physics applies the impulse
+};
+
+namespace PMove
+{
+	// Planes whose normal points up less than this are too steep to stand on, as in Quake 3
+	static constexpr float MinWalkNormal = 0.7f;
+	// Clipped velocities are pushed slightly off the plane, so they don't end up inside it by rounding
+	static constexpr float Overclip = 1.001f;
+
+	// Hands the sampled ground to the kernel, before the command is simulated
+	void SetGroundContact(PMoveState& state, const PMoveGroundContact& ground);
+
+	// Removes the part of the velocity going into the plane, PM_ClipVelocity
+	PMoveVec3 ClipVelocity(const PMoveVec3& velocity, const PMoveVec3& normal, float overbounce);
+
+	// Rotates the command's local move direction into world space around the up axis
+	PMoveVec3 GetWishDir(const Cmd& cmd, float yaw);
+
+	// Turns the command's jump button into a jump request, once per command before it is simulated
+	void QueueJump(PMoveState& state, const PMoveParams& params, const Cmd& cmd);
+
+	void Accelerate(PMoveState& state, const PMoveVec3& wishdir, float wishspeed, float accel, float dt);
+	void AirControl(PMoveState& state, const PMoveParams& params, const Cmd& cmd, const PMoveVec3& wishdir, float wishspeed, float dt);
+	void ApplyFriction(PMoveState& state, const PMoveParams& params, float t, float dt);
+	// Speed ApplyFriction takes away, t is 0 on the tick a jump leaves the ground
+	float GetFrictionDrop(const PMoveState& state, const PMoveParams& params, float t, float dt);
+
+	void GroundMove(PMoveState& state, const PMoveParams& params, const Cmd& cmd, float dt);
+	void AirMove(PMoveState& state, const PMoveParams& params, const Cmd& cmd, float dt);
+
+	// Advances a player by exactly one tick, with every feature of the default ruleset (see MovementRuleset.h)
+	PMoveState Move(const PMoveState& from, const PMoveParams& params, const Cmd& cmd, float dt);
+
+	using MoveFunc = PMoveState (*)(const PMoveState& from, const PMoveParams& params, const Cmd& cmd, float dt);
+
+	// Standing still on walkable ground with no input and no jump pending, every ruleset's move of the command leaves the state as it is
+	bool IsAtRest(const PMoveState& state, const Cmd& cmd);
+}
+
+// Accumulates variable frame times and hands out whole fixed ticks
+// Ticks end on a grid of their own, start + n * interval, no matter how
+// the frames fall across it. Inputs stamped with the same clock (see
+// InputTimeline.h) land in the tick they were made in, so clients
+// running at any frame rate produce the same commands.
+class CFixedTimestep
+{
+public:
+	static constexpr float DefaultTickRate = 60.f;
+	// Caps the ticks handed out per frame, so a long hitch can't spiral into ever longer frames
+	static constexpr int MaxTicksPerFrame = 8;
+
+	explicit CFixedTimestep(float tickRate = DefaultTickRate)
+		: m_tickInterval(1.f / tickRate)
+	{
+	}
+
+	// Returns the number of ticks to simulate for this frame
+	int Advance(float frameTime) { return AdvanceTo(m_time + frameTime); }
+
+	// Same as Advance, driven by a clock in seconds instead of frame times
+	int AdvanceTo(double time)
+	{
+		m_time = time;
+
+		int ticks = 0;
+		while (m_time - m_lastTickEndTime >= m_tickInterval && ticks < MaxTicksPerFrame)
+		{
+			m_lastTickEndTime += m_tickInterval;
+			m_tickEndTimes[ticks++] = m_lastTickEndTime;
+		}
+
+		if (ticks == MaxTicksPerFrame && m_time - m_lastTickEndTime >= m_tickInterval)
+		{
+			// Drop the backlog instead of carrying it into the next frame
+			m_lastTickEndTime = m_time;
+		}
+
+		return ticks;
+	}
+
+	float GetTickInterval() const { return m_tickInterval; }
+	// When the given tick of those the last Advance handed out ends, on the clock Advance was driven by
+	double GetTickEndTime(int tick) const { return m_tickEndTimes[tick]; }
+	// Fraction of a tick left in the accumulator, used to blend rendering between ticks
+	float GetInterpolationAlpha() const { return static_cast<float>((m_time - m_lastTickEndTime) / m_tickInterval); }
+
+	// Starts the tick grid at the given clock time
+	void Reset(double time = 0.0)
+	{
+		m_time = time;
+		m_lastTickEndTime = time;
+	}
+
+private:
+	float m_tickInterval;
+	// Double, the grid has to stay exact over hours of clock time
+	double m_time = 0.0;
+	double m_lastTickEndTime = 0.0;
+	double m_tickEndTimes[MaxTicksPerFrame] = {};
+};
@@ -0,0 +1,391 @@
+#include "PlayerMovementBatch.h"
+#include "MovementRuleset.h"
+
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+	#define PMOVE_BATCH_X86 1
+	#include <immintrin.h>
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+	#endif
+#else
+	#define PMOVE_BATCH_X86 0
+#endif
+
+namespace PMoveBatch
+{
+
+ESimdLevel GetSupportedSimdLevel()
+{
+#if PMOVE_BATCH_X86 && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] >= 7)
+	{
+		__cpuid(info, 1);
+		const bool osSavesYmm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+		__cpuidex(info, 7, 0);
+		if (osSavesYmm && (info[1] & (1 << 5)) != 0)
+			return ESimdLevel::Avx2;
+	}
+	return ESimdLevel::Sse;
+#elif PMOVE_BATCH_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return ESimdLevel::Avx2;
+	return ESimdLevel::Sse;
+#else
+	return ESimdLevel::Scalar;
+#endif
+}
+
+const char* GetSimdLevelName(ESimdLevel level)
+{
+	switch (level)
+	{
+	case ESimdLevel::Sse: return "sse";
+	case ESimdLevel::Avx2: return "avx2";
+	default: return "scalar";
+	}
+}
+
+template<typename TRuleset>
+void StepScalar(const SPlayerMovementArrays& a, uint32_t begin, uint32_t end, float dt)
+{
+	// Mirrors PMove::GroundMove / PMove::AirMove operation for operation, so results match the reference kernel
+	for (uint32_t i = begin; i < end; ++i)
+	{
+		if (!a.alive[i])
+			continue;
+
+		float vx = a.velocityX[i], vy = a.velocityY[i], vz = a.velocityZ[i];
+		const float forwardMove = a.forwardMove[i];
+		const float rightMove = a.rightMove[i];
+
+		const float c = std::cos(a.yaw[i]);
+		const float s = std::sin(a.yaw[i]);
+		float wx = rightMove * c - forwardMove * s;
+		float wy = rightMove * s + forwardMove * c;
+
+		if (a.onGround[i])
+		{
+			// Friction
+			const float t = a.wishJump[i] ? 0.f : 1.0f;
+			const float speed = std::sqrt(vx * vx + 0.0f * 0.0f + vz * vz);
+			const float control = speed < a.runDeacceleration[i] ? a.runDeacceleration[i] : speed;
+			const float drop = control * a.friction[i] * dt * t * a.surfaceFriction[i];
+			float newspeed = speed - drop;
+			if (newspeed < 0)
+				newspeed = 0;
+			if (speed > 0)
+				newspeed /= speed;
+			vx *= newspeed;
+			vy *= newspeed;
+
+			const float length = std::sqrt(wx * wx + wy * wy + 0.f * 0.f);
+			if (length > 0.f)
+			{
+				const float invLength = 1.f / length;
+				wx *= invLength;
+				wy *= invLength;
+			}
+			a.moveDirX[i] = wx;
+			a.moveDirY[i] = wy;
+			a.moveDirZ[i] = 0.f;
+
+			const float wishspeed = std::sqrt(wx * wx + wy * wy + 0.f * 0.f) * a.moveSpeed[i];
+
+			// Accelerate
+			const float addspeed = wishspeed - (vx * wx + vy * wy + vz * 0.f);
+			if (addspeed > 0)
+			{
+				float accelspeed = a.runAcceleration[i] * dt * wishspeed;
+				if (accelspeed > addspeed)
+					accelspeed = addspeed;
+				vx += accelspeed * wx;
+				vy += accelspeed * wy;
+			}
+
+			vz = 0;
+			if (a.groundNormalZ[i] < 1.f)
+			{
+				const float nx = a.groundNormalX[i], ny = a.groundNormalY[i], nz = a.groundNormalZ[i];
+				const float speed = std::sqrt(vx * vx + vy * vy + vz * vz);
+				float backoff = vx * nx + vy * ny + vz * nz;
+				if (backoff < 0)
+					backoff *= PMove::Overclip;
+				else
+					backoff /= PMove::Overclip;
+				vx = vx - nx * backoff;
+				vy = vy - ny * backoff;
+				vz = vz - nz * backoff;
+
+				const float clippedLength = std::sqrt(vx * vx + vy * vy + vz * vz);
+				if (clippedLength > 0.f)
+				{
+					const float invLength = 1.f / clippedLength;
+					vx *= invLength;
+					vy *= invLength;
+					vz *= invLength;
+				}
+				vx = vx * speed;
+				vy = vy * speed;
+				vz = vz * speed;
+			}
+			if (a.wishJump[i])
+			{
+				a.jumped[i] = true;
+				a.wishJump[i] = false;
+			}
+		}
+		else
+		{
+			const float length = std::sqrt(wx * wx + wy * wy + 0.f * 0.f);
+			float wishspeed = length * a.moveSpeed[i];
+			if (length > 0.f)
+			{
+				const float invLength = 1.f / length;
+				wx *= invLength;
+				wy *= invLength;
+			}
+			float dirX = wx, dirY = wy, dirZ = 0.f;
+
+			const float wishspeed2 = wishspeed;
+			float accel = (vx * wx + vy * wy + vz * 0.f) < 0 ? a.airDecceleration[i] : a.airAcceleration[i];
+			if (PMove::IsAirStrafing<TRuleset>(forwardMove, rightMove))
+			{
+				if (wishspeed > a.sideStrafeSpeed[i])
+					wishspeed = a.sideStrafeSpeed[i];
+				accel = a.sideStrafeAcceleration[i];
+			}
+
+			// Accelerate
+			const float addspeed = wishspeed - (vx * wx + vy * wy + vz * 0.f);
+			if (addspeed > 0)
+			{
+				float accelspeed = accel * dt * wishspeed;
+				if (accelspeed > addspeed)
+					accelspeed = addspeed;
+				vx += accelspeed * wx;
+				vy += accelspeed * wy;
+			}
+
+			// Air control
+			if (TRuleset::AirControl && a.airControl[i] > 0 && forwardMove != 0 && wishspeed2 != 0)
+			{
+				const float zspeed = vz;
+				vz = 0;
+				const float speed = std::sqrt(vx * vx + vy * vy + vz * vz);
+				if (speed > 0.f)
+				{
+					const float invSpeed = 1.f / speed;
+					vx *= invSpeed;
+					vy *= invSpeed;
+					vz *= invSpeed;
+				}
+
+				const float dot = vx * wx + vy * wy + vz * 0.f;
+				float k = 32;
+				k *= a.airControl[i] * dot * dot * dt;
+
+				if (dot > 0)
+				{
+					vx = vx * speed + wx * k;
+					vy = vy * speed + wy * k;
+					vz = vz * speed + 0.f * k;
+
+					const float length2 = std::sqrt(vx * vx + vy * vy + vz * vz);
+					if (length2 > 0.f)
+					{
+						const float invLength2 = 1.f / length2;
+						vx *= invLength2;
+						vy *= invLength2;
+						vz *= invLength2;
+					}
+					dirX = vx;
+					dirY = vy;
+					dirZ = vz;
+				}
+
+				vx *= speed;
+				vz = zspeed;
+				vy *= speed;
+			}
+
+			a.moveDirX[i] = dirX;
+			a.moveDirY[i] = dirY;
+			a.moveDirZ[i] = dirZ;
+
+			vz -= a.gravity[i] * dt;
+
+			if (a.onSteepPlane[i])
+			{
+				const float nx = a.groundNormalX[i], ny = a.groundNormalY[i], nz = a.groundNormalZ[i];
+				float backoff = vx * nx + vy * ny + vz * nz;
+				if (backoff < 0)
+				{
+					backoff *= PMove::Overclip;
+					vx = vx - nx * backoff;
+					vy = vy - ny * backoff;
+					vz = vz - nz * backoff;
+				}
+			}
+		}
+
+		a.velocityX[i] = vx;
+		a.velocityY[i] = vy;
+		a.velocityZ[i] = vz;
+	}
+}
+
+}
+
+#if PMOVE_BATCH_X86
+
+// No FMA here on purpose: contracting multiply-adds would break bit exactness with the scalar path
+#if defined(__clang__)
+	#define PMOVE_BEGIN_TARGET_AVX2 _Pragma("clang attribute push (__attribute__((target(\"avx2\"))), apply_to = function)")
+	#define PMOVE_END_TARGET_AVX2 _Pragma("clang attribute pop")
+#elif defined(__GNUC__)
+	#define PMOVE_BEGIN_TARGET_AVX2 _Pragma("GCC push_options") _Pragma("GCC target(\"avx2\")")
+	#define PMOVE_END_TARGET_AVX2 _Pragma("GCC pop_options")
+#else
+	#define PMOVE_BEGIN_TARGET_AVX2
+	#define PMOVE_END_TARGET_AVX2
+#endif
+
+namespace
+{
+	inline int CountTrailingZeros(int value)
+	{
+	#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward(&index, static_cast<unsigned long>(value));
+		return static_cast<int>(index);
+	#else
+		return __builtin_ctz(static_cast<unsigned>(value));
+	#endif
+	}
+}
+
+namespace PMoveBatchSse
+{
+	struct L
+	{
+		using V = __m128;
+		static constexpr int Width = 4;
+
+		static V Zero() { return _mm_setzero_ps(); }
+		static V Set1(float value) { return _mm_set1_ps(value); }
+		static V Load(const float* p) { return _mm_loadu_ps(p); }
+		static void Store(float* p, V v) { _mm_storeu_ps(p, v); }
+		// Expands 0/1 bytes to full lane masks
+		static V LoadMask(const uint8_t* p) { return _mm_castsi128_ps(_mm_cmpgt_epi32(_mm_setr_epi32(p[0], p[1], p[2], p[3]), _mm_setzero_si128())); }
+		static int MoveMask(V mask) { return _mm_movemask_ps(mask); }
+
+		static V Add(V a, V b) { return _mm_add_ps(a, b); }
+		static V Sub(V a, V b) { return _mm_sub_ps(a, b); }
+		static V Mul(V a, V b) { return _mm_mul_ps(a, b); }
+		static V Div(V a, V b) { return _mm_div_ps(a, b); }
+		static V Sqrt(V a) { return _mm_sqrt_ps(a); }
+
+		static V CmpLt(V a, V b) { return _mm_cmplt_ps(a, b); }
+		static V CmpGt(V a, V b) { return _mm_cmpgt_ps(a, b); }
+		static V CmpEq(V a, V b) { return _mm_cmpeq_ps(a, b); }
+		static V CmpNeq(V a, V b) { return _mm_cmpneq_ps(a, b); }
+		static V And(V a, V b) { return _mm_and_ps(a, b); }
+		// ~a & b
+		static V AndNot(V a, V b) { return _mm_andnot_ps(a, b); }
+		// mask ? a : b
+		static V Select(V mask, V a, V b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+	};
+
+	#include "PlayerMovementBatchLanes.inl"
+}
+
+PMOVE_BEGIN_TARGET_AVX2
+namespace PMoveBatchAvx2
+{
+	struct L
+	{
+		using V = __m256;
+		static constexpr int Width = 8;
+
+		static V Zero() { return _mm256_setzero_ps(); }
+		static V Set1(float value) { return _mm256_set1_ps(value); }
+		static V Load(const float* p) { return _mm256_loadu_ps(p); }
+		static void Store(float* p, V v) { _mm256_storeu_ps(p, v); }
+		static V LoadMask(const uint8_t* p)
+		{
+			const __m256i values = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)));
+			return _mm256_castsi256_ps(_mm256_cmpgt_epi32(values, _mm256_setzero_si256()));
+		}
+		static int MoveMask(V mask) { return _mm256_movemask_ps(mask); }
+
+		static V Add(V a, V b) { return _mm256_add_ps(a, b); }
+		static V Sub(V a, V b) { return _mm256_sub_ps(a, b); }
+		static V Mul(V a, V b) { return _mm256_mul_ps(a, b); }
+		static V Div(V a, V b) { return _mm256_div_ps(a, b); }
+		static V Sqrt(V a) { return _mm256_sqrt_ps(a); }
+
+		static V CmpLt(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+		static V CmpGt(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+		static V CmpEq(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+		static V CmpNeq(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_NEQ_UQ); }
+		static V And(V a, V b) { return _mm256_and_ps(a, b); }
+		static V AndNot(V a, V b) { return _mm256_andnot_ps(a, b); }
+		static V Select(V mask, V a, V b) { return _mm256_blendv_ps(b, a, mask); }
+	};
+
+	#include "PlayerMovementBatchLanes.inl"
+}
+PMOVE_END_TARGET_AVX2
+
+#endif
+
+namespace PMoveBatch
+{
+
+template<typename TRuleset>
+void Step(const SPlayerMovementArrays& arrays, uint32_t count, float dt, ESimdLevel level)
+{
+	uint32_t vectorEnd = 0;
+
+#if PMOVE_BATCH_X86
+	switch (level)
+	{
+	case ESimdLevel::Avx2:
+		vectorEnd = count - count % PMoveBatchAvx2::L::Width;
+		PMoveBatchAvx2::StepLanes<TRuleset>(arrays, 0, vectorEnd, dt);
+		break;
+	case ESimdLevel::Sse:
+		vectorEnd = count - count % PMoveBatchSse::L::Width;
+		PMoveBatchSse::StepLanes<TRuleset>(arrays, 0, vectorEnd, dt);
+		break;
+	default:
+		break;
+	}
+#endif
+
+	StepScalar<TRuleset>(arrays, vectorEnd, count, dt);
+}
+
+void Step(const SPlayerMovementArrays& arrays, uint32_t count, float dt, ESimdLevel level)
+{
+	Step<SQ3Ruleset>(arrays, count, dt, level);
+}
+
+// The SIMD paths only exist in this file, so every ruleset is instantiated here
+#define PMOVE_INSTANTIATE_RULESET(TRuleset) \
+	template void StepScalar<TRuleset>(const SPlayerMovementArrays& arrays, uint32_t begin, uint32_t end, float dt); \
+	template void Step<TRuleset>(const SPlayerMovementArrays& arrays, uint32_t count, float dt, ESimdLevel level);
+
+PMOVE_INSTANTIATE_RULESET(SQ3Ruleset)
+PMOVE_INSTANTIATE_RULESET(SCpmaRuleset)
+PMOVE_INSTANTIATE_RULESET(SQwRuleset)
+PMOVE_INSTANTIATE_RULESET(SVq3Ruleset)
+
+#undef PMOVE_INSTANTIATE_RULESET
+
+}
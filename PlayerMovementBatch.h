@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+
+////////////////////////////////////////////////////////
+// Batched movement step over structure-of-arrays player data
+// The SIMD paths advance 4 (SSE) or 8 (AVX2) players at once without
+// branching, computing both the ground and air move and blending per
+// lane. They use the same operations in the same order as the scalar
+// path, so results are identical to PMove::Move.
+////////////////////////////////////////////////////////
+
+// Raw views of the per player arrays owned by CPlayerMovementSystem
+struct SPlayerMovementArrays
+{
+	float* velocityX;
+	float* velocityY;
+	float* velocityZ;
+	float* moveDirX;
+	float* moveDirY;
+	float* moveDirZ;
+	const float* yaw;
+	const float* forwardMove;
+	const float* rightMove;
+	const uint8_t* onGround;
+	const uint8_t* onSteepPlane;
+	const float* groundNormalX;
+	const float* groundNormalY;
+	const float* groundNormalZ;
+	const float* surfaceFriction;
+	uint8_t* wishJump;
+	uint8_t* jumped;
+	const uint8_t* alive;
+
+	const float* gravity;
+	const float* friction;
+	const float* moveSpeed;
+	const float* runAcceleration;
+	const float* runDeacceleration;
+	const float* airAcceleration;
+	const float* airDecceleration;
+	const float* airControl;
+	const float* sideStrafeAcceleration;
+	const float* sideStrafeSpeed;
+};
+
+namespace PMoveBatch
+{
+	enum class ESimdLevel
+	{
+		Scalar = 0,
+		Sse,
+		Avx2
+	};
+
+	// Best instruction set available on the running CPU
+	ESimdLevel GetSupportedSimdLevel();
+	const char* GetSimdLevelName(ESimdLevel level);
+
+	// Instantiated for every ruleset of MovementRuleset.h
+	template<typename TRuleset>
+	void StepScalar(const SPlayerMovementArrays& arrays, uint32_t begin, uint32_t end, float dt);
+
+	// Advances players [0, count) with the requested level, falls back to scalar for the tail and unsupported levels
+	template<typename TRuleset>
+	void Step(const SPlayerMovementArrays& arrays, uint32_t count, float dt, ESimdLevel level);
+	// Default ruleset, see PMove::Move
+	void Step(const SPlayerMovementArrays& arrays, uint32_t count, float dt, ESimdLevel level);
+}
@@ -0,0 +1,202 @@
+// Branch free movement step over L::Width players at a time.
+// Included once per instruction set from PlayerMovementBatch.cpp, inside a namespace that defines the lane type L.
+// Every expression mirrors PMove::GroundMove / PMove::AirMove so each lane is bit identical to the scalar path.
+// Features the ruleset doesn't have are left out entirely instead of being blended away.
+
+template<typename TRuleset>
+void StepLanes(const SPlayerMovementArrays& a, uint32_t begin, uint32_t end, float dt)
+{
+	using V = L::V;
+
+	const V zero = L::Zero();
+	const V one = L::Set1(1.f);
+	const V vdt = L::Set1(dt);
+
+	for (uint32_t i = begin; i + L::Width <= end; i += L::Width)
+	{
+		const V alive = L::LoadMask(a.alive + i);
+		if (L::MoveMask(alive) == 0)
+			continue;
+
+		const V ground = L::LoadMask(a.onGround + i);
+		const V wishJump = L::LoadMask(a.wishJump + i);
+
+		const V vx = L::Load(a.velocityX + i);
+		const V vy = L::Load(a.velocityY + i);
+		const V vz = L::Load(a.velocityZ + i);
+		const V forwardMove = L::Load(a.forwardMove + i);
+		const V rightMove = L::Load(a.rightMove + i);
+		const V moveSpeed = L::Load(a.moveSpeed + i);
+
+		// Trigonometry stays scalar so it matches the reference kernel exactly
+		alignas(32) float cosYaw[L::Width];
+		alignas(32) float sinYaw[L::Width];
+		for (int lane = 0; lane < L::Width; ++lane)
+		{
+			cosYaw[lane] = std::cos(a.yaw[i + lane]);
+			sinYaw[lane] = std::sin(a.yaw[i + lane]);
+		}
+		const V c = L::Load(cosYaw);
+		const V s = L::Load(sinYaw);
+
+		const V wx = L::Sub(L::Mul(rightMove, c), L::Mul(forwardMove, s));
+		const V wy = L::Add(L::Mul(rightMove, s), L::Mul(forwardMove, c));
+
+		// Both moves share the normalized wish direction
+		const V length = L::Sqrt(L::Add(L::Mul(wx, wx), L::Mul(wy, wy)));
+		const V hasLength = L::CmpGt(length, zero);
+		const V invLength = L::Div(one, L::Select(hasLength, length, one));
+		const V nx = L::Select(hasLength, L::Mul(wx, invLength), wx);
+		const V ny = L::Select(hasLength, L::Mul(wy, invLength), wy);
+
+		// Ground move: friction
+		const V t = L::Select(wishJump, zero, one);
+		const V frictionSpeed = L::Sqrt(L::Add(L::Mul(vx, vx), L::Mul(vz, vz)));
+		const V runDeacceleration = L::Load(a.runDeacceleration + i);
+		const V control = L::Select(L::CmpLt(frictionSpeed, runDeacceleration), runDeacceleration, frictionSpeed);
+		const V drop = L::Mul(L::Mul(L::Mul(L::Mul(control, L::Load(a.friction + i)), vdt), t), L::Load(a.surfaceFriction + i));
+		V newspeed = L::Sub(frictionSpeed, drop);
+		newspeed = L::Select(L::CmpLt(newspeed, zero), zero, newspeed);
+		const V isMoving = L::CmpGt(frictionSpeed, zero);
+		newspeed = L::Select(isMoving, L::Div(newspeed, L::Select(isMoving, frictionSpeed, one)), newspeed);
+		V gvx = L::Mul(vx, newspeed);
+		V gvy = L::Mul(vy, newspeed);
+
+		// Ground move: accelerate
+		{
+			const V wishspeed = L::Mul(L::Sqrt(L::Add(L::Mul(nx, nx), L::Mul(ny, ny))), moveSpeed);
+			const V addspeed = L::Sub(wishspeed, L::Add(L::Mul(gvx, nx), L::Mul(gvy, ny)));
+			V accelspeed = L::Mul(L::Mul(L::Load(a.runAcceleration + i), vdt), wishspeed);
+			accelspeed = L::Select(L::CmpGt(accelspeed, addspeed), addspeed, accelspeed);
+			const V accelerate = L::CmpGt(addspeed, zero);
+			gvx = L::Select(accelerate, L::Add(gvx, L::Mul(accelspeed, nx)), gvx);
+			gvy = L::Select(accelerate, L::Add(gvy, L::Mul(accelspeed, ny)), gvy);
+		}
+
+		// Ground move: follow a sloped ground plane at the same speed, flat ground only drops the vertical speed
+		const V groundNormalX = L::Load(a.groundNormalX + i);
+		const V groundNormalY = L::Load(a.groundNormalY + i);
+		const V groundNormalZ = L::Load(a.groundNormalZ + i);
+		V gvz = zero;
+		{
+			const V overclip = L::Set1(PMove::Overclip);
+			const V speed = L::Sqrt(L::Add(L::Add(L::Mul(gvx, gvx), L::Mul(gvy, gvy)), L::Mul(zero, zero)));
+			V backoff = L::Add(L::Add(L::Mul(gvx, groundNormalX), L::Mul(gvy, groundNormalY)), L::Mul(zero, groundNormalZ));
+			backoff = L::Select(L::CmpLt(backoff, zero), L::Mul(backoff, overclip), L::Div(backoff, overclip));
+			V cx = L::Sub(gvx, L::Mul(groundNormalX, backoff));
+			V cy = L::Sub(gvy, L::Mul(groundNormalY, backoff));
+			V cz = L::Sub(zero, L::Mul(groundNormalZ, backoff));
+
+			const V clippedLength = L::Sqrt(L::Add(L::Add(L::Mul(cx, cx), L::Mul(cy, cy)), L::Mul(cz, cz)));
+			const V hasClippedLength = L::CmpGt(clippedLength, zero);
+			const V invClippedLength = L::Div(one, L::Select(hasClippedLength, clippedLength, one));
+			cx = L::Select(hasClippedLength, L::Mul(cx, invClippedLength), cx);
+			cy = L::Select(hasClippedLength, L::Mul(cy, invClippedLength), cy);
+			cz = L::Select(hasClippedLength, L::Mul(cz, invClippedLength), cz);
+
+			const V slope = L::CmpLt(groundNormalZ, one);
+			gvx = L::Select(slope, L::Mul(cx, speed), gvx);
+			gvy = L::Select(slope, L::Mul(cy, speed), gvy);
+			gvz = L::Select(slope, L::Mul(cz, speed), gvz);
+		}
+
+		// Air move: pick the acceleration
+		const V wishspeed2 = L::Mul(length, moveSpeed);
+		V wishspeed = wishspeed2;
+		V accel;
+		if constexpr (TRuleset::AirStrafe == EAirStrafe::Always)
+		{
+			const V sideStrafeSpeed = L::Load(a.sideStrafeSpeed + i);
+			wishspeed = L::Select(L::CmpGt(wishspeed, sideStrafeSpeed), sideStrafeSpeed, wishspeed);
+			accel = L::Load(a.sideStrafeAcceleration + i);
+		}
+		else
+		{
+			accel = L::Select(L::CmpLt(L::Add(L::Mul(vx, nx), L::Mul(vy, ny)), zero), L::Load(a.airDecceleration + i), L::Load(a.airAcceleration + i));
+			if constexpr (TRuleset::AirStrafe == EAirStrafe::Sideways)
+			{
+				const V sideStrafe = L::And(L::CmpEq(forwardMove, zero), L::CmpNeq(rightMove, zero));
+				const V sideStrafeSpeed = L::Load(a.sideStrafeSpeed + i);
+				wishspeed = L::Select(L::And(sideStrafe, L::CmpGt(wishspeed, sideStrafeSpeed)), sideStrafeSpeed, wishspeed);
+				accel = L::Select(sideStrafe, L::Load(a.sideStrafeAcceleration + i), accel);
+			}
+		}
+
+		// Air move: accelerate
+		V avx = vx;
+		V avy = vy;
+		{
+			const V addspeed = L::Sub(wishspeed, L::Add(L::Mul(vx, nx), L::Mul(vy, ny)));
+			V accelspeed = L::Mul(L::Mul(accel, vdt), wishspeed);
+			accelspeed = L::Select(L::CmpGt(accelspeed, addspeed), addspeed, accelspeed);
+			const V accelerate = L::CmpGt(addspeed, zero);
+			avx = L::Select(accelerate, L::Add(avx, L::Mul(accelspeed, nx)), avx);
+			avy = L::Select(accelerate, L::Add(avy, L::Mul(accelspeed, ny)), avy);
+		}
+
+		// Air move: air control
+		V dirX = nx;
+		V dirY = ny;
+		if constexpr (TRuleset::AirControl)
+		{
+			const V k32 = L::Set1(32.f);
+			const V airControl = L::Load(a.airControl + i);
+			const V applyAirControl = L::And(L::CmpGt(airControl, zero), L::And(L::CmpNeq(forwardMove, zero), L::CmpNeq(wishspeed2, zero)));
+
+			const V speed = L::Sqrt(L::Add(L::Mul(avx, avx), L::Mul(avy, avy)));
+			const V hasSpeed = L::CmpGt(speed, zero);
+			const V invSpeed = L::Div(one, L::Select(hasSpeed, speed, one));
+			V ux = L::Select(hasSpeed, L::Mul(avx, invSpeed), avx);
+			V uy = L::Select(hasSpeed, L::Mul(avy, invSpeed), avy);
+
+			const V dot = L::Add(L::Mul(ux, nx), L::Mul(uy, ny));
+			const V k = L::Mul(k32, L::Mul(L::Mul(L::Mul(airControl, dot), dot), vdt));
+
+			const V steer = L::CmpGt(dot, zero);
+			const V px = L::Add(L::Mul(ux, speed), L::Mul(nx, k));
+			const V py = L::Add(L::Mul(uy, speed), L::Mul(ny, k));
+			const V steerLength = L::Sqrt(L::Add(L::Mul(px, px), L::Mul(py, py)));
+			const V hasSteerLength = L::CmpGt(steerLength, zero);
+			const V invSteerLength = L::Div(one, L::Select(hasSteerLength, steerLength, one));
+			ux = L::Select(steer, L::Select(hasSteerLength, L::Mul(px, invSteerLength), px), ux);
+			uy = L::Select(steer, L::Select(hasSteerLength, L::Mul(py, invSteerLength), py), uy);
+
+			const V steerDir = L::And(applyAirControl, steer);
+			dirX = L::Select(steerDir, ux, dirX);
+			dirY = L::Select(steerDir, uy, dirY);
+
+			avx = L::Select(applyAirControl, L::Mul(ux, speed), avx);
+			avy = L::Select(applyAirControl, L::Mul(uy, speed), avy);
+		}
+		V avz = L::Sub(vz, L::Mul(L::Load(a.gravity + i), vdt));
+
+		// Air move: slide down planes too steep to stand on
+		{
+			const V backoff = L::Add(L::Add(L::Mul(avx, groundNormalX), L::Mul(avy, groundNormalY)), L::Mul(avz, groundNormalZ));
+			const V clip = L::And(L::LoadMask(a.onSteepPlane + i), L::CmpLt(backoff, zero));
+			const V overclipped = L::Mul(backoff, L::Set1(PMove::Overclip));
+			avx = L::Select(clip, L::Sub(avx, L::Mul(groundNormalX, overclipped)), avx);
+			avy = L::Select(clip, L::Sub(avy, L::Mul(groundNormalY, overclipped)), avy);
+			avz = L::Select(clip, L::Sub(avz, L::Mul(groundNormalZ, overclipped)), avz);
+		}
+
+		// Blend the ground and air results, dead players keep their state
+		const V groundAlive = L::And(ground, alive);
+		const V airAlive = L::AndNot(ground, alive);
+		L::Store(a.velocityX + i, L::Select(groundAlive, gvx, L::Select(airAlive, avx, vx)));
+		L::Store(a.velocityY + i, L::Select(groundAlive, gvy, L::Select(airAlive, avy, vy)));
+		L::Store(a.velocityZ + i, L::Select(groundAlive, gvz, L::Select(airAlive, avz, vz)));
+		L::Store(a.moveDirX + i, L::Select(alive, L::Select(ground, nx, dirX), L::Load(a.moveDirX + i)));
+		L::Store(a.moveDirY + i, L::Select(alive, L::Select(ground, ny, dirY), L::Load(a.moveDirY + i)));
+		L::Store(a.moveDirZ + i, L::Select(alive, zero, L::Load(a.moveDirZ + i)));
+
+		int jumpLanes = L::MoveMask(L::And(groundAlive, wishJump));
+		while (jumpLanes != 0)
+		{
+			const int lane = CountTrailingZeros(jumpLanes);
+			a.jumped[i + lane] = true;
+			a.wishJump[i + lane] = false;
+			jumpLanes &= jumpLanes - 1;
+		}
+	}
+}
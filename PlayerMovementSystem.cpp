@@ -0,0 +1,284 @@
+#include "PlayerMovementSystem.h"
+
+
+// Keep in sync with the per player arrays declared in the header
+template<typename TFunc>
+void CPlayerMovementSystem::ForEachArray(TFunc&& func)
+{
+	func(m_velocityX); func(m_velocityY); func(m_velocityZ);
+	func(m_moveDirX); func(m_moveDirY); func(m_moveDirZ);
+	func(m_yaw);
+	func(m_forwardMove); func(m_rightMove); func(m_upMove);
+	func(m_onGround); func(m_wishJump); func(m_jumpHeld); func(m_jumped); func(m_alive);
+	func(m_onSteepPlane);
+	func(m_groundNormalX); func(m_groundNormalY); func(m_groundNormalZ); func(m_surfaceFriction);
+	func(m_gravity); func(m_friction); func(m_moveSpeed);
+	func(m_runAcceleration); func(m_runDeacceleration);
+	func(m_airAcceleration); func(m_airDecceleration); func(m_airControl);
+	func(m_sideStrafeAcceleration); func(m_sideStrafeSpeed);
+	func(m_jumpSpeed); func(m_jumpImpulse);
+	func(m_holdJumpToBhop);
+}
+
+CPlayerMovementSystem::Handle CPlayerMovementSystem::Add()
+{
+	return Add(m_defaultParams);
+}
+
+CPlayerMovementSystem::Handle CPlayerMovementSystem::Add(const PMoveParams& params)
+{
+	Handle handle;
+	if (!m_freeHandles.empty())
+	{
+		handle = m_freeHandles.back();
+		m_freeHandles.pop_back();
+	}
+	else
+	{
+		handle = static_cast<Handle>(m_denseIndexByHandle.size());
+		m_denseIndexByHandle.push_back(InvalidHandle);
+	}
+
+	m_denseIndexByHandle[handle] = static_cast<uint32_t>(m_handleByDenseIndex.size());
+	m_handleByDenseIndex.push_back(handle);
+	PushBack(params);
+
+	return handle;
+}
+
+void CPlayerMovementSystem::Remove(Handle handle)
+{
+	if (!IsValid(handle))
+		return;
+
+	// Swap the last player into the freed slot to keep the arrays packed
+	const uint32_t index = m_denseIndexByHandle[handle];
+	const uint32_t last = static_cast<uint32_t>(m_handleByDenseIndex.size() - 1);
+	if (index != last)
+	{
+		MoveDense(last, index);
+		m_handleByDenseIndex[index] = m_handleByDenseIndex[last];
+		m_denseIndexByHandle[m_handleByDenseIndex[index]] = index;
+	}
+
+	m_handleByDenseIndex.pop_back();
+	PopBack();
+
+	m_denseIndexByHandle[handle] = InvalidHandle;
+	m_freeHandles.push_back(handle);
+}
+
+void CPlayerMovementSystem::SetAlive(Handle handle, bool isAlive)
+{
+	m_alive[m_denseIndexByHandle[handle]] = isAlive;
+}
+
+void CPlayerMovementSystem::SetParams(Handle handle, const PMoveParams& params)
+{
+	const uint32_t i = m_denseIndexByHandle[handle];
+
+	m_gravity[i] = params.gravity;
+	m_friction[i] = params.friction;
+	m_moveSpeed[i] = params.moveSpeed;
+	m_runAcceleration[i] = params.runAcceleration;
+	m_runDeacceleration[i] = params.runDeacceleration;
+	m_airAcceleration[i] = params.airAcceleration;
+	m_airDecceleration[i] = params.airDecceleration;
+	m_airControl[i] = params.airControl;
+	m_sideStrafeAcceleration[i] = params.sideStrafeAcceleration;
+	m_sideStrafeSpeed[i] = params.sideStrafeSpeed;
+	m_jumpSpeed[i] = params.jumpSpeed;
+	m_jumpImpulse[i] = params.jumpImpulse;
+	m_holdJumpToBhop[i] = params.holdJumpToBhop;
+}
+
+PMoveParams CPlayerMovementSystem::GetParams(Handle handle) const
+{
+	const uint32_t i = m_denseIndexByHandle[handle];
+
+	PMoveParams params;
+	params.gravity = m_gravity[i];
+	params.friction = m_friction[i];
+	params.moveSpeed = m_moveSpeed[i];
+	params.runAcceleration = m_runAcceleration[i];
+	params.runDeacceleration = m_runDeacceleration[i];
+	params.airAcceleration = m_airAcceleration[i];
+	params.airDecceleration = m_airDecceleration[i];
+	params.airControl = m_airControl[i];
+	params.sideStrafeAcceleration = m_sideStrafeAcceleration[i];
+	params.sideStrafeSpeed = m_sideStrafeSpeed[i];
+	params.jumpSpeed = m_jumpSpeed[i];
+	params.jumpImpulse = m_jumpImpulse[i];
+	params.holdJumpToBhop = m_holdJumpToBhop[i] != 0;
+	return params;
+}
+
+void CPlayerMovementSystem::SetInput(Handle handle, const Cmd& cmd, float yaw, bool onGround)
+{
+	PMoveGroundContact ground;
+	ground.onGround = onGround;
+	SetInput(handle, cmd, yaw, ground);
+}
+
+void CPlayerMovementSystem::SetInput(Handle handle, const Cmd& cmd, float yaw, const PMoveGroundContact& ground)
+{
+	const uint32_t i = m_denseIndexByHandle[handle];
+
+	m_forwardMove[i] = cmd.forwardMove;
+	m_rightMove[i] = cmd.rightMove;
+	m_upMove[i] = cmd.upMove;
+	m_yaw[i] = yaw;
+	m_onGround[i] = ground.onGround;
+	m_onSteepPlane[i] = ground.onSteepPlane;
+	m_groundNormalX[i] = ground.normal.x;
+	m_groundNormalY[i] = ground.normal.y;
+	m_groundNormalZ[i] = ground.normal.z;
+	m_surfaceFriction[i] = ground.surfaceFriction;
+
+	if (m_holdJumpToBhop[i])
+		m_wishJump[i] = cmd.jump;
+	else if (cmd.jump && !m_jumpHeld[i])
+		m_wishJump[i] = true;
+	else if (!cmd.jump)
+		m_wishJump[i] = false;
+	m_jumpHeld[i] = cmd.jump;
+}
+
+void CPlayerMovementSystem::SetWishJump(Handle handle, bool wishJump)
+{
+	m_wishJump[m_denseIndexByHandle[handle]] = wishJump;
+}
+
+void CPlayerMovementSystem::SetState(Handle handle, const PMoveState& state)
+{
+	const uint32_t i = m_denseIndexByHandle[handle];
+
+	m_velocityX[i] = state.velocity.x;
+	m_velocityY[i] = state.velocity.y;
+	m_velocityZ[i] = state.velocity.z;
+	m_moveDirX[i] = state.moveDirectionNorm.x;
+	m_moveDirY[i] = state.moveDirectionNorm.y;
+	m_moveDirZ[i] = state.moveDirectionNorm.z;
+	m_yaw[i] = state.yaw;
+	m_onGround[i] = state.onGround;
+	m_onSteepPlane[i] = state.onSteepPlane;
+	m_groundNormalX[i] = state.groundNormal.x;
+	m_groundNormalY[i] = state.groundNormal.y;
+	m_groundNormalZ[i] = state.groundNormal.z;
+	m_surfaceFriction[i] = state.surfaceFriction;
+	m_wishJump[i] = state.wishJump;
+	m_jumpHeld[i] = state.jumpHeld;
+	m_jumped[i] = state.jumped;
+}
+
+PMoveState CPlayerMovementSystem::GetState(Handle handle) const
+{
+	const uint32_t i = m_denseIndexByHandle[handle];
+
+	PMoveState state;
+	state.velocity = PMoveVec3(m_velocityX[i], m_velocityY[i], m_velocityZ[i]);
+	state.moveDirectionNorm = PMoveVec3(m_moveDirX[i], m_moveDirY[i], m_moveDirZ[i]);
+	state.yaw = m_yaw[i];
+	state.onGround = m_onGround[i] != 0;
+	state.onSteepPlane = m_onSteepPlane[i] != 0;
+	state.groundNormal = PMoveVec3(m_groundNormalX[i], m_groundNormalY[i], m_groundNormalZ[i]);
+	state.surfaceFriction = m_surfaceFriction[i];
+	state.wishJump = m_wishJump[i] != 0;
+	state.jumpHeld = m_jumpHeld[i] != 0;
+	state.jumped = m_jumped[i] != 0;
+	return state;
+}
+
+bool CPlayerMovementSystem::ConsumeJump(Handle handle)
+{
+	const uint32_t i = m_denseIndexByHandle[handle];
+
+	const bool jumped = m_jumped[i] != 0;
+	m_jumped[i] = false;
+	return jumped;
+}
+
+SPlayerMovementArrays CPlayerMovementSystem::GetArrays(uint32_t begin)
+{
+	SPlayerMovementArrays arrays;
+	arrays.velocityX = m_velocityX.data() + begin;
+	arrays.velocityY = m_velocityY.data() + begin;
+	arrays.velocityZ = m_velocityZ.data() + begin;
+	arrays.moveDirX = m_moveDirX.data() + begin;
+	arrays.moveDirY = m_moveDirY.data() + begin;
+	arrays.moveDirZ = m_moveDirZ.data() + begin;
+	arrays.yaw = m_yaw.data() + begin;
+	arrays.forwardMove = m_forwardMove.data() + begin;
+	arrays.rightMove = m_rightMove.data() + begin;
+	arrays.onGround = m_onGround.data() + begin;
+	arrays.onSteepPlane = m_onSteepPlane.data() + begin;
+	arrays.groundNormalX = m_groundNormalX.data() + begin;
+	arrays.groundNormalY = m_groundNormalY.data() + begin;
+	arrays.groundNormalZ = m_groundNormalZ.data() + begin;
+	arrays.surfaceFriction = m_surfaceFriction.data() + begin;
+	arrays.wishJump = m_wishJump.data() + begin;
+	arrays.jumped = m_jumped.data() + begin;
+	arrays.alive = m_alive.data() + begin;
+	arrays.gravity = m_gravity.data() + begin;
+	arrays.friction = m_friction.data() + begin;
+	arrays.moveSpeed = m_moveSpeed.data() + begin;
+	arrays.runAcceleration = m_runAcceleration.data() + begin;
+	arrays.runDeacceleration = m_runDeacceleration.data() + begin;
+	arrays.airAcceleration = m_airAcceleration.data() + begin;
+	arrays.airDecceleration = m_airDecceleration.data() + begin;
+	arrays.airControl = m_airControl.data() + begin;
+	arrays.sideStrafeAcceleration = m_sideStrafeAcceleration.data() + begin;
+	arrays.sideStrafeSpeed = m_sideStrafeSpeed.data() + begin;
+	return arrays;
+}
+
+void CPlayerMovementSystem::Step(float dt)
+{
+	const uint32_t count = static_cast<uint32_t>(m_handleByDenseIndex.size());
+	if (m_pJobPool == nullptr || count <= PlayersPerJob)
+	{
+		m_pRuleset->pStep(GetArrays(0), count, dt, m_simdLevel);
+		return;
+	}
+
+	// Players only read and write their own lanes, so chunks need no synchronization
+	m_pJobPool->ParallelFor(count, PlayersPerJob, [this, dt](uint32_t begin, uint32_t end)
+	{
+		m_pRuleset->pStep(GetArrays(begin), end - begin, dt, m_simdLevel);
+	});
+}
+
+void CPlayerMovementSystem::SetRuleset(const SMovementRuleset& ruleset)
+{
+	m_pRuleset = &ruleset;
+	SetDefaultParams(ruleset.defaultParams);
+}
+
+void CPlayerMovementSystem::SetDefaultParams(const PMoveParams& params)
+{
+	m_defaultParams = params;
+	for (const Handle handle : m_handleByDenseIndex)
+	{
+		SetParams(handle, params);
+	}
+}
+
+void CPlayerMovementSystem::PushBack(const PMoveParams& params)
+{
+	ForEachArray([](auto& values) { values.emplace_back(); });
+	SetParams(m_handleByDenseIndex.back(), params);
+
+	// Flat ground until the first input says otherwise
+	m_groundNormalZ.back() = 1.f;
+	m_surfaceFriction.back() = 1.f;
+}
+
+void CPlayerMovementSystem::MoveDense(uint32_t from, uint32_t to)
+{
+	ForEachArray([from, to](auto& values) { values[to] = values[from]; });
+}
+
+void CPlayerMovementSystem::PopBack()
+{
+	ForEachArray([](auto& values) { values.pop_back(); });
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "PlayerMovement.h"
+#include "PlayerMovementBatch.h"
+#include "MovementRuleset.h"
+#include "WorkStealingPool.h"
+
+#include <cstdint>
+#include <vector>
+
+////////////////////////////////////////////////////////
+// Batch movement solver for every player on a server
+// Player state and tuning are kept in structure-of-arrays form and
+// advanced in a single loop per tick, players only keep a handle.
+// Produces the same results as PMove::Move for each player, using the
+// widest SIMD instruction set the CPU supports. Large servers can split
+// the step across the cores of a CWorkStealingPool.
+////////////////////////////////////////////////////////
+class CPlayerMovementSystem
+{
+public:
+	using Handle = uint32_t;
+	static constexpr Handle InvalidHandle = UINT32_MAX;
+	// Share of a step handed to a pool thread at once, a multiple of every SIMD width and of a cache line of flags.
+	// Up to this many players are stepped on the calling thread, a few microseconds of work don't pay for waking workers.
+	static constexpr uint32_t PlayersPerJob = 256;
+
+	// Added with the default tuning, see SetDefaultParams
+	Handle Add();
+	Handle Add(const PMoveParams& params);
+	void Remove(Handle handle);
+	bool IsValid(Handle handle) const { return handle < m_denseIndexByHandle.size() && m_denseIndexByHandle[handle] != InvalidHandle; }
+
+	// Dead players are kept in the arrays but skipped by Step
+	void SetAlive(Handle handle, bool isAlive);
+
+	void SetParams(Handle handle, const PMoveParams& params);
+	PMoveParams GetParams(Handle handle) const;
+
+	// Input gathered from the engine before a tick, also queues the command's jump as PMove::QueueJump does
+	void SetInput(Handle handle, const Cmd& cmd, float yaw, const PMoveGroundContact& ground);
+	// Same on flat ground with default friction
+	void SetInput(Handle handle, const Cmd& cmd, float yaw, bool onGround);
+	void SetWishJump(Handle handle, bool wishJump);
+
+	void SetState(Handle handle, const PMoveState& state);
+	PMoveState GetState(Handle handle) const;
+
+	// Returns whether a ground jump triggered since the last call, physics is expected to apply the impulse
+	bool ConsumeJump(Handle handle);
+	// Whether a ground jump triggered that ConsumeJump hasn't returned yet
+	bool HasPendingJump(Handle handle) const { return m_jumped[m_denseIndexByHandle[handle]] != 0; }
+
+	// Advances every alive player by one tick
+	void Step(float dt);
+
+	// Every player moves by the same ruleset, switching also resets everyone to its default tuning
+	void SetRuleset(const SMovementRuleset& ruleset);
+	const SMovementRuleset& GetRuleset() const { return *m_pRuleset; }
+
+	// Tuning of every player, and of the players added after, e.g. a reloaded tuning profile. SetRuleset resets it to the ruleset's.
+	void SetDefaultParams(const PMoveParams& params);
+	const PMoveParams& GetDefaultParams() const { return m_defaultParams; }
+
+	// Defaults to the best supported level, lowering it is mostly useful to compare paths
+	void SetSimdLevel(PMoveBatch::ESimdLevel level) { m_simdLevel = level; }
+	PMoveBatch::ESimdLevel GetSimdLevel() const { return m_simdLevel; }
+
+	// Step splits the players across the pool, nullptr steps them on the calling thread. The pool has to outlive its use here.
+	void SetJobPool(CWorkStealingPool* pJobPool) { m_pJobPool = pJobPool; }
+	CWorkStealingPool* GetJobPool() const { return m_pJobPool; }
+
+	size_t GetPlayerCount() const { return m_handleByDenseIndex.size(); }
+
+private:
+	void PushBack(const PMoveParams& params);
+	void MoveDense(uint32_t from, uint32_t to);
+	void PopBack();
+	template<typename TFunc> void ForEachArray(TFunc&& func);
+	// Views of the arrays starting at player begin
+	SPlayerMovementArrays GetArrays(uint32_t begin);
+
+	// Handles stay stable, the arrays below are kept densely packed
+	std::vector<uint32_t> m_denseIndexByHandle;
+	std::vector<Handle> m_handleByDenseIndex;
+	std::vector<Handle> m_freeHandles;
+
+	PMoveBatch::ESimdLevel m_simdLevel = PMoveBatch::GetSupportedSimdLevel();
+	const SMovementRuleset* m_pRuleset = &PMoveRulesets::GetDefault();
+	PMoveParams m_defaultParams = PMoveRulesets::GetDefault().defaultParams;
+	CWorkStealingPool* m_pJobPool = nullptr;
+
+	// Per player state
+	std::vector<float> m_velocityX, m_velocityY, m_velocityZ;
+	std::vector<float> m_moveDirX, m_moveDirY, m_moveDirZ;
+	std::vector<float> m_yaw;
+	std::vector<float> m_forwardMove, m_rightMove, m_upMove;
+	std::vector<uint8_t> m_onGround, m_wishJump, m_jumpHeld, m_jumped, m_alive;
+	std::vector<uint8_t> m_onSteepPlane;
+	std::vector<float> m_groundNormalX, m_groundNormalY, m_groundNormalZ, m_surfaceFriction;
+
+	// Per player tuning
+	std::vector<float> m_gravity, m_friction, m_moveSpeed;
+	std::vector<float> m_runAcceleration, m_runDeacceleration;
+	std::vector<float> m_airAcceleration, m_airDecceleration, m_airControl;
+	std::vector<float> m_sideStrafeAcceleration, m_sideStrafeSpeed;
+	std::vector<float> m_jumpSpeed, m_jumpImpulse;
+	std::vector<uint8_t> m_holdJumpToBhop;
+};
@@ -0,0 +1,117 @@
+#include "PlayerPrediction.h"
+
+void CMovementPredictor::Record(const Cmd& cmd, const PMoveGroundContact& ground)
+{
+	SPredictedCmd& predictedCmd = m_cmds.Insert(cmd.sequence);
+	predictedCmd.cmd = cmd;
+	predictedCmd.ground = ground;
+	predictedCmd.position = PMoveVec3();
+
+	m_newestSequence = cmd.sequence;
+}
+
+void CMovementPredictor::RecordPosition(uint32_t sequence, const PMoveVec3& position)
+{
+	if (SPredictedCmd* pPredictedCmd = m_cmds.Find(sequence))
+	{
+		pPredictedCmd->position = position;
+	}
+}
+
+bool CMovementPredictor::Reconcile(uint32_t ackedSequence, const PMoveState& serverState, const PMoveParams& params, float dt, PMoveState& predictedState, PMove::MoveFunc pMove) const
+{
+	// Signed distance so the comparison survives sequence wrap around
+	if (static_cast<int32_t>(m_newestSequence - ackedSequence) < 0 || m_cmds.Find(ackedSequence) == nullptr)
+		return false;
+
+	PMoveState state = serverState;
+	for (uint32_t sequence = ackedSequence + 1; sequence != m_newestSequence + 1; ++sequence)
+	{
+		const SPredictedCmd* pPredictedCmd = m_cmds.Find(sequence);
+		if (pPredictedCmd == nullptr)
+			break;
+
+		state.yaw = pPredictedCmd->cmd.yaw;
+		PMove::SetGroundContact(state, pPredictedCmd->ground);
+		PMove::QueueJump(state, params, pPredictedCmd->cmd);
+		state = pMove(state, params, pPredictedCmd->cmd, dt);
+	}
+
+	// Jumps were already handed to physics when the commands were first predicted
+	state.jumped = false;
+	predictedState = state;
+	return true;
+}
+
+bool CMovementPredictor::GetPositionError(uint32_t ackedSequence, const PMoveVec3& serverPosition, PMoveVec3& error) const
+{
+	const SPredictedCmd* pPredictedCmd = m_cmds.Find(ackedSequence);
+	if (pPredictedCmd == nullptr)
+		return false;
+
+	error = serverPosition - pPredictedCmd->position;
+	return true;
+}
+
+void CMovementPredictor::Reset()
+{
+	m_cmds.Clear();
+	m_newestSequence = 0;
+}
+
+void CServerCmdQueue::Receive(const Cmd& cmd)
+{
+	if (static_cast<int32_t>(cmd.sequence - m_lastProcessedSequence) <= 0 || m_cmds.Find(cmd.sequence) != nullptr)
+		return;
+
+	m_cmds.Insert(cmd.sequence) = cmd;
+	if (static_cast<int32_t>(cmd.sequence - m_newestSequence) > 0)
+	{
+		m_newestSequence = cmd.sequence;
+	}
+}
+
+Cmd CServerCmdQueue::Pop()
+{
+	uint32_t firstSequence = m_lastProcessedSequence + 1;
+	if (static_cast<int32_t>(m_newestSequence - firstSequence) < 0)
+		return m_lastCmd;
+
+	// Skip over commands too far behind the client, and over commands that were lost for good, the client has moved on from them
+	bool hasSkippedJump = false;
+	if (m_newestSequence - firstSequence > JitterMargin)
+	{
+		const uint32_t keptSequence = m_newestSequence - JitterMargin;
+		if (m_newestSequence - firstSequence >= CmdCapacity)
+		{
+			firstSequence = m_newestSequence - CmdCapacity + 1;
+		}
+		for (uint32_t sequence = firstSequence; sequence != keptSequence; ++sequence)
+		{
+			const Cmd* pCmd = m_cmds.Find(sequence);
+			hasSkippedJump |= pCmd != nullptr && pCmd->jump;
+		}
+		firstSequence = keptSequence;
+	}
+
+	for (uint32_t sequence = firstSequence; static_cast<int32_t>(m_newestSequence - sequence) >= 0; ++sequence)
+	{
+		if (const Cmd* pCmd = m_cmds.Find(sequence))
+		{
+			m_lastCmd = *pCmd;
+			m_lastCmd.jump |= hasSkippedJump;
+			m_lastProcessedSequence = sequence;
+			return m_lastCmd;
+		}
+	}
+
+	return m_lastCmd;
+}
+
+void CServerCmdQueue::Reset()
+{
+	m_cmds.Clear();
+	m_lastCmd = Cmd();
+	m_lastProcessedSequence = 0;
+	m_newestSequence = 0;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "PlayerMovement.h"
+#include "SequenceRing.h"
+
+#include <cstdint>
+
+////////////////////////////////////////////////////////
+// Client side prediction and server reconciliation
+// The client keeps every command the server hasn't acknowledged yet.
+// When authoritative state arrives it rewinds to it and re-simulates
+// the newer commands with the movement kernel. Everything is fixed
+// size, nothing allocates.
+////////////////////////////////////////////////////////
+
+// Client: history of locally predicted commands
+class CMovementPredictor
+{
+public:
+	// 500 ms at 128 Hz, so replay keeps working well past the usual round trip
+	static constexpr uint32_t CmdCapacity = 64;
+
+	struct SPredictedCmd
+	{
+		Cmd cmd;
+		PMoveGroundContact ground;            // Ground contact the command was predicted with
+		PMoveVec3 position;                   // Entity position once the command was predicted
+	};
+
+	// Stores a command before it is simulated locally and sent to the server
+	void Record(const Cmd& cmd, const PMoveGroundContact& ground);
+	void RecordPosition(uint32_t sequence, const PMoveVec3& position);
+
+	// Rewinds to the server's state after ackedSequence and re-simulates every newer command.
+	// Returns false if nothing needed replaying, e.g. for stale or duplicate acks.
+	// pMove has to be the server's ruleset, see SMovementRuleset.
+	bool Reconcile(uint32_t ackedSequence, const PMoveState& serverState, const PMoveParams& params, float dt, PMoveState& predictedState, PMove::MoveFunc pMove = &PMove::Move) const;
+
+	// Difference between the server position and what was predicted for the same command
+	bool GetPositionError(uint32_t ackedSequence, const PMoveVec3& serverPosition, PMoveVec3& error) const;
+
+	uint32_t GetNewestSequence() const { return m_newestSequence; }
+	void Reset();
+
+private:
+	CSequenceRing<SPredictedCmd, CmdCapacity> m_cmds;
+	uint32_t m_newestSequence = 0;
+};
+
+// Server: commands received from a client, consumed one per tick in sequence order
+class CServerCmdQueue
+{
+public:
+	static constexpr uint32_t CmdCapacity = 64;
+	// Commands that may wait behind the one being popped, enough to ride out a few ticks of delivery jitter
+	static constexpr uint32_t JitterMargin = 3;
+
+	// Duplicates and commands older than the last processed one are ignored
+	void Receive(const Cmd& cmd);
+
+	// Next command to simulate. If the client's command hasn't arrived yet the last one is repeated
+	// without consuming a sequence number, like Quake 3 does for dropped packets.
+	// One command is popped per tick, so a backlog from late commands arriving at once would never
+	// drain: commands more than JitterMargin behind the newest are skipped, a jump held in any of
+	// them carried over into the popped command.
+	Cmd Pop();
+
+	// Acknowledged back to the client together with the resulting state
+	uint32_t GetLastProcessedSequence() const { return m_lastProcessedSequence; }
+	// Newest command the client has sent, running ahead of the processed one by the commands in flight
+	uint32_t GetNewestSequence() const { return m_newestSequence; }
+	void Reset();
+
+private:
+	CSequenceRing<Cmd, CmdCapacity> m_cmds;
+	Cmd m_lastCmd;
+	uint32_t m_lastProcessedSequence = 0;
+	uint32_t m_newestSequence = 0;
+};
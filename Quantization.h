@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+////////////////////////////////////////////////////////
+// Mapping floats to fixed bit widths for network messages
+// Ranged values are clamped, angles wrap around a full turn.
+////////////////////////////////////////////////////////
+
+namespace PMoveQuantize
+{
+
+constexpr double TwoPi = 6.283185307179586;
+
+inline uint32_t GetMask(uint32_t bitCount)
+{
+	return bitCount >= 32 ? 0xFFFFFFFFu : (1u << bitCount) - 1;
+}
+
+inline uint32_t QuantizeRange(float value, float min, float max, uint32_t bitCount)
+{
+	const uint32_t maxValue = GetMask(bitCount);
+	const double t = (static_cast<double>(value) - min) / (static_cast<double>(max) - min);
+	// Also catches NaN
+	if (!(t > 0.0))
+		return 0;
+	if (t >= 1.0)
+		return maxValue;
+	return static_cast<uint32_t>(t * maxValue + 0.5);
+}
+
+inline float DequantizeRange(uint32_t value, float min, float max, uint32_t bitCount)
+{
+	return static_cast<float>(min + (static_cast<double>(max) - min) * value / GetMask(bitCount));
+}
+
+inline uint32_t QuantizeAngle(float value, uint32_t bitCount)
+{
+	double turns = value / TwoPi;
+	turns -= std::floor(turns);
+	if (!(turns >= 0.0))
+		return 0;
+	return static_cast<uint32_t>(turns * (static_cast<double>(GetMask(bitCount)) + 1.0) + 0.5) & GetMask(bitCount);
+}
+
+inline float DequantizeAngle(uint32_t value, uint32_t bitCount)
+{
+	const double angle = value * TwoPi / (static_cast<double>(GetMask(bitCount)) + 1.0);
+	return static_cast<float>(angle > TwoPi * 0.5 ? angle - TwoPi : angle);
+}
+
+}
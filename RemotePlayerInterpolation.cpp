@@ -0,0 +1,150 @@
+#include "RemotePlayerInterpolation.h"
+
+#include <cmath>
+
+namespace
+{
+	// Weight of a new measurement in the running estimates, RFC 3550 uses 1/16 for jitter
+	const double EstimateGain = 1.0 / 16.0;
+	const float TwoPi = 6.2831853f;
+
+	float LerpAngle(float from, float to, float alpha)
+	{
+		return from + std::remainder(to - from, TwoPi) * alpha;
+	}
+}
+
+bool CRemotePlayerInterpolator::Sample(double localTime, SInterpolationSample& sample)
+{
+	SInterpolationSample incoming;
+	while (m_incoming.Pop(incoming))
+	{
+		Receive(incoming);
+	}
+
+	if (m_sampleCount == 0)
+		return false;
+
+	UpdateRenderDelay(localTime);
+	const double renderTime = localTime - m_transitOffset - m_renderDelay;
+
+	// Snapshots stopped coming or the delay is still adapting, keep the player moving for a moment
+	const SInterpolationSample& newest = GetSample(0);
+	if (renderTime >= newest.serverTime)
+	{
+		const double extrapolation = renderTime - newest.serverTime;
+		const float ahead = static_cast<float>(extrapolation < m_config.maxExtrapolation ? extrapolation : m_config.maxExtrapolation);
+		sample = newest;
+		sample.position = newest.position + newest.velocity * (m_config.velocityScale * ahead);
+		sample.serverTime = renderTime;
+		m_extrapolatedCount += extrapolation > 0.0 ? 1 : 0;
+		return true;
+	}
+
+	for (uint32_t age = 1; age < m_sampleCount; ++age)
+	{
+		const SInterpolationSample& from = GetSample(age);
+		if (from.serverTime > renderTime)
+			continue;
+
+		const SInterpolationSample& to = GetSample(age - 1);
+		const double span = to.serverTime - from.serverTime;
+		const float alpha = static_cast<float>((renderTime - from.serverTime) / span);
+
+		if (m_config.useHermite)
+		{
+			// Velocities are the tangents, so speed is continuous across snapshots and strafe curves stay round
+			const float alpha2 = alpha * alpha;
+			const float alpha3 = alpha2 * alpha;
+			const float tangentScale = m_config.velocityScale * static_cast<float>(span);
+			sample.position = from.position * (2.f * alpha3 - 3.f * alpha2 + 1.f)
+				+ from.velocity * ((alpha3 - 2.f * alpha2 + alpha) * tangentScale)
+				+ to.position * (-2.f * alpha3 + 3.f * alpha2)
+				+ to.velocity * ((alpha3 - alpha2) * tangentScale);
+		}
+		else
+		{
+			sample.position = from.position + (to.position - from.position) * alpha;
+		}
+
+		sample.serverTime = renderTime;
+		sample.arrivalTime = to.arrivalTime;
+		sample.velocity = from.velocity + (to.velocity - from.velocity) * alpha;
+		sample.yaw = LerpAngle(from.yaw, to.yaw, alpha);
+		sample.pitch = from.pitch + (to.pitch - from.pitch) * alpha;
+		sample.onGround = alpha < 0.5f ? from.onGround : to.onGround;
+		return true;
+	}
+
+	// Older than anything kept, only happens right after the delay grew a lot
+	sample = GetSample(m_sampleCount - 1);
+	sample.serverTime = renderTime;
+	return true;
+}
+
+void CRemotePlayerInterpolator::Reset()
+{
+	SInterpolationSample incoming;
+	while (m_incoming.Pop(incoming))
+	{
+	}
+
+	m_sampleCount = 0;
+	m_newestIndex = 0;
+	m_transitOffset = 0.0;
+	m_lastTransit = 0.0;
+	m_jitter = 0.0;
+	m_snapshotInterval = 0.0;
+	m_renderDelay = 0.0;
+	m_hasRenderDelay = false;
+	m_lastLocalTime = 0.0;
+	m_extrapolatedCount = 0;
+}
+
+void CRemotePlayerInterpolator::Receive(const SInterpolationSample& sample)
+{
+	const double transit = sample.arrivalTime - sample.serverTime;
+
+	if (m_sampleCount == 0)
+	{
+		m_transitOffset = transit;
+		m_lastTransit = transit;
+	}
+	else
+	{
+		// Reordered or duplicated snapshots can't be interpolated towards anymore
+		const double interval = sample.serverTime - GetSample(0).serverTime;
+		if (interval <= 0.0)
+			return;
+
+		m_snapshotInterval = m_snapshotInterval > 0.0 ? m_snapshotInterval + (interval - m_snapshotInterval) * EstimateGain : interval;
+		m_jitter += (std::fabs(transit - m_lastTransit) - m_jitter) * EstimateGain;
+		m_lastTransit = transit;
+		m_transitOffset += (transit - m_transitOffset) * EstimateGain;
+	}
+
+	m_newestIndex = (m_newestIndex + 1) & (Capacity - 1);
+	m_samples[m_newestIndex] = sample;
+	m_sampleCount = m_sampleCount < Capacity ? m_sampleCount + 1 : Capacity;
+}
+
+void CRemotePlayerInterpolator::UpdateRenderDelay(double localTime)
+{
+	double targetDelay = m_snapshotInterval + m_config.jitterScale * m_jitter;
+	targetDelay = targetDelay < m_config.minDelay ? m_config.minDelay : targetDelay > m_config.maxDelay ? m_config.maxDelay : targetDelay;
+
+	if (!m_hasRenderDelay)
+	{
+		m_renderDelay = targetDelay;
+		m_hasRenderDelay = true;
+	}
+	else
+	{
+		// Slides towards the target, jumping would make the player skip or freeze
+		const double maxStep = m_config.delayAdaptRate * (localTime - m_lastLocalTime);
+		const double step = targetDelay - m_renderDelay;
+		m_renderDelay += step > maxStep ? maxStep : step < -maxStep ? -maxStep : step;
+	}
+
+	m_lastLocalTime = localTime;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "PlayerMovement.h"
+#include "SpscQueue.h"
+
+#include <array>
+#include <cstdint>
+
+////////////////////////////////////////////////////////
+// Jitter buffer for players simulated on another machine
+// The network thread pushes every snapshot of the player with its server
+// time and local arrival time. The render thread draws the player a little
+// in the past, interpolating between the two snapshots around that time.
+// How far in the past adapts to the measured jitter, so a steady
+// connection gets a short delay and a bursty one stops stuttering.
+// The two threads only share a lock-free queue.
+////////////////////////////////////////////////////////
+
+struct SInterpolationSample
+{
+	double serverTime = 0.0;              // When the server simulated this state, in seconds
+	double arrivalTime = 0.0;             // Local clock when it was received, in seconds
+	PMoveVec3 position;
+	PMoveVec3 velocity;
+	float yaw = 0.f;
+	float pitch = 0.f;
+	bool onGround = false;
+};
+
+struct SInterpolationConfig
+{
+	float minDelay = 0.f;                 // Bounds of the render delay behind the newest snapshot, in seconds
+	float maxDelay = 0.5f;
+	float jitterScale = 3.f;              // The delay covers the snapshot interval plus this many times the jitter
+	float delayAdaptRate = 0.1f;          // Seconds of delay change per second, keeps adaptation invisible
+	float maxExtrapolation = 0.1f;        // How long to keep moving a player after the newest snapshot
+	bool useHermite = true;               // Cubic Hermite using the snapshot velocities, linear otherwise
+	float velocityScale = 1.f;            // Position units moved per velocity unit and second
+};
+
+class CRemotePlayerInterpolator
+{
+public:
+	static constexpr uint32_t Capacity = 32;
+
+	explicit CRemotePlayerInterpolator(const SInterpolationConfig& config = SInterpolationConfig()) : m_config(config) {}
+
+	// Network thread. Returns false if the render thread fell a full buffer behind.
+	bool Push(const SInterpolationSample& sample) { return m_incoming.Push(sample); }
+
+	// Render thread. Writes the player at the current render time, its serverTime is the time that was rendered.
+	// Returns false until the first snapshot arrived.
+	bool Sample(double localTime, SInterpolationSample& sample);
+
+	// Render thread
+	float GetRenderDelay() const { return static_cast<float>(m_renderDelay); }
+	float GetJitter() const { return static_cast<float>(m_jitter); }
+	uint32_t GetExtrapolatedCount() const { return m_extrapolatedCount; }
+	void Reset();
+
+private:
+	void Receive(const SInterpolationSample& sample);
+	void UpdateRenderDelay(double localTime);
+	const SInterpolationSample& GetSample(uint32_t age) const { return m_samples[(m_newestIndex - age) & (Capacity - 1)]; }
+
+	SInterpolationConfig m_config;
+	CSpscQueue<SInterpolationSample, Capacity> m_incoming;
+
+	// Everything below belongs to the render thread
+	std::array<SInterpolationSample, Capacity> m_samples;
+	uint32_t m_sampleCount = 0;
+	uint32_t m_newestIndex = 0;
+
+	double m_transitOffset = 0.0;         // Smoothed arrival time minus server time
+	double m_lastTransit = 0.0;
+	double m_jitter = 0.0;                // Mean transit time deviation between consecutive snapshots, as in RFC 3550
+	double m_snapshotInterval = 0.0;      // Smoothed server time between snapshots
+	double m_renderDelay = 0.0;
+	bool m_hasRenderDelay = false;
+	double m_lastLocalTime = 0.0;
+	uint32_t m_extrapolatedCount = 0;
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+// Fixed capacity ring of entries addressed by sequence number, older entries are overwritten
+template<typename T, uint32_t CAPACITY>
+class CSequenceRing
+{
+	static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0, "CAPACITY shall be a power of two!");
+
+public:
+	static constexpr uint32_t Capacity = CAPACITY;
+
+	T& Insert(uint32_t sequence)
+	{
+		Slot& slot = m_slots[sequence & (CAPACITY - 1)];
+		slot.sequence = sequence;
+		slot.isValid = true;
+		return slot.value;
+	}
+
+	// Returns nullptr if the entry was never inserted or has been overwritten since
+	T* Find(uint32_t sequence)
+	{
+		Slot& slot = m_slots[sequence & (CAPACITY - 1)];
+		return slot.isValid && slot.sequence == sequence ? &slot.value : nullptr;
+	}
+
+	const T* Find(uint32_t sequence) const
+	{
+		const Slot& slot = m_slots[sequence & (CAPACITY - 1)];
+		return slot.isValid && slot.sequence == sequence ? &slot.value : nullptr;
+	}
+
+	void Clear()
+	{
+		for (Slot& slot : m_slots)
+		{
+			slot.isValid = false;
+		}
+	}
+
+private:
+	struct Slot
+	{
+		T value;
+		uint32_t sequence = 0;
+		bool isValid = false;
+	};
+
+	std::array<Slot, CAPACITY> m_slots;
+};
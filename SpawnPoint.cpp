@@ -24,4 +24,52 @@ static void RegisterSpawnPointComponent(Schematyc::IEnvRegistrar& registrar)
 	}
 }
 
-CRY_STATIC_AUTO_REGISTER_FUNCTION(&RegisterSpawnPointComponent)
\ No newline at end of file
+CRY_STATIC_AUTO_REGISTER_FUNCTION(&RegisterSpawnPointComponent)
+
+CSpawnPointRegistry& CSpawnPointComponent::GetRegistry()
+{
+	static CSpawnPointRegistry registry;
+	return registry;
+}
+
+Matrix34 CSpawnPointComponent::GetSpawnPointTransform(CSpawnPointRegistry::ESelection selection, const PMoveVec3* pEnemies, size_t enemyCount)
+{
+	CSpawnPointRegistry& registry = GetRegistry();
+	const CSpawnPointRegistry::Handle handle = registry.Select(selection, pEnemies, enemyCount);
+	if (handle == CSpawnPointRegistry::InvalidHandle)
+		return IDENTITY;
+
+	if (IEntity* pEntity = gEnv->pEntitySystem->GetEntity(static_cast<EntityId>(registry.GetUserId(handle))))
+	{
+		return pEntity->GetWorldTM();
+	}
+
+	return IDENTITY;
+}
+
+void CSpawnPointComponent::Initialize()
+{
+	const Vec3 position = m_pEntity->GetWorldPos();
+	m_registryHandle = GetRegistry().Add(PMoveVec3(position.x, position.y, position.z), static_cast<uint32_t>(GetEntityId()));
+}
+
+void CSpawnPointComponent::OnShutDown()
+{
+	GetRegistry().Remove(m_registryHandle);
+	m_registryHandle = CSpawnPointRegistry::InvalidHandle;
+}
+
+Cry::Entity::EventFlags CSpawnPointComponent::GetEventMask() const
+{
+	return Cry::Entity::EEvent::TransformChanged;
+}
+
+void CSpawnPointComponent::ProcessEvent(const SEntityEvent& event)
+{
+	// Points are moved around in the editor, keep the registry in sync
+	if (event.event == Cry::Entity::EEvent::TransformChanged && m_registryHandle != CSpawnPointRegistry::InvalidHandle)
+	{
+		const Vec3 position = m_pEntity->GetWorldPos();
+		GetRegistry().SetPosition(m_registryHandle, PMoveVec3(position.x, position.y, position.z));
+	}
+}
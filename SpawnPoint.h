@@ -4,6 +4,8 @@
 
 #include <CryEntitySystem/IEntitySystem.h>
 
+#include "SpawnPointRegistry.h"
+
 ////////////////////////////////////////////////////////
 // Spawn point
 ////////////////////////////////////////////////////////
@@ -24,22 +26,21 @@ public:
 		desc.SetComponentFlags({ IEntityComponent::EFlags::Transform, IEntityComponent::EFlags::Socket, IEntityComponent::EFlags::Attach });
 	}
 	
-	static Matrix34 GetFirstSpawnPointTransform()
-	{
-		// Spawn at first default spawner
-		IEntityItPtr pEntityIterator = gEnv->pEntitySystem->GetEntityIterator();
-		pEntityIterator->MoveFirst();
-
-		while (!pEntityIterator->IsEnd())
-		{
-			IEntity *pEntity = pEntityIterator->Next();
-
-			if (CSpawnPointComponent* pSpawner = pEntity->GetComponent<CSpawnPointComponent>())
-			{
-				return pSpawner->GetWorldTransformMatrix();
-			}
-		}
-		
-		return IDENTITY;
-	}
+	// IEntityComponent
+	virtual void Initialize() override;
+	virtual void OnShutDown() override;
+
+	virtual Cry::Entity::EventFlags GetEventMask() const override;
+	virtual void ProcessEvent(const SEntityEvent& event) override;
+	// ~IEntityComponent
+
+	// Spawn points register themselves here, so picking one never has to walk the entity system
+	static CSpawnPointRegistry& GetRegistry();
+
+	// Returns IDENTITY if the level has no spawn points
+	static Matrix34 GetSpawnPointTransform(CSpawnPointRegistry::ESelection selection, const PMoveVec3* pEnemies = nullptr, size_t enemyCount = 0);
+	static Matrix34 GetFirstSpawnPointTransform() { return GetSpawnPointTransform(CSpawnPointRegistry::ESelection::First); }
+
+protected:
+	CSpawnPointRegistry::Handle m_registryHandle = CSpawnPointRegistry::InvalidHandle;
 };
@@ -0,0 +1,355 @@
+#include "SpawnPointRegistry.h"
+
+#include <algorithm>
+
+namespace
+{
+	// Caps the temporary grid on sparse levels, the cell size grows instead
+	const uint32_t MaxGridCells = 1 << 16;
+
+	float GetDistanceSq(const PMoveVec3& a, const PMoveVec3& b)
+	{
+		const PMoveVec3 delta = a - b;
+		return delta.x * delta.x + delta.y * delta.y + delta.z * delta.z;
+	}
+
+	// Squared distance from point to the farthest corner of the box
+	float GetFarthestDistanceSq(const PMoveVec3& point, const PMoveVec3& boundsMin, const PMoveVec3& boundsMax)
+	{
+		const float x = std::max(std::fabs(point.x - boundsMin.x), std::fabs(point.x - boundsMax.x));
+		const float y = std::max(std::fabs(point.y - boundsMin.y), std::fabs(point.y - boundsMax.y));
+		const float z = std::max(std::fabs(point.z - boundsMin.z), std::fabs(point.z - boundsMax.z));
+		return x * x + y * y + z * z;
+	}
+}
+
+CSpawnPointRegistry::Handle CSpawnPointRegistry::Add(const PMoveVec3& position, uint32_t userId)
+{
+	Handle handle;
+	if (!m_freeHandles.empty())
+	{
+		handle = m_freeHandles.back();
+		m_freeHandles.pop_back();
+	}
+	else
+	{
+		handle = static_cast<Handle>(m_denseIndexByHandle.size());
+		m_denseIndexByHandle.push_back(InvalidHandle);
+		m_previousUsed.push_back(InvalidHandle);
+		m_nextUsed.push_back(InvalidHandle);
+	}
+
+	m_denseIndexByHandle[handle] = static_cast<uint32_t>(m_handleByDenseIndex.size());
+	m_handleByDenseIndex.push_back(handle);
+	m_positions.push_back(position);
+	m_userIds.push_back(userId);
+	m_isGridDirty = true;
+
+	// Never used, so it goes first
+	m_previousUsed[handle] = InvalidHandle;
+	m_nextUsed[handle] = m_leastRecentlyUsed;
+	(m_leastRecentlyUsed != InvalidHandle ? m_previousUsed[m_leastRecentlyUsed] : m_mostRecentlyUsed) = handle;
+	m_leastRecentlyUsed = handle;
+
+	return handle;
+}
+
+void CSpawnPointRegistry::Remove(Handle handle)
+{
+	if (!IsValid(handle))
+		return;
+
+	// Swap the last point into the freed slot to keep the arrays packed
+	const uint32_t index = m_denseIndexByHandle[handle];
+	const uint32_t last = static_cast<uint32_t>(m_handleByDenseIndex.size() - 1);
+	if (index != last)
+	{
+		m_positions[index] = m_positions[last];
+		m_userIds[index] = m_userIds[last];
+		m_handleByDenseIndex[index] = m_handleByDenseIndex[last];
+		m_denseIndexByHandle[m_handleByDenseIndex[index]] = index;
+	}
+
+	m_handleByDenseIndex.pop_back();
+	m_positions.pop_back();
+	m_userIds.pop_back();
+	Unlink(handle);
+
+	m_denseIndexByHandle[handle] = InvalidHandle;
+	m_freeHandles.push_back(handle);
+	m_isGridDirty = true;
+	m_lastFarthest = m_lastFarthest == handle ? InvalidHandle : m_lastFarthest;
+}
+
+void CSpawnPointRegistry::SetPosition(Handle handle, const PMoveVec3& position)
+{
+	m_positions[m_denseIndexByHandle[handle]] = position;
+	m_isGridDirty = true;
+}
+
+CSpawnPointRegistry::Handle CSpawnPointRegistry::Select(ESelection selection, const PMoveVec3* pEnemies, size_t enemyCount)
+{
+	const uint32_t count = static_cast<uint32_t>(m_positions.size());
+	if (count == 0)
+		return InvalidHandle;
+
+	Handle handle = m_handleByDenseIndex[0];
+	switch (selection)
+	{
+	case ESelection::First:
+		break;
+	case ESelection::RoundRobin:
+		handle = m_handleByDenseIndex[m_roundRobinCursor++ % count];
+		break;
+	case ESelection::FarthestFromEnemies:
+		handle = pEnemies != nullptr && enemyCount > 0 ? SelectFarthest(pEnemies, enemyCount) : m_leastRecentlyUsed;
+		break;
+	case ESelection::LeastRecentlyUsed:
+		handle = m_leastRecentlyUsed;
+		break;
+	}
+
+	Unlink(handle);
+	LinkMostRecentlyUsed(handle);
+	return handle;
+}
+
+CSpawnPointRegistry::Handle CSpawnPointRegistry::SelectFarthest(const PMoveVec3* pEnemies, size_t enemyCount)
+{
+	if (m_isGridDirty)
+	{
+		RebuildGrid();
+	}
+
+	BucketEnemies(pEnemies, enemyCount);
+
+	// Starting from the previous pick, most cells are ruled out by the first enemy near them
+	uint32_t bestIndex = IsValid(m_lastFarthest) ? m_denseIndexByHandle[m_lastFarthest] : 0;
+	float bestDistanceSq = GetNearestEnemyDistanceSq(m_positions[bestIndex], pEnemies, enemyCount, 0, -1.f);
+
+	m_candidateCells.clear();
+	for (uint32_t cell = 0; cell < m_cells.size(); ++cell)
+	{
+		if (BoundCell(m_cells[cell], pEnemies, bestDistanceSq))
+		{
+			m_candidateCells.push_back(cell);
+		}
+	}
+
+	std::sort(m_candidateCells.begin(), m_candidateCells.end(), [this](uint32_t a, uint32_t b)
+	{
+		return m_cells[a].farthestDistanceSq > m_cells[b].farthestDistanceSq;
+	});
+
+	for (const uint32_t cellIndex : m_candidateCells)
+	{
+		const SCell& cell = m_cells[cellIndex];
+		if (cell.farthestDistanceSq <= bestDistanceSq)
+			break;
+
+		for (uint32_t i = cell.begin; i < cell.end; ++i)
+		{
+			const uint32_t index = m_cellPoints[i];
+			const float distanceSq = GetNearestEnemyDistanceSq(m_positions[index], pEnemies, enemyCount, cell.nearEnemy, bestDistanceSq);
+			if (distanceSq > bestDistanceSq)
+			{
+				bestDistanceSq = distanceSq;
+				bestIndex = index;
+			}
+		}
+	}
+
+	m_lastFarthest = m_handleByDenseIndex[bestIndex];
+	return m_lastFarthest;
+}
+
+float CSpawnPointRegistry::GetNearestEnemyDistanceSq(const PMoveVec3& position, const PMoveVec3* pEnemies, size_t enemyCount, uint32_t firstEnemy, float stopDistanceSq) const
+{
+	// Starting with an enemy that's likely near, the search stops once one is no farther than stopDistanceSq
+	float distanceSq = GetDistanceSq(position, pEnemies[firstEnemy]);
+	for (size_t enemy = 0; enemy < enemyCount && distanceSq > stopDistanceSq; ++enemy)
+	{
+		distanceSq = std::min(distanceSq, GetDistanceSq(position, pEnemies[enemy]));
+	}
+	return distanceSq;
+}
+
+void CSpawnPointRegistry::BucketEnemies(const PMoveVec3* pEnemies, size_t enemyCount)
+{
+	m_enemyGridSize = 1;
+	while (m_enemyGridSize < MaxEnemyGridSize && 2 * (m_enemyGridSize + 1) * (m_enemyGridSize + 1) <= enemyCount)
+	{
+		++m_enemyGridSize;
+	}
+	m_enemyBucketWidth = std::max((m_levelMax.x - m_levelMin.x) / m_enemyGridSize, 1e-3f);
+	m_enemyBucketHeight = std::max((m_levelMax.y - m_levelMin.y) / m_enemyGridSize, 1e-3f);
+
+	// Counting sort, enemies outside of the spawn points' bounds go to the border buckets
+	const uint32_t bucketCount = m_enemyGridSize * m_enemyGridSize;
+	m_enemyBucketStart.assign(bucketCount + 1, 0);
+	m_enemyBucketByEnemy.resize(enemyCount);
+	m_enemyBuckets.resize(enemyCount);
+	for (size_t i = 0; i < enemyCount; ++i)
+	{
+		const float maxBucket = static_cast<float>(m_enemyGridSize - 1);
+		const float column = std::min(std::max((pEnemies[i].x - m_levelMin.x) / m_enemyBucketWidth, 0.f), maxBucket);
+		const float row = std::min(std::max((pEnemies[i].y - m_levelMin.y) / m_enemyBucketHeight, 0.f), maxBucket);
+		m_enemyBucketByEnemy[i] = static_cast<uint32_t>(row) * m_enemyGridSize + static_cast<uint32_t>(column);
+		++m_enemyBucketStart[m_enemyBucketByEnemy[i] + 1];
+	}
+	for (uint32_t bucket = 1; bucket <= bucketCount; ++bucket)
+	{
+		m_enemyBucketStart[bucket] += m_enemyBucketStart[bucket - 1];
+	}
+	for (size_t i = 0; i < enemyCount; ++i)
+	{
+		m_enemyBuckets[m_enemyBucketStart[m_enemyBucketByEnemy[i]]++] = static_cast<uint32_t>(i);
+	}
+	// Filling moved every start to the end of its bucket, which is where the next one starts
+	for (uint32_t bucket = bucketCount; bucket > 0; --bucket)
+	{
+		m_enemyBucketStart[bucket] = m_enemyBucketStart[bucket - 1];
+	}
+	m_enemyBucketStart[0] = 0;
+}
+
+bool CSpawnPointRegistry::BoundCell(SCell& cell, const PMoveVec3* pEnemies, float cullDistanceSq) const
+{
+	const int gridSize = static_cast<int>(m_enemyGridSize);
+	const PMoveVec3 center = (cell.boundsMin + cell.boundsMax) * 0.5f;
+	const int column = static_cast<int>(std::min(std::max((center.x - m_levelMin.x) / m_enemyBucketWidth, 0.f), gridSize - 1.f));
+	const int row = static_cast<int>(std::min(std::max((center.y - m_levelMin.y) / m_enemyBucketHeight, 0.f), gridSize - 1.f));
+
+	// Any enemy bounds the cell, rings of buckets are searched until one had enemies, plus one ring since its corners may be closer
+	cell.farthestDistanceSq = -1.f;
+	int lastRing = gridSize;
+	for (int ring = 0; ring <= lastRing; ++ring)
+	{
+		for (int y = std::max(row - ring, 0); y <= std::min(row + ring, gridSize - 1); ++y)
+		{
+			// Only the outline of the ring, the inside was searched before
+			const bool isEdgeRow = y == row - ring || y == row + ring;
+			const int step = isEdgeRow || ring == 0 ? 1 : 2 * ring;
+			for (int x = column - ring; x <= column + ring; x += step)
+			{
+				if (x < 0 || x >= gridSize)
+					continue;
+
+				const uint32_t bucket = static_cast<uint32_t>(y * gridSize + x);
+				for (uint32_t i = m_enemyBucketStart[bucket]; i < m_enemyBucketStart[bucket + 1]; ++i)
+				{
+					const uint32_t enemy = m_enemyBuckets[i];
+					const float distanceSq = GetFarthestDistanceSq(pEnemies[enemy], cell.boundsMin, cell.boundsMax);
+					if (distanceSq <= cullDistanceSq)
+						return false;
+
+					if (cell.farthestDistanceSq < 0.f || distanceSq < cell.farthestDistanceSq)
+					{
+						cell.farthestDistanceSq = distanceSq;
+						cell.nearEnemy = enemy;
+					}
+				}
+			}
+		}
+
+		if (cell.farthestDistanceSq >= 0.f && lastRing == gridSize)
+		{
+			lastRing = ring + 1;
+		}
+	}
+
+	return true;
+}
+
+void CSpawnPointRegistry::LinkMostRecentlyUsed(Handle handle)
+{
+	m_previousUsed[handle] = m_mostRecentlyUsed;
+	m_nextUsed[handle] = InvalidHandle;
+	(m_mostRecentlyUsed != InvalidHandle ? m_nextUsed[m_mostRecentlyUsed] : m_leastRecentlyUsed) = handle;
+	m_mostRecentlyUsed = handle;
+}
+
+void CSpawnPointRegistry::Unlink(Handle handle)
+{
+	const Handle previous = m_previousUsed[handle];
+	const Handle next = m_nextUsed[handle];
+	(previous != InvalidHandle ? m_nextUsed[previous] : m_leastRecentlyUsed) = next;
+	(next != InvalidHandle ? m_previousUsed[next] : m_mostRecentlyUsed) = previous;
+}
+
+void CSpawnPointRegistry::RebuildGrid()
+{
+	m_isGridDirty = false;
+	m_cells.clear();
+	m_cellPoints.clear();
+
+	const uint32_t count = static_cast<uint32_t>(m_positions.size());
+	if (count == 0)
+		return;
+
+	// Cells are columns, spawn points mostly differ horizontally
+	PMoveVec3& levelMin = m_levelMin;
+	PMoveVec3& levelMax = m_levelMax;
+	levelMin = levelMax = m_positions[0];
+	for (const PMoveVec3& position : m_positions)
+	{
+		levelMin = PMoveVec3(std::min(levelMin.x, position.x), std::min(levelMin.y, position.y), std::min(levelMin.z, position.z));
+		levelMax = PMoveVec3(std::max(levelMax.x, position.x), std::max(levelMax.y, position.y), std::max(levelMax.z, position.z));
+	}
+
+	float cellSize = std::max(m_cellSize, 1e-3f);
+	uint32_t columns = 0;
+	uint32_t rows = 0;
+	for (;;)
+	{
+		columns = static_cast<uint32_t>((levelMax.x - levelMin.x) / cellSize) + 1;
+		rows = static_cast<uint32_t>((levelMax.y - levelMin.y) / cellSize) + 1;
+		if (static_cast<uint64_t>(columns) * rows <= MaxGridCells)
+			break;
+		cellSize *= 2.f;
+	}
+
+	// Counting sort of the points by cell
+	std::vector<uint32_t> cellByPoint(count);
+	std::vector<uint32_t> cellStart(static_cast<size_t>(columns) * rows + 1, 0);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const uint32_t column = std::min(static_cast<uint32_t>((m_positions[i].x - levelMin.x) / cellSize), columns - 1);
+		const uint32_t row = std::min(static_cast<uint32_t>((m_positions[i].y - levelMin.y) / cellSize), rows - 1);
+		cellByPoint[i] = row * columns + column;
+		++cellStart[cellByPoint[i] + 1];
+	}
+	for (size_t cell = 1; cell < cellStart.size(); ++cell)
+	{
+		cellStart[cell] += cellStart[cell - 1];
+	}
+
+	m_cellPoints.resize(count);
+	std::vector<uint32_t> cursor(cellStart.begin(), cellStart.end() - 1);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		m_cellPoints[cursor[cellByPoint[i]]++] = i;
+	}
+
+	// Only occupied cells are kept, bounded by their points rather than the grid lines
+	for (size_t cell = 0; cell + 1 < cellStart.size(); ++cell)
+	{
+		if (cellStart[cell] == cellStart[cell + 1])
+			continue;
+
+		SCell occupied;
+		occupied.begin = cellStart[cell];
+		occupied.end = cellStart[cell + 1];
+		occupied.boundsMin = occupied.boundsMax = m_positions[m_cellPoints[occupied.begin]];
+		for (uint32_t i = occupied.begin + 1; i < occupied.end; ++i)
+		{
+			const PMoveVec3& position = m_positions[m_cellPoints[i]];
+			occupied.boundsMin = PMoveVec3(std::min(occupied.boundsMin.x, position.x), std::min(occupied.boundsMin.y, position.y), std::min(occupied.boundsMin.z, position.z));
+			occupied.boundsMax = PMoveVec3(std::max(occupied.boundsMax.x, position.x), std::max(occupied.boundsMax.y, position.y), std::max(occupied.boundsMax.z, position.z));
+		}
+		occupied.farthestDistanceSq = 0.f;
+		occupied.nearEnemy = 0;
+
+		m_cells.push_back(occupied);
+	}
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "PlayerMovement.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+////////////////////////////////////////////////////////
+// Every spawn point of the level, registered by the spawn point components
+// Picking a spawn no longer walks the entity system. Points are grouped
+// into the cells of a uniform grid, each cell knowing the bounds of its
+// points, so the farthest-from-enemies search can skip whole cells that
+// can't beat the best point found so far. Enemies are bucketed into a
+// coarse grid per search, so bounding a cell only looks at enemies near it.
+////////////////////////////////////////////////////////
+class CSpawnPointRegistry
+{
+public:
+	using Handle = uint32_t;
+	static constexpr Handle InvalidHandle = UINT32_MAX;
+
+	enum class ESelection
+	{
+		First,                  // The same point every time while the set of points doesn't change
+		RoundRobin,             // Cycles through all points
+		FarthestFromEnemies,    // Largest distance to the nearest enemy, least recently used without enemies
+		LeastRecentlyUsed
+	};
+
+	// userId identifies the owner of the point, e.g. its entity
+	Handle Add(const PMoveVec3& position, uint32_t userId);
+	void Remove(Handle handle);
+	bool IsValid(Handle handle) const { return handle < m_denseIndexByHandle.size() && m_denseIndexByHandle[handle] != InvalidHandle; }
+
+	void SetPosition(Handle handle, const PMoveVec3& position);
+	PMoveVec3 GetPosition(Handle handle) const { return m_positions[m_denseIndexByHandle[handle]]; }
+	uint32_t GetUserId(Handle handle) const { return m_userIds[m_denseIndexByHandle[handle]]; }
+
+	// Picks a point and marks it as used. Returns InvalidHandle if there are no points.
+	Handle Select(ESelection selection, const PMoveVec3* pEnemies = nullptr, size_t enemyCount = 0);
+
+	// Larger cells mean fewer bounds to test but coarser culling, grows by itself on huge levels
+	void SetCellSize(float cellSize) { m_cellSize = cellSize; m_isGridDirty = true; }
+
+	size_t GetCount() const { return m_positions.size(); }
+	size_t GetCellCount() const { return m_cells.size(); }
+
+private:
+	struct SCell
+	{
+		PMoveVec3 boundsMin;
+		PMoveVec3 boundsMax;
+		uint32_t begin;             // Range in m_cellPoints
+		uint32_t end;
+		float farthestDistanceSq;   // Upper bound of any point's distance to its nearest enemy
+		uint32_t nearEnemy;         // The enemy that gave the bound, likely close to every point
+	};
+
+	Handle SelectFarthest(const PMoveVec3* pEnemies, size_t enemyCount);
+	float GetNearestEnemyDistanceSq(const PMoveVec3& position, const PMoveVec3* pEnemies, size_t enemyCount, uint32_t firstEnemy, float stopDistanceSq) const;
+	void RebuildGrid();
+	void BucketEnemies(const PMoveVec3* pEnemies, size_t enemyCount);
+	// Returns false as soon as the cell can't hold a point farther than cullDistanceSq from its nearest enemy
+	bool BoundCell(SCell& cell, const PMoveVec3* pEnemies, float cullDistanceSq) const;
+
+	void LinkMostRecentlyUsed(Handle handle);
+	void Unlink(Handle handle);
+
+	// Handles stay stable, the arrays below are kept densely packed
+	std::vector<uint32_t> m_denseIndexByHandle;
+	std::vector<Handle> m_handleByDenseIndex;
+	std::vector<Handle> m_freeHandles;
+
+	std::vector<PMoveVec3> m_positions;
+	std::vector<uint32_t> m_userIds;
+	uint32_t m_roundRobinCursor = 0;
+
+	// Usage order as a list through the handles, least recently used first and never used points before that
+	std::vector<Handle> m_previousUsed;
+	std::vector<Handle> m_nextUsed;
+	Handle m_leastRecentlyUsed = InvalidHandle;
+	Handle m_mostRecentlyUsed = InvalidHandle;
+
+	// Dense indices grouped by cell, rebuilt lazily after points changed
+	float m_cellSize = 64.f;
+	bool m_isGridDirty = false;
+	std::vector<SCell> m_cells;
+	std::vector<uint32_t> m_cellPoints;
+	std::vector<uint32_t> m_candidateCells;
+	PMoveVec3 m_levelMin;
+	PMoveVec3 m_levelMax;
+	// Enemies hardly move between joins, the previous pick makes a good first guess
+	Handle m_lastFarthest = InvalidHandle;
+
+	// Enemies of the current search grouped into buckets over the level, about two per bucket
+	static constexpr uint32_t MaxEnemyGridSize = 8;
+	uint32_t m_enemyGridSize = 1;
+	float m_enemyBucketWidth = 1.f;
+	float m_enemyBucketHeight = 1.f;
+	std::vector<uint32_t> m_enemyBucketStart;
+	std::vector<uint32_t> m_enemyBuckets;
+	std::vector<uint32_t> m_enemyBucketByEnemy;
+};
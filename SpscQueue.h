@@ -0,0 +1,45 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Bounded lock-free queue between exactly one producer thread and one consumer thread
+template<typename T, uint32_t CAPACITY>
+class CSpscQueue
+{
+	static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0, "CAPACITY shall be a power of two!");
+
+public:
+	static constexpr uint32_t Capacity = CAPACITY;
+
+	// Producer thread only. Returns false without blocking if the consumer fell a full queue behind.
+	bool Push(const T& value)
+	{
+		const uint32_t head = m_head.load(std::memory_order_relaxed);
+		if (head - m_tail.load(std::memory_order_acquire) == CAPACITY)
+			return false;
+
+		m_items[head & (CAPACITY - 1)] = value;
+		m_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer thread only
+	bool Pop(T& value)
+	{
+		const uint32_t tail = m_tail.load(std::memory_order_relaxed);
+		if (tail == m_head.load(std::memory_order_acquire))
+			return false;
+
+		value = m_items[tail & (CAPACITY - 1)];
+		m_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+private:
+	// Producer and consumer indices on separate cache lines so the threads don't contend
+	alignas(64) std::atomic<uint32_t> m_head{ 0 };
+	alignas(64) std::atomic<uint32_t> m_tail{ 0 };
+	alignas(64) std::array<T, CAPACITY> m_items;
+};
@@ -0,0 +1,65 @@
+////////////////////////////////////////////////////////
+// Movement demo replay
+// Replays demos recorded with pm_demo through the ruleset each was
+// recorded with and prints one line per demo with where it ended up.
+// Run over a corpus of demos before and after a movement change and
+// diff the output, any line that changed is a run that moves differently.
+// Ground mismatches count the ticks on which the replay's flat floor
+// disagreed with the recorded physics, a demo from uneven ground drifts
+// from there on but still replays the same every time.
+//
+// Build (from the repository root):
+//   g++ -O2 -std=c++17 -pthread -I. Tools/MovementDemoReplay.cpp MovementDemo.cpp MovementRuleset.cpp PlayerMovement.cpp PlayerMovementBatch.cpp -o movement_demo_replay
+// Usage:
+//   movement_demo_replay <demo file>...
+////////////////////////////////////////////////////////
+
+#include "MovementDemo.h"
+#include "MovementRuleset.h"
+
+#include <cstdio>
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::fprintf(stderr, "usage: %s <demo file>...\n", argv[0]);
+		return 1;
+	}
+
+	std::printf("%-32s %-5s %7s %6s %12s %12s %12s %9s %8s %8s\n", "demo", "rules", "ticks", "jumps", "x", "y", "z", "speed", "ground!", "first");
+
+	int failedCount = 0;
+	for (int i = 1; i < argc; ++i)
+	{
+		CMovementDemoReader demo;
+		if (!demo.Open(argv[i]))
+		{
+			std::fprintf(stderr, "%s is not a movement demo\n", argv[i]);
+			++failedCount;
+			continue;
+		}
+
+		char szRuleset[sizeof(demo.GetHeader().ruleset) + 1] = {};
+		for (size_t c = 0; c < sizeof(demo.GetHeader().ruleset); ++c)
+		{
+			szRuleset[c] = demo.GetHeader().ruleset[c];
+		}
+
+		const SMovementRuleset* pRuleset = PMoveRulesets::Find(szRuleset);
+		if (pRuleset == nullptr)
+		{
+			std::fprintf(stderr, "%s was recorded with the unknown ruleset %s\n", argv[i], szRuleset);
+			++failedCount;
+			continue;
+		}
+
+		const SMovementDemoReplay replay = PMoveDemo::Replay(demo, pRuleset->pMove);
+		const PMoveVec3& velocity = replay.state.velocity;
+		std::printf("%-32s %-5s %7u %6u %12.3f %12.3f %12.3f %9.2f %8u %8u\n", argv[i], pRuleset->szName, replay.tickCount, replay.jumpCount,
+			replay.position.x, replay.position.y, replay.position.z, std::sqrt(velocity.x * velocity.x + velocity.y * velocity.y),
+			replay.groundMismatchCount, replay.firstGroundMismatch);
+	}
+
+	return failedCount == 0 ? 0 : 1;
+}
@@ -0,0 +1,175 @@
+////////////////////////////////////////////////////////
+// Movement trace decoder
+// Prints the records of a trace written with pm_trace, ordered by
+// player and command sequence, followed by a bunny hop summary per
+// player: how many landings jumped again on the landing tick and how
+// much speed friction took on the ground ticks in between.
+//
+// Build (from the repository root):
+//   g++ -O2 -std=c++17 -I. Tools/MovementTraceDump.cpp MovementTrace.cpp -o movement_trace_dump
+// Usage:
+//   movement_trace_dump <trace file> [entity id] [--summary]
+////////////////////////////////////////////////////////
+
+#include "MovementTrace.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	struct SPlayerSummary
+	{
+		uint32_t entityId = 0;
+		uint32_t tickCount = 0;
+		uint32_t groundTickCount = 0;
+		uint32_t jumpPressedCount = 0;
+		uint32_t jumpCount = 0;
+		uint32_t landingCount = 0;
+		uint32_t hopOnLandingCount = 0;       // Landings that jumped right away, friction never touched them
+		float frictionDrop = 0.f;
+		float maxSpeed = 0.f;
+	};
+
+	const char* GetEventName(EMovementTraceEvent event)
+	{
+		switch (event)
+		{
+		case EMovementTraceEvent::Tick: return "tick";
+		case EMovementTraceEvent::JumpPressed: return "jump-pressed";
+		case EMovementTraceEvent::Jumped: return "jumped";
+		default: return "unknown";
+		}
+	}
+
+	void PrintRecord(const SMovementTraceRecord& record)
+	{
+		std::printf("%10u %8u %-12s %c%c%c %9.2f %7.3f %6.3f %6.3f\n",
+			record.tick, record.entityId, GetEventName(record.event),
+			(record.flags & eMovementTraceFlag_OnGround) != 0 ? 'G' : '-',
+			(record.flags & eMovementTraceFlag_WishJump) != 0 ? 'W' : '-',
+			(record.flags & eMovementTraceFlag_JumpHeld) != 0 ? 'H' : '-',
+			record.speed, record.frictionDrop,
+			record.wishDirX / PMoveTrace::WishDirScale, record.wishDirY / PMoveTrace::WishDirScale);
+	}
+
+	void PrintSummary(const SPlayerSummary& summary)
+	{
+		std::printf("%8u %7u %7u %7u %6u %8u %7u (%5.1f%%) %10.1f %9.2f\n",
+			summary.entityId, summary.tickCount, summary.groundTickCount, summary.jumpPressedCount, summary.jumpCount,
+			summary.landingCount, summary.hopOnLandingCount, summary.landingCount > 0 ? 100.0 * summary.hopOnLandingCount / summary.landingCount : 0.0,
+			summary.frictionDrop, summary.maxSpeed);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const char* szPath = nullptr;
+	bool hasEntityFilter = false;
+	uint32_t entityFilter = 0;
+	bool isSummaryOnly = false;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--summary") == 0)
+			isSummaryOnly = true;
+		else if (szPath == nullptr)
+			szPath = argv[i];
+		else
+		{
+			hasEntityFilter = true;
+			entityFilter = static_cast<uint32_t>(std::strtoul(argv[i], nullptr, 10));
+		}
+	}
+
+	if (szPath == nullptr)
+	{
+		std::fprintf(stderr, "usage: %s <trace file> [entity id] [--summary]\n", argv[0]);
+		return 1;
+	}
+
+	std::vector<SMovementTraceRecord> records;
+	if (!PMoveTrace::ReadFile(szPath, records))
+	{
+		std::fprintf(stderr, "%s is not a movement trace\n", szPath);
+		return 1;
+	}
+
+	if (hasEntityFilter)
+	{
+		records.erase(std::remove_if(records.begin(), records.end(), [entityFilter](const SMovementTraceRecord& record) { return record.entityId != entityFilter; }), records.end());
+	}
+
+	// Threads drain in turns, stable so records of the same command keep the order they were pushed in
+	std::stable_sort(records.begin(), records.end(), [](const SMovementTraceRecord& a, const SMovementTraceRecord& b)
+	{
+		return a.entityId != b.entityId ? a.entityId < b.entityId : static_cast<int32_t>(a.tick - b.tick) < 0;
+	});
+
+	if (!isSummaryOnly)
+	{
+		std::printf("%10s %8s %-12s %3s %9s %7s %6s %6s\n", "tick", "entity", "event", "flg", "speed", "drop", "wishx", "wishy");
+		for (const SMovementTraceRecord& record : records)
+		{
+			PrintRecord(record);
+		}
+		std::printf("\n");
+	}
+
+	std::printf("%8s %7s %7s %7s %6s %8s %17s %10s %9s\n", "entity", "ticks", "ground", "pressed", "jumps", "landings", "hop on landing", "friction", "max speed");
+
+	SPlayerSummary summary;
+	bool wasOnGround = true;
+	for (size_t i = 0; i < records.size(); ++i)
+	{
+		const SMovementTraceRecord& record = records[i];
+		if (i == 0 || record.entityId != summary.entityId)
+		{
+			if (i != 0)
+			{
+				PrintSummary(summary);
+			}
+			summary = SPlayerSummary();
+			summary.entityId = record.entityId;
+			wasOnGround = true;
+		}
+
+		summary.maxSpeed = std::max(summary.maxSpeed, record.speed);
+		switch (record.event)
+		{
+		case EMovementTraceEvent::Tick:
+		{
+			const bool isOnGround = (record.flags & eMovementTraceFlag_OnGround) != 0;
+			++summary.tickCount;
+			if (isOnGround)
+			{
+				++summary.groundTickCount;
+				summary.frictionDrop += record.frictionDrop;
+				if (!wasOnGround)
+				{
+					++summary.landingCount;
+					summary.hopOnLandingCount += (record.flags & eMovementTraceFlag_WishJump) != 0 ? 1 : 0;
+				}
+			}
+			wasOnGround = isOnGround;
+		}
+		break;
+		case EMovementTraceEvent::JumpPressed:
+			++summary.jumpPressedCount;
+			break;
+		case EMovementTraceEvent::Jumped:
+			++summary.jumpCount;
+			break;
+		}
+	}
+
+	if (!records.empty())
+	{
+		PrintSummary(summary);
+	}
+
+	return 0;
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "PlayerMovement.h"
+
+#include <cmath>
+#include <cstdint>
+
+////////////////////////////////////////////////////////
+// A player's view stored as yaw, pitch and roll
+// Mouse input, commands and snapshots all deal in angles, so they are
+// the stored representation. Quaternions and basis vectors are derived
+// on first use after a change, from one sine and cosine per angle, and
+// cached until the next change. Angles never take a round trip through
+// a matrix, and mouse deltas are summed in double, so the view doesn't
+// drift however long a session goes on.
+// Follows CCamera::CreateOrientationYPR: yaw around z, then pitch
+// around x, then roll around the forward y axis.
+////////////////////////////////////////////////////////
+
+// Same layout and convention as CryEngine's Quat (v, w)
+struct SViewQuat
+{
+	float x = 0.f;
+	float y = 0.f;
+	float z = 0.f;
+	float w = 1.f;
+};
+
+class CViewAngles
+{
+public:
+	static constexpr double Pi = 3.141592653589793;
+	static constexpr double TwoPi = 6.283185307179586;
+
+	CViewAngles() = default;
+	CViewAngles(float yaw, float pitch, float roll = 0.f) { Set(yaw, pitch, roll); }
+
+	void Set(float yaw, float pitch, float roll)
+	{
+		SetYaw(yaw);
+		SetPitch(pitch);
+		SetRoll(roll);
+	}
+
+	// Yaw is wrapped into [-Pi, Pi] by a double precision turn, wrapping by a float one would be off a little every turn
+	void SetYaw(double yaw) { SetAngle(m_yaw, yaw > Pi || yaw < -Pi ? std::remainder(yaw, TwoPi) : yaw); }
+	void AddYaw(float delta) { SetYaw(m_yaw + delta); }
+	void SetPitch(double pitch) { SetAngle(m_pitch, pitch); }
+	// Clamped, a delta pushing against a limit is dropped
+	void AddPitch(float delta, float minPitch, float maxPitch)
+	{
+		const double pitch = m_pitch + delta;
+		SetPitch(pitch < minPitch ? minPitch : pitch > maxPitch ? maxPitch : pitch);
+	}
+	void SetRoll(double roll) { SetAngle(m_roll, roll); }
+
+	float GetYaw() const { return static_cast<float>(m_yaw); }
+	float GetPitch() const { return static_cast<float>(m_pitch); }
+	float GetRoll() const { return static_cast<float>(m_roll); }
+
+	// Yaw, pitch and roll
+	const SViewQuat& GetOrientation() const { Refresh(); return m_orientation; }
+	// Yaw alone, what the player's entity turns by
+	const SViewQuat& GetYawOrientation() const { Refresh(); return m_yawOrientation; }
+	// Pitch and roll alone, the camera relative to the entity
+	const SViewQuat& GetPitchRollOrientation() const { Refresh(); return m_pitchRollOrientation; }
+
+	// Columns of the full orientation
+	const PMoveVec3& GetRight() const { Refresh(); return m_right; }
+	const PMoveVec3& GetForward() const { Refresh(); return m_forward; }
+	const PMoveVec3& GetUp() const { Refresh(); return m_up; }
+
+	// How often the cache was rebuilt, each time evaluating the trigonometry once
+	uint32_t GetRefreshCount() const { return m_refreshCount; }
+
+private:
+	void SetAngle(double& angle, double value)
+	{
+		// The cache is built from the float angles, changes below their precision don't invalidate it
+		m_isDirty = m_isDirty || static_cast<float>(angle) != static_cast<float>(value);
+		angle = value;
+	}
+
+	void Refresh() const
+	{
+		if (!m_isDirty)
+			return;
+
+		const float sy = std::sin(GetYaw() * 0.5f), cy = std::cos(GetYaw() * 0.5f);
+		const float sp = std::sin(GetPitch() * 0.5f), cp = std::cos(GetPitch() * 0.5f);
+		const float sr = std::sin(GetRoll() * 0.5f), cr = std::cos(GetRoll() * 0.5f);
+
+		// Yaw * pitch * roll, multiplied out
+		SViewQuat& q = m_orientation;
+		q.x = cr * cy * sp - cp * sy * sr;
+		q.y = cy * cp * sr + cr * sy * sp;
+		q.z = cr * cp * sy + cy * sp * sr;
+		q.w = cy * cp * cr - sy * sp * sr;
+
+		m_yawOrientation = SViewQuat{ 0.f, 0.f, sy, cy };
+		m_pitchRollOrientation = SViewQuat{ sp * cr, cp * sr, sp * sr, cp * cr };
+
+		m_right = PMoveVec3(1.f - 2.f * (q.y * q.y + q.z * q.z), 2.f * (q.x * q.y + q.w * q.z), 2.f * (q.x * q.z - q.w * q.y));
+		m_forward = PMoveVec3(2.f * (q.x * q.y - q.w * q.z), 1.f - 2.f * (q.x * q.x + q.z * q.z), 2.f * (q.y * q.z + q.w * q.x));
+		m_up = PMoveVec3(2.f * (q.x * q.z + q.w * q.y), 2.f * (q.y * q.z - q.w * q.x), 1.f - 2.f * (q.x * q.x + q.y * q.y));
+
+		++m_refreshCount;
+		m_isDirty = false;
+	}
+
+	// Double, so a session's worth of small mouse deltas sums up without rounding away
+	double m_yaw = 0.0;
+	double m_pitch = 0.0;
+	double m_roll = 0.0;
+
+	mutable bool m_isDirty = true;
+	mutable uint32_t m_refreshCount = 0;
+	mutable SViewQuat m_orientation;
+	mutable SViewQuat m_yawOrientation;
+	mutable SViewQuat m_pitchRollOrientation;
+	mutable PMoveVec3 m_right;
+	mutable PMoveVec3 m_forward;
+	mutable PMoveVec3 m_up;
+};
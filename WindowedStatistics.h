@@ -0,0 +1,264 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+////////////////////////////////////////////////////////
+// Statistics over the last few samples of a metric, and input filters
+// Samples are kept in a power of two ring indexed by mask. The mean
+// comes from a running sum, re-summed from the window every time the
+// ring wraps, so rounding can't pile up over a long session. Min, max
+// and variance are computed from the window when asked for, which keeps
+// the push cheap. CWindowedMeanBatch keeps one window per lane, e.g. per
+// player, in one array, so pushing every lane is a single flat loop.
+// The exponential and one euro filters smooth noisy input like mouse
+// deltas without a window.
+////////////////////////////////////////////////////////
+
+namespace WindowedStatistics
+{
+	inline float GetMagnitude(float value) { return std::fabs(value); }
+	inline double GetMagnitude(double value) { return std::fabs(value); }
+	template<typename T> float GetMagnitude(const T& value) { return value.GetLength(); }
+
+	// Smoothing factor of a low pass filter with the given cutoff in Hz, for a sample dt seconds after the previous one
+	inline float GetAlpha(float cutoff, float dt)
+	{
+		const float tau = 1.f / (6.283185307f * cutoff);
+		return 1.f / (1.f + tau / dt);
+	}
+}
+
+template<typename T, uint32_t CAPACITY>
+class CWindowedStatistics
+{
+	static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0, "CAPACITY shall be a power of two!");
+
+public:
+	static constexpr uint32_t Capacity = CAPACITY;
+
+	void Push(T value)
+	{
+		const uint32_t index = m_cursor & (CAPACITY - 1);
+		m_sum += value - m_values[index];
+		m_values[index] = value;
+		++m_cursor;
+		m_count = m_count < CAPACITY ? m_count + 1 : CAPACITY;
+
+		if ((m_cursor & (CAPACITY - 1)) == 0)
+		{
+			m_sum = Sum();
+		}
+	}
+
+	// Number of samples in the window, less than Capacity until it filled up
+	uint32_t GetCount() const { return m_count; }
+	T GetSum() const { return m_sum; }
+	// All of these are 0 while the window is empty
+	T GetMean() const { return m_count > 0 ? m_sum / static_cast<T>(m_count) : T(0); }
+
+	T GetMin() const
+	{
+		T min = m_count > 0 ? m_values[0] : T(0);
+		for (uint32_t i = 1; i < m_count; ++i)
+		{
+			min = m_values[i] < min ? m_values[i] : min;
+		}
+		return min;
+	}
+
+	T GetMax() const
+	{
+		T max = m_count > 0 ? m_values[0] : T(0);
+		for (uint32_t i = 1; i < m_count; ++i)
+		{
+			max = m_values[i] > max ? m_values[i] : max;
+		}
+		return max;
+	}
+
+	// Population variance, in two passes so a large mean doesn't cancel it out
+	T GetVariance() const
+	{
+		if (m_count == 0)
+			return T(0);
+
+		const T mean = Sum() / static_cast<T>(m_count);
+		T sum = T(0);
+		for (uint32_t i = 0; i < m_count; ++i)
+		{
+			const T deviation = m_values[i] - mean;
+			sum += deviation * deviation;
+		}
+		return sum / static_cast<T>(m_count);
+	}
+
+	void Reset()
+	{
+		m_values.fill(T(0));
+		m_cursor = 0;
+		m_count = 0;
+		m_sum = T(0);
+	}
+
+private:
+	// Slots the window hasn't reached yet are zero, so they can be summed along
+	T Sum() const
+	{
+		T sum = T(0);
+		for (const T& value : m_values)
+		{
+			sum += value;
+		}
+		return sum;
+	}
+
+	std::array<T, CAPACITY> m_values{};
+	uint32_t m_cursor = 0;
+	uint32_t m_count = 0;
+	T m_sum = T(0);
+};
+
+// Windowed means of many metrics that are sampled together
+template<uint32_t CAPACITY>
+class CWindowedMeanBatch
+{
+	static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0, "CAPACITY shall be a power of two!");
+
+public:
+	static constexpr uint32_t Capacity = CAPACITY;
+
+	explicit CWindowedMeanBatch(uint32_t laneCount)
+		: m_laneCount(laneCount)
+		, m_values(static_cast<size_t>(laneCount) * CAPACITY, 0.f)
+		, m_sums(laneCount, 0.f)
+	{
+	}
+
+	// One sample per lane
+	void Push(const float* pValues)
+	{
+		float* pRow = m_values.data() + static_cast<size_t>(m_cursor & (CAPACITY - 1)) * m_laneCount;
+		float* pSums = m_sums.data();
+		for (uint32_t lane = 0; lane < m_laneCount; ++lane)
+		{
+			pSums[lane] += pValues[lane] - pRow[lane];
+			pRow[lane] = pValues[lane];
+		}
+		++m_cursor;
+		m_count = m_count < CAPACITY ? m_count + 1 : CAPACITY;
+
+		if ((m_cursor & (CAPACITY - 1)) == 0)
+		{
+			Resum();
+		}
+	}
+
+	uint32_t GetLaneCount() const { return m_laneCount; }
+	uint32_t GetCount() const { return m_count; }
+	float GetMean(uint32_t lane) const { return m_count > 0 ? m_sums[lane] / static_cast<float>(m_count) : 0.f; }
+
+	void GetMeans(float* pMeans) const
+	{
+		const float scale = m_count > 0 ? 1.f / static_cast<float>(m_count) : 0.f;
+		for (uint32_t lane = 0; lane < m_laneCount; ++lane)
+		{
+			pMeans[lane] = m_sums[lane] * scale;
+		}
+	}
+
+	void Reset()
+	{
+		std::fill(m_values.begin(), m_values.end(), 0.f);
+		std::fill(m_sums.begin(), m_sums.end(), 0.f);
+		m_cursor = 0;
+		m_count = 0;
+	}
+
+private:
+	// Row by row, so every lane is summed in the same order as CWindowedStatistics does
+	void Resum()
+	{
+		std::fill(m_sums.begin(), m_sums.end(), 0.f);
+		for (uint32_t row = 0; row < CAPACITY; ++row)
+		{
+			const float* pRow = m_values.data() + static_cast<size_t>(row) * m_laneCount;
+			for (uint32_t lane = 0; lane < m_laneCount; ++lane)
+			{
+				m_sums[lane] += pRow[lane];
+			}
+		}
+	}
+
+	uint32_t m_laneCount;
+	// Sample major, each row holds one sample of every lane
+	std::vector<float> m_values;
+	std::vector<float> m_sums;
+	uint32_t m_cursor = 0;
+	uint32_t m_count = 0;
+};
+
+// First order low pass with a fixed cutoff, the same smoothing at any sample rate
+template<typename T>
+class CExponentialFilter
+{
+public:
+	explicit CExponentialFilter(float cutoff = 10.f) : m_cutoff(cutoff) {}
+
+	T Filter(const T& value, float dt)
+	{
+		m_value = m_hasValue && dt > 0.f ? m_value + (value - m_value) * WindowedStatistics::GetAlpha(m_cutoff, dt) : value;
+		m_hasValue = true;
+		return m_value;
+	}
+
+	const T& Get() const { return m_value; }
+	void Reset() { m_hasValue = false; m_value = T(); }
+
+private:
+	float m_cutoff;
+	T m_value = T();
+	bool m_hasValue = false;
+};
+
+// One euro filter (Casiez et al. 2012): smooths slow movement heavily and lets fast movement through with little lag
+template<typename T>
+class COneEuroFilter
+{
+public:
+	// minCutoff in Hz is the smoothing at rest, beta raises the cutoff with speed
+	explicit COneEuroFilter(float minCutoff = 1.f, float beta = 0.01f, float derivativeCutoff = 1.f)
+		: m_minCutoff(minCutoff)
+		, m_beta(beta)
+		, m_derivative(derivativeCutoff)
+	{
+	}
+
+	T Filter(const T& value, float dt)
+	{
+		if (!m_hasValue || dt <= 0.f)
+		{
+			m_value = m_hasValue ? m_value : value;
+			m_hasValue = true;
+			return m_value;
+		}
+
+		const T derivative = m_derivative.Filter((value - m_value) * (1.f / dt), dt);
+		const float cutoff = m_minCutoff + m_beta * static_cast<float>(WindowedStatistics::GetMagnitude(derivative));
+		m_value = m_value + (value - m_value) * WindowedStatistics::GetAlpha(cutoff, dt);
+		return m_value;
+	}
+
+	const T& Get() const { return m_value; }
+	void Reset() { m_derivative.Reset(); m_hasValue = false; m_value = T(); }
+
+private:
+	float m_minCutoff;
+	float m_beta;
+	CExponentialFilter<T> m_derivative;
+	T m_value = T();
+	bool m_hasValue = false;
+};
@@ -0,0 +1,144 @@
+#include "WorkStealingPool.h"
+
+CWorkStealingPool::CWorkStealingPool(uint32_t workerCount)
+{
+	for (uint32_t i = 0; i < workerCount + 1; ++i)
+	{
+		m_queues.push_back(std::make_unique<SQueue>());
+	}
+	for (uint32_t i = 0; i < workerCount; ++i)
+	{
+		m_workers.emplace_back(&CWorkStealingPool::RunWorker, this, i + 1);
+	}
+}
+
+CWorkStealingPool::~CWorkStealingPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_wakeMutex);
+		m_isStopping = true;
+	}
+	m_wake.notify_all();
+
+	for (std::thread& worker : m_workers)
+	{
+		worker.join();
+	}
+}
+
+void CWorkStealingPool::ParallelFor(uint32_t count, uint32_t grain, RangeFunc func, void* pContext)
+{
+	if (count == 0)
+		return;
+
+	grain = grain > 0 ? grain : 1;
+	const uint32_t chunkCount = (count + grain - 1) / grain;
+	if (m_workers.empty() || chunkCount == 1)
+	{
+		func(pContext, 0, count);
+		return;
+	}
+
+	m_func = func;
+	m_pContext = pContext;
+	m_remainingCount.store(chunkCount, std::memory_order_relaxed);
+
+	// Contiguous shares keep each participant on its own cache lines until it has to steal
+	const uint32_t queueCount = static_cast<uint32_t>(m_queues.size());
+	for (uint32_t queueIndex = 0; queueIndex < queueCount; ++queueIndex)
+	{
+		const uint32_t firstChunk = chunkCount * queueIndex / queueCount;
+		const uint32_t lastChunk = chunkCount * (queueIndex + 1) / queueCount;
+
+		SQueue& queue = *m_queues[queueIndex];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		// Owners pop from the back, so push in reverse to run the share front to back
+		for (uint32_t chunk = lastChunk; chunk-- > firstChunk;)
+		{
+			const uint32_t begin = chunk * grain;
+			const uint32_t end = begin + grain < count ? begin + grain : count;
+			queue.ranges.push_back(SRange{ begin, end });
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_wakeMutex);
+		++m_generation;
+	}
+	m_wake.notify_all();
+
+	Work(0);
+
+	// Stolen chunks may still be running on other threads
+	while (m_remainingCount.load(std::memory_order_acquire) != 0)
+	{
+		std::this_thread::yield();
+	}
+}
+
+void CWorkStealingPool::RunWorker(uint32_t queueIndex)
+{
+	uint64_t generation = 0;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_wakeMutex);
+			m_wake.wait(lock, [this, generation]() { return m_isStopping || m_generation != generation; });
+			if (m_isStopping)
+				return;
+			generation = m_generation;
+		}
+
+		Work(queueIndex);
+	}
+}
+
+void CWorkStealingPool::Work(uint32_t queueIndex)
+{
+	SRange range;
+	while (Pop(queueIndex, range) || Steal(queueIndex, range))
+	{
+		m_func(m_pContext, range.begin, range.end);
+		m_remainingCount.fetch_sub(1, std::memory_order_release);
+	}
+}
+
+bool CWorkStealingPool::Pop(uint32_t queueIndex, SRange& range)
+{
+	SQueue& queue = *m_queues[queueIndex];
+	std::lock_guard<std::mutex> lock(queue.mutex);
+	if (queue.front == queue.ranges.size())
+		return false;
+
+	range = queue.ranges.back();
+	queue.ranges.pop_back();
+	if (queue.front == queue.ranges.size())
+	{
+		queue.ranges.clear();
+		queue.front = 0;
+	}
+	return true;
+}
+
+bool CWorkStealingPool::Steal(uint32_t queueIndex, SRange& range)
+{
+	// Starting at the next queue spreads the thieves over different victims
+	const uint32_t queueCount = static_cast<uint32_t>(m_queues.size());
+	for (uint32_t offset = 1; offset < queueCount; ++offset)
+	{
+		SQueue& queue = *m_queues[(queueIndex + offset) % queueCount];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.front != queue.ranges.size())
+		{
+			range = queue.ranges[queue.front++];
+			if (queue.front == queue.ranges.size())
+			{
+				queue.ranges.clear();
+				queue.front = 0;
+			}
+			m_stolenCount.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+////////////////////////////////////////////////////////
+// Fixed set of worker threads splitting index ranges between them
+// ParallelFor cuts a range into chunks and deals each participant a
+// contiguous share into its own queue. Participants take chunks from
+// the back of their own queue and, once it runs dry, steal from the
+// front of the others', so a thread that got descheduled or slower
+// chunks doesn't hold up the rest. The calling thread works along and
+// returns once every chunk is done. Engine independent, see
+// CPlayerMovementSystem::SetJobPool.
+////////////////////////////////////////////////////////
+class CWorkStealingPool
+{
+public:
+	// Called with [begin, end) of one chunk, from any participating thread
+	using RangeFunc = void (*)(void* pContext, uint32_t begin, uint32_t end);
+
+	// 0 workers runs everything on the calling thread
+	explicit CWorkStealingPool(uint32_t workerCount);
+	~CWorkStealingPool();
+
+	CWorkStealingPool(const CWorkStealingPool&) = delete;
+	CWorkStealingPool& operator=(const CWorkStealingPool&) = delete;
+
+	uint32_t GetWorkerCount() const { return static_cast<uint32_t>(m_workers.size()); }
+
+	// Runs func over [0, count) in chunks of grain, blocks until all of them ran. One caller at a time.
+	void ParallelFor(uint32_t count, uint32_t grain, RangeFunc func, void* pContext);
+
+	template<typename TFunc>
+	void ParallelFor(uint32_t count, uint32_t grain, TFunc&& func)
+	{
+		ParallelFor(count, grain, [](void* pContext, uint32_t begin, uint32_t end) { (*static_cast<TFunc*>(pContext))(begin, end); }, &func);
+	}
+
+	// Chunks taken from another participant's queue since construction, for tuning the grain
+	uint64_t GetStolenCount() const { return m_stolenCount.load(std::memory_order_relaxed); }
+
+private:
+	struct SRange
+	{
+		uint32_t begin;
+		uint32_t end;
+	};
+
+	// Chunks are coarse, so a lock per queue costs next to nothing against the work in them.
+	// Thieves advance front instead of erasing, the storage is reused by the next job without allocating.
+	struct alignas(64) SQueue
+	{
+		std::mutex mutex;
+		std::vector<SRange> ranges;
+		size_t front = 0;
+	};
+
+	void RunWorker(uint32_t queueIndex);
+	// Runs chunks until every queue is empty, queueIndex is the participant's own queue
+	void Work(uint32_t queueIndex);
+	bool Pop(uint32_t queueIndex, SRange& range);
+	bool Steal(uint32_t queueIndex, SRange& range);
+
+	// Queue 0 belongs to the calling thread, queue i + 1 to worker i
+	std::vector<std::unique_ptr<SQueue>> m_queues;
+	std::vector<std::thread> m_workers;
+
+	std::mutex m_wakeMutex;
+	std::condition_variable m_wake;
+	uint64_t m_generation = 0;
+	bool m_isStopping = false;
+
+	// The current job, only written while no chunk is queued
+	RangeFunc m_func = nullptr;
+	void* m_pContext = nullptr;
+	std::atomic<uint32_t> m_remainingCount{ 0 };
+	std::atomic<uint64_t> m_stolenCount{ 0 };
+};
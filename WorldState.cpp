@@ -0,0 +1,84 @@
+#include "WorldState.h"
+#include "BitStream.h"
+#include "Quantization.h"
+
+namespace PMoveWorldState
+{
+
+size_t Write(const SSnapshotConfig& config, const SWorldStatePlayer* pPlayers, uint32_t playerCount, uint8_t* pBuffer, size_t capacity)
+{
+	if (playerCount > MaxPlayers)
+		return 0;
+
+	CBitWriter writer(pBuffer, capacity);
+	writer.WriteVarUint(playerCount);
+	for (uint32_t i = 0; i < playerCount; ++i)
+	{
+		const SWorldStatePlayer& player = pPlayers[i];
+		writer.WriteBits(player.id, 16);
+		writer.WriteBits(PMoveQuantize::QuantizeRange(player.position.x, config.positionMin.x, config.positionMax.x, config.positionBits), config.positionBits);
+		writer.WriteBits(PMoveQuantize::QuantizeRange(player.position.y, config.positionMin.y, config.positionMax.y, config.positionBits), config.positionBits);
+		writer.WriteBits(PMoveQuantize::QuantizeRange(player.position.z, config.positionMin.z, config.positionMax.z, config.positionBits), config.positionBits);
+		writer.WriteBits(PMoveQuantize::QuantizeAngle(player.yaw, config.angleBits), config.angleBits);
+	}
+
+	writer.Flush();
+	return writer.HasOverflowed() ? 0 : writer.GetByteCount();
+}
+
+bool Read(const SSnapshotConfig& config, const uint8_t* pBuffer, size_t size, SWorldStatePlayer* pPlayers, uint32_t& playerCount)
+{
+	CBitReader reader(pBuffer, size);
+	playerCount = reader.ReadVarUint();
+	if (reader.HasOverflowed() || playerCount > MaxPlayers)
+	{
+		playerCount = 0;
+		return false;
+	}
+
+	for (uint32_t i = 0; i < playerCount; ++i)
+	{
+		SWorldStatePlayer& player = pPlayers[i];
+		player.id = static_cast<uint16_t>(reader.ReadBits(16));
+		player.position.x = PMoveQuantize::DequantizeRange(reader.ReadBits(config.positionBits), config.positionMin.x, config.positionMax.x, config.positionBits);
+		player.position.y = PMoveQuantize::DequantizeRange(reader.ReadBits(config.positionBits), config.positionMin.y, config.positionMax.y, config.positionBits);
+		player.position.z = PMoveQuantize::DequantizeRange(reader.ReadBits(config.positionBits), config.positionMin.z, config.positionMax.z, config.positionBits);
+		player.yaw = PMoveQuantize::DequantizeAngle(reader.ReadBits(config.angleBits), config.angleBits);
+	}
+
+	if (reader.HasOverflowed())
+	{
+		playerCount = 0;
+		return false;
+	}
+	return true;
+}
+
+}
+
+void CJoinFanOut::BeginTick()
+{
+	m_playerCount = 0;
+	m_joinCount = 0;
+	m_joinerMessageSize = 0;
+	m_existingMessageSize = 0;
+}
+
+bool CJoinFanOut::AddPlayer(const SWorldStatePlayer& player, bool hasJoined)
+{
+	if (m_playerCount == PMoveWorldState::MaxPlayers)
+		return false;
+
+	m_players[m_playerCount++] = player;
+	if (hasJoined)
+	{
+		m_joiners[m_joinCount++] = player;
+	}
+	return true;
+}
+
+void CJoinFanOut::EndTick()
+{
+	m_joinerMessageSize = PMoveWorldState::Write(m_config, m_players.data(), m_playerCount, m_joinerMessage.data(), m_joinerMessage.size());
+	m_existingMessageSize = m_joinCount > 0 ? PMoveWorldState::Write(m_config, m_joiners.data(), m_joinCount, m_existingMessage.data(), m_existingMessage.size()) : 0;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "MovementSnapshot.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+////////////////////////////////////////////////////////
+// Join fan-out: where every player is, sent once per joining client
+// All players that became ready during a server tick are revived
+// together. Each of them then gets one message with every alive player,
+// and each client that was already playing gets one message with just
+// the newcomers. A full server reconnecting after a map change costs one
+// message per client instead of one per pair of players.
+////////////////////////////////////////////////////////
+
+struct SWorldStatePlayer
+{
+	uint16_t id = 0;                      // Snapshot id, see SSnapshotPlayer
+	PMoveVec3 position;
+	float yaw = 0.f;                      // Players only turn around the up axis
+};
+
+namespace PMoveWorldState
+{
+	static constexpr uint32_t MaxPlayers = PMoveSnapshot::MaxPlayers;
+	// Every player at full precision with the snapshot config's bit widths
+	static constexpr size_t MaxMessageSize = 2048;
+
+	// Returns the number of bytes written, 0 if the buffer was too small
+	size_t Write(const SSnapshotConfig& config, const SWorldStatePlayer* pPlayers, uint32_t playerCount, uint8_t* pBuffer, size_t capacity);
+	// Returns false for malformed messages, pPlayers must hold MaxPlayers
+	bool Read(const SSnapshotConfig& config, const uint8_t* pBuffer, size_t size, SWorldStatePlayer* pPlayers, uint32_t& playerCount);
+}
+
+// Server: collects the alive players of one tick and encodes both messages once for all receivers
+class CJoinFanOut
+{
+public:
+	explicit CJoinFanOut(const SSnapshotConfig& config = SSnapshotConfig()) : m_config(config) {}
+
+	void BeginTick();
+	// Players are written in the order they were added. Returns false once MaxPlayers were added.
+	bool AddPlayer(const SWorldStatePlayer& player, bool hasJoined);
+	void EndTick();
+
+	uint32_t GetPlayerCount() const { return m_playerCount; }
+	uint32_t GetJoinCount() const { return m_joinCount; }
+
+	// Every alive player, for the clients that joined this tick
+	const uint8_t* GetJoinerMessage() const { return m_joinerMessage.data(); }
+	size_t GetJoinerMessageSize() const { return m_joinerMessageSize; }
+	// Only this tick's joiners, for the clients that were already playing. Empty without joins.
+	const uint8_t* GetExistingMessage() const { return m_existingMessage.data(); }
+	size_t GetExistingMessageSize() const { return m_existingMessageSize; }
+
+private:
+	SSnapshotConfig m_config;
+
+	std::array<SWorldStatePlayer, PMoveWorldState::MaxPlayers> m_players;
+	std::array<SWorldStatePlayer, PMoveWorldState::MaxPlayers> m_joiners;
+	uint32_t m_playerCount = 0;
+	uint32_t m_joinCount = 0;
+
+	std::array<uint8_t, PMoveWorldState::MaxMessageSize> m_joinerMessage;
+	std::array<uint8_t, PMoveWorldState::MaxMessageSize> m_existingMessage;
+	size_t m_joinerMessageSize = 0;
+	size_t m_existingMessageSize = 0;
+};